@@ -0,0 +1,49 @@
+# - Find Lz4
+# Find the native Lz4 includes and library
+#
+#  Lz4_INCLUDE_DIR - where to find lz4.h, etc.
+#  Lz4_LIBRARIES   - List of libraries when using Lz4.
+#  Lz4_FOUND       - True if Lz4 found.
+
+
+if (Lz4_INCLUDE_DIR)
+  # Already in cache, be silent
+  set(Lz4_FIND_QUIETLY TRUE)
+endif ()
+
+find_path(Lz4_INCLUDE_DIR lz4.h
+  /opt/local/include
+  /usr/local/include
+  /usr/include
+)
+
+set(Lz4_NAMES lz4)
+find_library(Lz4_LIBRARY
+  NAMES ${Lz4_NAMES}
+  PATHS /usr/lib /usr/local/lib /opt/local/lib
+)
+
+if (Lz4_INCLUDE_DIR AND Lz4_LIBRARY)
+   set(Lz4_FOUND TRUE)
+    set( Lz4_LIBRARIES ${Lz4_LIBRARY} )
+else ()
+   set(Lz4_FOUND FALSE)
+   set( Lz4_LIBRARIES )
+endif ()
+
+if (Lz4_FOUND)
+   if (NOT Lz4_FIND_QUIETLY)
+      message(STATUS "Found Lz4: ${Lz4_LIBRARY}")
+   endif ()
+else ()
+      message(STATUS "Not Found Lz4: ${Lz4_LIBRARY}")
+   if (Lz4_FIND_REQUIRED)
+      message(STATUS "Looked for Lz4 libraries named ${Lz4_NAMES}.")
+      message(FATAL_ERROR "Could NOT find Lz4 library")
+   endif ()
+endif ()
+
+mark_as_advanced(
+  Lz4_LIBRARY
+  Lz4_INCLUDE_DIR
+  )
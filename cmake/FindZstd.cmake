@@ -0,0 +1,49 @@
+# - Find Zstd
+# Find the native Zstd includes and library
+#
+#  Zstd_INCLUDE_DIR - where to find zstd.h, etc.
+#  Zstd_LIBRARIES   - List of libraries when using Zstd.
+#  Zstd_FOUND       - True if Zstd found.
+
+
+if (Zstd_INCLUDE_DIR)
+  # Already in cache, be silent
+  set(Zstd_FIND_QUIETLY TRUE)
+endif ()
+
+find_path(Zstd_INCLUDE_DIR zstd.h
+  /opt/local/include
+  /usr/local/include
+  /usr/include
+)
+
+set(Zstd_NAMES zstd)
+find_library(Zstd_LIBRARY
+  NAMES ${Zstd_NAMES}
+  PATHS /usr/lib /usr/local/lib /opt/local/lib
+)
+
+if (Zstd_INCLUDE_DIR AND Zstd_LIBRARY)
+   set(Zstd_FOUND TRUE)
+    set( Zstd_LIBRARIES ${Zstd_LIBRARY} )
+else ()
+   set(Zstd_FOUND FALSE)
+   set( Zstd_LIBRARIES )
+endif ()
+
+if (Zstd_FOUND)
+   if (NOT Zstd_FIND_QUIETLY)
+      message(STATUS "Found Zstd: ${Zstd_LIBRARY}")
+   endif ()
+else ()
+      message(STATUS "Not Found Zstd: ${Zstd_LIBRARY}")
+   if (Zstd_FIND_REQUIRED)
+      message(STATUS "Looked for Zstd libraries named ${Zstd_NAMES}.")
+      message(FATAL_ERROR "Could NOT find Zstd library")
+   endif ()
+endif ()
+
+mark_as_advanced(
+  Zstd_LIBRARY
+  Zstd_INCLUDE_DIR
+  )
@@ -83,6 +83,20 @@ namespace Hypertable {
       return false;
     }
 
+    /** Returns the command of the request message and the time it arrived
+     * (see Event#arrival_time), or false if this handler does not carry a
+     * request with an arrival time.
+     */
+    bool get_request_arrival(uint64_t *commandp, int64_t *arrival_timep) {
+      if (!m_event_ptr || m_event_ptr->type != Event::MESSAGE ||
+          m_event_ptr->arrival_time == 0 ||
+          (m_event_ptr->header.flags & CommHeader::FLAGS_BIT_REQUEST) == 0)
+        return false;
+      *commandp = m_event_ptr->header.command;
+      *arrival_timep = m_event_ptr->arrival_time;
+      return true;
+    }
+
     bool expired() {
       if (m_event_ptr && m_event_ptr->type == Event::MESSAGE &&
           ReactorRunner::ms_record_arrival_clocks) {
@@ -23,7 +23,8 @@
 #define HYPERTABLE_APPLICATIONQUEUE_H
 
 #include <cassert>
-#include <list>
+#include <deque>
+#include <vector>
 
 #include <boost/thread/condition.hpp>
 
@@ -33,8 +34,10 @@
 #include "Common/HashMap.h"
 #include "Common/ReferenceCount.h"
 #include "Common/StringExt.h"
+#include "Common/atomic.h"
 
 #include "ApplicationHandler.h"
+#include "LatencyStats.h"
 
 namespace Hypertable {
 
@@ -42,133 +45,270 @@ namespace Hypertable {
    * Provides application work queue and worker threads.  It maintains a queue
    * of requests and a pool of threads that pull requests off the queue and
    * carry them out.
+   *
+   * Each worker has its own request deque, requests are spread over them
+   * round robin and a worker whose deque is empty steals from the others.
+   * Requests of the same thread group never run at the same time.  The
+   * ordinary ones are chained behind each other, only the oldest one of a
+   * group sits in a deque, so no worker ever has to skip over requests it
+   * isn't allowed to run.  Urgent requests go into a separate deque that
+   * is served first and keeps being served while the queue is stopped.
+   * They bypass the chain of their group, as they always have, and only
+   * wait for a request of the group that is actually running: a request
+   * picked up while another one of its group runs is parked with the
+   * group and dispatched again once that one completes.
    */
   class ApplicationQueue : public ReferenceCount {
 
-    class UsageRec {
-    public:
-      UsageRec() : thread_group(0), running(false), outstanding(1) { return; }
-      uint64_t thread_group;
-      bool     running;
-      int      outstanding;
-    };
-
-    typedef hash_map<uint64_t, UsageRec *> UsageRecMap;
+    class GroupRec;
 
     class WorkRec {
     public:
-      WorkRec(ApplicationHandler *ah) : handler(ah), usage(0) { return; }
+      WorkRec(ApplicationHandler *ah) : handler(ah), group(0), seq(0),
+                                        urgent(false) {
+        return;
+      }
       ~WorkRec() { delete handler; }
       ApplicationHandler   *handler;
-      UsageRec             *usage;
+      GroupRec             *group;
+      uint64_t              seq;
+      bool                  urgent;
+    };
+
+    typedef std::deque<WorkRec *> WorkQueue;
+
+    /**
+     * State of one thread group, which exists as long as one of its
+     * requests is outstanding.  <code>head</code> is the ordinary request
+     * that has been dispatched, the ordinary requests behind it wait in
+     * <code>pending</code>.  Requests picked up while another one of the
+     * group was running wait in <code>parked</code>, in arrival order.
+     */
+    class GroupRec {
+    public:
+      GroupRec(uint64_t tg) : thread_group(tg), head(0), outstanding(0),
+                              next_seq(0), running(false) { return; }
+      uint64_t   thread_group;
+      WorkRec   *head;
+      WorkQueue  pending;
+      WorkQueue  parked;
+      size_t     outstanding;
+      uint64_t   next_seq;
+      bool       running;
     };
 
-    typedef std::list<WorkRec *> WorkQueue;
+    typedef hash_map<uint64_t, GroupRec *> GroupRecMap;
+
+    class WorkerQueue {
+    public:
+      Mutex      mutex;
+      WorkQueue  queue;
+    };
 
     class ApplicationQueueState {
     public:
-      ApplicationQueueState() : shutdown(false), paused(false) { return; }
-      WorkQueue           queue;
-      WorkQueue           urgent_queue;
-      UsageRecMap         usage_map;
-      Mutex               queue_mutex;
-      Mutex               usage_mutex;
+      ApplicationQueueState() : shutdown(false), paused(false) {
+        atomic_set(&idle, 0);
+        atomic_set(&queued, 0);
+        atomic_set(&urgent_queued, 0);
+        atomic_set(&next_worker, 0);
+      }
+      ~ApplicationQueueState() {
+        for (size_t i=0; i<worker_queues.size(); i++)
+          delete worker_queues[i];
+      }
+      std::vector<WorkerQueue *> worker_queues;
+      WorkerQueue         urgent_queue;
+      GroupRecMap         group_map;
+      Mutex               group_mutex;
+      Mutex               mutex;
       boost::condition    cond;
       bool                shutdown;
       bool                paused;
+      atomic_t            idle;
+      atomic_t            queued;
+      atomic_t            urgent_queued;
+      atomic_t            next_worker;
     };
 
+    /**
+     * Puts a request that is allowed to run into a dispatch deque and wakes
+     * up an idle worker, if there is one.
+     */
+    static void dispatch(ApplicationQueueState &state, WorkRec *rec) {
+      if (rec->urgent) {
+        {
+          ScopedLock lock(state.urgent_queue.mutex);
+          state.urgent_queue.queue.push_back(rec);
+        }
+        atomic_inc(&state.urgent_queued);
+      }
+      else {
+        size_t i = (unsigned)atomic_inc_return(&state.next_worker)
+                   % state.worker_queues.size();
+        {
+          ScopedLock lock(state.worker_queues[i]->mutex);
+          state.worker_queues[i]->queue.push_back(rec);
+        }
+        atomic_inc(&state.queued);
+      }
+      // a worker going to sleep increments idle before it rechecks the
+      // counters, so either it sees the request or we see it idle
+      if (atomic_read(&state.idle)) {
+        ScopedLock lock(state.mutex);
+        state.cond.notify_one();
+      }
+    }
+
+    /**
+     * Marks the group of a request that is about to run as running.  If
+     * another request of the group is running, the request is parked with
+     * the group instead and false is returned.
+     */
+    static bool claim(ApplicationQueueState &state, WorkRec *rec) {
+      if (rec->group == 0)
+        return true;
+
+      ScopedLock lock(state.group_mutex);
+      GroupRec *group = rec->group;
+
+      if (group->running) {
+        WorkQueue::iterator iter = group->parked.begin();
+        while (iter != group->parked.end() && (*iter)->seq < rec->seq)
+          ++iter;
+        group->parked.insert(iter, rec);
+        return false;
+      }
+      group->running = true;
+      return true;
+    }
+
+    /**
+     * Finishes a request.  If it ran, the requests of its group parked in
+     * the meantime are dispatched again, and if it was the head of the
+     * group's chain, the next request of the chain is dispatched.
+     */
+    static void complete(ApplicationQueueState &state, WorkRec *rec,
+                         bool ran) {
+      WorkQueue next;
+
+      if (rec->group) {
+        ScopedLock lock(state.group_mutex);
+        GroupRec *group = rec->group;
+        if (ran) {
+          group->running = false;
+          next.swap(group->parked);
+        }
+        if (group->head == rec) {
+          group->head = 0;
+          if (!group->pending.empty()) {
+            group->head = group->pending.front();
+            group->pending.pop_front();
+            next.push_back(group->head);
+          }
+        }
+        if (--group->outstanding == 0) {
+          state.group_map.erase(group->thread_group);
+          delete group;
+        }
+      }
+
+      delete rec;
+
+      foreach(WorkRec *next_rec, next)
+        dispatch(state, next_rec);
+    }
+
     class Worker {
 
     public:
-      Worker(ApplicationQueueState &qstate) : m_state(qstate) { return; }
+      Worker(ApplicationQueueState &qstate, size_t id)
+        : m_state(qstate), m_id(id) { return; }
 
       void operator()() {
-        WorkRec *rec = 0;
-        WorkQueue::iterator iter;
+        WorkRec *rec;
 
         while (true) {
 
-          {  // !!! maybe ditch this block specifier
-            ScopedLock lock(m_state.queue_mutex);
-
-            while ((m_state.paused || m_state.queue.empty()) &&
-                   m_state.urgent_queue.empty()) {
-              if (m_state.shutdown)
+          if ((rec = next_request()) == 0) {
+            ScopedLock lock(m_state.mutex);
+            atomic_inc(&m_state.idle);
+            while ((m_state.paused || atomic_read(&m_state.queued) == 0) &&
+                   atomic_read(&m_state.urgent_queued) == 0) {
+              if (m_state.shutdown) {
+                atomic_dec(&m_state.idle);
                 return;
-              m_state.cond.wait(lock);
-            }
-
-            {
-              ScopedLock ulock(m_state.usage_mutex);
-
-              rec = 0;
-
-              iter = m_state.urgent_queue.begin();
-              while (iter != m_state.urgent_queue.end()) {
-                rec = (*iter);
-                if (rec->handler->expired()) {
-                  iter = m_state.urgent_queue.erase(iter);
-                  continue;
-                }
-                if (rec->usage == 0 || !rec->usage->running) {
-                  if (rec->usage)
-                    rec->usage->running = true;
-                  m_state.urgent_queue.erase(iter);
-                  break;
-                }
-                rec = 0;
-                iter++;
               }
-
-              if (rec == 0 && !m_state.paused) {
-                iter = m_state.queue.begin();
-                while (iter != m_state.queue.end()) {
-                  rec = (*iter);
-                  if (rec->handler->expired()) {
-                    iter = m_state.queue.erase(iter);
-                    continue;
-                  }
-                  if (rec->usage == 0 || !rec->usage->running) {
-                    if (rec->usage)
-                      rec->usage->running = true;
-                    m_state.queue.erase(iter);
-                    break;
-                  }
-                  rec = 0;
-                  iter++;
-                }
-              }
-            }
-            if (rec == 0) {
-              if (m_state.shutdown)
-                return;
               m_state.cond.wait(lock);
-              if (m_state.shutdown)
-                return;
             }
+            atomic_dec(&m_state.idle);
+            continue;
           }
 
-          if (rec) {
-            rec->handler->run();
-            if (rec->usage) {
-              ScopedLock ulock(m_state.usage_mutex);
-              rec->usage->running = false;
-              rec->usage->outstanding--;
-              if (rec->usage->outstanding == 0) {
-                m_state.usage_map.erase(rec->usage->thread_group);
-                delete rec->usage;
-              }
-            }
-            delete rec;
+          if (rec->handler->expired()) {
+            complete(m_state, rec, false);
+            continue;
           }
-        }
 
-        HT_INFO("thread exit");
+          if (!claim(m_state, rec))
+            continue;
+
+          uint64_t command;
+          int64_t arrival_time, start_time = 0;
+          if (LatencyStats::ms_enabled &&
+              rec->handler->get_request_arrival(&command, &arrival_time)) {
+            start_time = LatencyStats::now_micros();
+            LatencyStats::record(LatencyStats::QUEUE_WAIT, command,
+                                 start_time - arrival_time);
+          }
+
+          rec->handler->run();
+
+          if (start_time)
+            LatencyStats::record(LatencyStats::SERVICE_TIME, command,
+                                 LatencyStats::now_micros() - start_time);
+          complete(m_state, rec, true);
+        }
       }
 
     private:
+
+      WorkRec *pop(WorkerQueue *wq, atomic_t *count) {
+        WorkRec *rec;
+        ScopedLock lock(wq->mutex);
+        if (wq->queue.empty())
+          return 0;
+        rec = wq->queue.front();
+        wq->queue.pop_front();
+        atomic_dec(count);
+        return rec;
+      }
+
+      /**
+       * Returns the next request to run: urgent requests first, then the
+       * worker's own deque, then the oldest request of another worker.
+       */
+      WorkRec *next_request() {
+        std::vector<WorkerQueue *> &queues = m_state.worker_queues;
+        WorkRec *rec;
+
+        if (atomic_read(&m_state.urgent_queued) &&
+            (rec = pop(&m_state.urgent_queue, &m_state.urgent_queued)))
+          return rec;
+
+        if (m_state.paused || atomic_read(&m_state.queued) == 0)
+          return 0;
+
+        for (size_t i=0; i<queues.size(); i++) {
+          if ((rec = pop(queues[(m_id + i) % queues.size()],
+                         &m_state.queued)))
+            return rec;
+        }
+        return 0;
+      }
+
       ApplicationQueueState &m_state;
+      size_t m_id;
     };
 
     Mutex                  m_mutex;
@@ -185,11 +325,11 @@ namespace Hypertable {
      * @param worker_count number of worker threads to create
      */
     ApplicationQueue(int worker_count) : joined(false) {
-      Worker Worker(m_state);
       assert (worker_count > 0);
       for (int i=0; i<worker_count; ++i)
-        m_threads.create_thread(Worker);
-      //threads
+        m_state.worker_queues.push_back(new WorkerQueue());
+      for (int i=0; i<worker_count; ++i)
+        m_threads.create_thread(Worker(m_state, i));
     }
 
     ~ApplicationQueue() {
@@ -205,6 +345,7 @@ namespace Hypertable {
      * completion of the shutdown.
      */
     void shutdown() {
+      ScopedLock lock(m_state.mutex);
       m_state.shutdown = true;
       m_state.cond.notify_all();
     }
@@ -223,12 +364,12 @@ namespace Hypertable {
     }
 
     void stop() {
-      ScopedLock lock(m_state.queue_mutex);
+      ScopedLock lock(m_state.mutex);
       m_state.paused = true;
     }
 
     void start() {
-      ScopedLock lock(m_state.queue_mutex);
+      ScopedLock lock(m_state.mutex);
       m_state.paused = false;
       m_state.cond.notify_all();
     }
@@ -241,35 +382,40 @@ namespace Hypertable {
      * object
      */
     void add(ApplicationHandler *app_handler) {
-      UsageRecMap::iterator uiter;
-      uint64_t thread_group = app_handler->get_thread_group();
-      WorkRec *rec = new WorkRec(app_handler);
-      rec->usage = 0;
+      GroupRecMap::iterator giter;
+      uint64_t thread_group;
+      WorkRec *rec;
 
       HT_ASSERT(app_handler);
 
+      thread_group = app_handler->get_thread_group();
+      rec = new WorkRec(app_handler);
+      rec->urgent = app_handler->is_urgent();
+
       if (thread_group != 0) {
-        ScopedLock ulock(m_state.usage_mutex);
-        if ((uiter = m_state.usage_map.find(thread_group))
-            != m_state.usage_map.end()) {
-          rec->usage = (*uiter).second;
-          rec->usage->outstanding++;
-        }
+        ScopedLock lock(m_state.group_mutex);
+        if ((giter = m_state.group_map.find(thread_group))
+            != m_state.group_map.end())
+          rec->group = (*giter).second;
         else {
-          rec->usage = new UsageRec();
-          rec->usage->thread_group = thread_group;
-          m_state.usage_map[thread_group] = rec->usage;
+          rec->group = new GroupRec(thread_group);
+          m_state.group_map[thread_group] = rec->group;
+        }
+        rec->group->outstanding++;
+        rec->seq = rec->group->next_seq++;
+
+        // ordinary requests run once the ones ahead of them are done,
+        // urgent ones skip the chain
+        if (!rec->urgent) {
+          if (rec->group->head) {
+            rec->group->pending.push_back(rec);
+            return;
+          }
+          rec->group->head = rec;
         }
       }
 
-      {
-        ScopedLock lock(m_state.queue_mutex);
-        if (app_handler->is_urgent())
-          m_state.urgent_queue.push_back(rec);
-        else
-          m_state.queue.push_back(rec);
-        m_state.cond.notify_one();
-      }
+      dispatch(m_state, rec);
     }
   };
 
@@ -55,6 +55,8 @@ extern "C" {
 #include "Comm.h"
 #include "IOHandlerAccept.h"
 #include "IOHandlerData.h"
+#include "LocalSocket.h"
+#include "PayloadCodec.h"
 
 using namespace Hypertable;
 
@@ -71,11 +73,12 @@ Comm::Comm() {
   }
 
 #if defined(__linux__)
-  if (System::os_info().version_major < 2 ||
-      System::os_info().version_minor < 6 ||
-      (System::os_info().version_major == 2 &&
-       System::os_info().version_minor == 6 &&
-       System::os_info().version_micro < 17))
+  if (!ReactorFactory::ms_use_io_uring &&
+      (System::os_info().version_major < 2 ||
+       System::os_info().version_minor < 6 ||
+       (System::os_info().version_major == 2 &&
+        System::os_info().version_minor == 6 &&
+        System::os_info().version_micro < 17)))
     ReactorFactory::ms_epollet = false;
 #endif
 
@@ -115,6 +118,11 @@ Comm::connect(struct sockaddr_in &addr,
   if (m_handler_map_ptr->contains_handler(addr))
     return Error::COMM_ALREADY_CONNECTED;
 
+  // Peers on this host are reached through their Unix-domain socket
+  if (LocalSocket::ms_enabled && LocalSocket::is_local(addr) &&
+      (sd = LocalSocket::connect(addr.sin_port)) >= 0)
+    return connect_local_socket(sd, addr, default_handler_ptr);
+
   if ((sd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
     HT_ERRORF("socket: %s", strerror(errno));
     return Error::COMM_SOCKET_ERROR;
@@ -198,12 +206,18 @@ Comm::listen(struct sockaddr_in &addr, ConnectionHandlerFactoryPtr &chf_ptr,
                                                  m_handler_map_ptr, chf_ptr);
   m_handler_map_ptr->insert_handler(accept_handler);
   accept_handler->start_polling();
+
+  if (LocalSocket::ms_enabled)
+    listen_local(accept_handler->get_local_address().sin_port, chf_ptr,
+                 default_handler_ptr);
 }
 
 
 int
 Comm::send_request(const sockaddr_in &addr, uint32_t timeout_ms,
                    CommBufPtr &cbuf_ptr, DispatchHandler *resp_handler) {
+  compress_payload(addr, cbuf_ptr, true);
+
   ScopedLock lock(ms_mutex);
   IOHandlerDataPtr data_handler;
   int error = Error::OK;
@@ -236,6 +250,8 @@ Comm::send_request(const sockaddr_in &addr, uint32_t timeout_ms,
 
 
 int Comm::send_response(struct sockaddr_in &addr, CommBufPtr &cbuf_ptr) {
+  compress_payload(addr, cbuf_ptr, false);
+
   ScopedLock lock(ms_mutex);
   IOHandlerDataPtr data_handler;
   int error = Error::OK;
@@ -390,6 +406,45 @@ int Comm::close_socket(struct sockaddr_in &addr) {
  *  ----- Private methods -----
  */
 
+void
+Comm::listen_local(uint16_t port, ConnectionHandlerFactoryPtr &chf_ptr,
+                   DispatchHandlerPtr &default_handler_ptr) {
+  IOHandlerPtr handler;
+  IOHandlerAccept *accept_handler;
+  struct sockaddr_in key;
+  String path;
+  int sd;
+
+  if ((sd = LocalSocket::listen(port, path)) < 0)
+    return;
+
+  LocalSocket::next_peer_address(&key);
+
+  handler = accept_handler = new IOHandlerAccept(sd, key, default_handler_ptr,
+                                                 m_handler_map_ptr, chf_ptr);
+  accept_handler->set_local_path(path);
+  m_handler_map_ptr->insert_handler(accept_handler);
+  accept_handler->start_polling();
+}
+
+
+int
+Comm::connect_local_socket(int sd, struct sockaddr_in &addr,
+                           DispatchHandlerPtr &default_handler_ptr) {
+  IOHandlerPtr handler;
+  IOHandlerData *data_handler;
+
+  handler = data_handler = new IOHandlerData(sd, addr, default_handler_ptr);
+  m_handler_map_ptr->insert_handler(data_handler);
+
+  // CONNECTION_ESTABLISHED is delivered on the first write readiness
+  data_handler->start_polling();
+  data_handler->add_poll_interest(Reactor::READ_READY|Reactor::WRITE_READY);
+
+  return Error::OK;
+}
+
+
 int
 Comm::connect_socket(int sd, struct sockaddr_in &addr,
                      DispatchHandlerPtr &default_handler_ptr) {
@@ -432,3 +487,22 @@ Comm::connect_socket(int sd, struct sockaddr_in &addr,
 
   return Error::OK;
 }
+
+
+/**
+ * Compresses the payload outside of ms_mutex, so that large messages
+ * don't hold up sends on other connections.
+ */
+void Comm::compress_payload(const sockaddr_in &addr, CommBufPtr &cbuf_ptr,
+                            bool request) {
+  bool peer_accepts = false;
+
+  if (PayloadCodec::ms_codec) {
+    ScopedLock lock(ms_mutex);
+    IOHandlerDataPtr data_handler;
+    if (m_handler_map_ptr->lookup_data_handler(addr, data_handler))
+      peer_accepts = data_handler->peer_accepts_compression();
+  }
+
+  PayloadCodec::compress(cbuf_ptr.get(), request, peer_accepts);
+}
@@ -57,7 +57,9 @@ namespace Hypertable {
      * and associates with it a default dispatch handler.
      * CONNECTION_ESTABLISHED and DISCONNECT events are delivered to the
      * default dispatch handler.  The argument addr is used to subsequently
-     * refer to the connection.
+     * refer to the connection.  If addr belongs to this host and the peer
+     * listens on a Unix-domain socket (see LocalSocket), that socket is used
+     * instead of TCP.
      *
      * @param addr IP address and port to connect to
      * @param default_handler_ptr smart pointer to default dispatch handler
@@ -95,7 +97,8 @@ namespace Hypertable {
      * assigned dispatch handlers by invoking the get_instance method of the
      * connection handler factory supplied as the chf_ptr argument.
      * CONNECTION_ESTABLISHED events are logged, but not delivered to the
-     * application
+     * application.  Unless disabled with Comm.LocalSocket.Enable, a
+     * Unix-domain socket for the same port is opened for local clients.
      *
      * @param addr IP address and port to listen for connection on
      * @param chf_ptr connection handler factory smart pointer
@@ -262,6 +265,15 @@ namespace Hypertable {
     int connect_socket(int sd, struct sockaddr_in &addr,
                        DispatchHandlerPtr &default_handler_ptr);
 
+    int connect_local_socket(int sd, struct sockaddr_in &addr,
+                             DispatchHandlerPtr &default_handler_ptr);
+
+    void listen_local(uint16_t port, ConnectionHandlerFactoryPtr &chf_ptr,
+                      DispatchHandlerPtr &default_handler_ptr);
+
+    void compress_payload(const sockaddr_in &addr, CommBufPtr &cbuf_ptr,
+                          bool request);
+
     static atomic_t ms_next_request_id;
 
     static Mutex   ms_mutex;
@@ -261,6 +261,7 @@ namespace Hypertable {
 
     friend class IOHandlerData;
     friend class IOHandlerDatagram;
+    friend class PayloadCodec;
 
     StaticBuffer data;
     StaticBuffer ext;
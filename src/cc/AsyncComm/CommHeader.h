@@ -35,11 +35,17 @@ namespace Hypertable {
     static const uint16_t FLAGS_BIT_REQUEST          = 0x0001;
     static const uint16_t FLAGS_BIT_IGNORE_RESPONSE  = 0x0002;
     static const uint16_t FLAGS_BIT_URGENT           = 0x0004;
+    static const uint16_t FLAGS_BIT_COMPRESSED       = 0x0008;
+    static const uint16_t FLAGS_BIT_ACCEPTS_COMPRESSION = 0x0010;
+    static const uint16_t FLAGS_BIT_RESPONSE_ACCEPTS_COMPRESSION = 0x0020;
     static const uint16_t FLAGS_BIT_PAYLOAD_CHECKSUM = 0x8000;
 
     static const uint16_t FLAGS_MASK_REQUEST          = 0xFFFE;
     static const uint16_t FLAGS_MASK_IGNORE_RESPONSE  = 0xFFFD;
     static const uint16_t FLAGS_MASK_URGENT           = 0xFFFB;
+    static const uint16_t FLAGS_MASK_COMPRESSED       = 0xFFF7;
+    static const uint16_t FLAGS_MASK_ACCEPTS_COMPRESSION = 0xFFEF;
+    static const uint16_t FLAGS_MASK_RESPONSE_ACCEPTS_COMPRESSION = 0xFFDF;
     static const uint16_t FLAGS_MASK_PAYLOAD_CHECKSUM = 0x7FFF;
 
     CommHeader()
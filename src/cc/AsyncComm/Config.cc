@@ -22,6 +22,10 @@
 #include "Common/Compat.h"
 #include <fstream>
 #include "Config.h"
+#include "LatencyStats.h"
+#include "LocalSocket.h"
+#include "InflateQueue.h"
+#include "PayloadCodec.h"
 #include "ReactorFactory.h"
 
 namespace Hypertable { namespace Config {
@@ -47,6 +51,13 @@ void init_comm() {
   if (!has("reactors"))
     properties->add("reactors", reactors);
 
+  ReactorFactory::ms_receive_pool_size =
+      get_i64("Comm.ReceiveBufferPool.MaxSize");
+  LocalSocket::ms_enabled = get_bool("Comm.LocalSocket.Enable");
+  LatencyStats::ms_enabled = get_bool("Comm.LatencyHistograms");
+  LocalSocket::ms_dir = get_str("Comm.LocalSocket.Dir");
+  PayloadCodec::ms_threshold = get_i32("Comm.Compression.MinSize");
+  InflateQueue::ms_thread_count = get_i32("Comm.Compression.InflateThreads");
   ReactorFactory::initialize(reactors);
 }
 
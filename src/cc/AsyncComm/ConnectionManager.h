@@ -51,6 +51,8 @@ namespace Hypertable {
    * Establishes and maintains a set of TCP connections.  If any of the
    * connections gets broken, then this class will continuously attempt
    * to re-establish the connection, pausing for a while in between attempts.
+   * Connections to servers on the same host go over their Unix-domain
+   * socket when one is available (see Comm::connect).
    */
   class ConnectionManager : public DispatchHandler {
 
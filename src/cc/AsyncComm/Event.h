@@ -25,6 +25,7 @@
 #include <iostream>
 #include <time.h>
 
+#include "Common/BufferPool.h"
 #include "Common/InetAddr.h"
 #include "Common/String.h"
 #include "Common/ReferenceCount.h"
@@ -50,7 +51,7 @@ namespace Hypertable {
      */
     Event(Type ct, const sockaddr_in &a, int err = 0)
       : type(ct), addr(a), error(err), payload(0), payload_len(0),
-        thread_group(0) { }
+        thread_group(0), arrival_time(0) { }
 
     /** Initializes the event object.
      *
@@ -58,12 +59,16 @@ namespace Hypertable {
      * @param err error code associated with this event
      */
     Event(Type ct, int err=0) : type(ct), error(err), payload(0),
-        payload_len(0), thread_group(0) { }
+        payload_len(0), thread_group(0), arrival_time(0) { }
 
-    /** Destroys event.  Deallocates message data
+    /** Destroys event.  Deallocates message data, or returns it to
+     * payload_pool if it came from one.
      */
     ~Event() {
-      delete [] payload;
+      if (payload_pool)
+        payload_pool->release((uint8_t *)payload, payload_len);
+      else
+        delete [] payload;
     }
 
     /** Loads header object from serialized buffer.  This method
@@ -107,6 +112,9 @@ namespace Hypertable {
     /** Length of the message */
     size_t payload_len;
 
+    /** Pool from which the payload was allocated, if any */
+    BufferPoolPtr payload_pool;
+
     /** Thread group to which this message belongs.  Used to serialize
      * messages destined for the same object.  This value is created in
      * the constructor and is the combination of the socked descriptor from
@@ -121,6 +129,10 @@ namespace Hypertable {
     /** time (clock ticks) when message arrived **/
     clock_t arrival_clocks;
 
+    /** Monotonic time (microseconds) when the message header was read, or
+     * zero if latency recording is disabled (see LatencyStats) */
+    int64_t arrival_time;
+
     /** Generates a one-line string representation of the event.  For example:
      * <pre>
      *   Event: type=MESSAGE id=2 gid=0 header_len=16 total_len=20 \
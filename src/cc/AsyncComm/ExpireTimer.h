@@ -33,12 +33,6 @@ namespace Hypertable {
     DispatchHandler  *handler;
   };
 
-  struct LtTimer {
-    bool operator()(const ExpireTimer &t1, const ExpireTimer &t2) const {
-      return xtime_cmp(t1.expire_time, t2.expire_time) >= 0;
-    }
-  };
-
 }
 
 #endif // HYPERTABLE_ExpireTimer_H
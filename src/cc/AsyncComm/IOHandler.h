@@ -60,8 +60,13 @@ namespace Hypertable {
       : m_free_flag(0), m_addr(addr), m_sd(sd), m_dispatch_handler_ptr(dhp) {
       ReactorFactory::get_reactor(m_reactor_ptr);
       m_poll_interest = 0;
+      m_poll_id = 0;
       socklen_t namelen = sizeof(m_local_addr);
       getsockname(m_sd, (sockaddr *)&m_local_addr, &namelen);
+      // Unix-domain sockets have no IP address of their own
+      m_local_socket = m_local_addr.sin_family == AF_UNIX;
+      if (m_local_socket)
+        memset(&m_local_addr, 0, sizeof(m_local_addr));
       memset(&m_alias, 0, sizeof(m_alias));
     }
 
@@ -110,14 +115,17 @@ namespace Hypertable {
       }
     }
 
-    void start_polling() {
+    virtual void start_polling() {
 #if defined(__APPLE__)
       add_poll_interest(Reactor::READ_READY);
 #elif defined(__linux__)
       struct epoll_event event;
       memset(&event, 0, sizeof(struct epoll_event));
       event.data.ptr = this;
-      if (ReactorFactory::ms_epollet) {
+      if (m_reactor_ptr->uring)
+        m_poll_id = m_reactor_ptr->uring->add(this, m_sd,
+                                              EPOLLIN | EPOLLOUT | POLLRDHUP);
+      else if (ReactorFactory::ms_epollet) {
         event.events = EPOLLIN | EPOLLOUT | POLLRDHUP | EPOLLET;
         if (epoll_ctl(m_reactor_ptr->poll_fd, EPOLL_CTL_ADD, m_sd, &event)
             < 0) {
@@ -162,6 +170,10 @@ namespace Hypertable {
 
     int get_sd() { return m_sd; }
 
+    bool is_local_socket() { return m_local_socket; }
+
+    uint64_t get_poll_id() { return m_poll_id; }
+
     void get_reactor(ReactorPtr &reactor_ptr) { reactor_ptr = m_reactor_ptr; }
 
     void shutdown() {
@@ -180,7 +192,9 @@ namespace Hypertable {
       remove_poll_interest(Reactor::READ_READY|Reactor::WRITE_READY);
 #elif defined(__linux__)
       struct epoll_event event;  // this is necessary for < Linux 2.6.9
-      if (epoll_ctl(m_reactor_ptr->poll_fd, EPOLL_CTL_DEL, m_sd, &event) < 0) {
+      if (m_reactor_ptr->uring)
+        m_reactor_ptr->uring->remove(m_poll_id);
+      else if (epoll_ctl(m_reactor_ptr->poll_fd, EPOLL_CTL_DEL, m_sd, &event) < 0) {
         HT_ERRORF("epoll_ctl(%d, EPOLL_CTL_DEL, %d) failed : %s",
                      m_reactor_ptr->poll_fd, m_sd, strerror(errno));
         exit(1);
@@ -197,6 +211,8 @@ namespace Hypertable {
     DispatchHandlerPtr  m_dispatch_handler_ptr;
     ReactorPtr          m_reactor_ptr;
     int                 m_poll_interest;
+    uint64_t            m_poll_id;
+    bool                m_local_socket;
 
 #if defined(__APPLE__)
     void display_event(struct kevent *event);
@@ -38,6 +38,7 @@ extern "C" {
 #include "HandlerMap.h"
 #include "IOHandlerAccept.h"
 #include "IOHandlerData.h"
+#include "LocalSocket.h"
 #include "ReactorFactory.h"
 using namespace Hypertable;
 
@@ -66,12 +67,13 @@ bool IOHandlerAccept::handle_event(struct epoll_event *event, clock_t ) {
 bool IOHandlerAccept::handle_incoming_connection() {
   int sd;
   struct sockaddr_in addr;
-  socklen_t addr_len = sizeof(sockaddr_in);
+  socklen_t addr_len;
   int one = 1;
   IOHandlerData *data_handler;
 
   while (true) {
 
+    addr_len = sizeof(sockaddr_in);
     if ((sd = accept(m_sd, (struct sockaddr *)&addr, &addr_len)) < 0) {
       if (errno == EAGAIN)
         break;
@@ -85,8 +87,10 @@ bool IOHandlerAccept::handle_incoming_connection() {
     // Set to non-blocking
     FileUtils::set_flags(sd, O_NONBLOCK);
 
+    if (m_local_socket)
+      LocalSocket::next_peer_address(&addr);
 #if defined(__linux__)
-    if (setsockopt(sd, SOL_TCP, TCP_NODELAY, &one, sizeof(one)) < 0)
+    else if (setsockopt(sd, SOL_TCP, TCP_NODELAY, &one, sizeof(one)) < 0)
       HT_WARNF("setsockopt(TCP_NODELAY) failure: %s", strerror(errno));
 #elif defined(__APPLE__)
     if (setsockopt(sd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one)) < 0)
@@ -23,6 +23,12 @@
 #ifndef HYPERTABLE_IOHANDLERACCEPT_H
 #define HYPERTABLE_IOHANDLERACCEPT_H
 
+extern "C" {
+#include <unistd.h>
+}
+
+#include "Common/String.h"
+
 #include "HandlerMap.h"
 #include "IOHandler.h"
 #include "ConnectionHandlerFactory.h"
@@ -44,9 +50,13 @@ namespace Hypertable {
     }
 
     virtual ~IOHandlerAccept() {
-      return;
+      if (!m_local_path.empty())
+        unlink(m_local_path.c_str());
     }
 
+    /** Records the Unix-domain socket file to remove on destruction */
+    void set_local_path(const String &path) { m_local_path = path; }
+
 #if defined(__APPLE__)
     virtual bool handle_event(struct kevent *event, clock_t arrival_clocks);
 #elif defined(__linux__)
@@ -61,6 +71,7 @@ namespace Hypertable {
   private:
     HandlerMapPtr m_handler_map_ptr;
     ConnectionHandlerFactoryPtr m_handler_factory_ptr;
+    String m_local_path;
   };
 
   typedef intrusive_ptr<IOHandlerAccept> IOHandlerAcceptPtr;
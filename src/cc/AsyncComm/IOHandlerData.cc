@@ -21,6 +21,7 @@
 
 #include "Common/Compat.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 using namespace std;
@@ -28,6 +29,8 @@ using namespace std;
 extern "C" {
 #include <arpa/inet.h>
 #include <errno.h>
+#include <limits.h>
+#include <sys/uio.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #if defined(__APPLE__)
@@ -41,8 +44,20 @@ extern "C" {
 #include "Common/Time.h"
 
 #include "IOHandlerData.h"
+#include "InflateQueue.h"
+#include "LatencyStats.h"
+#include "PayloadCodec.h"
 using namespace Hypertable;
 
+namespace {
+  /** Most iovecs handed to a single send call */
+#if defined(IOV_MAX) && IOV_MAX < 1024
+  const int SEND_IOV_MAX = IOV_MAX;
+#else
+  const int SEND_IOV_MAX = 1024;
+#endif
+}
+
 #if defined(__linux__)
 
 namespace {
@@ -83,11 +98,12 @@ namespace {
   }
 
   ssize_t
-  et_socket_writev(int fd, const iovec *vector, int count, int *errnop) {
+  et_socket_sendmsg(int fd, const struct msghdr *msg, int flags,
+                    int *errnop) {
     ssize_t nwritten;
-    while ((nwritten = ::writev(fd, vector, count)) <= 0) {
+    while ((nwritten = ::sendmsg(fd, msg, flags)) <= 0) {
       if (errno == EINTR) {
-        nwritten = 0; /* and call write() again */
+        nwritten = 0; /* and call sendmsg() again */
         continue;
       }
       *errnop = errno;
@@ -212,6 +228,81 @@ IOHandlerData::handle_event(struct epoll_event *event, clock_t arrival_clocks) {
   return false;
 }
 
+
+void IOHandlerData::start_polling() {
+  UringPoller *uring = m_reactor_ptr->uring;
+
+  if (uring && uring->recv_supported()) {
+    m_poll_id = uring->add_recv(this, m_sd, EPOLLOUT);
+    m_poll_interest |= Reactor::READ_READY;
+  }
+  else
+    IOHandler::start_polling();
+}
+
+
+bool IOHandlerData::handle_received(const UringPoller::Received &received,
+                                    clock_t arrival_clocks) {
+  const uint8_t *data = received.data;
+  size_t remaining = received.len;
+  size_t n;
+
+  if (received.error) {
+    if (received.error == ECONNREFUSED) {
+      handle_disconnect(Error::COMM_CONNECT_ERROR);
+      return true;
+    }
+    HT_ERRORF("socket recv(%d) failure : %s", m_sd, strerror(received.error));
+    handle_disconnect();
+    return true;
+  }
+
+  if (remaining == 0) {
+    HT_DEBUGF("Received EOF on descriptor %d (%s:%d)", m_sd,
+              inet_ntoa(m_addr.sin_addr), ntohs(m_addr.sin_port));
+    handle_disconnect();
+    return true;
+  }
+
+  try {
+    while (true) {
+      if (!m_got_header) {
+        if (remaining == 0)
+          break;
+        n = std::min(remaining, m_message_header_remaining);
+        memcpy(m_message_header_ptr, data, n);
+        m_message_header_ptr += n;
+        m_message_header_remaining -= n;
+        if (m_message_header_remaining == 0)
+          handle_message_header(arrival_clocks);
+      }
+      else {
+        if (m_message_remaining) {
+          if (remaining == 0)
+            break;
+          n = std::min(remaining, m_message_remaining);
+          memcpy(m_message_ptr, data, n);
+          m_message_ptr += n;
+          m_message_remaining -= n;
+        }
+        else
+          n = 0;
+        if (m_message_remaining == 0)
+          handle_message_body();
+      }
+      data += n;
+      remaining -= n;
+    }
+  }
+  catch (Hypertable::Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    handle_disconnect();
+    return true;
+  }
+
+  return false;
+}
+
 #elif defined(__APPLE__)
 
 /**
@@ -325,9 +416,21 @@ void IOHandlerData::handle_message_header(clock_t arrival_clocks) {
   }
 
   m_event->load_header(m_sd, m_message_header, header_len);
+  // a response echoes the flags of its request, so responses advertise
+  // with a bit of their own that no request carries
+  if (m_event->header.flags & CommHeader::FLAGS_BIT_REQUEST) {
+    if (m_event->header.flags & CommHeader::FLAGS_BIT_ACCEPTS_COMPRESSION)
+      m_peer_accepts_compression = true;
+  }
+  else if (m_event->header.flags &
+           CommHeader::FLAGS_BIT_RESPONSE_ACCEPTS_COMPRESSION)
+    m_peer_accepts_compression = true;
   m_event->arrival_clocks = arrival_clocks;
+  if (LatencyStats::ms_enabled)
+    m_event->arrival_time = LatencyStats::now_micros();
 
-  m_message = new uint8_t [m_event->header.total_len - header_len];
+  m_message = m_reactor_ptr->receive_pool()->allocate(
+      m_event->header.total_len - header_len);
   m_message_ptr = m_message;
   m_message_remaining = m_event->header.total_len - header_len;
   m_message_header_remaining = 0;
@@ -338,23 +441,30 @@ void IOHandlerData::handle_message_header(clock_t arrival_clocks) {
 
 void IOHandlerData::handle_message_body() {
   DispatchHandler *dh = 0;
+  int64_t send_time = 0;
 
   if ((m_event->header.flags & CommHeader::FLAGS_BIT_REQUEST) == 0 &&
       (m_event->header.id == 0
-      || (dh = m_reactor_ptr->remove_request(m_event->header.id)) == 0)) {
+      || (dh = m_reactor_ptr->remove_request(m_event->header.id,
+                                             &send_time)) == 0)) {
     if ((m_event->header.flags & CommHeader::FLAGS_BIT_IGNORE_RESPONSE) == 0) {
       HT_WARNF("Received response for non-pending event (id=%d,version"
                "=%d,total_len=%d)", m_event->header.id, m_event->header.version,
                m_event->header.total_len);
     }
-    delete [] m_message;
+    m_reactor_ptr->receive_pool()->release(m_message,
+        m_event->header.total_len - m_event->header.header_len);
     delete m_event;
   }
   else {
     m_event->payload = m_message;
     m_event->payload_len = m_event->header.total_len
                            - m_event->header.header_len;
-    deliver_event( m_event, dh );
+    m_event->payload_pool = m_reactor_ptr->receive_pool();
+    if (send_time && m_event->arrival_time)
+      LatencyStats::record(LatencyStats::ROUND_TRIP, m_event->header.command,
+                           m_event->arrival_time - send_time);
+    deliver_in_order(m_event, dh);
   }
 
   reset_incoming_message_state();
@@ -363,7 +473,62 @@ void IOHandlerData::handle_message_body() {
 
 void IOHandlerData::handle_disconnect(int error) {
   m_reactor_ptr->cancel_requests(this);
-  deliver_event(new Event(Event::DISCONNECT, m_addr, error));
+  deliver_in_order(new Event(Event::DISCONNECT, m_addr, error), 0);
+}
+
+
+/**
+ * Delivers the event right away unless it is compressed or the events
+ * received before it are still waiting to be inflated, in which case it
+ * is queued behind them and the InflateQueue delivers it.
+ */
+void IOHandlerData::deliver_in_order(Event *event, DispatchHandler *dh) {
+  {
+    ScopedLock lock(m_deferred_mutex);
+    if (m_deferring ||
+        (event->header.flags & CommHeader::FLAGS_BIT_COMPRESSED)) {
+      DeferredEvent deferred;
+      deferred.event = event;
+      deferred.dh = dh;
+      m_deferred.push_back(deferred);
+      if (!m_deferring) {
+        m_deferring = true;
+        InflateQueue::add(this);
+      }
+      return;
+    }
+  }
+  deliver_event(event, dh);
+}
+
+
+void IOHandlerData::deliver_deferred() {
+  DeferredEvent deferred;
+
+  while (true) {
+    {
+      ScopedLock lock(m_deferred_mutex);
+      if (m_deferred.empty()) {
+        m_deferring = false;
+        return;
+      }
+      deferred = m_deferred.front();
+      m_deferred.pop_front();
+    }
+
+    if ((deferred.event->header.flags & CommHeader::FLAGS_BIT_COMPRESSED) &&
+        !PayloadCodec::decompress(deferred.event)) {
+      // a request can't be answered without its payload, so it is dropped
+      // and left to time out; a response is failed back to its handler
+      if (deferred.dh)
+        deliver_event(new Event(Event::ERROR, m_addr,
+                                Error::COMM_RECEIVE_ERROR), deferred.dh);
+      delete deferred.event;
+      continue;
+    }
+
+    deliver_event(deferred.event, deferred.dh);
+  }
 }
 
 
@@ -393,7 +558,8 @@ bool IOHandlerData::handle_write_readiness() {
       HT_ERRORF("setsockopt(SO_RCVBUF) failed - %s", strerror(errno));
     }
 
-    if (getsockname(m_sd, (struct sockaddr *)&m_local_addr, &name_len) < 0) {
+    if (!m_local_socket &&
+        getsockname(m_sd, (struct sockaddr *)&m_local_addr, &name_len) < 0) {
       HT_ERRORF("getsockname(%d) failed - %s", m_sd, strerror(errno));
       return true;
     }
@@ -428,7 +594,8 @@ IOHandlerData::send_message(CommBufPtr &cbp, uint32_t timeout_ms,
     boost::xtime expire_time;
     boost::xtime_get(&expire_time, boost::TIME_UTC);
     xtime_add_millis(expire_time, timeout_ms);
-    m_reactor_ptr->add_request(cbp->header.id, this, disp_handler, expire_time);
+    m_reactor_ptr->add_request(cbp->header.id, this, disp_handler, expire_time,
+        LatencyStats::ms_enabled ? LatencyStats::now_micros() : 0);
   }
 
   m_send_queue.push_back(cbp);
@@ -450,81 +617,127 @@ IOHandlerData::send_message(CommBufPtr &cbp, uint32_t timeout_ms,
 
 
 
-#if defined(__linux__)
-
-int IOHandlerData::flush_send_queue() {
-  ssize_t nwritten, towrite, remaining;
-  struct iovec vec[2];
-  int count;
-  int error = 0;
+/**
+ * Fills in an iovec for each unwritten piece of the queued buffers, in queue
+ * order, until the queue or the iovec array is exhausted.
+ *
+ * @param vec iovec array to fill in
+ * @param max_count number of entries in vec
+ * @param towrite address of variable to hold the total length
+ * @param more address of variable set to true if buffers were left out
+ * @return number of iovec entries filled in
+ */
+int
+IOHandlerData::gather_send_queue(struct iovec *vec, int max_count,
+                                 ssize_t *towrite, bool *more) {
+  std::list<CommBufPtr>::iterator iter = m_send_queue.begin();
+  ssize_t remaining;
+  int count = 0;
 
-  while (!m_send_queue.empty()) {
+  *towrite = 0;
 
-    CommBufPtr &cbp = m_send_queue.front();
-
-    count = 0;
-    towrite = 0;
-    remaining = cbp->data.size - (cbp->data_ptr - cbp->data.base);
+  for (; iter != m_send_queue.end() && count + 2 <= max_count; ++iter) {
+    CommBuf *cbuf = (*iter).get();
+    remaining = cbuf->data.size - (cbuf->data_ptr - cbuf->data.base);
     if (remaining > 0) {
-      vec[0].iov_base = (void *)cbp->data_ptr;
-      vec[0].iov_len = remaining;
-      towrite = remaining;
+      vec[count].iov_base = (void *)cbuf->data_ptr;
+      vec[count].iov_len = remaining;
+      *towrite += remaining;
       ++count;
     }
-    if (cbp->ext.base != 0) {
-      remaining = cbp->ext.size - (cbp->ext_ptr - cbp->ext.base);
+    if (cbuf->ext.base != 0) {
+      remaining = cbuf->ext.size - (cbuf->ext_ptr - cbuf->ext.base);
       if (remaining > 0) {
-        vec[count].iov_base = (void *)cbp->ext_ptr;
+        vec[count].iov_base = (void *)cbuf->ext_ptr;
         vec[count].iov_len = remaining;
-        towrite += remaining;
+        *towrite += remaining;
         ++count;
       }
     }
+  }
 
-    nwritten = et_socket_writev(m_sd, vec, count, &error);
-    if (nwritten == (ssize_t)-1) {
-      if (error == EAGAIN)
-        return Error::OK;
-      HT_WARNF("FileUtils::writev(%d, len=%d) failed : %s", m_sd, (int)towrite,
-               strerror(errno));
-      return Error::COMM_BROKEN_CONNECTION;
-    }
-    else if (nwritten < towrite) {
-      if (nwritten == 0) {
-        if (error == EAGAIN)
-          break;
-        if (error) {
-          HT_WARNF("FileUtils::writev(%d, len=%d) failed : %s", m_sd,
-                   (int)towrite, strerror(error));
-          return Error::COMM_BROKEN_CONNECTION;
-        }
-        continue;
+  *more = iter != m_send_queue.end();
+  return count;
+}
+
+
+/**
+ * Advances the write pointers of the queued buffers past nwritten bytes,
+ * which may span several buffers, and removes the buffers that have been
+ * written completely.
+ *
+ * @param nwritten number of bytes written
+ * @return number of buffers removed from the queue
+ */
+int IOHandlerData::consume_send_queue(size_t nwritten) {
+  size_t remaining;
+  int completed = 0;
+
+  while (!m_send_queue.empty()) {
+    CommBufPtr &cbp = m_send_queue.front();
+
+    remaining = cbp->data.size - (cbp->data_ptr - cbp->data.base);
+    if (remaining > 0) {
+      if (nwritten < remaining) {
+        cbp->data_ptr += nwritten;
+        break;
       }
-      remaining = cbp->data.size - (cbp->data_ptr - cbp->data.base);
+      cbp->data_ptr += remaining;
+      nwritten -= remaining;
+    }
+    if (cbp->ext.base != 0) {
+      remaining = cbp->ext.size - (cbp->ext_ptr - cbp->ext.base);
       if (remaining > 0) {
         if (nwritten < remaining) {
-          cbp->data_ptr += nwritten;
-          if (error == EAGAIN)
-            break;
-          error = 0;
-          continue;
-        }
-        else {
-          nwritten -= remaining;
-          cbp->data_ptr += remaining;
-        }
-      }
-      if (cbp->ext.base != 0) {
-        cbp->ext_ptr += nwritten;
-        if (error == EAGAIN)
+          cbp->ext_ptr += nwritten;
           break;
-        error = 0;
-        continue;
+        }
+        cbp->ext_ptr += remaining;
+        nwritten -= remaining;
       }
     }
 
     // buffer written successfully, now remove from queue (destroys buffer)
     m_send_queue.pop_front();
+    ++completed;
+  }
+
+  return completed;
+}
+
+
+#if defined(__linux__)
+
+/**
+ * Writes as many queued buffers as fit in IOV_MAX iovecs with each system
+ * call.  When the queue doesn't fit, MSG_MORE tells the stack to hold back
+ * a partial segment for the data of the next call.
+ */
+int IOHandlerData::flush_send_queue() {
+  struct iovec vec[SEND_IOV_MAX];
+  struct msghdr msg;
+  ssize_t nwritten, towrite;
+  bool more;
+  int error = 0;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = vec;
+
+  while (!m_send_queue.empty()) {
+
+    msg.msg_iovlen = gather_send_queue(vec, SEND_IOV_MAX, &towrite, &more);
+
+    nwritten = et_socket_sendmsg(m_sd, &msg, more ? MSG_MORE : 0, &error);
+    if (nwritten == (ssize_t)-1) {
+      m_reactor_ptr->record_send(1, 0);
+      if (error == EAGAIN)
+        return Error::OK;
+      HT_WARNF("sendmsg(%d, len=%d) failed : %s", m_sd, (int)towrite,
+               strerror(error));
+      return Error::COMM_BROKEN_CONNECTION;
+    }
+
+    m_reactor_ptr->record_send(1, consume_send_queue(nwritten));
   }
 
   return Error::OK;
@@ -533,32 +746,14 @@ int IOHandlerData::flush_send_queue() {
 #elif defined(__APPLE__)
 
 int IOHandlerData::flush_send_queue() {
-  ssize_t nwritten, towrite, remaining;
-  struct iovec vec[2];
+  struct iovec vec[SEND_IOV_MAX];
+  ssize_t nwritten, towrite;
+  bool more;
   int count;
 
   while (!m_send_queue.empty()) {
 
-    CommBufPtr &cbp = m_send_queue.front();
-
-    count = 0;
-    towrite = 0;
-    remaining = cbp->data.size - (cbp->data_ptr - cbp->data.base);
-    if (remaining > 0) {
-      vec[0].iov_base = (void *)cbp->data_ptr;
-      vec[0].iov_len = remaining;
-      towrite = remaining;
-      ++count;
-    }
-    if (cbp->ext.base != 0) {
-      remaining = cbp->ext.size - (cbp->ext_ptr - cbp->ext.base);
-      if (remaining > 0) {
-        vec[count].iov_base = (void *)cbp->ext_ptr;
-        vec[count].iov_len = remaining;
-        towrite += remaining;
-        ++count;
-      }
-    }
+    count = gather_send_queue(vec, SEND_IOV_MAX, &towrite, &more);
 
     nwritten = FileUtils::writev(m_sd, vec, count);
     if (nwritten == (ssize_t)-1) {
@@ -566,28 +761,11 @@ int IOHandlerData::flush_send_queue() {
                strerror(errno));
       return Error::COMM_BROKEN_CONNECTION;
     }
-    else if (nwritten < towrite) {
-      if (nwritten == 0)
-        break;
-      remaining = cbp->data.size - (cbp->data_ptr - cbp->data.base);
-      if (remaining > 0) {
-        if (nwritten < remaining) {
-          cbp->data_ptr += nwritten;
-          break;
-        }
-        else {
-          nwritten -= remaining;
-          cbp->data_ptr += remaining;
-        }
-      }
-      if (cbp->ext.base != 0) {
-        cbp->ext_ptr += nwritten;
-        break;
-      }
-    }
 
-    // buffer written successfully, now remove from queue (destroys buffer)
-    m_send_queue.pop_front();
+    m_reactor_ptr->record_send(1, consume_send_queue(nwritten));
+
+    if (nwritten < towrite)
+      break;
   }
 
   return Error::OK;
@@ -22,6 +22,7 @@
 #ifndef HYPERTABLE_IOHANDLERDATA_H
 #define HYPERTABLE_IOHANDLERDATA_H
 
+#include <deque>
 #include <list>
 
 extern "C" {
@@ -47,6 +48,8 @@ namespace Hypertable {
     IOHandlerData(int sd, struct sockaddr_in &addr, DispatchHandlerPtr &dhp)
       : IOHandler(sd, addr, dhp), m_send_queue() {
       m_connected = false;
+      m_peer_accepts_compression = false;
+      m_deferring = false;
       reset_incoming_message_state();
     }
 
@@ -76,12 +79,49 @@ namespace Hypertable {
 
     bool handle_write_readiness();
 
+#if defined(__linux__)
+    /**
+     * Uses a multishot recv for the incoming data when the reactor's
+     * io_uring backend supports it, otherwise polls like other handlers
+     */
+    virtual void start_polling();
+
+    /**
+     * Processes data that a multishot recv read off the socket.  Returns
+     * true if the handler should be removed, like handle_event().
+     */
+    bool handle_received(const UringPoller::Received &received,
+                         clock_t arrival_clocks);
+#endif
+
+    /**
+     * Returns true once the peer has advertised that it can inflate
+     * compressed payloads (see PayloadCodec)
+     */
+    bool peer_accepts_compression() { return m_peer_accepts_compression; }
+
+    /**
+     * Inflates and delivers the messages deferred to the InflateQueue, in
+     * the order they were received, until there are none left.
+     */
+    void deliver_deferred();
+
   private:
+    struct DeferredEvent {
+      Event           *event;
+      DispatchHandler *dh;
+    };
+
+    void deliver_in_order(Event *event, DispatchHandler *dh);
     void handle_message_header(clock_t arrival_clocks);
     void handle_message_body();
     void handle_disconnect(int error = Error::OK);
+    int gather_send_queue(struct iovec *vec, int max_count, ssize_t *towrite,
+                          bool *more);
+    int consume_send_queue(size_t nwritten);
 
     bool                m_connected;
+    bool                m_peer_accepts_compression;
     Mutex               m_mutex;
     Event              *m_event;
     uint8_t             m_message_header[64];
@@ -92,6 +132,9 @@ namespace Hypertable {
     uint8_t            *m_message_ptr;
     size_t              m_message_remaining;
     std::list<CommBufPtr> m_send_queue;
+    Mutex               m_deferred_mutex;
+    std::deque<DeferredEvent> m_deferred;
+    bool                m_deferring;
   };
 
   typedef intrusive_ptr<IOHandlerData> IOHandlerDataPtr;
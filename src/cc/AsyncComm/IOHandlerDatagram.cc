@@ -73,7 +73,8 @@ bool IOHandlerDatagram::handle_event(struct epoll_event *event, clock_t ) {
 
       payload_len = nread - (ssize_t)event->header.header_len;
       event->payload_len = payload_len;
-      event->payload = new uint8_t [payload_len];
+      event->payload = m_reactor_ptr->receive_pool()->allocate(payload_len);
+      event->payload_pool = m_reactor_ptr->receive_pool();
       memcpy((void *)event->payload, m_message + event->header.header_len,
              payload_len);
       deliver_event( event );
@@ -142,7 +143,8 @@ bool IOHandlerDatagram::handle_event(struct kevent *event, clock_t ) {
 
     payload_len = nread - (ssize_t)event->header.header_len;
     event->payload_len = payload_len;
-    event->payload = new uint8_t [payload_len];
+    event->payload = m_reactor_ptr->receive_pool()->allocate(payload_len);
+    event->payload_pool = m_reactor_ptr->receive_pool();
     memcpy((void *)event->payload, m_message + event->header.header_len,
            payload_len);
 
@@ -0,0 +1,79 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include "InflateQueue.h"
+
+using namespace Hypertable;
+
+size_t InflateQueue::ms_thread_count = 2;
+Mutex InflateQueue::ms_mutex;
+boost::condition InflateQueue::ms_cond;
+std::deque<IOHandlerDataPtr> InflateQueue::ms_queue;
+boost::thread_group InflateQueue::ms_threads;
+bool InflateQueue::ms_started = false;
+bool InflateQueue::ms_shutdown = false;
+
+
+void InflateQueue::add(IOHandlerData *handler) {
+  ScopedLock lock(ms_mutex);
+
+  if (!ms_started) {
+    Worker worker;
+    for (size_t i=0; i<ms_thread_count; i++)
+      ms_threads.create_thread(worker);
+    ms_started = true;
+  }
+
+  ms_queue.push_back(handler);
+  ms_cond.notify_one();
+}
+
+
+void InflateQueue::destroy() {
+  {
+    ScopedLock lock(ms_mutex);
+    ms_shutdown = true;
+    ms_cond.notify_all();
+  }
+  ms_threads.join_all();
+  ms_queue.clear();
+}
+
+
+void InflateQueue::Worker::operator()() {
+  IOHandlerDataPtr handler;
+
+  while (true) {
+    {
+      ScopedLock lock(ms_mutex);
+      while (ms_queue.empty() && !ms_shutdown)
+        ms_cond.wait(lock);
+      if (ms_shutdown)
+        return;
+      handler = ms_queue.front();
+      ms_queue.pop_front();
+    }
+    handler->deliver_deferred();
+    handler = 0;
+  }
+}
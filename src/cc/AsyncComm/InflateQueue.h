@@ -0,0 +1,75 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_INFLATEQUEUE_H
+#define HYPERTABLE_INFLATEQUEUE_H
+
+#include <deque>
+
+#include <boost/thread/condition.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "Common/Mutex.h"
+
+#include "IOHandlerData.h"
+
+namespace Hypertable {
+
+  /**
+   * Process wide pool of threads that inflate compressed messages, so
+   * that the reactor threads don't spend their time in the codec.  A
+   * connection that receives a compressed message hands it to the pool
+   * along with every message it receives after it, until the pool has
+   * caught up, so that the messages of a connection are still delivered
+   * in order.  The threads are started when the first message is added.
+   */
+  class InflateQueue {
+  public:
+
+    /**
+     * Schedules delivery of the messages deferred by handler (see
+     * IOHandlerData::deliver_deferred)
+     */
+    static void add(IOHandlerData *handler);
+
+    /** Stops the threads */
+    static void destroy();
+
+    /** Number of threads (Comm.Compression.InflateThreads) */
+    static size_t ms_thread_count;
+
+  private:
+    class Worker {
+    public:
+      void operator()();
+    };
+
+    static Mutex ms_mutex;
+    static boost::condition ms_cond;
+    static std::deque<IOHandlerDataPtr> ms_queue;
+    static boost::thread_group ms_threads;
+    static bool ms_started;
+    static bool ms_shutdown;
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_INFLATEQUEUE_H
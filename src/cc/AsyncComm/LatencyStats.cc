@@ -0,0 +1,71 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include "LatencyStats.h"
+
+using namespace Hypertable;
+
+bool LatencyStats::ms_enabled = true;
+Mutex LatencyStats::ms_mutex;
+LatencyHistogram *volatile
+LatencyStats::ms_histograms[KIND_COUNT][MAX_COMMAND + 1];
+
+
+LatencyHistogram *LatencyStats::create(Kind kind, uint64_t command) {
+  ScopedLock lock(ms_mutex);
+  if (ms_histograms[kind][command] == 0)
+    ms_histograms[kind][command] = new LatencyHistogram();
+  return ms_histograms[kind][command];
+}
+
+
+void LatencyStats::snapshot(std::vector<Entry> &entries) {
+  Entry entry;
+
+  for (int kind = 0; kind < KIND_COUNT; ++kind) {
+    for (uint64_t command = 0; command <= MAX_COMMAND; ++command) {
+      LatencyHistogram *histogram = ms_histograms[kind][command];
+      if (histogram == 0)
+        continue;
+      histogram->snapshot(entry.histogram);
+      if (entry.histogram.buckets.empty())
+        continue;
+      entry.kind = (uint8_t)kind;
+      entry.command = command;
+      entries.push_back(entry);
+    }
+  }
+}
+
+
+const char *LatencyStats::kind_text(uint8_t kind) {
+  switch (kind) {
+  case QUEUE_WAIT:
+    return "queue_wait";
+  case SERVICE_TIME:
+    return "service_time";
+  case ROUND_TRIP:
+    return "round_trip";
+  }
+  return "unknown";
+}
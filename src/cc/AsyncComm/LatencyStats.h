@@ -0,0 +1,101 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_LATENCYSTATS_H
+#define HYPERTABLE_LATENCYSTATS_H
+
+#include <vector>
+
+extern "C" {
+#include <time.h>
+#include <sys/time.h>
+}
+
+#include "Common/LatencyHistogram.h"
+#include "Common/Mutex.h"
+
+namespace Hypertable {
+
+  /**
+   * Process wide latency histograms of the Comm layer, keyed by
+   * CommHeader::command.  The server side records how long requests wait in
+   * the ApplicationQueue and how long their handlers run; the client side
+   * records the round trip time of requests.  Command codes are only unique
+   * within a protocol, and a process may be a client of several services,
+   * so round trip times of different services can share a command slot.
+   */
+  class LatencyStats {
+  public:
+    enum Kind { QUEUE_WAIT = 0, SERVICE_TIME, ROUND_TRIP, KIND_COUNT };
+
+    /** Commands at or above this value share the last slot */
+    static const uint64_t MAX_COMMAND = 64;
+
+    struct Entry {
+      uint8_t kind;
+      uint64_t command;
+      LatencyHistogram::Snapshot histogram;
+    };
+
+    /** Returns a monotonic timestamp in microseconds */
+    static int64_t now_micros() {
+#if defined(CLOCK_MONOTONIC)
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+#else
+      struct timeval tv;
+      gettimeofday(&tv, 0);
+      return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+#endif
+    }
+
+    static void record(Kind kind, uint64_t command, int64_t micros) {
+      if (command > MAX_COMMAND)
+        command = MAX_COMMAND;
+      LatencyHistogram *histogram = ms_histograms[kind][command];
+      if (histogram == 0)
+        histogram = create(kind, command);
+      histogram->record(micros);
+    }
+
+    /**
+     * Appends the values recorded since process start, one entry per kind
+     * and command that saw any traffic
+     */
+    static void snapshot(std::vector<Entry> &entries);
+
+    static const char *kind_text(uint8_t kind);
+
+    /** Set from Comm.LatencyHistograms; recording is skipped if false */
+    static bool ms_enabled;
+
+  private:
+    static LatencyHistogram *create(Kind kind, uint64_t command);
+
+    static Mutex ms_mutex;
+    static LatencyHistogram *volatile
+        ms_histograms[KIND_COUNT][MAX_COMMAND + 1];
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_LATENCYSTATS_H
@@ -0,0 +1,196 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include <set>
+
+extern "C" {
+#include <errno.h>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+}
+
+#include "Common/FileUtils.h"
+#include "Common/Logger.h"
+#include "Common/Mutex.h"
+#include "Common/System.h"
+#include "Common/atomic.h"
+
+#include "LocalSocket.h"
+
+using namespace Hypertable;
+
+bool   LocalSocket::ms_enabled = true;
+String LocalSocket::ms_dir;
+
+namespace {
+
+  Mutex local_mutex;
+  bool local_addrs_loaded = false;
+  std::set<uint32_t> local_addrs;
+  atomic_t next_peer_id = ATOMIC_INIT(0);
+
+  void load_local_addrs() {
+    struct ifaddrs *ifa_list, *ifa;
+
+    if (getifaddrs(&ifa_list) < 0) {
+      HT_WARNF("getifaddrs() failed - %s", strerror(errno));
+      return;
+    }
+    for (ifa = ifa_list; ifa; ifa = ifa->ifa_next) {
+      if (ifa->ifa_addr && ifa->ifa_addr->sa_family == AF_INET)
+        local_addrs.insert(
+            ((struct sockaddr_in *)ifa->ifa_addr)->sin_addr.s_addr);
+    }
+    freeifaddrs(ifa_list);
+  }
+
+} // local namespace
+
+
+bool LocalSocket::is_local(const sockaddr_in &addr) {
+  if ((ntohl(addr.sin_addr.s_addr) >> 24) == 127)
+    return true;
+
+  ScopedLock lock(local_mutex);
+  if (!local_addrs_loaded) {
+    load_local_addrs();
+    local_addrs_loaded = true;
+  }
+  return local_addrs.count(addr.sin_addr.s_addr) > 0;
+}
+
+
+bool LocalSocket::make_path(uint16_t port, sockaddr_un *sun) {
+  String dir = ms_dir.empty() ? System::install_dir + "/run" : ms_dir;
+  String path = format("%s/comm.%u.sock", dir.c_str(), (unsigned)ntohs(port));
+
+  if (path.length() >= sizeof(sun->sun_path))
+    return false;
+
+  memset(sun, 0, sizeof(*sun));
+  sun->sun_family = AF_UNIX;
+  strcpy(sun->sun_path, path.c_str());
+  return true;
+}
+
+
+void LocalSocket::next_peer_address(sockaddr_in *addr) {
+  uint32_t id;
+
+  // port 0 marks an unset alias in HandlerMap, so skip it
+  do {
+    id = (uint32_t)atomic_inc_return(&next_peer_id);
+  } while ((id & 0xFFFF) == 0);
+
+  memset(addr, 0, sizeof(*addr));
+  addr->sin_family = AF_INET;
+  addr->sin_addr.s_addr = htonl(0x7FFF0000 | (id >> 16));
+  addr->sin_port = htons((uint16_t)(id & 0xFFFF));
+}
+
+
+int LocalSocket::connect(uint16_t port) {
+  sockaddr_un sun;
+  int sd;
+
+  if (!make_path(port, &sun))
+    return -1;
+
+  if ((sd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+    HT_ERRORF("socket(AF_UNIX) - %s", strerror(errno));
+    return -1;
+  }
+
+  FileUtils::set_flags(sd, O_NONBLOCK);
+
+#if defined(__APPLE__)
+  int one = 1;
+  if (setsockopt(sd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one)) < 0)
+    HT_WARNF("setsockopt(SO_NOSIGPIPE) failure: %s", strerror(errno));
+#endif
+
+  while (::connect(sd, (struct sockaddr *)&sun, sizeof(sun)) < 0) {
+    if (errno == EINTR)
+      continue;
+    if (errno == EINPROGRESS)
+      break;
+    // ENOENT/ECONNREFUSED: no local listener, EAGAIN: backlog full
+    ::close(sd);
+    return -1;
+  }
+  return sd;
+}
+
+
+int LocalSocket::listen(uint16_t port, String &path) {
+  sockaddr_un sun;
+  int sd;
+
+  if (!make_path(port, &sun)) {
+    HT_WARNF("Unix-domain socket path for port %u too long, local "
+             "connections will use TCP", (unsigned)ntohs(port));
+    return -1;
+  }
+
+  // Only remove the socket file if nobody is listening on it anymore
+  if ((sd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+    HT_ERRORF("socket(AF_UNIX) - %s", strerror(errno));
+    return -1;
+  }
+  if (::connect(sd, (struct sockaddr *)&sun, sizeof(sun)) == 0) {
+    HT_WARNF("%s is in use by another process, local connections will use "
+             "TCP", sun.sun_path);
+    ::close(sd);
+    return -1;
+  }
+  ::close(sd);
+  unlink(sun.sun_path);
+
+  if ((sd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+    HT_ERRORF("socket(AF_UNIX) - %s", strerror(errno));
+    return -1;
+  }
+
+  FileUtils::set_flags(sd, O_NONBLOCK);
+
+  if (bind(sd, (const sockaddr *)&sun, sizeof(sun)) < 0) {
+    HT_INFOF("Unable to bind %s (%s), local connections will use TCP",
+             sun.sun_path, strerror(errno));
+    ::close(sd);
+    return -1;
+  }
+
+  if (::listen(sd, 1000) < 0) {
+    HT_WARNF("listen(%s) failed - %s", sun.sun_path, strerror(errno));
+    ::close(sd);
+    unlink(sun.sun_path);
+    return -1;
+  }
+
+  path = sun.sun_path;
+  return sd;
+}
@@ -0,0 +1,84 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_LOCALSOCKET_H
+#define HYPERTABLE_LOCALSOCKET_H
+
+extern "C" {
+#include <netinet/in.h>
+#include <sys/un.h>
+}
+
+#include "Common/String.h"
+
+namespace Hypertable {
+
+  /**
+   * Helpers for the Unix-domain socket transport used between processes
+   * on the same host.  Every TCP listener also listens on a Unix-domain
+   * socket named after its port, and Comm::connect uses that socket instead
+   * of TCP loopback when the remote address belongs to this host.
+   * Connections accepted on a Unix-domain socket have no IP peer address,
+   * so they are keyed by a synthetic address in 127.255.0.0/16.
+   */
+  class LocalSocket {
+  public:
+
+    /** Returns true if addr refers to this host (loopback or the address
+     * of one of the local interfaces)
+     */
+    static bool is_local(const sockaddr_in &addr);
+
+    /** Builds the Unix-domain socket path for the given TCP port (network
+     * byte order).  Returns false if the path does not fit into sun_path.
+     */
+    static bool make_path(uint16_t port, sockaddr_un *sun);
+
+    /** Fills in a unique synthetic peer address for an accepted
+     * Unix-domain connection
+     */
+    static void next_peer_address(sockaddr_in *addr);
+
+    /** Connects a non-blocking Unix-domain socket to the listener for the
+     * given TCP port (network byte order).  Returns the descriptor, or -1 if
+     * there is no live listener, in which case the caller falls back to TCP.
+     */
+    static int connect(uint16_t port);
+
+    /** Creates a non-blocking Unix-domain listening socket for the given TCP
+     * port (network byte order), replacing a stale socket file left behind
+     * by a previous process.  Returns the descriptor, or -1 on failure.
+     */
+    static int listen(uint16_t port, String &path);
+
+    /** True if the Unix-domain transport is enabled (Comm.LocalSocket.Enable)
+     */
+    static bool ms_enabled;
+
+    /** Directory holding the sockets (Comm.LocalSocket.Dir), defaults to
+     * the run directory of the installation
+     */
+    static String ms_dir;
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_LOCALSOCKET_H
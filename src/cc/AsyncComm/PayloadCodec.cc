@@ -0,0 +1,128 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include "Common/Logger.h"
+
+#include "CommBuf.h"
+#include "Event.h"
+#include "PayloadCodec.h"
+
+using namespace Hypertable;
+
+PayloadCodec *PayloadCodec::ms_codec = 0;
+size_t PayloadCodec::ms_threshold = 4096;
+Mutex PayloadCodec::ms_mutex;
+uint64_t PayloadCodec::ms_raw_bytes = 0;
+uint64_t PayloadCodec::ms_wire_bytes = 0;
+
+
+void PayloadCodec::compress(CommBuf *cbuf, bool request, bool peer_accepts) {
+  size_t header_len = cbuf->header.encoded_length();
+  size_t payload_len = cbuf->data.size - header_len + cbuf->ext.size;
+
+  // responses inherit the flags of the request they answer
+  cbuf->header.flags &= (CommHeader::FLAGS_MASK_COMPRESSED
+                         & CommHeader::FLAGS_MASK_ACCEPTS_COMPRESSION
+                         & CommHeader::FLAGS_MASK_RESPONSE_ACCEPTS_COMPRESSION);
+
+  if (ms_codec == 0)
+    return;
+
+  if (request)
+    cbuf->header.flags |= CommHeader::FLAGS_BIT_ACCEPTS_COMPRESSION;
+  else
+    cbuf->header.flags |= CommHeader::FLAGS_BIT_RESPONSE_ACCEPTS_COMPRESSION;
+
+  if (!peer_accepts || payload_len < ms_threshold || !ms_codec->deflates())
+    return;
+
+  DynamicBuffer input(0, false);
+  DynamicBuffer output;
+
+  if (cbuf->ext.size) {
+    input.grow(payload_len);
+    input.add_unchecked(cbuf->data.base + header_len,
+                        cbuf->data.size - header_len);
+    input.add_unchecked(cbuf->ext.base, cbuf->ext.size);
+    input.own = true;
+  }
+  else {
+    input.base = cbuf->data.base + header_len;
+    input.ptr = input.base + payload_len;
+    input.size = payload_len;
+  }
+
+  if (!ms_codec->deflate(input.base, payload_len, output) ||
+      output.fill() >= payload_len)
+    return;
+
+  size_t len = header_len + output.fill();
+  cbuf->data.set(new uint8_t [len], len, true);
+  memcpy(cbuf->data.base + header_len, output.base, output.fill());
+  cbuf->data_ptr = cbuf->data.base + cbuf->data.size;
+  cbuf->ext.free();
+  cbuf->header.flags |= CommHeader::FLAGS_BIT_COMPRESSED;
+  cbuf->header.set_total_length(cbuf->data.size);
+
+  ScopedLock lock(ms_mutex);
+  ms_raw_bytes += payload_len;
+  ms_wire_bytes += output.fill();
+}
+
+
+bool PayloadCodec::decompress(Event *event) {
+  DynamicBuffer output;
+
+  if (ms_codec == 0) {
+    HT_ERRORF("Received compressed message with no codec installed (%s)",
+              event->to_str().c_str());
+    return false;
+  }
+
+  if (!ms_codec->inflate(event->payload, event->payload_len, output)) {
+    HT_ERRORF("Unable to inflate message payload (%s)",
+              event->to_str().c_str());
+    return false;
+  }
+
+  if (event->payload_pool)
+    event->payload_pool->release((uint8_t *)event->payload,
+                                 event->payload_len);
+  else
+    delete [] event->payload;
+  event->payload_pool = 0;
+
+  size_t len;
+  event->payload = output.release(&len);
+  event->payload_len = len;
+  event->header.total_len = event->header.header_len + len;
+  event->header.flags &= CommHeader::FLAGS_MASK_COMPRESSED;
+  return true;
+}
+
+
+void PayloadCodec::get_stats(uint64_t *raw_bytes, uint64_t *wire_bytes) {
+  ScopedLock lock(ms_mutex);
+  *raw_bytes = ms_raw_bytes;
+  *wire_bytes = ms_wire_bytes;
+}
@@ -0,0 +1,106 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_PAYLOADCODEC_H
+#define HYPERTABLE_PAYLOADCODEC_H
+
+#include "Common/DynamicBuffer.h"
+#include "Common/Mutex.h"
+
+namespace Hypertable {
+
+  class CommBuf;
+  class Event;
+
+  /**
+   * Compression of message payloads on the wire.  Every request sent by a
+   * process with a codec installed carries
+   * CommHeader::FLAGS_BIT_ACCEPTS_COMPRESSION and every response
+   * CommHeader::FLAGS_BIT_RESPONSE_ACCEPTS_COMPRESSION; responses need a
+   * bit of their own because peers without compression support echo the
+   * flags of the request in their responses.  A connection starts
+   * compressing outgoing payloads of at least ms_threshold bytes once the
+   * peer has been seen to set the bit.  Compressed messages carry
+   * CommHeader::FLAGS_BIT_COMPRESSED and are inflated by the InflateQueue
+   * threads before the Event is delivered, so handlers never see them.
+   * The codec itself lives above the Comm layer and is installed by the
+   * application.
+   */
+  class PayloadCodec {
+  public:
+    virtual ~PayloadCodec() { }
+
+    /**
+     * Compresses len bytes of data into output.  Returns false if the data
+     * does not compress, in which case it is sent as is.  Must be thread
+     * safe.
+     */
+    virtual bool deflate(const uint8_t *data, size_t len,
+                         DynamicBuffer &output) = 0;
+
+    /**
+     * Inflates a payload produced by deflate into output.  Returns false if
+     * the payload is corrupt.  Must be thread safe.
+     */
+    virtual bool inflate(const uint8_t *data, size_t len,
+                         DynamicBuffer &output) = 0;
+
+    /**
+     * Returns false if this codec only inflates, i.e. outgoing payloads are
+     * never compressed but the peers are still told they may compress.
+     */
+    virtual bool deflates() { return true; }
+
+    /**
+     * Sets or clears the compression flags of an outgoing request or
+     * response and compresses its payload if peer_accepts is true and the
+     * payload is large enough.  Must be called before the header is
+     * written.
+     */
+    static void compress(CommBuf *cbuf, bool request, bool peer_accepts);
+
+    /**
+     * Replaces the payload of a compressed incoming message with its
+     * inflated contents.  Returns false if it can't be inflated.
+     */
+    static bool decompress(Event *event);
+
+    /**
+     * Returns the payload bytes of the compressed messages sent since
+     * process start, before and after compression
+     */
+    static void get_stats(uint64_t *raw_bytes, uint64_t *wire_bytes);
+
+    /** Installed codec, or 0 if payloads are never compressed */
+    static PayloadCodec *ms_codec;
+
+    /** Smallest payload that gets compressed (Comm.Compression.MinSize) */
+    static size_t ms_threshold;
+
+  private:
+    static Mutex ms_mutex;
+    static uint64_t ms_raw_bytes;
+    static uint64_t ms_wire_bytes;
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_PAYLOADCODEC_H
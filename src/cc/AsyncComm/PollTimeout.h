@@ -27,6 +27,7 @@
 #include <boost/thread/xtime.hpp>
 
 #include <cassert>
+#include <climits>
 
 namespace Hypertable {
 
@@ -54,6 +55,15 @@ namespace Hypertable {
       assert(duration_millis >= 0);
     }
 
+    void set_millis(uint64_t millis) {
+      if (millis > (uint64_t)INT_MAX)
+        millis = INT_MAX;
+      duration_ts.tv_sec = millis / 1000;
+      duration_ts.tv_nsec = (millis % 1000) * 1000000;
+      ts_ptr = &duration_ts;
+      duration_millis = (int)millis;
+    }
+
     void set_indefinite() {
       ts_ptr = 0;
       duration_millis = -1;
@@ -56,14 +56,24 @@ const int Reactor::WRITE_READY  = 0x02;
 /**
  *
  */
-Reactor::Reactor() : m_mutex(), m_interrupt_in_progress(false) {
+Reactor::Reactor(size_t receive_pool_size)
+  : m_mutex(), m_request_cache(0), m_timer_wheel(0),
+    m_interrupt_in_progress(false), m_thread_set(false),
+    m_wakeup_scheduled(false), m_next_wakeup_tick(0),
+    m_receive_pool(new BufferPool(receive_pool_size)) {
   struct sockaddr_in addr;
 
+  boost::xtime_get(&m_base_time, boost::TIME_UTC);
+
+  atomic_set(&m_send_syscalls, 0);
+  atomic_set(&m_messages_sent, 0);
+
 #if defined(__linux__)
   if ((poll_fd = epoll_create(256)) < 0) {
     perror("epoll_create");
     exit(1);
   }
+  uring = ReactorFactory::ms_use_io_uring ? new UringPoller(512) : 0;
 #elif defined(__APPLE__)
   kqd = kqueue();
 #endif
@@ -104,7 +114,9 @@ Reactor::Reactor() : m_mutex(), m_interrupt_in_progress(false) {
   }
 
 #if defined(__linux__)
-  if (ReactorFactory::ms_epollet) {
+  if (uring)
+    uring->add(0, m_interrupt_sd, EPOLLIN);
+  else if (ReactorFactory::ms_epollet) {
 
     struct epoll_event event;
     memset(&event, 0, sizeof(struct epoll_event));
@@ -126,86 +138,115 @@ Reactor::Reactor() : m_mutex(), m_interrupt_in_progress(false) {
     }
   }
 #endif
+}
+
 
-  memset(&m_next_wakeup, 0, sizeof(m_next_wakeup));
+Reactor::~Reactor() {
+  std::vector<TimerWheel::Entry *> entries;
+  poll_loop_interrupt();
+  m_timer_wheel.drain(entries);
+  foreach(TimerWheel::Entry *entry, entries)
+    delete static_cast<TimerNode *>(entry);
+#if defined(__linux__)
+  delete uring;
+#endif
 }
 
 
 void Reactor::handle_timeouts(PollTimeout &next_timeout) {
-  vector<ExpireTimer> expired_timers;
+  std::vector<RequestCache::Timeout> timeouts;
+  std::vector<TimerWheel::Entry *> expired;
+  std::vector<DispatchHandler *> expired_handlers;
   EventPtr event_ptr;
-  boost::xtime     now, next_req_timeout;
-  ExpireTimer timer;
+  boost::xtime now;
+  uint64_t now_tick, next_tick, timer_tick;
+  bool have_next;
 
-  {
-    ScopedLock lock(m_mutex);
-    IOHandler       *handler;
-    DispatchHandler *dh;
+  boost::xtime_get(&now, boost::TIME_UTC);
+  now_tick = to_tick(now, false);
 
-    boost::xtime_get(&now, boost::TIME_UTC);
+  drain_pending();
 
-    while ((dh = m_request_cache.get_next_timeout(now, handler,
-                                                  &next_req_timeout)) != 0) {
-      handler->deliver_event(new Event(Event::ERROR, ((IOHandlerData *)
-          handler)->get_address(), Error::REQUEST_TIMEOUT), dh);
-    }
-
-    if (next_req_timeout.sec != 0) {
-      next_timeout.set(now, next_req_timeout);
-      memcpy(&m_next_wakeup, &next_req_timeout, sizeof(m_next_wakeup));
-    }
-    else {
-      next_timeout.set_indefinite();
-      memset(&m_next_wakeup, 0, sizeof(m_next_wakeup));
-    }
-
-    if (!m_timer_heap.empty()) {
-      ExpireTimer timer;
-
-      while (!m_timer_heap.empty()) {
-        timer = m_timer_heap.top();
-        if (xtime_cmp(timer.expire_time, now) > 0) {
-          if (next_req_timeout.sec == 0
-              || xtime_cmp(timer.expire_time, next_req_timeout) < 0) {
-            next_timeout.set(now, timer.expire_time);
-            memcpy(&m_next_wakeup, &timer.expire_time, sizeof(m_next_wakeup));
-          }
-          break;
-        }
-        expired_timers.push_back(timer);
-        m_timer_heap.pop();
-      }
+  m_request_cache.get_timeouts(now_tick, timeouts);
+  foreach(RequestCache::Timeout &timeout, timeouts) {
+    timeout.handler->deliver_event(new Event(Event::ERROR, ((IOHandlerData *)
+        timeout.handler)->get_address(), Error::REQUEST_TIMEOUT), timeout.dh);
+  }
 
-    }
+  m_timer_wheel.advance(now_tick, expired);
+  foreach(TimerWheel::Entry *entry, expired) {
+    TimerNode *node = static_cast<TimerNode *>(entry);
+    expired_handlers.push_back(node->handler);
+    delete node;
   }
 
   /**
    * Deliver timer events
    */
-  for (size_t i=0; i<expired_timers.size(); i++) {
+  foreach(DispatchHandler *handler, expired_handlers) {
     event_ptr = new Event(Event::TIMER, Error::OK);
-    if (expired_timers[i].handler)
-      expired_timers[i].handler->handle(event_ptr);
+    if (handler)
+      handler->handle(event_ptr);
   }
 
-  {
-    ScopedLock lock(m_mutex);
+  boost::xtime_get(&now, boost::TIME_UTC);
+  now_tick = to_tick(now, false);
 
-    if (!m_timer_heap.empty()) {
-      timer = m_timer_heap.top();
-      if (next_req_timeout.sec == 0
-          || xtime_cmp(timer.expire_time, next_req_timeout) < 0) {
-        next_timeout.set(now, timer.expire_time);
-        memcpy(&m_next_wakeup, &timer.expire_time, sizeof(m_next_wakeup));
-      }
+  /**
+   * Publish the next wakeup while holding the pending lock, so that a
+   * thread adding an earlier request or timer afterwards knows to interrupt
+   * the poll loop
+   */
+  {
+    ScopedLock lock(m_pending_mutex);
+    drain_pending_locked();
+
+    have_next = m_request_cache.next_expiry(&next_tick);
+    if (m_timer_wheel.next_expiry(&timer_tick)
+        && (!have_next || timer_tick < next_tick)) {
+      next_tick = timer_tick;
+      have_next = true;
     }
 
+    m_wakeup_scheduled = have_next;
+    m_next_wakeup_tick = have_next ? next_tick : 0;
+  }
+
+  if (have_next)
+    next_timeout.set_millis(next_tick > now_tick ? next_tick - now_tick : 0);
+  else
+    next_timeout.set_indefinite();
+
+  if (m_interrupt_in_progress) {
+    ScopedLock lock(m_mutex);
     poll_loop_continue();
   }
 
 }
 
 
+/**
+ * Moves requests and timers queued by other threads into the reactor's
+ * timer wheels.  Called from the reactor thread.
+ */
+void Reactor::drain_pending() {
+  ScopedLock lock(m_pending_mutex);
+  drain_pending_locked();
+}
+
+
+void Reactor::drain_pending_locked() {
+  foreach(PendingRequest &request, m_pending_requests)
+    m_request_cache.insert(request.id, request.handler, request.dh,
+                           request.expire_tick, request.send_time);
+  m_pending_requests.clear();
+
+  foreach(ExpireTimer &timer, m_pending_timers)
+    insert_timer(timer.handler, to_tick(timer.expire_time, true));
+  m_pending_timers.clear();
+}
+
+
 
 /**
  *
@@ -22,17 +22,25 @@
 #ifndef HYPERTABLE_REACTOR_H
 #define HYPERTABLE_REACTOR_H
 
-#include <queue>
 #include <set>
+#include <vector>
+
+extern "C" {
+#include <pthread.h>
+}
 
 #include <boost/thread/thread.hpp>
 
+#include "Common/BufferPool.h"
 #include "Common/Mutex.h"
 #include "Common/ReferenceCount.h"
+#include "Common/atomic.h"
 
 #include "PollTimeout.h"
 #include "RequestCache.h"
 #include "ExpireTimer.h"
+#include "TimerWheel.h"
+#include "UringPoller.h"
 
 namespace Hypertable {
 
@@ -45,37 +53,75 @@ namespace Hypertable {
     static const int READ_READY;
     static const int WRITE_READY;
 
-    Reactor();
-    ~Reactor() {
-      poll_loop_interrupt();
-    }
+    Reactor(size_t receive_pool_size);
+    ~Reactor();
 
     void operator()();
 
+    /**
+     * Registers a request timeout.  On the reactor thread the request goes
+     * straight into the request cache without locking.  Other threads
+     * queue it for the reactor to pick up, and interrupt the poll loop only
+     * if it would otherwise sleep past the new expiration time.
+     */
     void add_request(uint32_t id, IOHandler *handler, DispatchHandler *dh,
-                     boost::xtime &expire) {
-      ScopedLock lock(m_mutex);
-      boost::xtime now;
-      m_request_cache.insert(id, handler, dh, expire);
-      boost::xtime_get(&now, boost::TIME_UTC);
-      if (m_next_wakeup.sec == 0 || xtime_cmp(expire, m_next_wakeup) < 0)
+                     boost::xtime &expire, int64_t send_time = 0) {
+      uint64_t expire_tick = to_tick(expire, true);
+      if (on_reactor_thread()) {
+        m_request_cache.insert(id, handler, dh, expire_tick, send_time);
+        return;
+      }
+      PendingRequest request = { id, handler, dh, expire_tick, send_time };
+      bool interrupt;
+      {
+        ScopedLock lock(m_pending_mutex);
+        m_pending_requests.push_back(request);
+        interrupt = schedule_wakeup(expire_tick);
+      }
+      if (interrupt) {
+        ScopedLock lock(m_mutex);
         poll_loop_interrupt();
+      }
     }
 
-    DispatchHandler *remove_request(uint32_t id) {
-      ScopedLock lock(m_mutex);
-      return m_request_cache.remove(id);
+    /**
+     * Removes a request from the request cache.  Must be called from the
+     * reactor thread.
+     */
+    DispatchHandler *remove_request(uint32_t id, int64_t *send_timep = 0) {
+      DispatchHandler *dh = m_request_cache.remove(id, send_timep);
+      if (dh == 0) {
+        drain_pending();
+        dh = m_request_cache.remove(id, send_timep);
+      }
+      return dh;
     }
 
+    /**
+     * Delivers an error to every outstanding request sent over the given
+     * handler.  Must be called from the reactor thread.
+     */
     void cancel_requests(IOHandler *handler, int32_t error=Error::COMM_BROKEN_CONNECTION) {
-      ScopedLock lock(m_mutex);
+      drain_pending();
       m_request_cache.purge_requests(handler, error);
     }
 
     void add_timer(ExpireTimer &timer) {
-      ScopedLock lock(m_mutex);
-      m_timer_heap.push(timer);
-      poll_loop_interrupt();
+      uint64_t expire_tick = to_tick(timer.expire_time, true);
+      if (on_reactor_thread()) {
+        insert_timer(timer.handler, expire_tick);
+        return;
+      }
+      bool interrupt;
+      {
+        ScopedLock lock(m_pending_mutex);
+        m_pending_timers.push_back(timer);
+        interrupt = schedule_wakeup(expire_tick);
+      }
+      if (interrupt) {
+        ScopedLock lock(m_mutex);
+        poll_loop_interrupt();
+      }
     }
 
     void schedule_removal(IOHandler *handler) {
@@ -91,8 +137,48 @@ namespace Hypertable {
 
     void handle_timeouts(PollTimeout &next_timeout);
 
+    /**
+     * Records the calling thread as the reactor thread.  Called by
+     * ReactorRunner before entering the poll loop.
+     */
+    void set_thread() {
+      m_thread = pthread_self();
+      m_thread_set = true;
+    }
+
+    bool on_reactor_thread() {
+      return m_thread_set && pthread_equal(m_thread, pthread_self());
+    }
+
+    /**
+     * Records send system calls made, and messages completely written, by
+     * the connections of this reactor.
+     */
+    void record_send(int syscalls, int messages) {
+      atomic_add(syscalls, &m_send_syscalls);
+      atomic_add(messages, &m_messages_sent);
+    }
+
+    /**
+     * Returns the number of send system calls and messages sent since the
+     * reactor was started.  The counters wrap around at 2^32.
+     */
+    void get_send_stats(uint32_t *syscalls, uint32_t *messages) {
+      *syscalls = (uint32_t)atomic_read(&m_send_syscalls);
+      *messages = (uint32_t)atomic_read(&m_messages_sent);
+    }
+
+    /**
+     * Returns the pool from which the connections of this reactor allocate
+     * incoming message buffers.
+     */
+    BufferPool *receive_pool() { return m_receive_pool.get(); }
+
 #if defined(__linux__)
     int poll_fd;
+    /** io_uring poller used instead of poll_fd when that backend is
+     * selected, otherwise null */
+    UringPoller *uring;
 #elif defined (__APPLE__)
     int kqd;
 #endif
@@ -101,16 +187,73 @@ namespace Hypertable {
     void poll_loop_continue();
 
   protected:
-    typedef std::priority_queue<ExpireTimer, std::vector<ExpireTimer>, LtTimer>
-            TimerHeap;
+
+    struct PendingRequest {
+      uint32_t         id;
+      IOHandler       *handler;
+      DispatchHandler *dh;
+      uint64_t         expire_tick;
+      int64_t          send_time;
+    };
+
+    class TimerNode : public TimerWheel::Entry {
+    public:
+      DispatchHandler *handler;
+    };
+
+    /**
+     * Converts an absolute time to a tick (millisecond) relative to the
+     * reactor's creation time, rounding up for expiration times
+     */
+    uint64_t to_tick(const boost::xtime &xt, bool round_up) {
+      int64_t nanos = ((int64_t)xt.sec - (int64_t)m_base_time.sec)
+          * 1000000000LL + ((int64_t)xt.nsec - (int64_t)m_base_time.nsec);
+      if (nanos <= 0)
+        return 0;
+      return round_up ? (nanos + 999999) / 1000000 : nanos / 1000000;
+    }
+
+    /**
+     * Lowers the scheduled wakeup to expire_tick if it is earlier.  Called
+     * with m_pending_mutex held.  Returns true if the poll loop needs to be
+     * interrupted to honor the new wakeup.
+     */
+    bool schedule_wakeup(uint64_t expire_tick) {
+      if (m_wakeup_scheduled && m_next_wakeup_tick <= expire_tick)
+        return false;
+      m_wakeup_scheduled = true;
+      m_next_wakeup_tick = expire_tick;
+      return true;
+    }
+
+    void insert_timer(DispatchHandler *handler, uint64_t expire_tick) {
+      TimerNode *node = new TimerNode;
+      node->handler = handler;
+      m_timer_wheel.insert(node, expire_tick);
+    }
+
+    void drain_pending();
+    void drain_pending_locked();
 
     Mutex           m_mutex;
+    boost::xtime    m_base_time;
     RequestCache    m_request_cache;
-    TimerHeap       m_timer_heap;
+    TimerWheel      m_timer_wheel;
     int             m_interrupt_sd;
     bool            m_interrupt_in_progress;
-    boost::xtime    m_next_wakeup;
+    pthread_t       m_thread;
+    volatile bool   m_thread_set;
+
+    /** Requests and timers added by threads other than the reactor's */
+    Mutex           m_pending_mutex;
+    std::vector<PendingRequest> m_pending_requests;
+    std::vector<ExpireTimer> m_pending_timers;
+    bool            m_wakeup_scheduled;
+    uint64_t        m_next_wakeup_tick;
     std::set<IOHandler *> m_removed_handlers;
+    atomic_t        m_send_syscalls;
+    atomic_t        m_messages_sent;
+    BufferPoolPtr   m_receive_pool;
   };
 
   typedef intrusive_ptr<Reactor> ReactorPtr;
@@ -20,8 +20,11 @@
  */
 
 #include "Common/Compat.h"
+#include "Common/Config.h"
+#include "Common/Logger.h"
 
 #include "HandlerMap.h"
+#include "InflateQueue.h"
 #include "ReactorFactory.h"
 #include "ReactorRunner.h"
 using namespace Hypertable;
@@ -37,6 +40,8 @@ boost::thread_group ReactorFactory::ms_threads;
 Mutex        ReactorFactory::ms_mutex;
 atomic_t     ReactorFactory::ms_next_reactor = ATOMIC_INIT(0);
 bool         ReactorFactory::ms_epollet = true;
+bool         ReactorFactory::ms_use_io_uring = false;
+size_t       ReactorFactory::ms_receive_pool_size = 64 * 1024 * 1024;
 
 /**
  */
@@ -49,8 +54,24 @@ void ReactorFactory::initialize(uint16_t reactor_count) {
   ReactorRunner::ms_handler_map_ptr = new HandlerMap();
   signal(SIGPIPE, SIG_IGN);
   assert(reactor_count > 0);
+
+#if defined(__linux__)
+  if (Config::properties &&
+      Config::properties->get_str("Comm.Reactor.Backend") == "io_uring")
+    ms_use_io_uring = true;
+  if (ms_use_io_uring && !UringPoller::supported()) {
+    HT_WARN("io_uring reactor backend not supported, using epoll");
+    ms_use_io_uring = false;
+  }
+  // io_uring polls are edge-triggered
+  if (ms_use_io_uring)
+    ms_epollet = true;
+#else
+  ms_use_io_uring = false;
+#endif
+
   for (uint16_t i=0; i<reactor_count; i++) {
-    reactor_ptr = new Reactor();
+    reactor_ptr = new Reactor(ms_receive_pool_size);
     ms_reactors.push_back(reactor_ptr);
     rrunner.set_reactor(reactor_ptr);
     ms_threads.create_thread(rrunner);
@@ -62,6 +83,7 @@ void ReactorFactory::destroy() {
   for (size_t i=0; i<ms_reactors.size(); i++)
     ms_reactors[i]->poll_loop_interrupt();
   ms_threads.join_all();
+  InflateQueue::destroy();
   ms_reactors.clear();
   ReactorRunner::ms_handler_map_ptr = 0;
 }
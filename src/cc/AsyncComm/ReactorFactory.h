@@ -72,6 +72,17 @@ namespace Hypertable {
 
     static bool ms_epollet;
 
+    /** True if the reactors use the io_uring backend instead of epoll.
+     * Set by initialize from Comm.Reactor.Backend, or by the application
+     * before calling it.
+     */
+    static bool ms_use_io_uring;
+
+    /** Byte limit of the receive buffer pool of each reactor.  Takes effect
+     * for reactors created by a subsequent call to initialize.
+     */
+    static size_t ms_receive_pool_size;
+
   private:
     static Mutex        ms_mutex;
     static atomic_t ms_next_reactor;
@@ -64,11 +64,17 @@ void ReactorRunner::operator()() {
 
   uint32_t dispatch_delay = Config::properties->get_i32("Comm.DispatchDelay");
 
+  m_reactor_ptr->set_thread();
+
 #if defined(__linux__)
   struct epoll_event events[256];
+  UringPoller::Received received[256];
 
-  while ((n = epoll_wait(m_reactor_ptr->poll_fd, events, 256,
-          timeout.get_millis())) >= 0 || errno == EINTR) {
+  while ((n = m_reactor_ptr->uring
+          ? m_reactor_ptr->uring->wait(events, received, 256,
+                                       timeout.get_millis())
+          : epoll_wait(m_reactor_ptr->poll_fd, events, 256,
+                       timeout.get_millis())) >= 0 || errno == EINTR) {
 
     if (ms_record_arrival_clocks)
       got_clocks = false;
@@ -92,7 +98,10 @@ void ReactorRunner::operator()() {
           arrival_clocks = std::clock();
           got_clocks = true;
         }
-        if (handler && handler->handle_event(&events[i], arrival_clocks)) {
+        if (handler && (m_reactor_ptr->uring && received[i].recv
+            ? ((IOHandlerData *)handler)->handle_received(received[i],
+                                                          arrival_clocks)
+            : handler->handle_event(&events[i], arrival_clocks))) {
           ms_handler_map_ptr->decomission_handler(handler->get_address());
           removed_handlers.insert(handler);
         }
@@ -161,7 +170,9 @@ ReactorRunner::cleanup_and_remove_handlers(std::set<IOHandler *> &handlers) {
 #if defined(__linux__)
     struct epoll_event event;
     memset(&event, 0, sizeof(struct epoll_event));
-    if (epoll_ctl(m_reactor_ptr->poll_fd, EPOLL_CTL_DEL, handler->get_sd(), &event) < 0) {
+    if (m_reactor_ptr->uring)
+      m_reactor_ptr->uring->remove(handler->get_poll_id());
+    else if (epoll_ctl(m_reactor_ptr->poll_fd, EPOLL_CTL_DEL, handler->get_sd(), &event) < 0) {
       if (!ms_shutdown)
         HT_ERRORF("epoll_ctl(EPOLL_CTL_DEL, %d) failure, %s", handler->get_sd(),
                   strerror(errno));
@@ -32,9 +32,16 @@ using namespace std;
 #include "RequestCache.h"
 using namespace Hypertable;
 
+RequestCache::~RequestCache() {
+  for (IdHandlerMap::iterator iter = m_id_map.begin();
+       iter != m_id_map.end(); ++iter)
+    delete (*iter).second;
+}
+
+
 void
 RequestCache::insert(uint32_t id, IOHandler *handler, DispatchHandler *dh,
-                     boost::xtime &expire) {
+                     uint64_t expire_tick, int64_t send_time) {
   CacheNode *node = new CacheNode;
 
   HT_DEBUGF("Adding id %d", id);
@@ -46,24 +53,14 @@ RequestCache::insert(uint32_t id, IOHandler *handler, DispatchHandler *dh,
   node->id = id;
   node->handler = handler;
   node->dh = dh;
-  memcpy(&node->expire, &expire, sizeof(expire));
-
-  if (m_head == 0) {
-    node->next = node->prev = 0;
-    m_head = m_tail = node;
-  }
-  else {
-    node->next = m_tail;
-    node->next->prev = node;
-    node->prev = 0;
-    m_tail = node;
-  }
+  node->send_time = send_time;
 
+  m_wheel.insert(node, expire_tick);
   m_id_map[id] = node;
 }
 
 
-DispatchHandler *RequestCache::remove(uint32_t id) {
+DispatchHandler *RequestCache::remove(uint32_t id, int64_t *send_timep) {
 
   HT_DEBUGF("Removing id %d", id);
 
@@ -76,70 +73,52 @@ DispatchHandler *RequestCache::remove(uint32_t id) {
 
   CacheNode *node = (*iter).second;
 
-  if (node->prev == 0)
-    m_tail = node->next;
-  else
-    node->prev->next = node->next;
-
-  if (node->next == 0)
-    m_head = node->prev;
-  else
-    node->next->prev = node->prev;
-
+  m_wheel.remove(node);
   m_id_map.erase(iter);
 
   DispatchHandler *dh = node->dh;
+  if (send_timep)
+    *send_timep = node->send_time;
   delete node;
   return dh;
 }
 
 
 
-DispatchHandler *
-RequestCache::get_next_timeout(boost::xtime &now, IOHandler *&handlerp,
-                               boost::xtime *next_timeout) {
-
-  while (m_head && xtime_cmp(m_head->expire, now) <= 0) {
-
-    IdHandlerMap::iterator iter = m_id_map.find(m_head->id);
-    assert (iter != m_id_map.end());
-    CacheNode *node = m_head;
-    if (m_head->prev) {
-      m_head = m_head->prev;
-      m_head->next = 0;
-    }
-    else
-      m_head = m_tail = 0;
-
-    m_id_map.erase(iter);
-
-    if (node->handler != 0) {
-      handlerp = node->handler;
-      DispatchHandler *dh = node->dh;
-      delete node;
-      return dh;
-    }
+void
+RequestCache::get_timeouts(uint64_t now_tick, std::vector<Timeout> &timeouts) {
+  Timeout timeout;
+
+  m_expired.clear();
+  m_wheel.advance(now_tick, m_expired);
+
+  foreach(TimerWheel::Entry *entry, m_expired) {
+    CacheNode *node = static_cast<CacheNode *>(entry);
+    m_id_map.erase(node->id);
+    timeout.handler = node->handler;
+    timeout.dh = node->dh;
+    timeouts.push_back(timeout);
     delete node;
   }
-
-  if (m_head)
-    memcpy(next_timeout, &m_head->expire, sizeof(boost::xtime));
-  else
-    memset(next_timeout, 0, sizeof(boost::xtime));
-
-  return 0;
 }
 
 
 
 void RequestCache::purge_requests(IOHandler *handler, int32_t error) {
-  for (CacheNode *node = m_tail; node != 0; node = node->next) {
-    if (node->handler == handler) {
-      HT_DEBUGF("Purging request id %d", node->id);
-      handler->deliver_event(new Event(Event::ERROR, ((IOHandlerData *)handler)->get_address(),
-                                       error), node->dh);
-      node->handler = 0;  // mark for deletion
-    }
+  std::vector<CacheNode *> purged;
+
+  for (IdHandlerMap::iterator iter = m_id_map.begin();
+       iter != m_id_map.end(); ++iter) {
+    if ((*iter).second->handler == handler)
+      purged.push_back((*iter).second);
   }
-}
 
+  foreach(CacheNode *node, purged) {
+    HT_DEBUGF("Purging request id %d", node->id);
+    m_wheel.remove(node);
+    m_id_map.erase(node->id);
+    handler->deliver_event(new Event(Event::ERROR, ((IOHandlerData *)handler)->get_address(),
+                                     error), node->dh);
+    delete node;
+  }
+}
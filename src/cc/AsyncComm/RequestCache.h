@@ -23,45 +23,69 @@
 #ifndef HYPERTABLE_REQUESTCACHE_H
 #define HYPERTABLE_REQUESTCACHE_H
 
-#include <boost/thread/xtime.hpp>
+#include <vector>
 
 #include "Common/HashMap.h"
 
 #include "DispatchHandler.h"
+#include "TimerWheel.h"
 
 namespace Hypertable {
 
   class IOHandler;
 
+  /**
+   * Outstanding requests of a reactor, indexed by request id and by
+   * expiration tick.  Timeouts are kept in a TimerWheel so that inserting
+   * and removing a request are O(1).  Not thread safe; the reactor only
+   * touches it from its own thread.
+   */
   class RequestCache {
 
-    struct CacheNode {
-      struct CacheNode  *prev, *next;
-      boost::xtime       expire;
+    class CacheNode : public TimerWheel::Entry {
+    public:
       uint32_t           id;
       IOHandler         *handler;
       DispatchHandler   *dh;
+      int64_t            send_time;
     };
 
     typedef hash_map<uint32_t, CacheNode *> IdHandlerMap;
 
   public:
 
-    RequestCache() : m_id_map(), m_head(0), m_tail(0) { return; }
+    struct Timeout {
+      IOHandler       *handler;
+      DispatchHandler *dh;
+    };
+
+    RequestCache(uint64_t now_tick) : m_id_map(), m_wheel(now_tick) { }
+    ~RequestCache();
 
     void insert(uint32_t id, IOHandler *handler, DispatchHandler *dh,
-                boost::xtime &expire);
+                uint64_t expire_tick, int64_t send_time = 0);
+
+    /**
+     * Removes a request and returns its dispatch handler, or 0 if the id
+     * is unknown.  If send_timep is given it receives the send_time passed
+     * to insert().
+     */
+    DispatchHandler *remove(uint32_t id, int64_t *send_timep = 0);
 
-    DispatchHandler *remove(uint32_t id);
+    /**
+     * Removes the requests that expire at or before now_tick and appends
+     * them to timeouts.
+     */
+    void get_timeouts(uint64_t now_tick, std::vector<Timeout> &timeouts);
 
-    DispatchHandler *get_next_timeout(boost::xtime &now, IOHandler *&handlerp,
-                                      boost::xtime *next_timeout);
+    bool next_expiry(uint64_t *tickp) { return m_wheel.next_expiry(tickp); }
 
     void purge_requests(IOHandler *handler, int32_t error);
 
   private:
     IdHandlerMap  m_id_map;
-    CacheNode    *m_head, *m_tail;
+    TimerWheel    m_wheel;
+    std::vector<TimerWheel::Entry *> m_expired;
   };
 }
 
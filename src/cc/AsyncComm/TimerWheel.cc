@@ -0,0 +1,201 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include <algorithm>
+
+#include "Common/Logger.h"
+
+#include "TimerWheel.h"
+
+using namespace Hypertable;
+
+
+TimerWheel::TimerWheel(uint64_t now_tick)
+  : m_current(now_tick), m_count(0), m_root_count(0) {
+  for (int i=0; i<ROOT_SIZE; i++)
+    m_root[i].prev = m_root[i].next = &m_root[i];
+  for (int level=0; level<LEVELS-1; level++)
+    for (int i=0; i<LEVEL_SIZE; i++)
+      m_levels[level][i].prev = m_levels[level][i].next = &m_levels[level][i];
+}
+
+
+void TimerWheel::insert(Entry *entry, uint64_t expire_tick) {
+  HT_ASSERT(!entry->linked());
+  entry->expire_tick = expire_tick;
+  link(entry);
+  m_count++;
+}
+
+
+void TimerWheel::remove(Entry *entry) {
+  HT_ASSERT(entry->linked());
+  entry->prev->next = entry->next;
+  entry->next->prev = entry->prev;
+  entry->prev = entry->next = 0;
+  if (entry->level == 0)
+    m_root_count--;
+  m_count--;
+}
+
+
+void TimerWheel::advance(uint64_t now_tick, std::vector<Entry *> &expired) {
+
+  while (m_current <= now_tick) {
+
+    if (m_count == 0) {
+      m_current = now_tick + 1;
+      return;
+    }
+
+    // Skip to the next revolution of the root wheel if it is empty
+    if (m_root_count == 0) {
+      uint64_t next_wrap = (m_current | (ROOT_SIZE-1)) + 1;
+      if (next_wrap > now_tick + 1) {
+        m_current = now_tick + 1;
+        return;
+      }
+      set_current(next_wrap);
+      continue;
+    }
+
+    Entry *head = &m_root[m_current & (ROOT_SIZE-1)];
+    while (head->next != head) {
+      Entry *entry = head->next;
+      remove(entry);
+      expired.push_back(entry);
+    }
+    set_current(m_current + 1);
+  }
+}
+
+
+bool TimerWheel::next_expiry(uint64_t *tickp) {
+  if (m_count == 0)
+    return false;
+
+  if (m_root_count) {
+    int index = (int)(m_current & (ROOT_SIZE-1));
+    uint64_t next_wrap = (m_current | (ROOT_SIZE-1)) + 1;
+    for (int i=0; i<ROOT_SIZE; i++) {
+      Entry *head = &m_root[(index + i) & (ROOT_SIZE-1)];
+      if (head->next != head) {
+        // slots past a wrap are only reached after the cascade
+        *tickp = std::min(m_current + i, next_wrap);
+        return true;
+      }
+    }
+  }
+  *tickp = (m_current | (ROOT_SIZE-1)) + 1;
+  return true;
+}
+
+
+void TimerWheel::drain(std::vector<Entry *> &entries) {
+  for (int level=0; level<LEVELS; level++) {
+    int size = level == 0 ? ROOT_SIZE : LEVEL_SIZE;
+    for (int i=0; i<size; i++) {
+      Entry *head = slot(level, i);
+      while (head->next != head) {
+        Entry *entry = head->next;
+        remove(entry);
+        entries.push_back(entry);
+      }
+    }
+  }
+}
+
+
+/**
+ * Places an entry in the slot that covers its expire tick.  Expire ticks
+ * in the past go in the current root slot and ticks beyond the range of
+ * the wheel are clamped to its end.
+ */
+void TimerWheel::link(Entry *entry) {
+  uint64_t expire = entry->expire_tick;
+  if (expire < m_current)
+    expire = m_current;
+  uint64_t delta = expire - m_current;
+  int level, index;
+
+  if (delta < (uint64_t)ROOT_SIZE) {
+    level = 0;
+    index = (int)(expire & (ROOT_SIZE-1));
+  }
+  else {
+    int shift = ROOT_BITS;
+    for (level=1; level<LEVELS-1; level++, shift += LEVEL_BITS) {
+      if (delta < ((uint64_t)1 << (shift + LEVEL_BITS)))
+        break;
+    }
+    if (level == LEVELS-1
+        && delta >= ((uint64_t)1 << (shift + LEVEL_BITS)))
+      expire = m_current + ((uint64_t)1 << (shift + LEVEL_BITS)) - 1;
+    index = (int)((expire >> shift) & (LEVEL_SIZE-1));
+  }
+
+  Entry *head = slot(level, index);
+  entry->level = level;
+  entry->next = head;
+  entry->prev = head->prev;
+  head->prev->next = entry;
+  head->prev = entry;
+  if (level == 0)
+    m_root_count++;
+}
+
+
+/**
+ * Moves the current tick forward.  When it reaches the start of a root
+ * wheel revolution, the matching slots of the outer wheels are cascaded.
+ */
+void TimerWheel::set_current(uint64_t tick) {
+  m_current = tick;
+  if ((m_current & (ROOT_SIZE-1)) == 0) {
+    for (int level=1; level<LEVELS; level++) {
+      int shift = ROOT_BITS + (level-1)*LEVEL_BITS;
+      int index = (int)((m_current >> shift) & (LEVEL_SIZE-1));
+      cascade(level, index);
+      if (index != 0)
+        break;
+    }
+  }
+}
+
+
+/**
+ * Re-inserts the entries of a slot of an outer wheel, which moves them one
+ * or more wheels inward.
+ */
+void TimerWheel::cascade(int level, int index) {
+  Entry *head = slot(level, index);
+  Entry *entry = head->next;
+
+  head->prev = head->next = head;
+  while (entry != head) {
+    Entry *next = entry->next;
+    entry->prev = entry->next = 0;
+    link(entry);
+    entry = next;
+  }
+}
@@ -0,0 +1,114 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_TIMERWHEEL_H
+#define HYPERTABLE_TIMERWHEEL_H
+
+#include <vector>
+
+namespace Hypertable {
+
+  /**
+   * Hashed hierarchical timer wheel.  Time is measured in integral ticks.
+   * The root wheel has 256 slots of one tick each and is followed by four
+   * wheels of 64 slots, each slot spanning a full revolution of the wheel
+   * below it, for a range of 2^32 ticks.  Entries are intrusive, so insert
+   * and remove are O(1); entries of the outer wheels are cascaded inward
+   * as the root wheel wraps.  The wheel does not own its entries and is not
+   * thread safe.
+   */
+  class TimerWheel {
+
+  public:
+
+    class Entry {
+    public:
+      Entry() : prev(0), next(0), expire_tick(0), level(0) { }
+      bool linked() const { return next != 0; }
+      Entry *prev, *next;
+      uint64_t expire_tick;
+      int level;
+    };
+
+    static const int ROOT_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const int LEVELS = 5;
+
+    /**
+     * Constructor.
+     *
+     * @param now_tick current tick
+     */
+    TimerWheel(uint64_t now_tick);
+
+    /**
+     * Adds an entry that expires at expire_tick.  An expire tick that has
+     * already passed expires on the next call to advance().
+     */
+    void insert(Entry *entry, uint64_t expire_tick);
+
+    /** Removes a linked entry */
+    void remove(Entry *entry);
+
+    /**
+     * Moves the wheel forward to now_tick and unlinks every entry that
+     * expires at or before it, appending it to expired.
+     */
+    void advance(uint64_t now_tick, std::vector<Entry *> &expired);
+
+    /**
+     * Returns the tick at or after which the next call to advance() may
+     * expire an entry.  When the root wheel is empty this is the tick at
+     * which the next cascade happens, so the value is never later than the
+     * earliest expire tick.
+     *
+     * @param tickp address of variable to hold the tick
+     * @return false if the wheel is empty
+     */
+    bool next_expiry(uint64_t *tickp);
+
+    /** Unlinks every entry, appending it to entries */
+    void drain(std::vector<Entry *> &entries);
+
+    size_t size() { return m_count; }
+
+  private:
+    static const int ROOT_SIZE = 1 << ROOT_BITS;
+    static const int LEVEL_SIZE = 1 << LEVEL_BITS;
+
+    Entry *slot(int level, int index) {
+      return level == 0 ? &m_root[index]
+                        : &m_levels[level-1][index];
+    }
+    void link(Entry *entry);
+    void set_current(uint64_t tick);
+    void cascade(int level, int index);
+
+    Entry m_root[ROOT_SIZE];
+    Entry m_levels[LEVELS-1][LEVEL_SIZE];
+    uint64_t m_current;
+    size_t m_count;
+    size_t m_root_count;
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_TIMERWHEEL_H
@@ -0,0 +1,603 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#if defined(__linux__)
+
+extern "C" {
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#if defined(HT_WITH_IO_URING)
+#include <linux/io_uring.h>
+#endif
+}
+
+#include <algorithm>
+
+#include "Common/Error.h"
+#include "Common/Logger.h"
+
+#include "UringPoller.h"
+
+using namespace Hypertable;
+
+#if defined(HT_WITH_IO_URING)
+
+namespace {
+
+  /** user_data of requests whose completions carry no event */
+  const uint64_t INTERNAL_REQUEST_ID = 0;
+
+  /** user_data bit that marks the recv request of a registration */
+  const uint64_t RECV_REQUEST_BIT = 1ULL << 63;
+
+  /** Registered recv buffers; the count must be a power of two */
+  const uint16_t RECV_BUFFER_COUNT = 128;
+  const uint32_t RECV_BUFFER_SIZE = 16384;
+  const uint16_t RECV_BUFFER_GROUP = 0;
+
+  int uring_setup(unsigned entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+  }
+
+  /**
+   * Multishot recv arrived in Linux 6.0, after the last io_uring feature
+   * bit that could tell it apart
+   */
+  bool kernel_has_multishot_recv() {
+    struct utsname name;
+    int major = 0, minor = 0;
+    if (uname(&name) < 0 || sscanf(name.release, "%d.%d", &major, &minor) < 2)
+      return false;
+    return major >= 6;
+  }
+
+}
+
+
+bool UringPoller::supported() {
+  struct io_uring_params params;
+  int fd;
+
+  memset(&params, 0, sizeof(params));
+  if ((fd = uring_setup(2, &params)) < 0)
+    return false;
+  close(fd);
+
+  // IORING_FEAT_RSRC_TAGS arrived in 5.13 together with multishot poll
+  return (params.features & IORING_FEAT_EXT_ARG) &&
+      (params.features & IORING_FEAT_RSRC_TAGS);
+}
+
+
+UringPoller::UringPoller(unsigned entries)
+  : m_sq_ring(0), m_cq_ring(0), m_sqes(0), m_unsubmitted(0), m_next_id(1),
+    m_sqe_in_ring(false), m_recv_ring(0), m_recv_buffers(0), m_recv_tail(0) {
+  struct io_uring_params params;
+  uint8_t *sq_ring, *cq_ring;
+
+  // A full completion queue terminates multishot polls, so make it roomy
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = entries * 8;
+  if ((m_ring_fd = uring_setup(entries, &params)) < 0)
+    HT_THROWF(Error::COMM_POLL_ERROR, "io_uring_setup(%u) failed - %s",
+              entries, strerror(errno));
+
+  m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  m_cq_ring_size = params.cq_off.cqes
+      + params.cq_entries * sizeof(struct io_uring_cqe);
+  m_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (m_cq_ring_size > m_sq_ring_size)
+      m_sq_ring_size = m_cq_ring_size;
+    m_cq_ring_size = 0;
+  }
+
+  m_sq_ring = mmap(0, m_sq_ring_size, PROT_READ|PROT_WRITE,
+                   MAP_SHARED|MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+  if (m_sq_ring == MAP_FAILED)
+    HT_THROWF(Error::COMM_POLL_ERROR, "mmap(io_uring SQ ring) failed - %s",
+              strerror(errno));
+
+  if (m_cq_ring_size) {
+    m_cq_ring = mmap(0, m_cq_ring_size, PROT_READ|PROT_WRITE,
+                     MAP_SHARED|MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+    if (m_cq_ring == MAP_FAILED)
+      HT_THROWF(Error::COMM_POLL_ERROR, "mmap(io_uring CQ ring) failed - %s",
+                strerror(errno));
+  }
+
+  m_sqes = mmap(0, m_sqes_size, PROT_READ|PROT_WRITE,
+                MAP_SHARED|MAP_POPULATE, m_ring_fd, IORING_OFF_SQES);
+  if (m_sqes == MAP_FAILED)
+    HT_THROWF(Error::COMM_POLL_ERROR, "mmap(io_uring SQEs) failed - %s",
+              strerror(errno));
+
+  sq_ring = (uint8_t *)m_sq_ring;
+  cq_ring = m_cq_ring_size ? (uint8_t *)m_cq_ring : sq_ring;
+
+  m_sq_head = (unsigned *)(sq_ring + params.sq_off.head);
+  m_sq_tail = (unsigned *)(sq_ring + params.sq_off.tail);
+  m_sq_mask = (unsigned *)(sq_ring + params.sq_off.ring_mask);
+  m_sq_array = (unsigned *)(sq_ring + params.sq_off.array);
+  m_sq_entries = params.sq_entries;
+
+  m_cq_head = (unsigned *)(cq_ring + params.cq_off.head);
+  m_cq_tail = (unsigned *)(cq_ring + params.cq_off.tail);
+  m_cq_mask = (unsigned *)(cq_ring + params.cq_off.ring_mask);
+  m_cqes = cq_ring + params.cq_off.cqes;
+
+  setup_recv_buffers();
+}
+
+
+UringPoller::~UringPoller() {
+  if (m_sqes && m_sqes != MAP_FAILED)
+    munmap(m_sqes, m_sqes_size);
+  if (m_cq_ring && m_cq_ring != MAP_FAILED)
+    munmap(m_cq_ring, m_cq_ring_size);
+  if (m_sq_ring && m_sq_ring != MAP_FAILED)
+    munmap(m_sq_ring, m_sq_ring_size);
+  close(m_ring_fd);
+  // the kernel lets go of the recv buffers when the ring is closed
+  if (m_recv_buffers)
+    munmap(m_recv_buffers, (size_t)RECV_BUFFER_COUNT * RECV_BUFFER_SIZE);
+  if (m_recv_ring)
+    munmap(m_recv_ring, RECV_BUFFER_COUNT * sizeof(struct io_uring_buf));
+}
+
+
+/**
+ * Registers the ring of buffers that multishot recv requests pick from.
+ * If the kernel can't do that, recv_supported() returns false and data
+ * sockets fall back to readiness polling.
+ */
+void UringPoller::setup_recv_buffers() {
+#if defined(IORING_RECV_MULTISHOT)
+  struct io_uring_buf_reg reg;
+  size_t ring_size = RECV_BUFFER_COUNT * sizeof(struct io_uring_buf);
+  size_t buffers_size = (size_t)RECV_BUFFER_COUNT * RECV_BUFFER_SIZE;
+  void *ring, *buffers;
+
+  if (!kernel_has_multishot_recv())
+    return;
+
+  ring = mmap(0, ring_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS,
+              -1, 0);
+  if (ring == MAP_FAILED)
+    return;
+  buffers = mmap(0, buffers_size, PROT_READ|PROT_WRITE,
+                 MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (buffers == MAP_FAILED) {
+    munmap(ring, ring_size);
+    return;
+  }
+
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uint64_t)(uintptr_t)ring;
+  reg.ring_entries = RECV_BUFFER_COUNT;
+  reg.bgid = RECV_BUFFER_GROUP;
+  if (syscall(__NR_io_uring_register, m_ring_fd, IORING_REGISTER_PBUF_RING,
+              &reg, 1) < 0) {
+    HT_INFOF("io_uring recv buffer ring unavailable (%s), polling data "
+             "sockets for readiness", strerror(errno));
+    munmap(buffers, buffers_size);
+    munmap(ring, ring_size);
+    return;
+  }
+
+  m_recv_ring = ring;
+  m_recv_buffers = (uint8_t *)buffers;
+  for (uint16_t bid=0; bid<RECV_BUFFER_COUNT; bid++)
+    m_recv_handed_out.push_back(bid);
+  recycle_recv_buffers();
+#endif
+}
+
+
+/**
+ * Puts the buffers handed out by the last wait() back into the recv
+ * buffer ring.  Called from the reactor thread only.
+ */
+void UringPoller::recycle_recv_buffers() {
+#if defined(IORING_RECV_MULTISHOT)
+  struct io_uring_buf *bufs = (struct io_uring_buf *)m_recv_ring;
+
+  if (m_recv_handed_out.empty())
+    return;
+
+  foreach(uint16_t bid, m_recv_handed_out) {
+    struct io_uring_buf *buf = &bufs[m_recv_tail & (RECV_BUFFER_COUNT - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(m_recv_buffers
+                                      + (size_t)bid * RECV_BUFFER_SIZE);
+    buf->len = RECV_BUFFER_SIZE;
+    buf->bid = bid;
+    m_recv_tail++;
+  }
+  m_recv_handed_out.clear();
+
+  // the ring tail overlays the reserved field of the first entry
+  __atomic_store_n(&bufs[0].resv, m_recv_tail, __ATOMIC_RELEASE);
+#endif
+}
+
+
+uint64_t UringPoller::add(IOHandler *handler, int sd, uint32_t events) {
+  ScopedLock lock(m_mutex);
+  uint64_t id = m_next_id++;
+  Registration &registration = m_registrations[id];
+
+  registration.handler = handler;
+  registration.sd = sd;
+  registration.events = events;
+  registration.recv = false;
+  prep_poll_add(id, sd, events);
+
+  if (enter(m_unsubmitted, 0, 0, 0, 0) < 0)
+    HT_ERRORF("io_uring_enter(submit) failed - %s", strerror(errno));
+  return id;
+}
+
+
+uint64_t UringPoller::add_recv(IOHandler *handler, int sd, uint32_t events) {
+  ScopedLock lock(m_mutex);
+  uint64_t id = m_next_id++;
+  Registration &registration = m_registrations[id];
+
+  HT_ASSERT(m_recv_buffers);
+
+  registration.handler = handler;
+  registration.sd = sd;
+  registration.events = events;
+  registration.recv = true;
+  prep_poll_add(id, sd, events);
+  prep_recv(id, sd);
+
+  if (enter(m_unsubmitted, 0, 0, 0, 0) < 0)
+    HT_ERRORF("io_uring_enter(submit) failed - %s", strerror(errno));
+  return id;
+}
+
+
+void UringPoller::remove(uint64_t id) {
+  ScopedLock lock(m_mutex);
+  RegistrationMap::iterator iter = m_registrations.find(id);
+  struct io_uring_sqe *sqe;
+
+  if (iter == m_registrations.end())
+    return;
+
+  if (iter->second.recv) {
+    sqe = (struct io_uring_sqe *)get_sqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = id | RECV_REQUEST_BIT;
+    sqe->user_data = INTERNAL_REQUEST_ID;
+    commit_sqe();
+  }
+
+  m_registrations.erase(iter);
+
+  sqe = (struct io_uring_sqe *)get_sqe();
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = id;
+  sqe->user_data = INTERNAL_REQUEST_ID;
+  commit_sqe();
+}
+
+
+int UringPoller::wait(struct epoll_event *events, Received *received,
+                      int maxevents, int timeout_millis) {
+  struct io_uring_getevents_arg arg;
+  struct __kernel_timespec ts;
+  struct io_uring_cqe *cqes = (struct io_uring_cqe *)m_cqes;
+  unsigned to_submit, head, tail;
+  int ret, n = 0;
+
+  // the caller is done with the data returned by the previous call
+  recycle_recv_buffers();
+
+  {
+    ScopedLock lock(m_mutex);
+    flush_sqe_backlog();
+    to_submit = m_unsubmitted;
+    m_unsubmitted = 0;
+  }
+
+  head = *m_cq_head;
+  tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+
+  if (head == tail && timeout_millis != 0) {
+    memset(&arg, 0, sizeof(arg));
+    if (timeout_millis > 0) {
+      ts.tv_sec = timeout_millis / 1000;
+      ts.tv_nsec = (long long)(timeout_millis % 1000) * 1000000LL;
+      arg.ts = (uint64_t)(uintptr_t)&ts;
+    }
+    ret = enter(to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                &arg, sizeof(arg));
+  }
+  else
+    ret = to_submit ? enter(to_submit, 0, 0, 0, 0) : 0;
+
+  if (ret < 0) {
+    // nothing was submitted; leave the entries for the next call
+    int saved_errno = errno;
+    ScopedLock lock(m_mutex);
+    m_unsubmitted += to_submit;
+    if (saved_errno != ETIME && saved_errno != EBUSY) {
+      errno = saved_errno;
+      return -1;
+    }
+  }
+
+  ScopedLock lock(m_mutex);
+
+  tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+  for (; head != tail && n < maxevents; head++) {
+    struct io_uring_cqe *cqe = &cqes[head & *m_cq_mask];
+
+    if (cqe->user_data == INTERNAL_REQUEST_ID)
+      continue;
+
+    if (cqe->user_data & RECV_REQUEST_BIT) {
+      if (handle_recv_completion(cqe, &events[n], &received[n]))
+        n++;
+      continue;
+    }
+
+    RegistrationMap::iterator iter = m_registrations.find(cqe->user_data);
+    if (iter == m_registrations.end())
+      continue;
+
+    // The kernel ends a multishot poll on overflow or error; re-arm it
+    if ((cqe->flags & IORING_CQE_F_MORE) == 0)
+      prep_poll_add(cqe->user_data, iter->second.sd, iter->second.events);
+
+    if (iter->second.handler == 0 || cqe->res == -ECANCELED)
+      continue;
+
+    memset(&events[n], 0, sizeof(struct epoll_event));
+    events[n].events = cqe->res < 0 ? EPOLLERR : (uint32_t)cqe->res;
+    events[n].data.ptr = iter->second.handler;
+    received[n].recv = false;
+    n++;
+  }
+  __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+
+  return n;
+}
+
+
+/**
+ * Returns a cleared submission queue entry for the caller to fill in and
+ * pass to commit_sqe().  If the submission queue is full, the queued
+ * entries are submitted once; if the kernel can't take them (EBUSY when
+ * the completion queue has overflowed), the entry goes to a backlog that
+ * wait() moves into the ring after it has reaped completions.  Never
+ * blocks, so the caller may hold m_mutex while the reactor thread is
+ * waiting for it.  Called with m_mutex held.
+ */
+void *UringPoller::get_sqe() {
+  unsigned tail = *m_sq_tail;
+  struct io_uring_sqe *sqe;
+
+  if (m_sqe_backlog.empty()
+      && tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) >= m_sq_entries) {
+    int ret = enter(m_unsubmitted, 0, 0, 0, 0);
+    if (ret > 0)
+      m_unsubmitted -= std::min((unsigned)ret, m_unsubmitted);
+    else if (ret < 0 && errno != EBUSY && errno != EAGAIN)
+      HT_ERRORF("io_uring_enter(submit) failed - %s", strerror(errno));
+  }
+
+  if (m_sqe_backlog.empty()
+      && tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) < m_sq_entries) {
+    sqe = &((struct io_uring_sqe *)m_sqes)[tail & *m_sq_mask];
+    m_sqe_in_ring = true;
+  }
+  else {
+    // keep submission order behind anything already in the backlog
+    m_sqe_backlog.resize(m_sqe_backlog.size() + sizeof(struct io_uring_sqe));
+    sqe = (struct io_uring_sqe *)&m_sqe_backlog[m_sqe_backlog.size()
+                                                - sizeof(struct io_uring_sqe)];
+    m_sqe_in_ring = false;
+  }
+
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+
+/**
+ * Makes the entry returned by the last get_sqe() visible to the kernel,
+ * unless it went to the backlog.  Called with m_mutex held.
+ */
+void UringPoller::commit_sqe() {
+  if (!m_sqe_in_ring)
+    return;
+  unsigned tail = *m_sq_tail;
+  m_sq_array[tail & *m_sq_mask] = tail & *m_sq_mask;
+  __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+  m_unsubmitted++;
+}
+
+
+/**
+ * Moves backlogged entries into the submission queue as far as it has
+ * room.  Called with m_mutex held.
+ */
+void UringPoller::flush_sqe_backlog() {
+  size_t offset = 0;
+
+  while (offset < m_sqe_backlog.size()) {
+    unsigned tail = *m_sq_tail;
+    if (tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) >= m_sq_entries)
+      break;
+    memcpy(&((struct io_uring_sqe *)m_sqes)[tail & *m_sq_mask],
+           &m_sqe_backlog[offset], sizeof(struct io_uring_sqe));
+    m_sqe_in_ring = true;
+    commit_sqe();
+    offset += sizeof(struct io_uring_sqe);
+  }
+  m_sqe_backlog.erase(m_sqe_backlog.begin(), m_sqe_backlog.begin() + offset);
+}
+
+
+/**
+ * Turns the completion of a multishot recv into an event, holding on to
+ * the buffer it filled until the next wait().  Ended requests are re-armed
+ * unless they ended with EOF or an error, which go to the handler.
+ * Returns false if there is nothing to deliver.  Called with m_mutex held.
+ */
+bool UringPoller::handle_recv_completion(void *vcqe, struct epoll_event *event,
+                                         Received *received) {
+#if defined(IORING_RECV_MULTISHOT)
+  struct io_uring_cqe *cqe = (struct io_uring_cqe *)vcqe;
+  uint64_t id = cqe->user_data & ~RECV_REQUEST_BIT;
+  uint16_t bid = 0;
+
+  if (cqe->flags & IORING_CQE_F_BUFFER) {
+    bid = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+    m_recv_handed_out.push_back(bid);
+  }
+
+  RegistrationMap::iterator iter = m_registrations.find(id);
+  if (iter == m_registrations.end() || cqe->res == -ECANCELED)
+    return false;
+
+  // ran out of buffers; they are recycled before the next submit
+  if (cqe->res == -ENOBUFS) {
+    if ((cqe->flags & IORING_CQE_F_MORE) == 0)
+      prep_recv(id, iter->second.sd);
+    return false;
+  }
+
+  if (cqe->res > 0 && (cqe->flags & IORING_CQE_F_MORE) == 0)
+    prep_recv(id, iter->second.sd);
+
+  memset(event, 0, sizeof(struct epoll_event));
+  event->events = EPOLLIN;
+  event->data.ptr = iter->second.handler;
+  received->recv = true;
+  received->data = 0;
+  received->len = 0;
+  received->error = 0;
+  if (cqe->res > 0) {
+    received->data = m_recv_buffers + (size_t)bid * RECV_BUFFER_SIZE;
+    received->len = (size_t)cqe->res;
+  }
+  else if (cqe->res < 0)
+    received->error = -cqe->res;
+  return true;
+#else
+  (void)vcqe; (void)event; (void)received;
+  return false;
+#endif
+}
+
+
+void UringPoller::prep_poll_add(uint64_t id, int sd, uint32_t events) {
+  struct io_uring_sqe *sqe = (struct io_uring_sqe *)get_sqe();
+
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = sd;
+  sqe->poll32_events = events;
+  sqe->len = IORING_POLL_ADD_MULTI;
+  sqe->user_data = id;
+  commit_sqe();
+}
+
+
+void UringPoller::prep_recv(uint64_t id, int sd) {
+#if defined(IORING_RECV_MULTISHOT)
+  struct io_uring_sqe *sqe = (struct io_uring_sqe *)get_sqe();
+
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = sd;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = RECV_BUFFER_GROUP;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->user_data = id | RECV_REQUEST_BIT;
+  commit_sqe();
+#else
+  (void)id; (void)sd;
+#endif
+}
+
+
+int UringPoller::enter(unsigned to_submit, unsigned min_complete,
+                       unsigned flags, void *arg, size_t argsz) {
+  int ret;
+  do {
+    ret = (int)syscall(__NR_io_uring_enter, m_ring_fd, to_submit,
+                       min_complete, flags, arg, argsz);
+  } while (ret < 0 && errno == EINTR && min_complete == 0);
+  return ret;
+}
+
+#else // HT_WITH_IO_URING
+
+bool UringPoller::supported() {
+  return false;
+}
+
+
+UringPoller::UringPoller(unsigned) {
+  HT_THROW(Error::NOT_IMPLEMENTED, "built without io_uring support");
+}
+
+
+UringPoller::~UringPoller() {
+}
+
+
+uint64_t UringPoller::add(IOHandler *, int, uint32_t) {
+  return 0;
+}
+
+
+uint64_t UringPoller::add_recv(IOHandler *, int, uint32_t) {
+  return 0;
+}
+
+
+void UringPoller::remove(uint64_t) {
+}
+
+
+int UringPoller::wait(struct epoll_event *, Received *, int, int) {
+  errno = ENOSYS;
+  return -1;
+}
+
+#endif // HT_WITH_IO_URING
+
+#endif // __linux__
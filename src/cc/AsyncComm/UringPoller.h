@@ -0,0 +1,184 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_URINGPOLLER_H
+#define HYPERTABLE_URINGPOLLER_H
+
+#if defined(__linux__)
+
+extern "C" {
+#include <sys/epoll.h>
+}
+
+#include <vector>
+
+#include "Common/HashMap.h"
+#include "Common/Mutex.h"
+
+namespace Hypertable {
+
+  class IOHandler;
+
+  /**
+   * Readiness notification for a Reactor built on io_uring.  Each
+   * registered descriptor gets one multishot poll request, so readiness is
+   * reported without re-arming, and the requests the reactor thread queues
+   * (re-arms and removals) are submitted together with the next wait.  The
+   * completions are handed back as epoll_event structures so that the
+   * IOHandler event code is shared with the epoll backend.  Delivery has
+   * edge-triggered semantics, like epoll with EPOLLET.
+   *
+   * Registrations are identified by a sequence number rather than by
+   * handler pointer, so completions that arrive after a handler has been
+   * removed are dropped instead of being delivered to a stale handler.
+   *
+   * Data sockets can instead be registered with add_recv(), which pairs
+   * the poll with a multishot recv that reads into a ring of buffers
+   * registered with the kernel.  Incoming data then arrives with the
+   * completion, so the reactor makes no read() calls and no per-socket
+   * buffer is pinned while a connection sits idle.  This needs Linux 6.0;
+   * recv_supported() tells whether it is available.
+   */
+  class UringPoller {
+
+  public:
+
+    /**
+     * Data returned by a multishot recv along with its event.  For events
+     * that only report readiness, recv is false.  A zero len with no error
+     * means the peer closed the connection.  data stays valid until the
+     * next call to wait().
+     */
+    struct Received {
+      bool           recv;
+      const uint8_t *data;
+      size_t         len;
+      int            error;
+    };
+
+    /**
+     * Returns true if the running kernel supports the io_uring features
+     * this class relies on (multishot poll and timed waits)
+     */
+    static bool supported();
+
+    UringPoller(unsigned entries);
+    ~UringPoller();
+
+    /**
+     * Starts polling sd for the given poll(2) events and submits the
+     * request right away.  May be called from any thread.
+     *
+     * @param handler handler to return in event data, or 0 for a
+     *        descriptor that only needs to wake up the reactor
+     * @param sd socket descriptor
+     * @param events poll events of interest
+     * @return registration id to pass to remove()
+     */
+    uint64_t add(IOHandler *handler, int sd, uint32_t events);
+
+    /**
+     * Like add(), but also starts a multishot recv on sd whose data is
+     * returned through the received array of wait().  events should not
+     * include EPOLLIN.  Only valid if recv_supported() returns true.
+     */
+    uint64_t add_recv(IOHandler *handler, int sd, uint32_t events);
+
+    /**
+     * Returns true if add_recv() can be used
+     */
+    bool recv_supported() { return m_recv_buffers != 0; }
+
+    /**
+     * Stops polling a registration.  No events are returned for it after
+     * this call; the cancellation is submitted with the next wait().
+     */
+    void remove(uint64_t id);
+
+    /**
+     * Submits queued requests and waits for events, like epoll_wait.
+     * Called from the reactor thread only.
+     *
+     * @param events array to receive events
+     * @param received array receiving the recv data of each event
+     * @param maxevents size of events and received
+     * @param timeout_millis maximum time to wait, or -1 for no limit
+     * @return number of events, or -1 with errno set
+     */
+    int wait(struct epoll_event *events, Received *received, int maxevents,
+             int timeout_millis);
+
+  private:
+
+    struct Registration {
+      IOHandler *handler;
+      int        sd;
+      uint32_t   events;
+      bool       recv;
+    };
+
+    typedef hash_map<uint64_t, Registration> RegistrationMap;
+
+    void *get_sqe();
+    void commit_sqe();
+    void flush_sqe_backlog();
+    void prep_poll_add(uint64_t id, int sd, uint32_t events);
+    void prep_recv(uint64_t id, int sd);
+    bool handle_recv_completion(void *cqe, struct epoll_event *event,
+                                Received *received);
+    void setup_recv_buffers();
+    void recycle_recv_buffers();
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags,
+              void *arg, size_t argsz);
+
+    Mutex            m_mutex;
+    int              m_ring_fd;
+    void            *m_sq_ring;
+    void            *m_cq_ring;
+    void            *m_sqes;
+    size_t           m_sq_ring_size;
+    size_t           m_cq_ring_size;
+    size_t           m_sqes_size;
+    unsigned        *m_sq_head;
+    unsigned        *m_sq_tail;
+    unsigned        *m_sq_mask;
+    unsigned        *m_sq_array;
+    unsigned         m_sq_entries;
+    unsigned        *m_cq_head;
+    unsigned        *m_cq_tail;
+    unsigned        *m_cq_mask;
+    void            *m_cqes;
+    unsigned         m_unsubmitted;
+    uint64_t         m_next_id;
+    RegistrationMap  m_registrations;
+    std::vector<uint8_t> m_sqe_backlog;
+    bool             m_sqe_in_ring;
+    void            *m_recv_ring;
+    uint8_t         *m_recv_buffers;
+    uint16_t         m_recv_tail;
+    std::vector<uint16_t> m_recv_handed_out;
+  };
+
+} // namespace Hypertable
+
+#endif // __linux__
+
+#endif // HYPERTABLE_URINGPOLLER_H
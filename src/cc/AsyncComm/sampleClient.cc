@@ -35,6 +35,8 @@ extern "C" {
 #include <pthread.h>
 #include <stdint.h>
 #include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
 #include <time.h>
 }
 
@@ -69,6 +71,10 @@ namespace {
     "  --host=<name>   Specifies the host to connect to (default = localhost)",
     "  --port=<n>      Specifies the port to connect to (default = 11255)",
     "  --reactors=<n>  Specifies the number of reactors (default=1)",
+    "  --io-uring      Use the io_uring reactor backend instead of epoll",
+    "  --benchmark=<n> Send the input file <n> times without echoing the",
+    "                  replies, then report messages per second and client",
+    "                  CPU time per message",
     "  --recv-addr=<addr>  Let the server connect to us by listening for",
     "                  connection request on <addr> (host:port).  The address",
     "                  that the server is connecting from should be the same",
@@ -84,6 +90,22 @@ namespace {
     (const char *)0
   };
   bool g_verbose = false;
+
+  double timeval_seconds(const struct timeval &tv) {
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+  }
+
+  double cpu_seconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return timeval_seconds(usage.ru_utime) + timeval_seconds(usage.ru_stime);
+  }
+
+  double wall_seconds() {
+    struct timeval now;
+    gettimeofday(&now, 0);
+    return timeval_seconds(now);
+  }
 }
 
 
@@ -260,6 +282,10 @@ int main(int argc, char **argv) {
   int max_outstanding = 50;
   const char *str;
   struct sockaddr_in local_addr;
+  int passes = 1;
+  bool benchmark = false;
+  int64_t messages = 0;
+  double start_wall = 0, start_cpu = 0;
 
   Config::init(0, 0);
 
@@ -269,7 +295,6 @@ int main(int argc, char **argv) {
     Usage::dump_and_exit(usage);
 
   System::initialize(System::locate_install_dir(argv[0]));
-  ReactorFactory::initialize(1);
 
   for (int i=1; i<argc; i++) {
     if (!strncmp(argv[i], "--host=", 7))
@@ -288,6 +313,12 @@ int main(int argc, char **argv) {
       udp_mode = true;
     else if (!strncmp(argv[i], "--reactors=", 11))
       reactor_count = atoi(&argv[i][11]);
+    else if (!strcmp(argv[i], "--io-uring"))
+      ReactorFactory::ms_use_io_uring = true;
+    else if (!strncmp(argv[i], "--benchmark=", 12)) {
+      passes = atoi(&argv[i][12]);
+      benchmark = true;
+    }
     else if (!strncmp(argv[i], "--recv-addr=", 12)) {
       if (!InetAddr::initialize(&local_addr, &argv[i][12]))
         HT_ABORT;
@@ -304,6 +335,8 @@ int main(int argc, char **argv) {
   if (in_file == 0)
     Usage::dump_and_exit(usage);
 
+  ReactorFactory::initialize(reactor_count);
+
   if (!InetAddr::initialize(&addr, host, port))
     exit(1);
 
@@ -347,7 +380,16 @@ int main(int argc, char **argv) {
   const uint8_t *decode_ptr;
   size_t decode_remain;
 
-  while (!myfile.eof()) {
+  start_wall = wall_seconds();
+  start_cpu = cpu_seconds();
+
+  for (int pass = 1; ; ) {
+    if (myfile.eof()) {
+      if (pass++ == passes)
+        break;
+      myfile.clear();
+      myfile.seekg(0);
+    }
     getline (myfile,line);
     if (line.length() > 0) {
       CommBufPtr cbp(new CommBuf(header, encoded_length_str16(line)));
@@ -379,11 +421,12 @@ int main(int argc, char **argv) {
         }
       }
       outstanding++;
+      messages++;
 
       if (outstanding  > max_outstanding) {
         if (!resp_handler->get_response(event_ptr))
           break;
-        try {
+        if (!benchmark) try {
           decode_ptr = event_ptr->payload;
           decode_remain = event_ptr->payload_len;
           str = decode_str16(&decode_ptr, &decode_remain);
@@ -401,7 +444,7 @@ int main(int argc, char **argv) {
   }
 
   while (outstanding > 0 && resp_handler->get_response(event_ptr)) {
-    try {
+    if (!benchmark) try {
       decode_ptr = event_ptr->payload;
       decode_remain = event_ptr->payload_len;
       str = decode_str16(&decode_ptr, &decode_remain);
@@ -420,6 +463,16 @@ int main(int argc, char **argv) {
 
   myfile.close();
 
+  if (benchmark) {
+    double elapsed = wall_seconds() - start_wall;
+    double cpu = cpu_seconds() - start_cpu;
+    printf("backend=%s messages=%lld elapsed=%.3fs rate=%.0f msg/s "
+           "cpu=%.2f us/msg\n", ReactorFactory::ms_use_io_uring ? "io_uring"
+           : "epoll", (long long)messages, elapsed,
+           elapsed > 0 ? messages / elapsed : 0.0,
+           messages ? (cpu * 1000000.0) / messages : 0.0);
+  }
+
   ReactorFactory::destroy();
 
   return 0;
@@ -68,6 +68,7 @@ namespace {
     "  --port=<n>      Specifies the port to listen on (default=11255)",
     "  --app-queue     Use an application queue for handling requests",
     "  --reactors=<n>  Specifies the number of reactors (default=1)",
+    "  --io-uring      Use the io_uring reactor backend instead of epoll",
     "  --delay=<ms>    Milliseconds to wait before echoing message (default=0)",
     "  --udp           Operate in UDP mode instead of TCP",
     "  --verbose,-v    Generate verbose output",
@@ -251,6 +252,8 @@ int main(int argc, char **argv) {
     }
     else if (!strncmp(argv[i], "--reactors=", 11))
       reactor_count = atoi(&argv[i][11]);
+    else if (!strcmp(argv[i], "--io-uring"))
+      ReactorFactory::ms_use_io_uring = true;
     else if (!strncmp(argv[i], "--delay=", 8))
       g_delay = atoi(&argv[i][8]);
     else if (!strcmp(argv[i], "--udp"))
@@ -43,6 +43,7 @@ extern "C" {
 #include "AsyncComm/Comm.h"
 #include "AsyncComm/ConnectionManager.h"
 #include "AsyncComm/Event.h"
+#include "AsyncComm/LocalSocket.h"
 #include "AsyncComm/ReactorFactory.h"
 
 #include "CommTestThreadFunction.h"
@@ -51,9 +52,10 @@ using namespace Hypertable;
 
 namespace {
   const char *usage[] = {
-    "usage: commTest",
+    "usage: commTest [--io-uring] [--tcp]",
     "",
-    "This program ...",
+    "This program ...  With --tcp, the connection to the local test",
+    "server goes over TCP loopback instead of its Unix-domain socket.",
     0
   };
 
@@ -62,10 +64,10 @@ namespace {
 
   class ServerLauncher {
   public:
-    ServerLauncher() {
+    ServerLauncher(bool io_uring) {
       if ((m_child_pid = fork()) == 0) {
         execl("./testServer", "./testServer", DEFAULT_PORT_ARG, "--app-queue",
-              (char *)0);
+              io_uring ? "--io-uring" : (char *)0, (char *)0);
       }
       poll(0,0,2000);
     }
@@ -83,10 +85,24 @@ namespace {
 int main(int argc, char **argv) {
   boost::thread  *thread1, *thread2;
   struct sockaddr_in addr;
-  ServerLauncher slauncher;
   Comm *comm;
   ConnectionManagerPtr conn_mgr;
 
+  bool io_uring = false;
+  bool tcp = false;
+
+  while (argc > 1) {
+    if (!strcmp(argv[argc-1], "--io-uring"))
+      io_uring = true;
+    else if (!strcmp(argv[argc-1], "--tcp"))
+      tcp = true;
+    else
+      break;
+    argc--;
+  }
+
+  ServerLauncher slauncher(io_uring);
+
   Config::init(argc, argv);
 
   if (argc != 1)
@@ -95,7 +111,9 @@ int main(int argc, char **argv) {
   srand(8876);
 
   System::initialize(System::locate_install_dir(argv[0]));
+  ReactorFactory::ms_use_io_uring = io_uring;
   ReactorFactory::initialize(1);
+  LocalSocket::ms_enabled = !tcp;
 
   InetAddr::initialize(&addr, "localhost", DEFAULT_PORT);
 
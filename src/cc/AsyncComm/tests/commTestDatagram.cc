@@ -50,7 +50,7 @@ using namespace Hypertable;
 
 namespace {
   const char *usage[] = {
-    "usage: commTestDatagram",
+    "usage: commTestDatagram [--io-uring]",
     "",
     "This program tests the UDP portion of AsyncComm.  It runs the echo",
     "server (testServer) in UDP mode, and then spawns two threads that",
@@ -66,10 +66,10 @@ namespace {
 
   class ServerLauncher {
   public:
-    ServerLauncher() {
+    ServerLauncher(bool io_uring) {
       if ((m_child_pid = fork()) == 0) {
         execl("./testServer", "./testServer", DEFAULT_PORT_ARG, "--app-queue",
-              "--udp", (char *)0);
+              "--udp", io_uring ? "--io-uring" : (char *)0, (char *)0);
       }
       poll(0,0,2000);
     }
@@ -87,7 +87,13 @@ namespace {
 int main(int argc, char **argv) {
   boost::thread  *thread1, *thread2;
   struct sockaddr_in addr;
-  ServerLauncher slauncher;
+
+  bool io_uring = argc == 2 && !strcmp(argv[1], "--io-uring");
+
+  if (io_uring)
+    argc = 1;
+
+  ServerLauncher slauncher(io_uring);
 
   Config::init(argc, argv);
 
@@ -97,6 +103,7 @@ int main(int argc, char **argv) {
   srand(8876);
 
   System::initialize(System::locate_install_dir(argv[0]));
+  ReactorFactory::ms_use_io_uring = io_uring;
   ReactorFactory::initialize(1);
 
   memset(&addr, 0, sizeof(struct sockaddr_in));
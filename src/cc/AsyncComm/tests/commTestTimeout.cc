@@ -52,7 +52,7 @@ using namespace Serialization;
 
 namespace {
   const char *usage[] = {
-    "usage: commTestTimout",
+    "usage: commTestTimout [--golden] [--io-uring]",
     "",
     "This program tests tests the request timeout logic of AsyncComm.",
     0
@@ -63,10 +63,11 @@ namespace {
 
   class ServerLauncher {
   public:
-    ServerLauncher() {
+    ServerLauncher(bool io_uring) {
       if ((m_child_pid = fork()) == 0) {
         execl("./testServer", "./testServer", DEFAULT_PORT_ARG,
-              "--delay=120000", (char *)0);
+              "--delay=120000", io_uring ? "--io-uring" : (char *)0,
+              (char *)0);
       }
       poll(0,0,2000);
     }
@@ -123,25 +124,29 @@ int main(int argc, char **argv) {
   EventPtr event_ptr;
   TestHarness harness("commTestTimeout");
   bool golden = false;
+  bool io_uring = false;
   ResponseHandler *resp_handler = new ResponseHandler();
   DispatchHandlerPtr dhp(resp_handler);
   int diff_exit = 0;
 
   Config::init(0, 0);
 
-  {
-    ServerLauncher slauncher;
+  for (int i=1; i<argc; i++) {
+    if (!strcmp(argv[i], "--golden"))
+      golden = true;
+    else if (!strcmp(argv[i], "--io-uring"))
+      io_uring = true;
+    else
+      Usage::dump_and_exit(usage);
+  }
 
-    if (argc > 1) {
-      if (!strcmp(argv[1], "--golden"))
-        golden = true;
-      else
-        Usage::dump_and_exit(usage);
-    }
+  {
+    ServerLauncher slauncher(io_uring);
 
     srand(8876);
 
     System::initialize(System::locate_install_dir(argv[0]));
+    ReactorFactory::ms_use_io_uring = io_uring;
     ReactorFactory::initialize(1);
 
     InetAddr::initialize(&addr, "localhost", DEFAULT_PORT);
@@ -0,0 +1,126 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <iostream>
+#include <set>
+
+extern "C" {
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+#include "Common/FileUtils.h"
+#include "Common/InetAddr.h"
+#include "Common/Logger.h"
+#include "Common/StringExt.h"
+
+#include "AsyncComm/LocalSocket.h"
+
+using namespace std;
+using namespace Hypertable;
+
+namespace {
+
+  /**
+   * Leaves a socket file behind with nobody listening on it, the way a
+   * process that gets killed does
+   */
+  void make_stale_socket(uint16_t port) {
+    sockaddr_un sun;
+    int sd;
+
+    HT_ASSERT(LocalSocket::make_path(port, &sun));
+    HT_ASSERT((sd = socket(AF_UNIX, SOCK_STREAM, 0)) >= 0);
+    HT_ASSERT(bind(sd, (const sockaddr *)&sun, sizeof(sun)) == 0);
+    HT_ASSERT(listen(sd, 1) == 0);
+    close(sd);
+    HT_ASSERT(FileUtils::exists(sun.sun_path));
+  }
+
+}
+
+/**
+ * Checks the Unix-domain transport that Comm uses between processes on
+ * the same host: that a stale socket file makes connect() report no
+ * listener (so Comm falls back to TCP) and gets replaced by listen(), that
+ * a live listener is never taken over, and that the synthetic peer
+ * addresses of accepted connections are local, unique and never use
+ * port 0.
+ */
+int main(int argc, char **argv) {
+  String dir = format("/tmp/localSocketTest%d", (int)getpid());
+  uint16_t port = htons(32997);
+  String path, path2;
+  int lsd, sd;
+
+  HT_ASSERT(FileUtils::mkdirs(dir));
+  LocalSocket::ms_dir = dir;
+
+  // no socket file at all
+  HT_ASSERT(LocalSocket::connect(port) == -1);
+
+  // stale socket file
+  make_stale_socket(port);
+  HT_ASSERT(LocalSocket::connect(port) == -1);
+
+  lsd = LocalSocket::listen(port, path);
+  HT_ASSERT(lsd >= 0);
+  HT_ASSERT(FileUtils::exists(path));
+
+  sd = LocalSocket::connect(port);
+  HT_ASSERT(sd >= 0);
+  close(sd);
+
+  // a live listener is left alone
+  HT_ASSERT(LocalSocket::listen(port, path2) == -1);
+  sd = LocalSocket::connect(port);
+  HT_ASSERT(sd >= 0);
+  close(sd);
+
+  close(lsd);
+  unlink(path.c_str());
+  rmdir(dir.c_str());
+
+  // synthetic peer addresses
+  set<pair<uint32_t, uint16_t> > seen;
+  sockaddr_in addr;
+
+  for (size_t i=0; i<140000; i++) {
+    LocalSocket::next_peer_address(&addr);
+    HT_ASSERT(addr.sin_family == AF_INET);
+    HT_ASSERT(addr.sin_port != 0);
+    HT_ASSERT((ntohl(addr.sin_addr.s_addr) >> 16) == 0x7FFF);
+    HT_ASSERT(LocalSocket::is_local(addr));
+    HT_ASSERT(seen.insert(make_pair(addr.sin_addr.s_addr,
+                                    addr.sin_port)).second);
+  }
+
+  InetAddr::initialize(&addr, "127.0.0.1", 38060);
+  HT_ASSERT(LocalSocket::is_local(addr));
+  InetAddr::initialize(&addr, "192.0.2.1", 38060);
+  HT_ASSERT(!LocalSocket::is_local(addr));
+
+  cout << "localSocketTest: OK" << endl;
+  return 0;
+}
@@ -0,0 +1,95 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "Common/Logger.h"
+
+#include "AsyncComm/TimerWheel.h"
+
+using namespace std;
+using namespace Hypertable;
+
+namespace {
+
+  typedef multimap<uint64_t, TimerWheel::Entry *> ExpireMap;
+
+  void erase_entry(ExpireMap &emap, TimerWheel::Entry *entry) {
+    ExpireMap::iterator iter = emap.find(entry->expire_tick);
+    while (iter != emap.end() && iter->second != entry)
+      ++iter;
+    HT_ASSERT(iter != emap.end());
+    emap.erase(iter);
+  }
+
+}
+
+/**
+ * Inserts entries with expirations spread across all levels of the wheel,
+ * cancels some of them, and then advances the wheel in irregular steps,
+ * checking that every entry expires on time, exactly once, and that
+ * next_expiry() never reports a tick later than the earliest expiration.
+ */
+int main(int argc, char **argv) {
+  uint64_t now = 123456789;
+  TimerWheel wheel(now);
+  vector<TimerWheel::Entry> entries(20000);
+  vector<TimerWheel::Entry *> expired;
+  ExpireMap emap;
+  uint64_t delta, next;
+
+  srandom(1);
+
+  for (size_t i=0; i<entries.size(); i++) {
+    delta = (i % 4 == 0) ? random() % 50000000 : random() % 3000;
+    wheel.insert(&entries[i], now + delta);
+    emap.insert(make_pair(now + delta, &entries[i]));
+  }
+
+  for (size_t i=0; i<entries.size(); i+=7) {
+    wheel.remove(&entries[i]);
+    erase_entry(emap, &entries[i]);
+  }
+
+  HT_ASSERT(wheel.size() == emap.size());
+
+  while (wheel.next_expiry(&next)) {
+    HT_ASSERT(next <= emap.begin()->first);
+    now = next + random() % 5;
+    expired.clear();
+    wheel.advance(now, expired);
+    for (size_t i=0; i<expired.size(); i++) {
+      HT_ASSERT(expired[i]->expire_tick <= now);
+      HT_ASSERT(!expired[i]->linked());
+      erase_entry(emap, expired[i]);
+    }
+    HT_ASSERT(emap.empty() || emap.begin()->first > now);
+  }
+
+  HT_ASSERT(emap.empty());
+
+  cout << "timerWheelTest: OK" << endl;
+  return 0;
+}
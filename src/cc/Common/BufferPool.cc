@@ -0,0 +1,181 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include <cstdlib>
+
+extern "C" {
+#include <sys/mman.h>
+}
+
+#include "Common/Logger.h"
+#include "Common/String.h"
+#include "Common/Sweetener.h"
+
+#include "BufferPool.h"
+
+using namespace Hypertable;
+
+
+BufferPool::BufferPool(size_t max_cached) : m_max_cached(max_cached) {
+  atomic_set(&m_cached_bytes, 0);
+  atomic_set(&m_slab_bytes, 0);
+  atomic_set(&m_hits, 0);
+  atomic_set(&m_misses, 0);
+}
+
+
+BufferPool::~BufferPool() {
+  for (int i=0; i<CLASS_COUNT; i++) {
+    foreach(uint8_t *buf, m_classes[i].free_list) {
+      if (!from_slab(buf))
+        delete [] buf;
+    }
+  }
+  for (std::map<uint8_t *, size_t>::iterator iter = m_slabs.begin();
+       iter != m_slabs.end(); ++iter)
+    ::free(iter->first);
+}
+
+
+uint8_t *BufferPool::allocate(size_t len) {
+  int cls = size_class(len);
+
+  if (cls < 0) {
+    atomic_inc(&m_misses);
+    return new uint8_t [len];
+  }
+
+  size_t class_len = (size_t)1 << (cls + MIN_CLASS_SHIFT);
+  SizeClass &sc = m_classes[cls];
+  uint8_t *buf;
+
+  {
+    ScopedLock lock(sc.mutex);
+    if (!sc.free_list.empty()) {
+      buf = sc.free_list.back();
+      sc.free_list.pop_back();
+      if (!from_slab(buf))
+        atomic_sub((int)class_len, &m_cached_bytes);
+      atomic_inc(&m_hits);
+      return buf;
+    }
+    if (cls + MIN_CLASS_SHIFT >= HUGE_CLASS_SHIFT && add_slab(cls)) {
+      buf = sc.free_list.back();
+      sc.free_list.pop_back();
+      atomic_inc(&m_misses);
+      return buf;
+    }
+  }
+
+  atomic_inc(&m_misses);
+  return new uint8_t [class_len];
+}
+
+
+void BufferPool::release(uint8_t *buf, size_t len) {
+  if (buf == 0)
+    return;
+
+  int cls = size_class(len);
+
+  if (cls < 0) {
+    HT_ASSERT(!from_slab(buf));
+    delete [] buf;
+    return;
+  }
+
+  size_t class_len = (size_t)1 << (cls + MIN_CLASS_SHIFT);
+  SizeClass &sc = m_classes[cls];
+
+  if (from_slab(buf)) {
+    ScopedLock lock(sc.mutex);
+    sc.free_list.push_back(buf);
+    return;
+  }
+
+  if ((size_t)atomic_add_return((int)class_len, &m_cached_bytes)
+      > m_max_cached) {
+    atomic_sub((int)class_len, &m_cached_bytes);
+    delete [] buf;
+    return;
+  }
+
+  ScopedLock lock(sc.mutex);
+  sc.free_list.push_back(buf);
+}
+
+
+int BufferPool::size_class(size_t len) {
+  int shift = MIN_CLASS_SHIFT;
+  while (((size_t)1 << shift) < len) {
+    if (++shift > MAX_CLASS_SHIFT)
+      return -1;
+  }
+  return shift - MIN_CLASS_SHIFT;
+}
+
+
+/**
+ * Carves a new huge page slab into buffers of class cls and adds them to
+ * the class free list.  Called with the class lock held.  Returns false
+ * if the slab budget is used up or the allocation fails.
+ */
+bool BufferPool::add_slab(int cls) {
+  size_t class_len = (size_t)1 << (cls + MIN_CLASS_SHIFT);
+  size_t slab_len = (class_len > SLAB_SIZE) ? class_len : SLAB_SIZE;
+  void *slab;
+
+  if ((size_t)atomic_read(&m_slab_bytes) + slab_len > m_max_cached)
+    return false;
+
+  if (posix_memalign(&slab, SLAB_SIZE, slab_len) != 0) {
+    HT_WARNF("Unable to allocate %llu byte buffer pool slab",
+             (Llu)slab_len);
+    return false;
+  }
+
+#if defined(MADV_HUGEPAGE)
+  madvise(slab, slab_len, MADV_HUGEPAGE);
+#endif
+
+  {
+    ScopedLock lock(m_slab_mutex);
+    m_slabs[(uint8_t *)slab] = slab_len;
+  }
+  atomic_add((int)slab_len, &m_slab_bytes);
+
+  SizeClass &sc = m_classes[cls];
+  for (size_t off = 0; off + class_len <= slab_len; off += class_len)
+    sc.free_list.push_back((uint8_t *)slab + off);
+  return true;
+}
+
+
+bool BufferPool::in_slab(uint8_t *buf) {
+  ScopedLock lock(m_slab_mutex);
+  std::map<uint8_t *, size_t>::iterator iter = m_slabs.upper_bound(buf);
+  if (iter == m_slabs.begin())
+    return false;
+  --iter;
+  return buf < iter->first + iter->second;
+}
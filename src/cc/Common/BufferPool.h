@@ -0,0 +1,119 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_BUFFERPOOL_H
+#define HYPERTABLE_BUFFERPOOL_H
+
+#include <map>
+#include <vector>
+
+#include "Common/Mutex.h"
+#include "Common/ReferenceCount.h"
+#include "Common/atomic.h"
+
+namespace Hypertable {
+
+  /**
+   * Size-classed pool of byte buffers.  Requests are rounded up to the next
+   * power of two between MIN_CLASS_SHIFT and MAX_CLASS_SHIFT and served from
+   * a per-class free list; larger requests bypass the pool.  Buffers of the
+   * large classes (HUGE_CLASS_SHIFT and up) are carved out of 2MB aligned
+   * slabs that are advised to be backed by transparent huge pages and are
+   * kept for the lifetime of the pool.  Other buffers are allocated with
+   * new[] and cached until the free lists hold max_cached bytes.  Buffers
+   * may be released from any thread; each class has its own lock.
+   */
+  class BufferPool : public ReferenceCount {
+  public:
+    static const int MIN_CLASS_SHIFT = 9;
+    static const int HUGE_CLASS_SHIFT = 16;
+    static const int MAX_CLASS_SHIFT = 22;
+    static const size_t SLAB_SIZE = 2 * 1024 * 1024;
+
+    /**
+     * Constructor.
+     *
+     * @param max_cached upper bound on the number of bytes held in free
+     *        lists, and separately on the number of bytes of huge page
+     *        slabs
+     */
+    BufferPool(size_t max_cached);
+    ~BufferPool();
+
+    /**
+     * Returns a buffer of at least len bytes.  The buffer must be handed
+     * back with release() passing the same length.
+     */
+    uint8_t *allocate(size_t len);
+
+    /**
+     * Returns a buffer obtained from allocate() to the pool.
+     *
+     * @param buf buffer to release
+     * @param len length that was passed to allocate()
+     */
+    void release(uint8_t *buf, size_t len);
+
+    /**
+     * Returns the number of allocations served from and missed by the pool
+     * since it was created.  The counters wrap around at 2^32.
+     */
+    void get_stats(uint32_t *hits, uint32_t *misses) {
+      *hits = (uint32_t)atomic_read(&m_hits);
+      *misses = (uint32_t)atomic_read(&m_misses);
+    }
+
+    /** Returns the number of bytes held in free lists outside of slabs */
+    size_t cached_bytes() { return (size_t)atomic_read(&m_cached_bytes); }
+
+    /** Returns the number of bytes allocated as huge page slabs */
+    size_t slab_bytes() { return (size_t)atomic_read(&m_slab_bytes); }
+
+  private:
+    static const int CLASS_COUNT = MAX_CLASS_SHIFT - MIN_CLASS_SHIFT + 1;
+
+    struct SizeClass {
+      Mutex mutex;
+      std::vector<uint8_t *> free_list;
+    };
+
+    static int size_class(size_t len);
+    bool add_slab(int cls);
+    bool in_slab(uint8_t *buf);
+    bool from_slab(uint8_t *buf) {
+      return atomic_read(&m_slab_bytes) != 0 && in_slab(buf);
+    }
+
+    SizeClass m_classes[CLASS_COUNT];
+    Mutex m_slab_mutex;
+    std::map<uint8_t *, size_t> m_slabs;
+    size_t m_max_cached;
+    atomic_t m_cached_bytes;
+    atomic_t m_slab_bytes;
+    atomic_t m_hits;
+    atomic_t m_misses;
+  };
+
+  typedef intrusive_ptr<BufferPool> BufferPoolPtr;
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_BUFFERPOOL_H
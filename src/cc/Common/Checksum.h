@@ -73,6 +73,34 @@ crc32(const void *data, size_t len);
 extern uint32_t
 crc32_update(uint32_t crc, const void *data, size_t len);
 
+/** Compute crc32c (Castagnoli) checksum.  Uses the SSE4.2 crc32
+ *  instruction when the CPU has it, slicing-by-8 tables otherwise
+ *
+ * @param data - input data
+ * @param len - input data length in bytes
+ */
+extern uint32_t
+crc32c(const void *data, size_t len);
+
+/** Update crc32c checksum incrementally
+ *
+ * @param crc - current crc32c checksum
+ * @param data - input data
+ * @param len - input data length in bytes
+ */
+extern uint32_t
+crc32c_update(uint32_t crc, const void *data, size_t len);
+
+/** Update crc32c checksum incrementally with the portable slicing-by-8
+ *  implementation, regardless of CPU support (for testing)
+ *
+ * @param crc - current crc32c checksum
+ * @param data - input data
+ * @param len - input data length in bytes
+ */
+extern uint32_t
+crc32c_update_sw(uint32_t crc, const void *data, size_t len);
+
 } // namespace Hypertable
 
 #endif /* HYPERTABLE_CHECKSUM_H */
@@ -143,8 +143,28 @@ void init_default_options() {
   // pre boost 1.35 doesn't support allow_unregistered, so we have to have the
   // full cfg definition here, which might not be a bad thing.
   file_desc().add_options()
+    ("Comm.Compression.Codec", str()->default_value("none"), "Codec used "
+        "to compress large message payloads sent to peers that accept them "
+        "(none, lz4, quicklz)")
+    ("Comm.Compression.MinSize", i32()->default_value(4096), "Smallest "
+        "message payload, in bytes, that is compressed")
+    ("Comm.Compression.InflateThreads", i32()->default_value(2), "Number of "
+        "threads that inflate compressed messages off the reactor threads")
     ("Comm.DispatchDelay", i32()->default_value(0), "[TESTING ONLY] "
         "Delay dispatching of read requests by this number of milliseconds")
+    ("Comm.LatencyHistograms", boo()->default_value(true), "Record per-command "
+        "queue wait, service time and round trip time histograms")
+    ("Comm.LocalSocket.Enable", boo()->default_value(true), "Listen on a "
+        "Unix-domain socket next to each TCP port and use it for connections "
+        "to servers on the same host")
+    ("Comm.LocalSocket.Dir", str()->default_value(""), "Directory for the "
+        "Unix-domain sockets (default: <install_dir>/run)")
+    ("Comm.Reactor.Backend", str()->default_value("epoll"), "I/O reactor "
+        "backend on Linux: epoll or io_uring (falls back to epoll if the "
+        "kernel lacks io_uring support)")
+    ("Comm.ReceiveBufferPool.MaxSize", i64()->default_value(64*M),
+        "Maximum number of bytes of idle message buffers, and separately "
+        "of huge page slabs, retained by each reactor's receive buffer pool")
     ("Hypertable.Verbose", boo()->default_value(false),
         "Enable verbose output (system wide)")
     ("Hypertable.Silent", boo()->default_value(false),
@@ -204,6 +224,12 @@ void init_default_options() {
         "Hyperspace Lease interval (see Chubby paper)")
     ("Hyperspace.GracePeriod", i32()->default_value(60000),
         "Hyperspace Grace period (see Chubby paper)")
+    ("Hypertable.Lib.Mutator.Async.MaxOutstanding", i32()->default_value(4),
+        "Maximum number of scatter buffers an asynchronous mutator keeps in "
+        "flight before set and flush wait")
+    ("Hypertable.Lib.Mutator.Async.Workers", i32()->default_value(2),
+        "Number of threads shared by all asynchronous mutators to process "
+        "update completions and run callbacks")
     ("Hypertable.Lib.Mutator.FlushDelay", i32()->default_value(0), "Number of "
         "milliseconds to wait prior to flushing scatter buffers (for testing)")
     ("Hypertable.Lib.Mutator.ScatterBuffer.FlushLimit.PerServer",
@@ -212,8 +238,24 @@ void init_default_options() {
     ("Hypertable.Lib.Mutator.ScatterBuffer.FlushLimit.Aggregate",
      i64()->default_value(40*M), "Amount of updates (bytes) accumulated for "
         "all servers to trigger a scatter buffer flush")
+    ("Hypertable.Lib.Mutator.Shared.FlushInterval", i32()->default_value(1000),
+        "Maximum time (milliseconds) a shared mutator holds mutations before "
+        "sending them")
+    ("Hypertable.Lib.Mutator.Shared.StagingBuffer.Size",
+     i32()->default_value(64*K), "Amount of updates (bytes) a thread "
+        "accumulates in a shared mutator before merging them into its "
+        "scatter buffer")
     ("Hypertable.LocationCache.MaxEntries", i64()->default_value(1*M),
         "Size of range location cache in number of entries")
+    ("Hypertable.LocationCache.NegativeTTL", i32()->default_value(2000),
+        "Time (milliseconds) a failed range location lookup is remembered "
+        "before METADATA is consulted again, 0 disables")
+    ("Hypertable.LocationCache.Prefetch.MaxEntries",
+     i32()->default_value(1000), "Maximum number of range locations "
+        "loaded into the location cache when a table is opened, 0 disables")
+    ("Hypertable.LocationCache.Prefetch.Timeout", i32()->default_value(2000),
+        "Time (milliseconds) after which a prefetch of range locations "
+        "gives up, the remaining locations are looked up on demand")
     ("Hypertable.Master.Host", str(),
         "Host on which Hypertable Master is running")
     ("Hypertable.Master.Port", i16()->default_value(38050),
@@ -224,6 +266,32 @@ void init_default_options() {
         "Number of Hypertable Master communication reactor threads created")
     ("Hypertable.Master.Gc.Interval", i32()->default_value(300000),
         "Garbage collection interval in milliseconds by Master")
+    ("Hypertable.Master.Balance.Interval", i32()->default_value(0),
+        "Interval in milliseconds at which the Master rebalances ranges "
+        "across range servers (0, the default, disables balancing)")
+    ("Hypertable.Master.Balance.Threshold", i32()->default_value(20),
+        "Percentage by which a server's load may deviate from the average "
+        "before ranges are moved")
+    ("Hypertable.Master.Balance.MaxMoves", i32()->default_value(10),
+        "Maximum number of range moves planned per balancing round")
+    ("Hypertable.Master.Balance.Concurrency", i32()->default_value(2),
+        "Maximum number of range moves carried out at the same time")
+    ("Hypertable.Master.Merge.Interval", i32()->default_value(0),
+        "Interval in milliseconds at which the Master looks for adjacent "
+        "small ranges to merge (0, the default, disables merging)")
+    ("Hypertable.Master.Merge.MaxBytes", i64()->default_value(0),
+        "Merge adjacent ranges whose combined size is below this many bytes "
+        "(0 means a quarter of Hypertable.RangeServer.Range.MaxBytes)")
+    ("Hypertable.Master.Merge.MaxPerInterval", i32()->default_value(16),
+        "Maximum number of range merges issued by the Master per interval")
+    ("Hypertable.Master.Recovery.Workers", i32()->default_value(0),
+        "Maximum number of range servers that replay the commit log of a "
+        "failed range server in parallel (0 = all of them)")
+    ("Hypertable.Master.Recovery.Timeout", i32()->default_value(600000),
+        "Timeout in milliseconds for a range server to replay its share of "
+        "a failed range server's commit log")
+    ("Hypertable.Master.Recovery.RetryInterval", i32()->default_value(30000),
+        "Number of milliseconds to wait before retrying a failed recovery")
     ("Hypertable.RangeServer.MemoryLimit", i64(), "RangeServer memory limit")
     ("Hypertable.RangeServer.MemoryLimit.Percentage", i32()->default_value(80),
      "RangeServer memory limit specified as percentage of physical RAM")
@@ -237,12 +305,33 @@ void init_default_options() {
         "Maximum bytes consumed by an Access Group")
     ("Hypertable.RangeServer.AccessGroup.MergeFiles", i32()->default_value(4),
         "How many files to merge during a merging compaction")
+    ("Hypertable.RangeServer.AccessGroup.CompactionPolicy",
+        str()->default_value("default"), "Default policy for choosing the "
+        "cell stores to merge (default, size-tiered, leveled).  Can be "
+        "overridden per table")
+    ("Hypertable.RangeServer.AccessGroup.CompactionPolicy.SizeTiered."
+        "BucketRatio", f64()->default_value(2.0), "Maximum size ratio between "
+        "the largest and smallest cell store in a size-tiered bucket")
+    ("Hypertable.RangeServer.AccessGroup.CompactionPolicy.Leveled.SizeRatio",
+        f64()->default_value(10.0), "Minimum size ratio between a leveled "
+        "cell store and all newer cell stores combined")
+    ("Hypertable.RangeServer.CellStore.CompressorThreads", i32(),
+        "Number of threads used to compress cell store blocks while they "
+        "are being written (0 = compress inline).  Default is "
+        "min(4, number-of-cores).")
     ("Hypertable.RangeServer.CellStore.DefaultBlockSize",
         i32()->default_value(64*KiB), "Default block size for cell stores")
     ("Hypertable.RangeServer.CellStore.DefaultCompressor",
         str()->default_value("lzo"), "Default compressor for cell stores")
     ("Hypertable.RangeServer.CellStore.DefaultBloomFilter",
         str()->default_value("rows"), "Default bloom filter for cell stores")
+    ("Hypertable.RangeServer.CellStore.MinCompressionGain",
+        f64()->default_value(0.1), "Cell store blocks that compress by less "
+        "than this fraction of their size are stored uncompressed "
+        "(0 = keep every block the compressor shrinks)")
+    ("Hypertable.RangeServer.Checksum.Crc32c", boo()->default_value(true),
+        "Checksum cell store and commit log blocks with crc32c (false = "
+        "fletcher32, readable by servers without crc32c support)")
     ("Hypertable.RangeServer.BlockCache.MaxMemory", i64()->default_value(200*M),
         "Bytes to dedicate to the block cache")
     ("Hypertable.RangeServer.Range.MaxBytes", i64()->default_value(200*M),
@@ -251,6 +340,15 @@ void init_default_options() {
         "of bytes per METADATA range before splitting (for testing)")
     ("Hypertable.RangeServer.Range.SplitOff", str()->default_value("high"),
         "Portion of range to split off (high or low)")
+    ("Hypertable.RangeServer.Range.SplitLoad.Rate", i32()->default_value(0),
+        "Split ranges that receive more than this many requests per second "
+        "(0 disables load-based splitting)")
+    ("Hypertable.RangeServer.Range.SplitLoad.MinBytes",
+     i64()->default_value(16*M), "Minimum size of a range before it is "
+        "split because of its request rate")
+    ("Hypertable.RangeServer.Range.SplitLoad.HalfLife",
+     i32()->default_value(60), "Half-life in seconds of the decayed range "
+        "request rates")
     ("Hypertable.RangeServer.ClockSkew.Max", i32()->default_value(3*M),
         "Maximum amount of clock skew (microseconds) the system will tolerate")
     ("Hypertable.RangeServer.CommitLog.DfsBroker.Host", str(),
@@ -268,13 +366,15 @@ void init_default_options() {
         "Roll commit log after this many bytes")
     ("Hypertable.RangeServer.CommitLog.Compressor",
         str()->default_value("quicklz"),
-        "Commit log compressor to use (zlib, lzo, quicklz, bmz, none)")
+        "Commit log compressor to use (zlib, lzo, quicklz, bmz, lz4, zstd, "
+        "none)")
     ("Hypertable.RangeServer.CommitLog.Flush", boo()->default_value(true),
         "Flush the commit log file after each write")
     ("Hypertable.CommitLog.RollLimit", i64()->default_value(100*M),
         "Roll commit log after this many bytes")
     ("Hypertable.CommitLog.Compressor", str()->default_value("quicklz"),
-        "Commit log compressor to use (zlib, lzo, quicklz, bmz, none)")
+        "Commit log compressor to use (zlib, lzo, quicklz, bmz, lz4, zstd, "
+        "none)")
     ("Hypertable.CommitLog.Flush", boo()->default_value(true),
         "Flush the commit log file after each write")
     ("Hypertable.CommitLog.SkipErrors", boo()->default_value(false),
@@ -286,12 +386,44 @@ void init_default_options() {
         "purging commit logs, etc.)")
     ("Hypertable.RangeServer.Maintenance.Interval", i32()->default_value(30000),
         "Maintenance scheduling interval in milliseconds")
+    ("Hypertable.RangeServer.Maintenance.Throttle.MaxRate",
+        i64()->default_value(0), "Maximum rate, in bytes per second, at "
+        "which compactions read and write cell store data (0 = unlimited)")
+    ("Hypertable.RangeServer.Maintenance.Throttle.MinRate",
+        i64()->default_value(4*M), "Rate, in bytes per second, below which "
+        "the compaction throttle will not back off")
+    ("Hypertable.RangeServer.Maintenance.Throttle.LatencyTarget",
+        i32()->default_value(0), "Foreground scan latency target in "
+        "milliseconds.  When non-zero, the compaction rate is lowered while "
+        "scan latency exceeds this target (0 = fixed rate)")
     ("Hypertable.RangeServer.Workers", i32()->default_value(20),
         "Number of Range Server worker threads created")
     ("Hypertable.RangeServer.Reactors", i32(),
         "Number of Range Server communication reactor threads created")
     ("Hypertable.RangeServer.MaintenanceThreads", i32(),
         "Number of maintenance threads.  Default is min(2, number-of-cores).")
+    ("Hypertable.RangeServer.UpdateApplyThreads", i32(),
+        "Number of threads used to apply committed updates to ranges in "
+        "parallel.  Default is min(8, number-of-cores).")
+    ("Hypertable.RangeServer.Replay.InflateThreads", i32(),
+        "Number of threads used to decompress commit log blocks during "
+        "recovery (0 = read and decompress inline).  Default is "
+        "min(4, number-of-cores).")
+    ("Hypertable.RangeServer.Replay.ReadAhead", i32()->default_value(64),
+        "Maximum number of commit log blocks read ahead of the replay "
+        "during recovery")
+    ("Hypertable.RangeServer.Replay.BatchSize", i64()->default_value(8*M),
+        "Number of bytes of replayed commit log data gathered before it is "
+        "applied to the ranges in parallel")
+    ("Hypertable.RangeServer.Checkpoint.Enable", boo()->default_value(false),
+        "Relieve commit log pressure by checkpointing cell caches instead of "
+        "compacting them into small cell stores")
+    ("Hypertable.RangeServer.Checkpoint.Dir",
+        str()->default_value("/hypertable/checkpoints"), "Directory in the "
+        "commit log filesystem that holds cell cache checkpoints")
+    ("Hypertable.RangeServer.Checkpoint.MaxMemory",
+        i64()->default_value(256*M), "Access groups caching more than this "
+        "many bytes are compacted rather than checkpointed")
     ("Hypertable.RangeServer.UpdateDelay", i32()->default_value(0),
         "Number of milliseconds to wait before carrying out an update (TESTING)")
     ("ThriftBroker.Timeout", i32()->default_value(20*K), "Timeout (ms) "
@@ -155,6 +155,7 @@ namespace Hypertable {
       RANGESERVER_TABLE_DROPPED          = 0x00050017,
       RANGESERVER_UNEXPECTED_TABLE_ID    = 0x00050018,
       RANGESERVER_RANGE_BUSY             = 0x00050019,
+      RANGESERVER_CORRUPT_CHECKPOINT     = 0x0005001A,
 
       HQL_BAD_LOAD_FILE_FORMAT  = 0x00060001,
 
@@ -0,0 +1,222 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_JOBQUEUE_H
+#define HYPERTABLE_JOBQUEUE_H
+
+#include <exception>
+#include <list>
+
+#include <boost/thread/condition.hpp>
+
+#include "Common/Error.h"
+#include "Common/Logger.h"
+#include "Common/Mutex.h"
+#include "Common/ReferenceCount.h"
+#include "Common/String.h"
+#include "Common/Thread.h"
+
+namespace Hypertable {
+
+  /**
+   * Pool of threads that carry out jobs on behalf of threads that wait for
+   * them.  A job that no worker has picked up by the time it is waited
+   * for is run by the waiting thread, so a waiter never stalls behind
+   * other waiters' jobs and the pool works, serially, with no threads at
+   * all.  A job that fails records the error, which the waiter inspects.
+   */
+  class JobQueue : public ReferenceCount {
+
+  public:
+
+    /**
+     * A unit of work.  Owned by the thread that adds and waits for it.
+     */
+    class Job {
+    public:
+      Job() : m_error(Error::OK), m_claimed(false), m_done(false) { }
+      virtual ~Job() { }
+      virtual void run() = 0;
+
+      /** Returns the error of a failed job, Error::OK otherwise */
+      int error() const { return m_error; }
+
+      /** Returns the message of the error of a failed job */
+      const String &error_msg() const { return m_error_msg; }
+
+    private:
+      friend class JobQueue;
+      int    m_error;
+      String m_error_msg;
+      bool   m_claimed;
+      bool   m_done;
+    };
+
+    /**
+     * Constructor.  Creates worker_count worker threads.
+     *
+     * @param worker_count number of worker threads to create, with none
+     *        every job is run by the thread that waits for it
+     */
+    JobQueue(int worker_count) : m_workers(worker_count), m_joined(false) {
+      Worker worker(m_state);
+      HT_ASSERT(worker_count >= 0);
+      for (int i=0; i<worker_count; ++i)
+        m_threads.create_thread(worker);
+    }
+
+    /**
+     * Shuts down the queue.  Queued jobs are carried out and then all
+     * threads exit.
+     */
+    void shutdown() {
+      ScopedLock lock(m_state.mutex);
+      m_state.shutdown = true;
+      m_state.cond.notify_all();
+    }
+
+    /**
+     * Waits for a shutdown to complete.
+     */
+    void join() {
+      if (!m_joined) {
+        m_threads.join_all();
+        m_joined = true;
+      }
+    }
+
+    /**
+     * Offers a job to the worker threads.
+     */
+    void add(Job *job) {
+      ScopedLock lock(m_state.mutex);
+      m_state.queue.push_back(job);
+      m_state.cond.notify_one();
+    }
+
+    /**
+     * Waits for a job to complete, running it in the calling thread if no
+     * worker has claimed it yet.  A job that was never added is simply
+     * run.
+     */
+    void wait(Job *job) {
+      {
+        ScopedLock lock(m_state.mutex);
+        if (job->m_claimed) {
+          while (!job->m_done)
+            m_state.done_cond.wait(lock);
+          return;
+        }
+        m_state.queue.remove(job);
+        job->m_claimed = true;
+      }
+      run_job(m_state, job);
+    }
+
+    size_t workers() { return m_workers; }
+
+  private:
+
+    typedef std::list<Job *> JobList;
+
+    class JobQueueState {
+    public:
+      JobQueueState() : shutdown(false) { return; }
+      JobList            queue;
+      Mutex              mutex;
+      boost::condition   cond;
+      boost::condition   done_cond;
+      bool               shutdown;
+    };
+
+    /**
+     * Runs a job, turning whatever it throws into its error, so that
+     * neither a worker nor a waiter is lost to a failed job.
+     */
+    static void run_job(JobQueueState &state, Job *job) {
+      int error = Error::OK;
+      String error_msg;
+      try {
+        job->run();
+      }
+      catch (Exception &e) {
+        error = e.code();
+        error_msg = e.what();
+      }
+      catch (std::exception &e) {
+        error = Error::EXTERNAL;
+        error_msg = e.what();
+      }
+      catch (...) {
+        error = Error::EXTERNAL;
+        error_msg = "unknown exception";
+      }
+      ScopedLock lock(state.mutex);
+      job->m_error = error;
+      job->m_error_msg = error_msg;
+      job->m_done = true;
+      state.done_cond.notify_all();
+    }
+
+    class Worker {
+
+    public:
+
+      Worker(JobQueueState &state) : m_state(state) { return; }
+
+      void operator()() {
+        Job *job;
+
+        while (true) {
+
+          {
+            ScopedLock lock(m_state.mutex);
+
+            while (m_state.queue.empty()) {
+              if (m_state.shutdown)
+                return;
+              m_state.cond.wait(lock);
+            }
+
+            job = m_state.queue.front();
+            m_state.queue.pop_front();
+            job->m_claimed = true;
+          }
+
+          run_job(m_state, job);
+        }
+      }
+
+    private:
+      JobQueueState &m_state;
+    };
+
+    JobQueueState  m_state;
+    ThreadGroup    m_threads;
+    int            m_workers;
+    bool           m_joined;
+  };
+
+  typedef boost::intrusive_ptr<JobQueue> JobQueuePtr;
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_JOBQUEUE_H
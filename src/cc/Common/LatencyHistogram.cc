@@ -0,0 +1,177 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include <iostream>
+
+#include "Common/Logger.h"
+#include "Common/Serialization.h"
+
+#include "LatencyHistogram.h"
+
+using namespace Hypertable;
+using namespace Serialization;
+
+LatencyHistogram::LatencyHistogram() {
+  for (int i = 0; i < BUCKETS; ++i)
+    atomic_set(&m_counts[i], 0);
+}
+
+
+size_t LatencyHistogram::bucket_index(uint64_t micros) {
+  if (micros < (uint64_t)SUB_BUCKETS)
+    return (size_t)micros;
+
+  int msb = 63 - __builtin_clzll(micros);
+  if (msb > MAX_SHIFT)
+    return BUCKETS - 1;
+
+  int shift = msb - SUB_BUCKET_SHIFT;
+  return (size_t)((shift + 1) * SUB_BUCKETS
+                  + (int)((micros >> shift) - SUB_BUCKETS));
+}
+
+
+uint64_t LatencyHistogram::bucket_value(size_t index) {
+  if (index < (size_t)SUB_BUCKETS)
+    return index;
+
+  int shift = (int)(index / SUB_BUCKETS) - 1;
+  uint64_t low = (uint64_t)(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+  return low + ((uint64_t)1 << shift) - 1;
+}
+
+
+void LatencyHistogram::snapshot(Snapshot &snapshot) {
+  snapshot.buckets.clear();
+  for (int i = 0; i < BUCKETS; ++i) {
+    uint32_t count = (uint32_t)atomic_read(&m_counts[i]);
+    if (count)
+      snapshot.buckets.push_back(std::make_pair((uint16_t)i, count));
+  }
+}
+
+
+size_t LatencyHistogram::Snapshot::encoded_length() const {
+  return 4 + 6 * buckets.size();
+}
+
+
+void LatencyHistogram::Snapshot::encode(uint8_t **bufp) const {
+  encode_i32(bufp, buckets.size());
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    encode_i16(bufp, buckets[i].first);
+    encode_i32(bufp, buckets[i].second);
+  }
+}
+
+
+void LatencyHistogram::Snapshot::decode(const uint8_t **bufp,
+                                        size_t *remainp) {
+  size_t n;
+  uint16_t index;
+
+  buckets.clear();
+  HT_TRY("decoding latency histogram",
+    n = decode_i32(bufp, remainp);
+    for (size_t i = 0; i < n; ++i) {
+      index = decode_i16(bufp, remainp);
+      buckets.push_back(std::make_pair(index, decode_i32(bufp, remainp)));
+    });
+}
+
+
+uint64_t LatencyHistogram::Snapshot::count() const {
+  uint64_t total = 0;
+  for (size_t i = 0; i < buckets.size(); ++i)
+    total += buckets[i].second;
+  return total;
+}
+
+
+uint64_t LatencyHistogram::Snapshot::percentile(double fraction) const {
+  uint64_t total = count();
+  uint64_t seen = 0;
+
+  if (total == 0)
+    return 0;
+
+  uint64_t rank = (uint64_t)(fraction * total + 0.5);
+  if (rank == 0)
+    rank = 1;
+
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i].second;
+    if (seen >= rank)
+      return bucket_value(buckets[i].first);
+  }
+  return max();
+}
+
+
+uint64_t LatencyHistogram::Snapshot::max() const {
+  return buckets.empty() ? 0 : bucket_value(buckets.back().first);
+}
+
+
+double LatencyHistogram::Snapshot::mean() const {
+  uint64_t total = 0;
+  double sum = 0.0;
+
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    total += buckets[i].second;
+    sum += (double)bucket_value(buckets[i].first) * buckets[i].second;
+  }
+  return total ? sum / total : 0.0;
+}
+
+
+void LatencyHistogram::Snapshot::subtract(const Snapshot &previous) {
+  std::vector<std::pair<uint16_t, uint32_t> > delta;
+  size_t j = 0;
+
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    uint32_t count = buckets[i].second;
+    while (j < previous.buckets.size()
+           && previous.buckets[j].first < buckets[i].first)
+      ++j;
+    if (j < previous.buckets.size()
+        && previous.buckets[j].first == buckets[i].first)
+      count -= previous.buckets[j].second;
+    if (count)
+      delta.push_back(std::make_pair(buckets[i].first, count));
+  }
+  buckets.swap(delta);
+}
+
+
+std::ostream &
+Hypertable::operator<<(std::ostream &os,
+                       const LatencyHistogram::Snapshot &snapshot) {
+  os << "count=" << snapshot.count() << " mean=" << (uint64_t)snapshot.mean()
+     << "us p50=" << snapshot.percentile(0.5)
+     << "us p90=" << snapshot.percentile(0.9)
+     << "us p99=" << snapshot.percentile(0.99)
+     << "us p999=" << snapshot.percentile(0.999)
+     << "us max=" << snapshot.max() << "us";
+  return os;
+}
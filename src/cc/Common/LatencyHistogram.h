@@ -0,0 +1,107 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_LATENCYHISTOGRAM_H
+#define HYPERTABLE_LATENCYHISTOGRAM_H
+
+#include <iosfwd>
+#include <utility>
+#include <vector>
+
+#include "Common/atomic.h"
+
+namespace Hypertable {
+
+  /**
+   * Log-linear (HDR style) histogram of latencies in microseconds.  Each
+   * power of two is split into SUB_BUCKETS linear buckets, so a recorded
+   * value is off by at most 1/SUB_BUCKETS (about 6%) of its magnitude.
+   * Values up to 2^MAX_SHIFT microseconds (about 12 days) are kept, larger
+   * ones land in the last bucket.  Recording is a single atomic increment
+   * and may be done from any thread.
+   */
+  class LatencyHistogram {
+  public:
+    static const int SUB_BUCKET_SHIFT = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_SHIFT;
+    static const int MAX_SHIFT = 40;
+    static const int BUCKETS = (MAX_SHIFT - SUB_BUCKET_SHIFT + 2) * SUB_BUCKETS;
+
+    /**
+     * Sparse copy of the non-empty buckets of a histogram
+     */
+    class Snapshot {
+    public:
+      size_t encoded_length() const;
+      void encode(uint8_t **bufp) const;
+      void decode(const uint8_t **bufp, size_t *remainp);
+
+      uint64_t count() const;
+
+      /** Returns the value below which the given fraction of the recorded
+       * values fall (e.g. 0.99 for the 99th percentile) */
+      uint64_t percentile(double fraction) const;
+
+      uint64_t max() const;
+
+      double mean() const;
+
+      /**
+       * Turns this snapshot into the values recorded since previous, an
+       * earlier snapshot of the same histogram.  Counts wrap around at
+       * 2^32, so the difference is exact as long as fewer values than that
+       * were recorded in between.
+       *
+       * @param previous earlier snapshot of the same histogram
+       */
+      void subtract(const Snapshot &previous);
+
+      /** (bucket index, count) pairs in ascending bucket order */
+      std::vector<std::pair<uint16_t, uint32_t> > buckets;
+    };
+
+    LatencyHistogram();
+
+    void record(int64_t micros) {
+      atomic_inc(&m_counts[bucket_index(micros < 0 ? 0 : micros)]);
+    }
+
+    /**
+     * Copies the counts recorded so far into snapshot.  The counts are
+     * never reset, so any number of readers may poll the same histogram
+     * and compute their own intervals with Snapshot::subtract().
+     */
+    void snapshot(Snapshot &snapshot);
+
+    static size_t bucket_index(uint64_t micros);
+
+    /** Returns the largest value that maps to the given bucket */
+    static uint64_t bucket_value(size_t index);
+
+  private:
+    atomic_t m_counts[BUCKETS];
+  };
+
+  std::ostream &operator<<(std::ostream &, const LatencyHistogram::Snapshot &);
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_LATENCYHISTOGRAM_H
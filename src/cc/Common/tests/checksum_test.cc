@@ -0,0 +1,108 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include <cstdlib>
+#include <iostream>
+
+#include "Common/Checksum.h"
+#include "Common/Config.h"
+#include "Common/Stopwatch.h"
+
+using namespace Hypertable;
+using namespace Config;
+using namespace std;
+
+namespace {
+
+struct MyPolicy : Config::Policy {
+  static void init_options() {
+    cmdline_desc("Usage: %s [Options] [<size>]\nOptions").add_options()
+      ("repeats,r", i32()->default_value(10), "number of repeats for tests")
+      ;
+    cmdline_hidden_desc().add_options()
+      ("size,s", i32()->default_value(1*M), "size of the checksummed buffer")
+      ;
+    cmdline_positional_desc().add("size", -1);
+  }
+};
+
+typedef Cons<MyPolicy, DefaultPolicy> AppPolicy;
+
+#define MEASURE(_label_, _code_, _n_) do { \
+  Stopwatch w; _code_; w.stop(); \
+  cout << _label_ <<": "<< (_n_) / w.elapsed() / M <<" MB/s" << endl; \
+} while (0)
+
+void check_crc32c(const uint8_t *data, size_t len) {
+  // standard check value
+  HT_ASSERT(crc32c("123456789", 9) == 0xE3069283);
+  HT_ASSERT(crc32c_update_sw(0, "123456789", 9) == 0xE3069283);
+
+  // hardware and software versions agree at any alignment and length
+  for (size_t offset = 0; offset < 8; ++offset)
+    for (size_t n = 0; n + offset < len && n < 4096; n += 13)
+      HT_ASSERT(crc32c(data + offset, n)
+                == crc32c_update_sw(0, data + offset, n));
+
+  // incremental updates give the same result as one pass
+  HT_ASSERT(crc32c_update(crc32c(data, len / 3), data + len / 3,
+                          len - len / 3) == crc32c(data, len));
+}
+
+} // local namespace
+
+int main(int ac, char *av[]) {
+  try {
+    init_with_policy<AppPolicy>(ac, av);
+
+    size_t len = get_i32("size");
+    int repeats = get_i32("repeats");
+    uint8_t *data = new uint8_t [len];
+    uint32_t checksum = 0;
+
+    srandom(1);
+    for (size_t i = 0; i < len; ++i)
+      data[i] = (uint8_t)random();
+
+    check_crc32c(data, len);
+
+    MEASURE("fletcher32", for (int r = 0; r < repeats; ++r)
+      checksum ^= fletcher32(data, len), (double)len * repeats);
+    MEASURE("crc32 (zlib)", for (int r = 0; r < repeats; ++r)
+      checksum ^= crc32(data, len), (double)len * repeats);
+    MEASURE("crc32c", for (int r = 0; r < repeats; ++r)
+      checksum ^= crc32c(data, len), (double)len * repeats);
+    MEASURE("crc32c (slicing-by-8)", for (int r = 0; r < repeats; ++r)
+      checksum ^= crc32c_update_sw(0, data, len), (double)len * repeats);
+
+    // in case of optimistic optimizer
+    cout <<"  checksum="<< checksum << endl;
+
+    delete [] data;
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,101 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include <cstdlib>
+#include <iostream>
+
+#include "Common/LatencyHistogram.h"
+#include "Common/Logger.h"
+#include "Common/Serialization.h"
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+
+void check_buckets() {
+  uint64_t prev = 0;
+
+  // indexes are monotonic and every value is within 1/16 of its bucket
+  for (uint64_t v = 0; v < (1ULL << 30); v = v < 64 ? v + 1 : v + v / 7) {
+    size_t index = LatencyHistogram::bucket_index(v);
+    uint64_t top = LatencyHistogram::bucket_value(index);
+    HT_ASSERT(index >= prev);
+    HT_ASSERT(top >= v);
+    HT_ASSERT(top - v <= v / LatencyHistogram::SUB_BUCKETS);
+    HT_ASSERT(LatencyHistogram::bucket_index(top) == index);
+    prev = index;
+  }
+  HT_ASSERT(LatencyHistogram::bucket_index(~0ULL)
+            == (size_t)LatencyHistogram::BUCKETS - 1);
+}
+
+void check_percentiles() {
+  LatencyHistogram histogram;
+  LatencyHistogram::Snapshot snapshot;
+
+  for (int64_t v = 1; v <= 10000; ++v)
+    histogram.record(v);
+
+  histogram.snapshot(snapshot);
+  HT_ASSERT(snapshot.count() == 10000);
+  HT_ASSERT(snapshot.percentile(0.5) >= 5000 &&
+            snapshot.percentile(0.5) <= 5000 + 5000 / 16);
+  HT_ASSERT(snapshot.percentile(0.99) >= 9900 &&
+            snapshot.percentile(0.99) <= 9900 + 9900 / 16);
+  HT_ASSERT(snapshot.max() >= 10000);
+
+  // snapshots don't reset the counts, intervals are differences
+  LatencyHistogram::Snapshot previous = snapshot;
+  histogram.snapshot(snapshot);
+  HT_ASSERT(snapshot.count() == 10000);
+  snapshot.subtract(previous);
+  HT_ASSERT(snapshot.count() == 0 && snapshot.buckets.empty());
+
+  histogram.record(3);
+  histogram.record(250000);
+  histogram.snapshot(snapshot);
+  HT_ASSERT(snapshot.count() == 10002);
+  snapshot.subtract(previous);
+  HT_ASSERT(snapshot.count() == 2 && snapshot.buckets.size() == 2);
+  HT_ASSERT(snapshot.max() >= 250000);
+
+  // serialization round trip
+  uint8_t buf[256], *p = buf;
+  HT_ASSERT(snapshot.encoded_length() < sizeof(buf));
+  snapshot.encode(&p);
+  const uint8_t *q = buf;
+  size_t remain = p - buf;
+  LatencyHistogram::Snapshot decoded;
+  decoded.decode(&q, &remain);
+  HT_ASSERT(remain == 0 && decoded.buckets == snapshot.buckets);
+  cout << decoded << endl;
+}
+
+} // local namespace
+
+int main(int ac, char *av[]) {
+  check_buckets();
+  check_percentiles();
+  return 0;
+}
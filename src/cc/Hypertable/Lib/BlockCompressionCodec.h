@@ -39,7 +39,7 @@ namespace Hypertable {
   class BlockCompressionCodec : public ReferenceCount {
   public:
     enum Type { UNKNOWN=-1, NONE=0, BMZ=1, ZLIB=2, LZO=3, QUICKLZ=4,
-                COMPRESSION_TYPE_LIMIT=5 };
+                LZ4=5, ZSTD=6, COMPRESSION_TYPE_LIMIT=7 };
     typedef std::vector<String> Args;
 
     static const char *get_compressor_name(uint16_t algo);
@@ -55,6 +55,28 @@ namespace Hypertable {
 
     virtual void set_args(const Args &args) {}
 
+    /**
+     * Returns the size of the dictionary that should be trained for this
+     * codec, or zero if it does not use one.
+     */
+    virtual size_t get_dictionary_size() { return 0; }
+
+    /**
+     * Builds a dictionary from sample data.  The samples are stored back to
+     * back in samples, their lengths are given in sample_sizes.
+     *
+     * @return false if no dictionary could be built from the samples
+     */
+    virtual bool train_dictionary(const DynamicBuffer &samples,
+                                  const std::vector<size_t> &sample_sizes,
+                                  DynamicBuffer &dictionary) { return false; }
+
+    /**
+     * Uses the given dictionary for every block deflated or inflated from
+     * now on.  The dictionary is copied.
+     */
+    virtual void set_dictionary(const uint8_t *dictionary, size_t len) {}
+
     virtual int get_type() = 0;
 
     HT_THREAD_ID_DECL(m_creator_thread);
@@ -0,0 +1,55 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_BLOCKCOMPRESSIONCODECLZ4_H
+#define HYPERTABLE_BLOCKCOMPRESSIONCODECLZ4_H
+
+#include "BlockCompressionCodec.h"
+
+namespace Hypertable {
+
+  /**
+   * LZ4 block codec.  Blocks are compressed with the fast LZ4 compressor,
+   * or with LZ4HC when the --hc argument is given (--level selects the HC
+   * level).  Both produce the same format, so inflating is the same.
+   */
+  class BlockCompressionCodecLz4 : public BlockCompressionCodec {
+
+  public:
+    BlockCompressionCodecLz4(const Args &args);
+    virtual ~BlockCompressionCodecLz4();
+
+    virtual void set_args(const Args &args);
+    virtual void deflate(const DynamicBuffer &input, DynamicBuffer &output,
+                         BlockCompressionHeader &header, size_t reserve=0);
+    virtual void inflate(const DynamicBuffer &input, DynamicBuffer &output,
+                         BlockCompressionHeader &header);
+    virtual int get_type() { return LZ4; }
+
+  private:
+    bool  m_hc;
+    int   m_level;
+    char *m_state;
+  };
+
+}
+
+#endif // HYPERTABLE_BLOCKCOMPRESSIONCODECLZ4_H
@@ -0,0 +1,239 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include <cstdlib>
+
+#include "Common/Checksum.h"
+#include "Common/Error.h"
+#include "Common/Logger.h"
+#include "Common/String.h"
+
+#include "BlockCompressionCodecZstd.h"
+
+extern "C" {
+#include <zdict.h>
+}
+
+using namespace Hypertable;
+
+/**
+ *
+ */
+BlockCompressionCodecZstd::BlockCompressionCodecZstd(const Args &args)
+  : m_cctx(0), m_dctx(0), m_cdict(0), m_ddict(0), m_dictionary(0),
+    m_dictionary_size(0), m_level(3) {
+  if (!args.empty())
+    set_args(args);
+}
+
+
+/**
+ *
+ */
+BlockCompressionCodecZstd::~BlockCompressionCodecZstd() {
+  free_dictionary();
+  if (m_cctx)
+    ZSTD_freeCCtx(m_cctx);
+  if (m_dctx)
+    ZSTD_freeDCtx(m_dctx);
+}
+
+
+void BlockCompressionCodecZstd::set_args(const Args &args) {
+  Args::const_iterator it = args.begin(), arg_end = args.end();
+
+  for (; it != arg_end; ++it) {
+    if (*it == "--level" && it + 1 != arg_end) {
+      m_level = atoi((*++it).c_str());
+      if (m_level < 1 || m_level > ZSTD_maxCLevel())
+        HT_THROWF(Error::BLOCK_COMPRESSOR_INVALID_ARG, "Invalid Zstd level "
+                  "%d (must be 1..%d)", m_level, ZSTD_maxCLevel());
+    }
+    else if (*it == "--dictionary" && it + 1 != arg_end) {
+      int size = atoi((*++it).c_str());
+      if (size < 256)
+        HT_THROWF(Error::BLOCK_COMPRESSOR_INVALID_ARG, "Invalid Zstd "
+                  "dictionary size %d (must be at least 256)", size);
+      m_dictionary_size = size;
+    }
+    else if ((*it).empty())
+      continue;
+    else
+      HT_THROWF(Error::BLOCK_COMPRESSOR_INVALID_ARG, "Unrecognized argument "
+                "to Zstd codec: '%s'", (*it).c_str());
+  }
+
+  // the digested compression dictionary depends on the level
+  if (m_cdict) {
+    ZSTD_freeCDict(m_cdict);
+    m_cdict = 0;
+  }
+}
+
+
+bool
+BlockCompressionCodecZstd::train_dictionary(const DynamicBuffer &samples,
+    const std::vector<size_t> &sample_sizes, DynamicBuffer &dictionary) {
+
+  if (m_dictionary_size == 0 || sample_sizes.empty())
+    return false;
+
+  dictionary.clear();
+  dictionary.reserve(m_dictionary_size);
+
+  size_t len = ZDICT_trainFromBuffer(dictionary.base, m_dictionary_size,
+      samples.base, &sample_sizes[0], sample_sizes.size());
+
+  if (ZDICT_isError(len)) {
+    HT_INFOF("Unable to train Zstd dictionary from %lu samples - %s",
+             (Lu)sample_sizes.size(), ZDICT_getErrorName(len));
+    return false;
+  }
+
+  dictionary.ptr = dictionary.base + len;
+  return true;
+}
+
+
+void
+BlockCompressionCodecZstd::set_dictionary(const uint8_t *dictionary,
+                                          size_t len) {
+  free_dictionary();
+  m_dictionary.set(dictionary, len);
+}
+
+
+void BlockCompressionCodecZstd::free_dictionary() {
+  if (m_cdict) {
+    ZSTD_freeCDict(m_cdict);
+    m_cdict = 0;
+  }
+  if (m_ddict) {
+    ZSTD_freeDDict(m_ddict);
+    m_ddict = 0;
+  }
+  m_dictionary.clear();
+}
+
+
+/**
+ *
+ */
+void
+BlockCompressionCodecZstd::deflate(const DynamicBuffer &input,
+    DynamicBuffer &output, BlockCompressionHeader &header, size_t reserve) {
+  size_t avail_out = ZSTD_compressBound(input.fill());
+  size_t len;
+
+  output.clear();
+  output.reserve(header.length() + avail_out + reserve);
+
+  if (m_cctx == 0)
+    m_cctx = ZSTD_createCCtx();
+
+  if (m_dictionary.fill()) {
+    if (m_cdict == 0)
+      m_cdict = ZSTD_createCDict(m_dictionary.base, m_dictionary.fill(),
+                                 m_level);
+    len = ZSTD_compress_usingCDict(m_cctx, output.base + header.length(),
+        avail_out, input.base, input.fill(), m_cdict);
+  }
+  else
+    len = ZSTD_compressCCtx(m_cctx, output.base + header.length(), avail_out,
+                            input.base, input.fill(), m_level);
+
+  /* check for an incompressible block */
+  if (ZSTD_isError(len) || len >= input.fill()) {
+    header.set_compression_type(NONE);
+    memcpy(output.base+header.length(), input.base, input.fill());
+    header.set_data_length(input.fill());
+    header.set_data_zlength(input.fill());
+  }
+  else {
+    header.set_compression_type(ZSTD);
+    header.set_data_length(input.fill());
+    header.set_data_zlength(len);
+  }
+  header.set_data_checksum(header.compute_data_checksum(
+      output.base + header.length(), header.get_data_zlength()));
+
+  output.ptr = output.base;
+  header.encode(&output.ptr);
+  output.ptr += header.get_data_zlength();
+}
+
+
+/**
+ *
+ */
+void BlockCompressionCodecZstd::inflate(const DynamicBuffer &input,
+    DynamicBuffer &output, BlockCompressionHeader &header) {
+  const uint8_t *msg_ptr = input.base;
+  size_t remaining = input.fill();
+
+  header.decode(&msg_ptr, &remaining);
+
+  if (header.get_data_zlength() != remaining)
+    HT_THROWF(Error::BLOCK_COMPRESSOR_BAD_HEADER, "Block decompression error, "
+              "header zlength = %lu, actual = %lu",
+              (Lu)header.get_data_zlength(), (Lu)remaining);
+
+  uint32_t checksum = header.compute_data_checksum(msg_ptr, remaining);
+
+  if (checksum != header.get_data_checksum())
+    HT_THROWF(Error::BLOCK_COMPRESSOR_CHECKSUM_MISMATCH, "Compressed block "
+              "checksum mismatch header=%lx, computed=%lx",
+              (Lu)header.get_data_checksum(), (Lu)checksum);
+
+  output.reserve(header.get_data_length());
+
+   // check compress type
+  if (header.get_compression_type() == NONE)
+    memcpy(output.base, msg_ptr, header.get_data_length());
+  else {
+    size_t len;
+
+    if (m_dctx == 0)
+      m_dctx = ZSTD_createDCtx();
+
+    if (m_dictionary.fill()) {
+      if (m_ddict == 0)
+        m_ddict = ZSTD_createDDict(m_dictionary.base, m_dictionary.fill());
+      len = ZSTD_decompress_usingDDict(m_dctx, output.base,
+          header.get_data_length(), msg_ptr, remaining, m_ddict);
+    }
+    else
+      len = ZSTD_decompressDCtx(m_dctx, output.base, header.get_data_length(),
+                                msg_ptr, remaining);
+
+    if (ZSTD_isError(len))
+      HT_THROWF(Error::BLOCK_COMPRESSOR_INFLATE_ERROR, "Compressed block "
+                "inflate error - %s", ZSTD_getErrorName(len));
+
+    if (len != header.get_data_length())
+      HT_THROWF(Error::BLOCK_COMPRESSOR_INFLATE_ERROR, "Compressed block "
+                "inflate error, expected %lu bytes, got %lu",
+                (Lu)header.get_data_length(), (Lu)len);
+  }
+  output.ptr = output.base + header.get_data_length();
+}
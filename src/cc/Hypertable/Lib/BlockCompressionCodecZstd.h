@@ -0,0 +1,76 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_BLOCKCOMPRESSIONCODECZSTD_H
+#define HYPERTABLE_BLOCKCOMPRESSIONCODECZSTD_H
+
+#include "Common/DynamicBuffer.h"
+
+#include "BlockCompressionCodec.h"
+
+extern "C" {
+#include <zstd.h>
+}
+
+namespace Hypertable {
+
+  /**
+   * Zstandard block codec.  --level selects the compression level.  With
+   * --dictionary <size>, the codec asks for a dictionary of that many bytes
+   * to be trained from sample blocks; small blocks compress much better
+   * with one.  The dictionary is not part of the block, whoever deflated
+   * the block has to arrange for the same dictionary to be set before it
+   * is inflated.
+   */
+  class BlockCompressionCodecZstd : public BlockCompressionCodec {
+
+  public:
+    BlockCompressionCodecZstd(const Args &args);
+    virtual ~BlockCompressionCodecZstd();
+
+    virtual void set_args(const Args &args);
+    virtual void deflate(const DynamicBuffer &input, DynamicBuffer &output,
+                         BlockCompressionHeader &header, size_t reserve=0);
+    virtual void inflate(const DynamicBuffer &input, DynamicBuffer &output,
+                         BlockCompressionHeader &header);
+    virtual int get_type() { return ZSTD; }
+
+    virtual size_t get_dictionary_size() { return m_dictionary_size; }
+    virtual bool train_dictionary(const DynamicBuffer &samples,
+                                  const std::vector<size_t> &sample_sizes,
+                                  DynamicBuffer &dictionary);
+    virtual void set_dictionary(const uint8_t *dictionary, size_t len);
+
+  private:
+    void free_dictionary();
+
+    ZSTD_CCtx    *m_cctx;
+    ZSTD_DCtx    *m_dctx;
+    ZSTD_CDict   *m_cdict;
+    ZSTD_DDict   *m_ddict;
+    DynamicBuffer m_dictionary;
+    size_t        m_dictionary_size;
+    int           m_level;
+  };
+
+}
+
+#endif // HYPERTABLE_BLOCKCOMPRESSIONCODECZSTD_H
@@ -33,6 +33,20 @@ using namespace Hypertable;
 using namespace Serialization;
 
 const size_t BlockCompressionHeader::LENGTH;
+const uint8_t BlockCompressionHeader::CHECKSUM_FLETCHER32;
+const uint8_t BlockCompressionHeader::CHECKSUM_CRC32C;
+const uint8_t BlockCompressionHeader::FLAGS_BIT_CRC32C;
+
+uint8_t BlockCompressionHeader::ms_default_checksum_type =
+    BlockCompressionHeader::CHECKSUM_CRC32C;
+
+
+uint32_t
+BlockCompressionHeader::compute_data_checksum(const void *data, size_t len) {
+  if (m_checksum_type == CHECKSUM_CRC32C)
+    return crc32c(data, len);
+  return fletcher32(data, len);
+}
 
 
 /**
@@ -42,7 +56,10 @@ void BlockCompressionHeader::encode(uint8_t **bufp) {
   memcpy(*bufp, m_magic, 10);
   (*bufp) += 10;
   *(*bufp)++ = (uint8_t)length();
-  *(*bufp)++ = (uint8_t)m_compression_type;
+  if (m_checksum_type == CHECKSUM_CRC32C)
+    *(*bufp)++ = (uint8_t)m_compression_type | FLAGS_BIT_CRC32C;
+  else
+    *(*bufp)++ = (uint8_t)m_compression_type;
   encode_i32(bufp, m_data_checksum);
   encode_i32(bufp, m_data_length);
   encode_i32(bufp, m_data_zlength);
@@ -89,6 +106,13 @@ void BlockCompressionHeader::decode(const uint8_t **bufp, size_t *remainp) {
 
   m_compression_type = decode_byte(bufp, remainp);
 
+  if (m_compression_type & FLAGS_BIT_CRC32C) {
+    m_checksum_type = CHECKSUM_CRC32C;
+    m_compression_type &= ~FLAGS_BIT_CRC32C;
+  }
+  else
+    m_checksum_type = CHECKSUM_FLETCHER32;
+
   if (m_compression_type >= BlockCompressionCodec::COMPRESSION_TYPE_LIMIT)
     HT_THROWF(Error::BLOCK_COMPRESSOR_BAD_HEADER, "Bad compression type: %d",
               (int)m_compression_type);
@@ -25,19 +25,33 @@
 namespace Hypertable {
 
   /**
-   * Base class for compressed block header.
+   * Base class for compressed block header.  The data checksum is crc32c,
+   * or fletcher32 for blocks written before crc32c was introduced; the
+   * high bit of the encoded compression type byte tells them apart.
+   * New headers take the process-wide default checksum type, which can be
+   * pinned to fletcher32 so that servers without crc32c support can still
+   * read what is written.
    */
   class BlockCompressionHeader {
   public:
 
     static const size_t LENGTH = 26;
 
+    static const uint8_t CHECKSUM_FLETCHER32 = 0;
+    static const uint8_t CHECKSUM_CRC32C = 1;
+
+    static const uint8_t FLAGS_BIT_CRC32C = 0x80;
+
     BlockCompressionHeader() : m_data_length(0), m_data_zlength(0),
-        m_data_checksum(0), m_compression_type((uint16_t)-1) { }
+        m_data_checksum(0), m_compression_type((uint16_t)-1),
+        m_checksum_type(ms_default_checksum_type) { }
 
     BlockCompressionHeader(const char *magic)
       : m_data_length(0), m_data_zlength(0), m_data_checksum(0),
-        m_compression_type((uint16_t)-1) { memcpy(m_magic, magic, 10); }
+        m_compression_type((uint16_t)-1),
+        m_checksum_type(ms_default_checksum_type) {
+      memcpy(m_magic, magic, 10);
+    }
 
     virtual ~BlockCompressionHeader() { return; }
 
@@ -58,6 +72,26 @@ namespace Hypertable {
     void     set_compression_type(uint16_t type) { m_compression_type = type; }
     uint16_t get_compression_type() { return m_compression_type; }
 
+    void     set_checksum_type(uint8_t type) { m_checksum_type = type; }
+    uint8_t  get_checksum_type() { return m_checksum_type; }
+
+    /**
+     * Computes the checksum of block data with the checksum type of this
+     * header.
+     *
+     * @param data pointer to the (compressed) block data
+     * @param len length of data
+     * @return checksum
+     */
+    uint32_t compute_data_checksum(const void *data, size_t len);
+
+    static void set_default_checksum_type(uint8_t type) {
+      ms_default_checksum_type = type;
+    }
+    static uint8_t get_default_checksum_type() {
+      return ms_default_checksum_type;
+    }
+
     virtual size_t length() { return LENGTH; }
     virtual void   encode(uint8_t **bufp);
     virtual void   write_header_checksum(uint8_t *base, uint8_t **bufp);
@@ -69,6 +103,9 @@ namespace Hypertable {
     uint32_t m_data_zlength;
     uint32_t m_data_checksum;
     uint16_t m_compression_type;
+    uint8_t  m_checksum_type;
+
+    static uint8_t ms_default_checksum_type;
   };
 
 }
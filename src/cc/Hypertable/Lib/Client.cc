@@ -40,6 +40,7 @@ extern "C" {
 #include "Hypertable/Lib/Config.h"
 
 #include "Client.h"
+#include "CommPayloadCodec.h"
 #include "HqlCommandInterpreter.h"
 
 using namespace std;
@@ -270,6 +271,7 @@ void Client::initialize() {
 
   m_comm = Comm::instance();
   m_conn_manager = new ConnectionManager(m_comm);
+  CommPayloadCodec::install(m_props);
 
   if (m_timeout_ms == 0)
     m_timeout_ms = m_props->get_i32("Hypertable.Request.Timeout");
@@ -0,0 +1,146 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include "Common/Error.h"
+#include "Common/Logger.h"
+
+#include "BlockCompressionHeader.h"
+#include "CommPayloadCodec.h"
+#include "CompressorFactory.h"
+
+using namespace Hypertable;
+
+const char CommPayloadCodec::MAGIC[10] =
+    { 'C','O','M','M','P','A','Y','L','O','D' };
+
+
+CommPayloadCodec::CommPayloadCodec(const String &spec) {
+  m_type = CompressorFactory::parse_block_codec_spec(spec, m_args);
+  // fail early on a codec that isn't compiled in
+  if (m_type != BlockCompressionCodec::NONE)
+    put_codec(get_codec(m_type));
+}
+
+
+CommPayloadCodec::~CommPayloadCodec() {
+  for (size_t i=0; i<BlockCompressionCodec::COMPRESSION_TYPE_LIMIT; i++)
+    foreach(BlockCompressionCodec *codec, m_idle[i])
+      delete codec;
+}
+
+
+bool CommPayloadCodec::deflate(const uint8_t *data, size_t len,
+                               DynamicBuffer &output) {
+  if (m_type == BlockCompressionCodec::NONE)
+    return false;
+
+  BlockCompressionHeader header(MAGIC);
+  DynamicBuffer input(0, false);
+  BlockCompressionCodec *codec = get_codec(m_type);
+
+  input.base = (uint8_t *)data;
+  input.ptr = input.base + len;
+  input.size = len;
+
+  try {
+    codec->deflate(input, output, header);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    put_codec(codec);
+    return false;
+  }
+  put_codec(codec);
+
+  return header.get_compression_type() != BlockCompressionCodec::NONE
+      && output.fill() < len;
+}
+
+
+bool CommPayloadCodec::inflate(const uint8_t *data, size_t len,
+                               DynamicBuffer &output) {
+  BlockCompressionHeader header;
+  DynamicBuffer input(0, false);
+  BlockCompressionCodec *codec = 0;
+  const uint8_t *ptr = data;
+  size_t remaining = len;
+
+  input.base = (uint8_t *)data;
+  input.ptr = input.base + len;
+  input.size = len;
+
+  try {
+    header.decode(&ptr, &remaining);
+    if (!header.check_magic(MAGIC))
+      HT_THROW(Error::BLOCK_COMPRESSOR_BAD_MAGIC, "Comm payload");
+    if (header.get_compression_type() >=
+        BlockCompressionCodec::COMPRESSION_TYPE_LIMIT)
+      HT_THROWF(Error::BLOCK_COMPRESSOR_UNSUPPORTED_TYPE, "Comm payload "
+                "compression type %d", (int)header.get_compression_type());
+    codec = get_codec((BlockCompressionCodec::Type)
+                      header.get_compression_type());
+    codec->inflate(input, output, header);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    if (codec)
+      put_codec(codec);
+    return false;
+  }
+  put_codec(codec);
+  return true;
+}
+
+
+void CommPayloadCodec::install(PropertiesPtr &props) {
+  static Mutex mutex;
+  ScopedLock lock(mutex);
+
+  if (PayloadCodec::ms_codec)
+    return;
+
+  PayloadCodec::ms_codec =
+      new CommPayloadCodec(props->get_str("Comm.Compression.Codec"));
+}
+
+
+BlockCompressionCodec *
+CommPayloadCodec::get_codec(BlockCompressionCodec::Type type) {
+  {
+    ScopedLock lock(m_mutex);
+    if (!m_idle[type].empty()) {
+      BlockCompressionCodec *codec = m_idle[type].back();
+      m_idle[type].pop_back();
+      return codec;
+    }
+  }
+  if (type == m_type)
+    return CompressorFactory::create_block_codec(type, m_args);
+  return CompressorFactory::create_block_codec(type);
+}
+
+
+void CommPayloadCodec::put_codec(BlockCompressionCodec *codec) {
+  ScopedLock lock(m_mutex);
+  m_idle[codec->get_type()].push_back(codec);
+}
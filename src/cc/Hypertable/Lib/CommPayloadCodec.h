@@ -0,0 +1,79 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_COMMPAYLOADCODEC_H
+#define HYPERTABLE_COMMPAYLOADCODEC_H
+
+#include <vector>
+
+#include "AsyncComm/PayloadCodec.h"
+
+#include "Common/Mutex.h"
+#include "Common/Properties.h"
+
+#include "BlockCompressionCodec.h"
+
+namespace Hypertable {
+
+  /**
+   * Comm payload codec backed by a block compression codec.  Each payload
+   * is sent as a self-describing compressed block (header with magic, type
+   * and crc32c), so the receiver can inflate it whatever codec it has
+   * configured itself.  Block codecs are not thread safe, so instances are
+   * kept in a pool and handed out one per call.
+   */
+  class CommPayloadCodec : public PayloadCodec {
+  public:
+    CommPayloadCodec(const String &spec);
+    virtual ~CommPayloadCodec();
+
+    virtual bool deflate(const uint8_t *data, size_t len,
+                         DynamicBuffer &output);
+
+    virtual bool inflate(const uint8_t *data, size_t len,
+                         DynamicBuffer &output);
+
+    virtual bool deflates() { return m_type != BlockCompressionCodec::NONE; }
+
+    /**
+     * Installs the codec named by Comm.Compression.Codec as
+     * PayloadCodec::ms_codec.  Every process installs one, even if it is
+     * configured with "none", so that it can inflate what its peers send.
+     */
+    static void install(PropertiesPtr &props);
+
+    static const char MAGIC[10];
+
+  private:
+    BlockCompressionCodec *get_codec(BlockCompressionCodec::Type type);
+    void put_codec(BlockCompressionCodec *codec);
+
+    typedef std::vector<BlockCompressionCodec *> CodecList;
+
+    Mutex m_mutex;
+    BlockCompressionCodec::Type m_type;
+    BlockCompressionCodec::Args m_args;
+    CodecList m_idle[BlockCompressionCodec::COMPRESSION_TYPE_LIMIT];
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_COMMPAYLOADCODEC_H
@@ -20,7 +20,9 @@
  */
 
 #include "Common/Compat.h"
+#include <algorithm>
 #include <cassert>
+#include <deque>
 #include <vector>
 
 extern "C" {
@@ -35,12 +37,16 @@ extern "C" {
 }
 
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/thread/condition.hpp>
 
 #include "Common/Config.h"
 #include "Common/Error.h"
 #include "Common/FileUtils.h"
 #include "Common/Logger.h"
+#include "Common/Mutex.h"
 #include "Common/StringExt.h"
+#include "Common/Sweetener.h"
+#include "Common/Thread.h"
 
 #include "Hypertable/Lib/CompressorFactory.h"
 
@@ -61,12 +67,168 @@ namespace {
       return num_x < num_y;
     }
   };
+
+  /**
+   * A block read ahead of the caller of CommitLogReader::next()
+   */
+  struct ReadAheadBlock {
+    ReadAheadBlock() : fragment(0), start_offset(0), end_offset(0),
+                       error(Error::OK), corrupt(false), done(false) { }
+    BlockCompressionHeaderCommitLog header;
+    DynamicBuffer zblock;
+    DynamicBuffer block;
+    CommitLogFileInfo *fragment;
+    String fname;
+    uint64_t start_offset;
+    uint64_t end_offset;
+    int error;
+    bool corrupt;
+    bool done;
+  };
 }
 
 
+/**
+ * Pipeline state for read-ahead mode.  One thread pulls raw blocks off of
+ * the fragment streams in log order and queues them for the inflate
+ * threads; the caller of next() consumes them from the front of the
+ * block queue as they finish.
+ */
+class CommitLogReader::ReadAhead {
+public:
+
+  class Reader {
+  public:
+    Reader(ReadAhead *ra, CommitLogReader *reader)
+      : m_ra(ra), m_reader(reader) { }
+    void operator()() { m_ra->read_loop(m_reader); }
+  private:
+    ReadAhead *m_ra;
+    CommitLogReader *m_reader;
+  };
+
+  class Inflater {
+  public:
+    Inflater(ReadAhead *ra) : m_ra(ra) { }
+    void operator()() { m_ra->inflate_loop(); }
+  private:
+    ReadAhead *m_ra;
+  };
+
+  ReadAhead(size_t max_blocks_)
+    : max_blocks(max_blocks_), eof(false), shutdown(false),
+      error(Error::OK), current(0) { }
+
+  ~ReadAhead() {
+    delete current;
+    foreach(ReadAheadBlock *block, blocks)
+      delete block;
+  }
+
+  void read_loop(CommitLogReader *reader) {
+    CommitLogBlockInfo binfo;
+    BlockCompressionHeaderCommitLog header;
+
+    try {
+      while (true) {
+        {
+          ScopedLock lock(mutex);
+          while (blocks.size() >= max_blocks && !shutdown)
+            cond.wait(lock);
+          if (shutdown)
+            return;
+        }
+
+        if (!reader->next_raw_block(&binfo, &header))
+          break;
+
+        ReadAheadBlock *block = new ReadAheadBlock();
+        block->header = header;
+        block->fragment = &(*reader->m_iter);
+        block->fname = (*reader->m_iter).block_stream->get_fname();
+        block->start_offset = binfo.start_offset;
+        block->end_offset = binfo.end_offset;
+        block->error = binfo.error;
+        block->corrupt = binfo.error != Error::OK;
+
+        if (!block->corrupt)
+          block->zblock.set(binfo.block_ptr, binfo.block_len);
+
+        ScopedLock lock(mutex);
+        blocks.push_back(block);
+        if (block->corrupt)
+          block->done = true;
+        else
+          inflate_queue.push_back(block);
+        cond.notify_all();
+      }
+    }
+    catch (Exception &e) {
+      ScopedLock lock(mutex);
+      error = e.code();
+      error_msg = e.what();
+    }
+
+    ScopedLock lock(mutex);
+    eof = true;
+    cond.notify_all();
+  }
+
+  void inflate_loop() {
+    CompressorMap compressor_map;
+    ReadAheadBlock *block;
+
+    while (true) {
+      {
+        ScopedLock lock(mutex);
+        while (inflate_queue.empty()) {
+          if (shutdown || eof)
+            return;
+          cond.wait(lock);
+        }
+        block = inflate_queue.front();
+        inflate_queue.pop_front();
+      }
+
+      try {
+        uint16_t ztype = block->header.get_compression_type();
+        if (ztype >= BlockCompressionCodec::COMPRESSION_TYPE_LIMIT)
+          HT_THROWF(Error::BLOCK_COMPRESSOR_UNSUPPORTED_TYPE,
+                    "Invalid compression type '%d'", (int)ztype);
+        BlockCompressionCodecPtr &codec = compressor_map[ztype];
+        if (!codec)
+          codec = CompressorFactory::create_block_codec(
+              (BlockCompressionCodec::Type)ztype);
+        codec->inflate(block->zblock, block->block, block->header);
+      }
+      catch (Exception &e) {
+        block->error = e.code();
+      }
+      block->zblock.free();
+
+      ScopedLock lock(mutex);
+      block->done = true;
+      cond.notify_all();
+    }
+  }
+
+  Mutex mutex;
+  boost::condition cond;
+  std::deque<ReadAheadBlock *> blocks;
+  std::deque<ReadAheadBlock *> inflate_queue;
+  size_t max_blocks;
+  bool eof;
+  bool shutdown;
+  int error;
+  String error_msg;
+  ReadAheadBlock *current;
+  ThreadGroup threads;
+};
+
+
 CommitLogReader::CommitLogReader(Filesystem *fs, const String &log_dir, bool mark_for_deletion)
   : CommitLogBase(log_dir), m_fs(fs), m_block_buffer(256), m_revision(0),
-    m_compressor(0) {
+    m_compressor(0), m_read_ahead(0) {
 
   if (get_bool("Hypertable.CommitLog.SkipErrors"))
     CommitLogBlockStream::ms_assert_on_error = false;
@@ -76,7 +238,58 @@ CommitLogReader::CommitLogReader(Filesystem *fs, const String &log_dir, bool mar
 }
 
 
+CommitLogReader::CommitLogReader(Filesystem *fs, const String &log_dir,
+                                 const std::vector<uint32_t> &fragments)
+  : CommitLogBase(log_dir), m_fs(fs), m_block_buffer(256), m_revision(0),
+    m_compressor(0), m_read_ahead(0) {
+
+  if (get_bool("Hypertable.CommitLog.SkipErrors"))
+    CommitLogBlockStream::ms_assert_on_error = false;
+
+  load_fragments(log_dir, false);
+
+  LogFragmentQueue selected;
+  foreach(const CommitLogFileInfo &fi, m_fragment_queue) {
+    if (find(fragments.begin(), fragments.end(), fi.num) != fragments.end())
+      selected.push_back(fi);
+  }
+  m_fragment_queue.swap(selected);
+
+  reset();
+}
+
+
 CommitLogReader::~CommitLogReader() {
+  stop_read_ahead();
+}
+
+
+void
+CommitLogReader::enable_read_ahead(size_t inflate_threads, size_t max_blocks) {
+  HT_ASSERT(m_read_ahead == 0);
+
+  m_read_ahead = new ReadAhead(max_blocks ? max_blocks : 1);
+
+  ReadAhead::Reader reader(m_read_ahead, this);
+  m_read_ahead->threads.create_thread(reader);
+
+  ReadAhead::Inflater inflater(m_read_ahead);
+  for (size_t i=0; i<(inflate_threads ? inflate_threads : 1); i++)
+    m_read_ahead->threads.create_thread(inflater);
+}
+
+
+void CommitLogReader::stop_read_ahead() {
+  if (m_read_ahead == 0)
+    return;
+  {
+    ScopedLock lock(m_read_ahead->mutex);
+    m_read_ahead->shutdown = true;
+    m_read_ahead->cond.notify_all();
+  }
+  m_read_ahead->threads.join_all();
+  delete m_read_ahead;
+  m_read_ahead = 0;
 }
 
 
@@ -95,7 +308,9 @@ CommitLogReader::next_raw_block(CommitLogBlockInfo *infop,
   if (!(*m_iter).block_stream->next(infop, header)) {
     delete (*m_iter).block_stream;
     (*m_iter).block_stream = 0;
-    (*m_iter).revision = m_revision;
+    // with read-ahead, next() records the revisions of the blocks it returns
+    if (m_read_ahead == 0)
+      (*m_iter).revision = m_revision;
     m_iter++;
     m_revision = 0;
     goto try_again;
@@ -117,6 +332,9 @@ CommitLogReader::next(const uint8_t **blockp, size_t *lenp,
                       BlockCompressionHeaderCommitLog *header) {
   CommitLogBlockInfo binfo;
 
+  if (m_read_ahead)
+    return next_read_ahead(blockp, lenp, header);
+
   while (next_raw_block(&binfo, header)) {
 
     if (binfo.error == Error::OK) {
@@ -139,11 +357,7 @@ CommitLogReader::next(const uint8_t **blockp, size_t *lenp,
         continue;
       }
 
-      if (header->get_revision() > m_latest_revision)
-        m_latest_revision = header->get_revision();
-
-      if (header->get_revision() > m_revision)
-        m_revision = header->get_revision();
+      update_revision(header->get_revision());
 
       zblock.release();
       *blockp = m_block_buffer.base;
@@ -164,6 +378,78 @@ CommitLogReader::next(const uint8_t **blockp, size_t *lenp,
 }
 
 
+bool
+CommitLogReader::next_read_ahead(const uint8_t **blockp, size_t *lenp,
+                                 BlockCompressionHeaderCommitLog *header) {
+  ReadAhead *ra = m_read_ahead;
+  int error;
+  String error_msg;
+
+  {
+    ScopedLock lock(ra->mutex);
+
+    delete ra->current;
+    ra->current = 0;
+
+    while (true) {
+      while (ra->blocks.empty() ? !ra->eof : !ra->blocks.front()->done)
+        ra->cond.wait(lock);
+
+      if (ra->blocks.empty())
+        break;
+
+      ReadAheadBlock *block = ra->blocks.front();
+      ra->blocks.pop_front();
+      ra->cond.notify_all();
+
+      if (block->corrupt)
+        HT_WARNF("Corruption detected in CommitLog fragment %s starting at "
+                 "postion %lld for %lld bytes - %s", block->fname.c_str(),
+                 (Lld)block->start_offset, (Lld)(block->end_offset
+                 - block->start_offset), Error::get_text(block->error));
+      else if (block->error != Error::OK)
+        HT_ERRORF("Inflate error in CommitLog fragment %s starting at "
+                  "postion %lld (block len = %lld) - %s", block->fname.c_str(),
+                  (Lld)block->start_offset, (Lld)(block->end_offset
+                  - block->start_offset), Error::get_text(block->error));
+      else {
+        int64_t revision = block->header.get_revision();
+        if (revision > block->fragment->revision)
+          block->fragment->revision = revision;
+        if (revision > m_latest_revision)
+          m_latest_revision = revision;
+        ra->current = block;
+        *header = block->header;
+        *blockp = block->block.base;
+        *lenp = block->block.fill();
+        return true;
+      }
+      delete block;
+    }
+
+    error = ra->error;
+    error_msg = ra->error_msg;
+  }
+
+  stop_read_ahead();
+
+  if (error != Error::OK)
+    HT_THROW(error, error_msg);
+
+  sort(m_fragment_queue.begin(), m_fragment_queue.end());
+
+  return false;
+}
+
+
+void CommitLogReader::update_revision(int64_t revision) {
+  if (revision > m_latest_revision)
+    m_latest_revision = revision;
+  if (revision > m_revision)
+    m_revision = revision;
+}
+
+
 void CommitLogReader::load_fragments(String log_dir, bool mark_for_deletion) {
   vector<string> listing;
   CommitLogFileInfo file_info;
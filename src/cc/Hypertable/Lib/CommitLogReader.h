@@ -47,6 +47,18 @@ namespace Hypertable {
 
   public:
     CommitLogReader(Filesystem *fs, const String &log_dir, bool mark_for_deletion=false);
+
+    /**
+     * Constructs a reader over a subset of the fragments in
+     * <code>log_dir</code>.  Logs linked in from those fragments are read
+     * in their entirety.
+     *
+     * @param fs filesystem holding the log
+     * @param log_dir commit log directory
+     * @param fragments numbers of the fragments to read
+     */
+    CommitLogReader(Filesystem *fs, const String &log_dir,
+                    const std::vector<uint32_t> &fragments);
     virtual ~CommitLogReader();
 
     bool next_raw_block(CommitLogBlockInfo *,
@@ -54,9 +66,30 @@ namespace Hypertable {
     bool next(const uint8_t **blockp, size_t *lenp,
               BlockCompressionHeaderCommitLog *);
 
+    /**
+     * Switches next() over to a pipelined mode.  A background thread reads
+     * raw blocks up to <code>max_blocks</code> ahead of the caller and
+     * <code>inflate_threads</code> threads decompress them concurrently.
+     * Blocks are still returned by next() in log order and the block
+     * returned remains valid until the following call to next().  Must be
+     * called before the first call to next().
+     *
+     * @param inflate_threads number of decompression threads
+     * @param max_blocks maximum number of blocks buffered ahead of the caller
+     */
+    void enable_read_ahead(size_t inflate_threads, size_t max_blocks);
+
+    /**
+     * Stops the read-ahead threads and frees the blocks they buffered.
+     * Called by next() at the end of the log; callers that stop reading
+     * early may call it to release the threads right away.
+     */
+    void stop_read_ahead();
+
     LogFragmentQueue &get_fragment_queue() { return m_fragment_queue; }
 
     void reset() {
+      stop_read_ahead();
       m_iter = m_fragment_queue.begin();
       m_block_buffer.clear();
       m_revision = 0;
@@ -65,6 +98,12 @@ namespace Hypertable {
 
   private:
 
+    class ReadAhead;
+    friend class ReadAhead;
+
+    bool next_read_ahead(const uint8_t **blockp, size_t *lenp,
+                         BlockCompressionHeaderCommitLog *);
+    void update_revision(int64_t revision);
     void load_fragments(String log_dir, bool mark_for_deletion);
     void load_compressor(uint16_t ztype);
 
@@ -79,6 +118,7 @@ namespace Hypertable {
     uint16_t               m_compressor_type;
     BlockCompressionCodec *m_compressor;
 
+    ReadAhead             *m_read_ahead;
   };
 
   typedef intrusive_ptr<CommitLogReader> CommitLogReaderPtr;
@@ -27,6 +27,12 @@
 #include "BlockCompressionCodecZlib.h"
 #include "BlockCompressionCodecLzo.h"
 #include "BlockCompressionCodecQuicklz.h"
+#ifdef HT_WITH_LZ4
+#include "BlockCompressionCodecLz4.h"
+#endif
+#ifdef HT_WITH_ZSTD
+#include "BlockCompressionCodecZstd.h"
+#endif
 
 using namespace Hypertable;
 using namespace std;
@@ -59,6 +65,12 @@ CompressorFactory::parse_block_codec_spec(const string &spec,
   if (name == "quicklz")
     return BlockCompressionCodec::QUICKLZ;
 
+  if (name == "lz4")
+    return BlockCompressionCodec::LZ4;
+
+  if (name == "zstd")
+    return BlockCompressionCodec::ZSTD;
+
   HT_ERRORF("unknown codec type: %s", name.c_str());
   return BlockCompressionCodec::UNKNOWN;
 }
@@ -77,6 +89,14 @@ CompressorFactory::create_block_codec(BlockCompressionCodec::Type type,
     return new BlockCompressionCodecLzo(args);
   case BlockCompressionCodec::QUICKLZ:
     return new BlockCompressionCodecQuicklz(args);
+#ifdef HT_WITH_LZ4
+  case BlockCompressionCodec::LZ4:
+    return new BlockCompressionCodecLz4(args);
+#endif
+#ifdef HT_WITH_ZSTD
+  case BlockCompressionCodec::ZSTD:
+    return new BlockCompressionCodecZstd(args);
+#endif
   default:
     HT_THROWF(Error::BLOCK_COMPRESSOR_UNSUPPORTED_TYPE, "Invalid compression "
               "type: '%d'", (int)type);
@@ -294,6 +294,7 @@ namespace {
     "",
     "table_option:",
     "  COMPRESSOR '=' compressor_spec",
+    "  | COMPACTION_POLICY '=' ('default' | 'size-tiered' | 'leveled')",
     "",
     "create_definition:",
     "  column_family_name [MAX_VERSIONS '=' value] [TTL '=' duration]",
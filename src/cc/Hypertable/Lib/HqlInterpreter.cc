@@ -105,6 +105,8 @@ cmd_create_table(Client *client, ParserState &state,
     schema = new Schema();
     schema->validate_compressor(state.table_compressor);
     schema->set_compressor(state.table_compressor);
+    schema->validate_compaction_policy(state.table_compaction_policy);
+    schema->set_compaction_policy(state.table_compaction_policy);
 
     foreach(Schema::AccessGroup *ag, state.ag_list) {
       schema->validate_compressor(ag->compressor);
@@ -242,6 +242,7 @@ namespace Hypertable {
       String input_file;
       String header_file;
       String table_compressor;
+      String table_compaction_policy;
       std::vector<String> key_columns;
       String timestamp_column;
       bool dupkeycols;
@@ -486,6 +487,19 @@ namespace Hypertable {
       ParserState &state;
     };
 
+    struct set_table_compaction_policy {
+      set_table_compaction_policy(ParserState &state) : state(state) { }
+      void operator()(char const *str, char const *end) const {
+        if (state.table_compaction_policy != "")
+          HT_THROW(Error::HQL_PARSE_ERROR,
+                   "table compaction policy multiply defined");
+        state.table_compaction_policy = String(str, end-str);
+        trim_if(state.table_compaction_policy, is_any_of("'\""));
+        to_lower(state.table_compaction_policy);
+      }
+      ParserState &state;
+    };
+
 
     struct set_help {
       set_help(ParserState &state) : state(state) { }
@@ -1245,6 +1259,7 @@ namespace Hypertable {
           Token DELETE       = as_lower_d["delete"];
           Token VALUES       = as_lower_d["values"];
           Token COMPRESSOR   = as_lower_d["compressor"];
+          Token COMPACTION_POLICY = as_lower_d["compaction_policy"];
           Token DUMP         = as_lower_d["dump"];
           Token STATS        = as_lower_d["stats"];
           Token STARTS       = as_lower_d["starts"];
@@ -1468,6 +1483,8 @@ namespace Hypertable {
           table_option
             = COMPRESSOR >> EQUAL >> string_literal[
                 set_table_compressor(self.state)]
+            | COMPACTION_POLICY >> EQUAL >> string_literal[
+                set_table_compaction_policy(self.state)]
             ;
 
           create_definitions
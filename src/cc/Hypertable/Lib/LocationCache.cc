@@ -25,7 +25,9 @@
 #include <fstream>
 #include <iostream>
 
+#include "Common/Error.h"
 #include "Common/InetAddr.h"
+#include "Common/Time.h"
 
 #include "LocationCache.h"
 
@@ -53,6 +55,13 @@ LocationCache::insert(uint32_t table_id, RangeLocationInfo &range_loc_info,
   newval->location = get_constant_location_str(range_loc_info.location.c_str());
   newval->pegged = pegged;
 
+  // the table's METADATA has changed, so the rows it was missing may no
+  // longer be
+  if (!m_negative_map.empty())
+    m_negative_map.erase(
+        m_negative_map.lower_bound(std::make_pair(table_id, String())),
+        m_negative_map.lower_bound(std::make_pair(table_id + 1, String())));
+
   key.table_id = table_id;
   key.end_row = (range_loc_info.end_row == "") ? 0 : newval->end_row.c_str();
 
@@ -168,6 +177,53 @@ bool LocationCache::invalidate(uint32_t table_id, const char *rowkey) {
 }
 
 
+void
+LocationCache::insert_negative(uint32_t table_id, const char *rowkey,
+                               int error, uint32_t ttl_millis) {
+  ScopedLock lock(m_mutex);
+  uint64_t now = get_ts64();
+  NegativeEntry entry;
+
+  if (m_negative_map.size() >= m_max_entries) {
+    NegativeMap::iterator iter = m_negative_map.begin();
+    while (iter != m_negative_map.end()) {
+      if ((*iter).second.expire_time <= now)
+        m_negative_map.erase(iter++);
+      else
+        ++iter;
+    }
+    if (m_negative_map.size() >= m_max_entries)
+      m_negative_map.clear();
+  }
+
+  entry.error = error;
+  entry.expire_time = now + (uint64_t)ttl_millis * 1000000LL;
+  m_negative_map[std::make_pair(table_id, String(rowkey ? rowkey : ""))] =
+      entry;
+}
+
+
+int LocationCache::lookup_negative(uint32_t table_id, const char *rowkey) {
+  ScopedLock lock(m_mutex);
+
+  if (m_negative_map.empty())
+    return Error::OK;
+
+  NegativeMap::iterator iter = m_negative_map.find(
+      std::make_pair(table_id, String(rowkey ? rowkey : "")));
+
+  if (iter == m_negative_map.end())
+    return Error::OK;
+
+  if ((*iter).second.expire_time <= get_ts64()) {
+    m_negative_map.erase(iter);
+    return Error::OK;
+  }
+
+  return (*iter).second.error;
+}
+
+
 void LocationCache::display(std::ostream &out) {
   for (Value *value = m_head; value; value = value->prev)
     out << "DUMP: end=" << value->end_row << " start=" << value->start_row
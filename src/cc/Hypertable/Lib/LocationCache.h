@@ -104,6 +104,23 @@ namespace Hypertable {
                 RangeLocationInfo *rane_loc_infop, bool inclusive=false);
     bool invalidate(uint32_t table_id, const char *rowkey);
 
+    /**
+     * Remembers for ttl_millis that the METADATA lookup of rowkey failed
+     * with error, so that lookups of the row in the meantime fail without
+     * scanning METADATA again.  Inserting a location for the table drops
+     * its negative entries.
+     */
+    void insert_negative(uint32_t table_id, const char *rowkey, int error,
+                         uint32_t ttl_millis);
+
+    /**
+     * Returns the error of an unexpired negative entry for rowkey, or
+     * Error::OK if there is none
+     */
+    int lookup_negative(uint32_t table_id, const char *rowkey);
+
+    uint32_t max_entries() { return m_max_entries; }
+
     void display(std::ostream &);
 
     static bool location_to_addr(const char *location,
@@ -118,9 +135,16 @@ namespace Hypertable {
     typedef std::map<LocationCacheKey, Value *> LocationMap;
     typedef std::set<const char *, LtCstr> LocationStrSet;
 
+    struct NegativeEntry {
+      int error;
+      uint64_t expire_time;
+    };
+    typedef std::map<std::pair<uint32_t, String>, NegativeEntry> NegativeMap;
+
     Mutex          m_mutex;
     LocationMap    m_location_map;
     LocationStrSet m_location_strings;
+    NegativeMap    m_negative_map;
     Value         *m_head;
     Value         *m_tail;
     uint32_t       m_max_entries;
@@ -65,6 +65,10 @@ operator<<(std::ostream &out, const MetaLogEntry *ep) {
     case RS_DROP_TABLE: {
       R_CAST_AND_OUTPUT(DropTable, ep, out) <<'}';
     } break;
+    case RS_RANGE_MERGED: {
+      R_CAST_AND_OUTPUT(RangeMerged, ep, out)
+          <<" state="<< sp->range_state <<'}';
+    } break;
     default: out <<"{UnknownEntry("<< ep->get_type() <<")}";
   }
   return out;
@@ -24,6 +24,8 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <algorithm>
+
 extern "C" {
 #include <limits.h>
 #include <poll.h>
@@ -106,11 +108,25 @@ RangeLocator::RangeLocator(PropertiesPtr &cfg, ConnectionManagerPtr &conn_mgr,
   int cache_size = cfg->get_i64("Hypertable.LocationCache.MaxEntries");
 
   m_cache = new LocationCache(cache_size);
+  m_negative_ttl = cfg->get_i32("Hypertable.LocationCache.NegativeTTL");
+  m_prefetch_max_entries =
+      cfg->get_i32("Hypertable.LocationCache.Prefetch.MaxEntries");
+  m_prefetch_timeout = cfg->get_i32("Hypertable.LocationCache.Prefetch.Timeout");
 
   initialize(timer);
 }
 
 
+RangeLocator::RangeLocator(LocationCachePtr &cache, uint32_t negative_ttl)
+  : m_cache(cache), m_root_stale(false), m_range_server(0, 1),
+    m_startrow_cid(0), m_location_cid(0), m_negative_ttl(negative_ttl),
+    m_prefetch_max_entries(0), m_prefetch_timeout(0) {
+  m_metadata_table.name = "METADATA";
+  m_metadata_table.id = 0;
+  m_metadata_table.generation = 0;
+}
+
+
 void RangeLocator::initialize(Timer &timer) {
   DynamicBuffer valbuf(0);
   HandleCallbackPtr null_handle_callback;
@@ -170,7 +186,8 @@ void RangeLocator::initialize(Timer &timer) {
 
 
 RangeLocator::~RangeLocator() {
-  m_hyperspace->close(m_root_file_handle);
+  if (m_hyperspace)
+    m_hyperspace->close(m_root_file_handle);
 }
 
 
@@ -238,6 +255,13 @@ RangeLocator::find(const TableIdentifier *table, const char *row_key,
   if (!hard && m_cache->lookup(table->id, row_key, rane_loc_infop))
     return Error::OK;
 
+  if (!hard && m_negative_ttl &&
+      (error = m_cache->lookup_negative(table->id, row_key)) != Error::OK)
+    return error;
+
+  if (!m_hyperspace)
+    return Error::METADATA_NOT_FOUND;
+
   /**
    * If key is on root METADATA range, return root range information
    */
@@ -370,6 +394,8 @@ RangeLocator::find(const TableIdentifier *table, const char *row_key,
 
   if ((error = process_metadata_scanblock(scan_block)) != Error::OK) {
     m_range_server.destroy_scanner(addr, scan_block.get_scanner_id(), 0);
+    if (error == Error::TABLE_NOT_FOUND && m_negative_ttl)
+      m_cache->insert_negative(table->id, row_key, error, m_negative_ttl);
     return error;
   }
 
@@ -383,6 +409,9 @@ RangeLocator::find(const TableIdentifier *table, const char *row_key,
   if (!m_cache->lookup(table->id, row_key, rane_loc_infop, inclusive)) {
     SAVE_ERR(Error::METADATA_NOT_FOUND, (String)"RangeLocator failed to find "
              "metadata for table '" + table->name + "' row '" + row_key + "'");
+    if (m_negative_ttl)
+      m_cache->insert_negative(table->id, row_key, Error::METADATA_NOT_FOUND,
+                               m_negative_ttl);
     return Error::METADATA_NOT_FOUND;
   }
 
@@ -390,7 +419,175 @@ RangeLocator::find(const TableIdentifier *table, const char *row_key,
 }
 
 
-int RangeLocator::process_metadata_scanblock(ScanBlock &scan_block) {
+namespace {
+  struct LtRow {
+    LtRow(const std::vector<const char *> &r) : rows(r) { }
+    bool operator()(size_t i, size_t j) const {
+      return strcmp(rows[i], rows[j]) < 0;
+    }
+    const std::vector<const char *> &rows;
+  };
+}
+
+
+void
+RangeLocator::find_batch(const TableIdentifier *table,
+    const std::vector<const char *> &rows,
+    std::vector<RangeLocationInfo> &range_loc_infos, Timer &timer) {
+  std::vector<size_t> order(rows.size());
+  bool prefetch_ok = true;
+
+  for (size_t i=0; i<rows.size(); i++)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), LtRow(rows));
+
+  range_loc_infos.resize(rows.size());
+
+  for (size_t i=0; i<order.size(); i++) {
+    const char *row = rows[order[i]];
+    RangeLocationInfo *infop = &range_loc_infos[order[i]];
+    bool inclusive = *row == 0;
+
+    if (m_cache->lookup(table->id, row, infop, inclusive))
+      continue;
+
+    // a row known to be missing is not worth a prefetch
+    if (m_negative_ttl &&
+        m_cache->lookup_negative(table->id, row) != Error::OK) {
+      find_loop(table, row, infop, timer, false);
+      continue;
+    }
+
+    // rows are usually missing in runs, so load the locations from here to
+    // the last row in one go, allowing for a few ranges per remaining row
+    if (prefetch_ok && table->id != 0)
+      prefetch_ok = prefetch(table, row, rows[order.back()],
+          (order.size() - i) + METADATA_READAHEAD_COUNT, timer) == Error::OK;
+
+    if (!m_cache->lookup(table->id, row, infop, inclusive))
+      find_loop(table, row, infop, timer, false);
+  }
+}
+
+
+int
+RangeLocator::prefetch(const TableIdentifier *table, const char *start_row,
+    const char *end_row, uint32_t max_entries, Timer &timer) {
+  Timer prefetch_timer(std::min(timer.remaining(), m_prefetch_timeout), true);
+  RangeLocationInfo meta_range;
+  RangeSpec range;
+  ScanSpec meta_scan_spec;
+  ScanBlock scan_block;
+  RowInterval ri;
+  struct sockaddr_in addr;
+  String last_end_row;
+  uint32_t count = 0;
+  bool reached_end = false;
+  int error;
+
+  // the root range has the locations of all METADATA ranges pegged
+  if (table->id == 0 || !m_hyperspace)
+    return Error::OK;
+
+  if (start_row == 0)
+    start_row = "";
+  if (m_cache->lookup(table->id, start_row, &meta_range, *start_row == 0))
+    return Error::OK;
+
+  // METADATA rows are keyed by end row, so the range that contains end_row
+  // is the first one at or after it; scan to the end of the table and stop
+  // once that one has been seen
+  String meta_start = format("%u:%s", table->id, start_row);
+  String meta_end = format("%u:%s", table->id, Key::END_ROW_MARKER);
+
+  while (count < max_entries && !reached_end) {
+
+    // locate the METADATA range that holds meta_start
+    if ((error = find(&m_metadata_table, meta_start.c_str(), &meta_range,
+                      prefetch_timer, false)) != Error::OK)
+      return error;
+
+    if (!LocationCache::location_to_addr(meta_range.location.c_str(), addr)) {
+      String err_msg = format("Invalid location found in METADATA entry for "
+          "row '%s' - %s", meta_start.c_str(), meta_range.location.c_str());
+      HT_ERRORF("%s", err_msg.c_str());
+      SAVE_ERR(Error::INVALID_METADATA, err_msg);
+      return Error::INVALID_METADATA;
+    }
+
+    range.start_row = meta_range.start_row.c_str();
+    range.end_row = meta_range.end_row.c_str();
+
+    meta_scan_spec.clear();
+    meta_scan_spec.row_limit = max_entries - count;
+    meta_scan_spec.max_versions = 1;
+    meta_scan_spec.columns.push_back("StartRow");
+    meta_scan_spec.columns.push_back("Location");
+
+    ri.start = meta_start.c_str();
+    ri.start_inclusive = true;
+    ri.end = meta_end.c_str();
+    ri.end_inclusive = true;
+    meta_scan_spec.row_intervals.push_back(ri);
+    meta_scan_spec.return_deletes = false;
+
+    if (m_conn_manager &&
+        !m_conn_manager->wait_for_connection(addr,
+                                             prefetch_timer.remaining()))
+      return Error::REQUEST_TIMEOUT;
+
+    try {
+      m_range_server.set_timeout(prefetch_timer.remaining());
+      m_range_server.create_scanner(addr, m_metadata_table, range,
+                                    meta_scan_spec, scan_block);
+
+      // a record split across two blocks is dropped; it is looked up on
+      // demand like any other miss
+      while (true) {
+        if ((error = process_metadata_scanblock(scan_block, &count,
+                                                &last_end_row))
+            != Error::OK) {
+          if (!scan_block.eos())
+            m_range_server.destroy_scanner(addr, scan_block.get_scanner_id(),
+                                           0);
+          return error;
+        }
+        if (end_row && *end_row && last_end_row.compare(end_row) >= 0)
+          reached_end = true;
+        if (scan_block.eos())
+          break;
+        if (reached_end) {
+          m_range_server.destroy_scanner(addr, scan_block.get_scanner_id(), 0);
+          break;
+        }
+        m_range_server.set_timeout(prefetch_timer.remaining());
+        m_range_server.fetch_scanblock(addr, scan_block.get_scanner_id(),
+                                       scan_block);
+      }
+    }
+    catch (Exception &e) {
+      if (e.code() == Error::RANGESERVER_RANGE_NOT_FOUND)
+        m_cache->invalidate(0, meta_start.c_str());
+      SAVE_ERR2(e.code(), e, format("Problem prefetching METADATA from row "
+                "'%s'", meta_start.c_str()));
+      return e.code();
+    }
+
+    // done if this METADATA range extends past the rows of interest
+    if (strcmp(meta_range.end_row.c_str(), meta_end.c_str()) >= 0)
+      break;
+
+    // the next METADATA range starts just after this one ends
+    meta_start = meta_range.end_row + "\001";
+  }
+
+  clear_error_history();
+  return Error::OK;
+}
+
+
+int RangeLocator::process_metadata_scanblock(ScanBlock &scan_block,
+    uint32_t *countp, String *last_end_rowp) {
   RangeLocationInfo range_loc_info;
   SerializedKey serkey;
   ByteString value;
@@ -445,6 +642,10 @@ int RangeLocator::process_metadata_scanblock(ScanBlock &scan_block) {
             m_conn_manager->add(addr, METADATA_RETRY_INTERVAL, "RangeServer");
 
           m_cache->insert(table_id, range_loc_info);
+          if (countp)
+            (*countp)++;
+          if (last_end_rowp)
+            *last_end_rowp = range_loc_info.end_row;
           /*
           HT_DEBUG_OUT << "(1) cache insert table=" << table_id << " start="
               << range_loc_info.start_row << " end=" << range_loc_info.end_row
@@ -509,6 +710,10 @@ int RangeLocator::process_metadata_scanblock(ScanBlock &scan_block) {
       m_conn_manager->add(addr, METADATA_RETRY_INTERVAL, "RangeServer");
 
     m_cache->insert(table_id, range_loc_info);
+    if (countp)
+      (*countp)++;
+    if (last_end_rowp)
+      *last_end_rowp = range_loc_info.end_row;
 
     /*
     HT_DEBUG_OUT << "(2) cache insert table=" << table_id << " start="
@@ -23,6 +23,7 @@
 #define HYPERTABLE_RANGELOCATOR_H
 
 #include <deque>
+#include <vector>
 
 #include "Common/Mutex.h"
 #include "Common/Error.h"
@@ -63,6 +64,15 @@ namespace Hypertable {
     RangeLocator(PropertiesPtr &cfg, ConnectionManagerPtr &conn_mgr,
                  Hyperspace::SessionPtr &hyperspace, uint32_t timeout_ms);
 
+    /** Constructs a locator that only answers from cache, including its
+     * negative entries, and never contacts Hyperspace or the range
+     * servers.  Lookups that miss the cache fail.  Used by tests.
+     *
+     * @param cache location cache to answer from
+     * @param negative_ttl lifetime of negative entries in milliseconds
+     */
+    RangeLocator(LocationCachePtr &cache, uint32_t negative_ttl);
+
     /** Destructor.  Closes the root file in Hyperspace */
     ~RangeLocator();
 
@@ -89,6 +99,47 @@ namespace Hypertable {
     int find(const TableIdentifier *table, const char *row_key,
              RangeLocationInfo *range_loc_infop, Timer &timer, bool hard);
 
+    /** Locates the ranges that contain each of a set of row keys.  Rows
+     * missing from the cache are looked up in order; each miss loads the
+     * locations from that row on, up to the last row, in one streaming
+     * METADATA scan, so the rows that follow it are usually found in the
+     * cache.
+     *
+     * @param table pointer to table identifier structure
+     * @param rows row keys to locate
+     * @param range_loc_infos receives the location of the range of each row,
+     *        in the order of rows
+     * @param timer reference to timer object
+     */
+    void find_batch(const TableIdentifier *table,
+                    const std::vector<const char *> &rows,
+                    std::vector<RangeLocationInfo> &range_loc_infos,
+                    Timer &timer);
+
+    /** Loads the locations of the ranges of a table, or of the part of it
+     * between two rows, into the cache with one streaming scan of each
+     * METADATA range involved.  Prefetching is only an optimization, so it
+     * gives up after Hypertable.LocationCache.Prefetch.Timeout
+     * milliseconds even if timer allows more, and returns right away if
+     * the location of start_row is already cached.
+     *
+     * @param table pointer to table identifier structure
+     * @param start_row first row of interest, 0 for the start of the table
+     * @param end_row last row of interest, 0 for the end of the table; the
+     *        range that contains it is loaded as well
+     * @param max_entries maximum number of locations to load
+     * @param timer reference to timer object
+     * @return Error::OK on success or error code on failure
+     */
+    int prefetch(const TableIdentifier *table, const char *start_row,
+                 const char *end_row, uint32_t max_entries, Timer &timer);
+
+    /** Returns the maximum number of locations loaded when a table is
+     * opened (Hypertable.LocationCache.Prefetch.MaxEntries), 0 if tables
+     * are not prefetched
+     */
+    uint32_t prefetch_max_entries() { return m_prefetch_max_entries; }
+
     /**
      * Invalidates the cached entry for the given row key
      *
@@ -133,7 +184,9 @@ namespace Hypertable {
   private:
 
     void initialize(Timer &timer);
-    int process_metadata_scanblock(ScanBlock &scan_block);
+    int process_metadata_scanblock(ScanBlock &scan_block,
+                                   uint32_t *countp = 0,
+                                   String *last_end_rowp = 0);
     int read_root_location(Timer &timer);
 
     Mutex                  m_mutex;
@@ -151,6 +204,9 @@ namespace Hypertable {
     uint8_t                m_location_cid;
     TableIdentifier        m_metadata_table;
     std::deque<Exception>  m_last_errors;
+    uint32_t               m_negative_ttl;
+    uint32_t               m_prefetch_max_entries;
+    uint32_t               m_prefetch_timeout;
   };
 
   typedef intrusive_ptr<RangeLocator> RangeLocatorPtr;
@@ -23,6 +23,7 @@
 #include "Common/Config.h"
 #include "Common/Error.h"
 #include "Common/StringExt.h"
+#include "Common/Serialization.h"
 #include "AsyncComm/DispatchHandlerSynchronizer.h"
 
 #include "RangeServerClient.h"
@@ -298,6 +299,67 @@ RangeServerClient::drop_range(const sockaddr_in &addr,
 }
 
 
+void
+RangeServerClient::merge_ranges(const sockaddr_in &addr,
+    const TableIdentifier &table, const RangeSpec &low,
+    const RangeSpec &high) {
+  DispatchHandlerSynchronizer sync_handler;
+  EventPtr event_ptr;
+  CommBufPtr cbp(RangeServerProtocol::create_request_merge_ranges(table, low,
+                 high));
+  send_message(addr, cbp, &sync_handler);
+
+  if (!sync_handler.wait_for_reply(event_ptr))
+    HT_THROW((int)Protocol::response_code(event_ptr),
+             String("RangeServer merge_ranges() failure : ")
+             + Protocol::string_format_message(event_ptr));
+}
+
+
+void
+RangeServerClient::relinquish_range(const sockaddr_in &addr,
+    const TableIdentifier &table, const RangeSpec &range) {
+  DispatchHandlerSynchronizer sync_handler;
+  EventPtr event_ptr;
+  CommBufPtr cbp(RangeServerProtocol::create_request_relinquish_range(table,
+                 range));
+  send_message(addr, cbp, &sync_handler);
+
+  if (!sync_handler.wait_for_reply(event_ptr))
+    HT_THROW((int)Protocol::response_code(event_ptr),
+             String("RangeServer relinquish_range() failure : ")
+             + Protocol::string_format_message(event_ptr));
+}
+
+
+void
+RangeServerClient::replay_fragments(const sockaddr_in &addr,
+    const String &log_dir, const std::vector<uint32_t> &fragments,
+    const std::vector<QualifiedRangeSpec> &ranges,
+    const std::vector<String> &destinations,
+    std::vector<String> &linked_logs) {
+  DispatchHandlerSynchronizer sync_handler;
+  EventPtr event_ptr;
+  CommBufPtr cbp(RangeServerProtocol::create_request_replay_fragments(log_dir,
+                 fragments, ranges, destinations));
+  send_message(addr, cbp, &sync_handler);
+
+  if (!sync_handler.wait_for_reply(event_ptr))
+    HT_THROW((int)Protocol::response_code(event_ptr),
+             String("RangeServer replay_fragments() failure : ")
+             + Protocol::string_format_message(event_ptr));
+
+  const uint8_t *decode_ptr = event_ptr->payload + 4;
+  size_t decode_remain = event_ptr->payload_len - 4;
+  size_t count = Serialization::decode_i32(&decode_ptr, &decode_remain);
+
+  linked_logs.clear();
+  for (size_t i=0; i<count; i++)
+    linked_logs.push_back(Serialization::decode_str16(&decode_ptr,
+                                                      &decode_remain));
+}
+
+
 void
 RangeServerClient::send_message(const sockaddr_in &addr, CommBufPtr &cbp,
                                 DispatchHandler *handler) {
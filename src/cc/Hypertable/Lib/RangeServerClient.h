@@ -275,6 +275,52 @@ namespace Hypertable {
     void drop_range(const sockaddr_in &addr, const TableIdentifier &table,
                     const RangeSpec &range, DispatchHandler *handler);
 
+    /** Issues a "merge ranges" request.  The two ranges must be adjacent
+     * and loaded on the same server.  The upper range absorbs the lower
+     * one.  This call blocks until it receives a response from the server
+     * or times out.
+     *
+     * @param addr remote address of RangeServer connection
+     * @param table table identifier
+     * @param low range specification of the lower range
+     * @param high range specification of the upper range
+     */
+    void merge_ranges(const sockaddr_in &addr, const TableIdentifier &table,
+                      const RangeSpec &low, const RangeSpec &high);
+
+    /** Issues a "relinquish range" request.  The server flushes the range
+     * to disk and unloads it, so that it can be loaded elsewhere.  This
+     * call blocks until it receives a response from the server or times
+     * out.
+     *
+     * @param addr remote address of RangeServer connection
+     * @param table table identifier
+     * @param range range specification
+     */
+    void relinquish_range(const sockaddr_in &addr, const TableIdentifier &table,
+                          const RangeSpec &range);
+
+    /** Issues a "replay fragments" request.  The server reads the given
+     * fragments of a failed server's commit log and sends each update to
+     * the server its range has been assigned to with "replay update"
+     * requests.  This call blocks until it receives a response from the
+     * server or times out.
+     *
+     * @param addr remote address of RangeServer connection
+     * @param log_dir commit log directory of the failed server
+     * @param fragments numbers of the fragments to replay
+     * @param ranges ranges being recovered
+     * @param destinations location of the server each range has been
+     *        assigned to, parallel to <code>ranges</code>
+     * @param linked_logs filled in with the directories of the logs that
+     *        were linked into the replayed fragments
+     */
+    void replay_fragments(const sockaddr_in &addr, const String &log_dir,
+                          const std::vector<uint32_t> &fragments,
+                          const std::vector<QualifiedRangeSpec> &ranges,
+                          const std::vector<String> &destinations,
+                          std::vector<String> &linked_logs);
+
   private:
 
     void send_message(const sockaddr_in &addr, CommBufPtr &cbp,
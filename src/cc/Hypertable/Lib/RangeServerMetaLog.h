@@ -106,6 +106,14 @@ public:
     write(entry.get());
   }
 
+  void
+  log_range_merged(const TableIdentifier &table, const RangeSpec &merged,
+                   const RangeState &state) {
+    MetaLogEntryPtr entry(MetaLogEntryFactory::new_rs_range_merged(
+                          table, merged, state));
+    write(entry.get());
+  }
+
 private:
   void write_header();
 };
@@ -109,6 +109,18 @@ public:
   virtual int get_type() const { return MetaLogEntryFactory::RS_DROP_TABLE; }
 };
 
+/**
+ * Records that adjacent ranges were merged into the given range, which
+ * replaces every range of the table that it covers.
+ */
+class RangeMerged : public MetaLogEntryRangeCommon {
+public:
+  RangeMerged() {}
+  RangeMerged(const TableIdentifier &t, const RangeSpec &merged,
+              const RangeState &s) : MetaLogEntryRangeCommon(t, merged, s) {}
+
+  virtual int get_type() const { return MetaLogEntryFactory::RS_RANGE_MERGED; }
+};
 
 }} // namespace Hypertable::RangeServerTxn
 
@@ -71,6 +71,12 @@ new_rs_drop_table(const TableIdentifier &table) {
   return new DropTable(table);
 }
 
+MetaLogEntry *
+new_rs_range_merged(const TableIdentifier &table, const RangeSpec &merged,
+                    const RangeState &state) {
+  return new RangeMerged(table, merged, state);
+}
+
 
 MetaLogEntry *
 new_from_payload(RangeServerMetaLogEntryType t, uint64_t timestamp,
@@ -86,6 +92,7 @@ new_from_payload(RangeServerMetaLogEntryType t, uint64_t timestamp,
     case RS_MOVE_PREPARED: p = new MovePrepared();      break;
     case RS_MOVE_DONE:     p = new MoveDone();          break;
     case RS_DROP_TABLE:    p = new DropTable();         break;
+    case RS_RANGE_MERGED:  p = new RangeMerged();       break;
     default: HT_THROWF(Error::METALOG_ENTRY_BAD_TYPE, "unknown type (%d)", t);
   }
   p->timestamp = timestamp;
@@ -37,7 +37,8 @@ enum RangeServerMetaLogEntryType {
   RS_MOVE_START         = 5,
   RS_MOVE_PREPARED      = 6,
   RS_MOVE_DONE          = 7,
-  RS_DROP_TABLE         = 8
+  RS_DROP_TABLE         = 8,
+  RS_RANGE_MERGED       = 9
 };
 
 MetaLogEntry *
@@ -69,6 +70,10 @@ new_rs_move_done(const TableIdentifier &, const RangeSpec &);
 MetaLogEntry *
 new_rs_drop_table(const TableIdentifier &);
 
+MetaLogEntry *
+new_rs_range_merged(const TableIdentifier &, const RangeSpec &merged,
+                    const RangeState &);
+
 MetaLogEntry *
 new_from_payload(RangeServerMetaLogEntryType, uint64_t timestamp,
                  StaticBuffer &);
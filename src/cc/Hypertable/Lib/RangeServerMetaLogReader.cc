@@ -161,16 +161,31 @@ void load_entry(Reader &rd, RsiSet &rsi_set, SplitDone *ep) {
 }
 
 
+/**
+ * A range that is being moved still belongs to this server until the move
+ * is done, so MoveStart and MovePrepared leave it in place for recovery.
+ */
 void load_entry(Reader &rd, RsiSet &rsi_set, MoveStart *ep) {
-  // TODO
 }
 
 void load_entry(Reader &rd, RsiSet &rsi_set, MovePrepared *ep) {
-  // TODO
 }
 
 void load_entry(Reader &rd, RsiSet &rsi_set, MoveDone *ep) {
-  // TODO
+  RangeStateInfo ri(ep->table, ep->range);
+  RsiSet::iterator it = rsi_set.find(&ri);
+
+  if (it == rsi_set.end()) {
+    HT_ERROR_OUT <<"Unexpected MoveDone "<< ep << " at "<< rd.pos() <<'/'
+                 << rd.size() <<" in "<< rd.path() << HT_END;
+
+    if (rd.skips_errors())
+      return;
+
+    HT_THROW_(Error::METALOG_ENTRY_BAD_ORDER);
+  }
+  delete *it;
+  rsi_set.erase(it);
 }
 
 void load_entry(Reader &rd, RsiSet &rsi_set, DropTable *ep) {
@@ -188,6 +203,28 @@ void load_entry(Reader &rd, RsiSet &rsi_set, DropTable *ep) {
   }
 }
 
+void load_entry(Reader &rd, RsiSet &rsi_set, RangeMerged *ep) {
+  RsiSet::iterator it = rsi_set.begin();
+  RsiSet::iterator tmpit;
+
+  // drop the ranges that were merged, i.e. everything the new one covers
+  while (it != rsi_set.end()) {
+    if ((*it)->table.id == ep->table.id &&
+        strcmp((*it)->range.start_row, ep->range.start_row) >= 0 &&
+        strcmp((*it)->range.end_row, ep->range.end_row) <= 0) {
+      tmpit = it;
+      ++it;
+      delete *tmpit;
+      rsi_set.erase(tmpit);
+    }
+    else
+      ++it;
+  }
+
+  rsi_set.insert(new RangeStateInfo(ep->table, ep->range, ep->range_state,
+                                    ep->timestamp));
+}
+
 } // local namespace
 
 namespace Hypertable {
@@ -257,6 +294,8 @@ RangeServerMetaLogReader::load_range_states(bool force) {
       load_entry(*this, rsi_set, (MoveDone *)p);        break;
     case RS_DROP_TABLE:
       load_entry(*this, rsi_set, (DropTable *)p);       break;
+    case RS_RANGE_MERGED:
+      load_entry(*this, rsi_set, (RangeMerged *)p);     break;
     default:
       HT_FATALF("Bad code: unhandled entry type: %d", p->get_type());
     }
@@ -47,6 +47,9 @@ namespace Hypertable {
     "replay commit",
     "get statistics",
     "update schema",
+    "merge ranges",
+    "relinquish range",
+    "replay fragments",
     (const char *)0
   };
 
@@ -197,6 +200,58 @@ namespace Hypertable {
     return cbuf;
   }
 
+  CommBuf *
+  RangeServerProtocol::create_request_merge_ranges(const TableIdentifier &table,
+      const RangeSpec &low, const RangeSpec &high) {
+    CommHeader header(COMMAND_MERGE_RANGES);
+    CommBuf *cbuf = new CommBuf(header, table.encoded_length()
+                                + low.encoded_length() + high.encoded_length());
+    table.encode(cbuf->get_data_ptr_address());
+    low.encode(cbuf->get_data_ptr_address());
+    high.encode(cbuf->get_data_ptr_address());
+    return cbuf;
+  }
+
+  CommBuf *
+  RangeServerProtocol::create_request_relinquish_range(
+      const TableIdentifier &table, const RangeSpec &range) {
+    CommHeader header(COMMAND_RELINQUISH_RANGE);
+    CommBuf *cbuf = new CommBuf(header, table.encoded_length()
+                                + range.encoded_length());
+    table.encode(cbuf->get_data_ptr_address());
+    range.encode(cbuf->get_data_ptr_address());
+    return cbuf;
+  }
+
+  CommBuf *
+  RangeServerProtocol::create_request_replay_fragments(const String &log_dir,
+      const std::vector<uint32_t> &fragments,
+      const std::vector<QualifiedRangeSpec> &ranges,
+      const std::vector<String> &destinations) {
+    CommHeader header(COMMAND_REPLAY_FRAGMENTS);
+    size_t len = encoded_length_str16(log_dir) + 4 + 4*fragments.size() + 4;
+
+    HT_ASSERT(ranges.size() == destinations.size());
+
+    for (size_t i=0; i<ranges.size(); i++)
+      len += ranges[i].table.encoded_length()
+          + ranges[i].range.encoded_length()
+          + encoded_length_str16(destinations[i]);
+
+    CommBuf *cbuf = new CommBuf(header, len);
+    cbuf->append_str16(log_dir);
+    cbuf->append_i32(fragments.size());
+    for (size_t i=0; i<fragments.size(); i++)
+      cbuf->append_i32(fragments[i]);
+    cbuf->append_i32(ranges.size());
+    for (size_t i=0; i<ranges.size(); i++) {
+      ranges[i].table.encode(cbuf->get_data_ptr_address());
+      ranges[i].range.encode(cbuf->get_data_ptr_address());
+      cbuf->append_str16(destinations[i]);
+    }
+    return cbuf;
+  }
+
   CommBuf *RangeServerProtocol::create_request_get_statistics() {
     CommHeader header(COMMAND_GET_STATISTICS);
     CommBuf *cbuf = new CommBuf(header);
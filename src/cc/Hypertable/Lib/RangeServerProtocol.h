@@ -22,6 +22,14 @@
 #ifndef HYPERTABLE_RANGESERVERPROTOCOL_H
 #define HYPERTABLE_RANGESERVERPROTOCOL_H
 
+#include <vector>
+
+extern "C" {
+#include <netinet/in.h>
+}
+
+#include "Common/StaticBuffer.h"
+
 #include "AsyncComm/Protocol.h"
 
 #include "RangeState.h"
@@ -51,7 +59,10 @@ namespace Hypertable {
     static const uint64_t COMMAND_REPLAY_COMMIT     = 14;
     static const uint64_t COMMAND_GET_STATISTICS    = 15;
     static const uint64_t COMMAND_UPDATE_SCHEMA     = 16;
-    static const uint64_t COMMAND_MAX               = 17;
+    static const uint64_t COMMAND_MERGE_RANGES      = 17;
+    static const uint64_t COMMAND_RELINQUISH_RANGE  = 18;
+    static const uint64_t COMMAND_REPLAY_FRAGMENTS  = 19;
+    static const uint64_t COMMAND_MAX               = 20;
 
     static const char *m_command_strings[];
 
@@ -183,6 +194,39 @@ namespace Hypertable {
     static CommBuf *create_request_drop_range(const TableIdentifier &table,
                                               const RangeSpec &range);
 
+    /** Creates a "merge ranges" request message.
+     *
+     * @param table table identifier
+     * @param low range specification of the lower range
+     * @param high range specification of the adjacent upper range
+     * @return protocol message
+     */
+    static CommBuf *create_request_merge_ranges(const TableIdentifier &table,
+        const RangeSpec &low, const RangeSpec &high);
+
+    /** Creates a "relinquish range" request message.
+     *
+     * @param table table identifier
+     * @param range range specification
+     * @return protocol message
+     */
+    static CommBuf *create_request_relinquish_range(
+        const TableIdentifier &table, const RangeSpec &range);
+
+    /** Creates a "replay fragments" request message.
+     *
+     * @param log_dir commit log directory of the failed server
+     * @param fragments numbers of the fragments to replay
+     * @param ranges ranges being recovered
+     * @param destinations location of the server each range has been
+     *        assigned to, parallel to <code>ranges</code>
+     * @return protocol message
+     */
+    static CommBuf *create_request_replay_fragments(const String &log_dir,
+        const std::vector<uint32_t> &fragments,
+        const std::vector<QualifiedRangeSpec> &ranges,
+        const std::vector<String> &destinations);
+
     /** Creates a "get statistics" request message.
      *
      * @return protocol message
@@ -72,7 +72,7 @@ Mutex desc_mutex;
 bool desc_inited = false;
 
 PropertiesDesc
-  compressor_desc("  bmz|lzo|quicklz|zlib|none [compressor_options]\n\n"
+  compressor_desc("  bmz|lzo|quicklz|zlib|lz4|zstd|none [compressor_options]\n\n"
       "compressor_options"),
   bloom_filter_desc("  rows|rows+cols|none [bloom_filter_options]\n\n"
       "  Default bloom filter is defined by the config property:\n"
@@ -93,9 +93,14 @@ void init_schema_options_desc() {
     ("normal", "Normal setting for zlib")
     ("fp-len", i16()->default_value(19), "Minimum fingerprint length for bmz")
     ("offset", i16()->default_value(0), "Starting fingerprint offset for bmz")
+    ("hc", "High compression mode for lz4")
+    ("level", i32(), "Compression level for lz4 (implies --hc) and zstd")
+    ("dictionary", i32(), "Size of the dictionary trained for each zstd "
+        "cell store")
     ;
   compressor_hidden_desc.add_options()
-    ("compressor-type", str(), "Compressor type (bmz|lzo|quicklz|zlib|none)")
+    ("compressor-type", str(), "Compressor type "
+        "(bmz|lzo|quicklz|zlib|lz4|zstd|none)")
     ;
   compressor_pos_desc.add("compressor-type", 1);
 
@@ -132,6 +137,7 @@ Schema::Schema(const Schema &src_schema)
   // Set schema attributes
   m_generation = src_schema.m_generation;
   m_compressor = src_schema.m_compressor;
+  m_compaction_policy = src_schema.m_compaction_policy;
   m_next_column_id = src_schema.m_next_column_id;
   m_max_column_family_id = src_schema.m_max_column_family_id;
   m_read_ids = src_schema.m_read_ids;
@@ -257,6 +263,16 @@ void Schema::validate_compressor(const String &compressor) {
 }
 
 
+void Schema::validate_compaction_policy(const String &policy) {
+  if (policy.empty())
+    return;
+
+  if (policy != "default" && policy != "size-tiered" && policy != "leveled")
+    set_error_string((String)"Invalid compaction policy '" + policy
+                     + "' (expected default, size-tiered or leveled)");
+}
+
+
 void Schema::validate_bloom_filter(const String &bloom_filter) {
   if (bloom_filter.empty())
     return;
@@ -288,6 +304,10 @@ void Schema::start_element_handler(void *userdata,
         ms_schema->set_generation(atts[i+1]);
       else if (!strcasecmp(atts[i], "compressor"))
         ms_schema->set_compressor((String)atts[i+1]);
+      else if (!strcasecmp(atts[i], "compactionPolicy")) {
+        ms_schema->validate_compaction_policy((String)atts[i+1]);
+        ms_schema->set_compaction_policy((String)atts[i+1]);
+      }
       else
         ms_schema->set_error_string((String)"Unrecognized 'Schema' attribute : "
                                      + atts[i]);
@@ -536,6 +556,9 @@ void Schema::render(String &output, bool with_ids) {
   if (m_compressor != "")
     output += format(" compressor=\"%s\"", m_compressor.c_str());
 
+  if (m_compaction_policy != "")
+    output += format(" compactionPolicy=\"%s\"", m_compaction_policy.c_str());
+
   output += ">\n";
 
   foreach(const AccessGroup *ag, m_access_groups) {
@@ -590,6 +613,9 @@ void Schema::render_hql_create_table(const String &table_name, String &output) {
   output += "\n";
   output += "CREATE TABLE ";
 
+  if (m_compaction_policy != "")
+    output += format("COMPACTION_POLICY=\"%s\" ", m_compaction_policy.c_str());
+
   if (m_compressor != "")
     output += format("COMPRESSOR=\"%s\"", m_compressor.c_str());
 
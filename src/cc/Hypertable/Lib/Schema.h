@@ -80,6 +80,8 @@ namespace Hypertable {
     void validate_compressor(const String &spec);
     static const PropertiesDesc &compressor_spec_desc();
 
+    void validate_compaction_policy(const String &policy);
+
     static void parse_bloom_filter(const String &spec, PropertiesPtr &);
     void validate_bloom_filter(const String &spec);
     static const PropertiesDesc &bloom_filter_spec_desc();
@@ -156,6 +158,11 @@ namespace Hypertable {
     void set_compressor(const String &compressor) { m_compressor = compressor; }
     const String &get_compressor() { return m_compressor; }
 
+    void set_compaction_policy(const String &policy) {
+      m_compaction_policy = policy;
+    }
+    const String &get_compaction_policy() { return m_compaction_policy; }
+
     typedef hash_map<String, ColumnFamily *> ColumnFamilyMap;
     typedef hash_map<String, AccessGroup *> AccessGroupMap;
 
@@ -178,6 +185,7 @@ namespace Hypertable {
     bool           m_output_ids;
     size_t         m_max_column_family_id;
     String         m_compressor;
+    String         m_compaction_policy;
 
     static void
     start_element_handler(void *userdata, const XML_Char *name,
@@ -23,6 +23,7 @@
 #include "Common/Serialization.h"
 #include "Common/Logger.h"
 
+#include "Hypertable/Lib/RangeServerProtocol.h"
 #include "Hypertable/Lib/Stat.h"
 
 using namespace std;
@@ -30,7 +31,7 @@ using namespace Hypertable;
 using namespace Serialization;
 
 size_t RangeStat::encoded_length() const {
-  return 64 + table_identifier.encoded_length() + range_spec.encoded_length();
+  return 96 + table_identifier.encoded_length() + range_spec.encoded_length();
 }
 
 void RangeStat::encode(uint8_t **bufp) const {
@@ -44,6 +45,10 @@ void RangeStat::encode(uint8_t **bufp) const {
   encode_i64(bufp, collided_cells);
   encode_i64(bufp, disk_usage);
   encode_i64(bufp, memory_usage);
+  encode_i64(bufp, bytes_written);
+  encode_i64(bufp, compaction_bytes_written);
+  encode_i64(bufp, read_rate);
+  encode_i64(bufp, write_rate);
 }
 
 void RangeStat::decode(const uint8_t **bufp, size_t *remainp) {
@@ -61,16 +66,26 @@ void RangeStat::decode(const uint8_t **bufp, size_t *remainp) {
     cached_cells = decode_i64(bufp, remainp);
     collided_cells = decode_i64(bufp, remainp);
     disk_usage = decode_i64(bufp, remainp);
-    memory_usage = decode_i64(bufp, remainp));
+    memory_usage = decode_i64(bufp, remainp);
+    bytes_written = decode_i64(bufp, remainp);
+    compaction_bytes_written = decode_i64(bufp, remainp);
+    read_rate = decode_i64(bufp, remainp);
+    write_rate = decode_i64(bufp, remainp));
 }
 
 size_t RangeServerStat::encoded_length() const {
-  size_t length = 28;
+  size_t length = 76;
 
   for (size_t i = 0; i < range_stats.size(); ++i) {
     length += range_stats[i].encoded_length();
   }
 
+  length += 4 + 16 * reactor_send_syscalls.size();
+
+  length += 4;
+  for (size_t i = 0; i < latencies.size(); ++i)
+    length += 9 + latencies[i].histogram.encoded_length();
+
   return length;
 }
 
@@ -80,6 +95,28 @@ void RangeServerStat::encode(uint8_t **bufp) const {
   for (size_t i = 0; i < range_stats.size(); ++i) {
     range_stats[i].encode(bufp);
   }
+
+  encode_i64(bufp, compaction_throttle_rate);
+  encode_i64(bufp, compaction_throttle_bytes);
+  encode_i64(bufp, compaction_throttle_wait_millis);
+  encode_i64(bufp, foreground_latency_millis);
+  encode_i64(bufp, comm_compression_raw_bytes);
+  encode_i64(bufp, comm_compression_wire_bytes);
+
+  encode_i32(bufp, reactor_send_syscalls.size());
+  for (size_t i = 0; i < reactor_send_syscalls.size(); ++i) {
+    encode_i32(bufp, reactor_send_syscalls[i]);
+    encode_i32(bufp, reactor_messages_sent[i]);
+    encode_i32(bufp, reactor_pool_hits[i]);
+    encode_i32(bufp, reactor_pool_misses[i]);
+  }
+
+  encode_i32(bufp, latencies.size());
+  for (size_t i = 0; i < latencies.size(); ++i) {
+    encode_i8(bufp, latencies[i].kind);
+    encode_i64(bufp, latencies[i].command);
+    latencies[i].histogram.encode(bufp);
+  }
 }
 
 void RangeServerStat::decode(const uint8_t **bufp, size_t *remainp) {
@@ -91,6 +128,60 @@ void RangeServerStat::decode(const uint8_t **bufp, size_t *remainp) {
   for (size_t i = 0; i < n; ++i) {
     range_stats.push_back(RangeStat(bufp, remainp));
   }
+
+  HT_TRY("decoding range server statistics",
+    compaction_throttle_rate = decode_i64(bufp, remainp);
+    compaction_throttle_bytes = decode_i64(bufp, remainp);
+    compaction_throttle_wait_millis = decode_i64(bufp, remainp);
+    foreground_latency_millis = decode_i64(bufp, remainp);
+    comm_compression_raw_bytes = decode_i64(bufp, remainp);
+    comm_compression_wire_bytes = decode_i64(bufp, remainp);
+    n = decode_i32(bufp, remainp);
+    for (size_t i = 0; i < n; ++i) {
+      reactor_send_syscalls.push_back(decode_i32(bufp, remainp));
+      reactor_messages_sent.push_back(decode_i32(bufp, remainp));
+      reactor_pool_hits.push_back(decode_i32(bufp, remainp));
+      reactor_pool_misses.push_back(decode_i32(bufp, remainp));
+    }
+    n = decode_i32(bufp, remainp);
+    latencies.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      latencies[i].kind = decode_i8(bufp, remainp);
+      latencies[i].command = decode_i64(bufp, remainp);
+      latencies[i].histogram.decode(bufp, remainp);
+    });
+}
+
+void RangeServerStat::subtract(const RangeServerStat &previous) {
+  compaction_throttle_bytes -= previous.compaction_throttle_bytes;
+  compaction_throttle_wait_millis -= previous.compaction_throttle_wait_millis;
+  comm_compression_raw_bytes -= previous.comm_compression_raw_bytes;
+  comm_compression_wire_bytes -= previous.comm_compression_wire_bytes;
+
+  // the reactor count is fixed for the lifetime of the server
+  if (previous.reactor_send_syscalls.size() == reactor_send_syscalls.size()) {
+    for (size_t i = 0; i < reactor_send_syscalls.size(); ++i) {
+      reactor_send_syscalls[i] -= previous.reactor_send_syscalls[i];
+      reactor_messages_sent[i] -= previous.reactor_messages_sent[i];
+      reactor_pool_hits[i] -= previous.reactor_pool_hits[i];
+      reactor_pool_misses[i] -= previous.reactor_pool_misses[i];
+    }
+  }
+
+  std::vector<LatencyStats::Entry> delta;
+  for (size_t i = 0; i < latencies.size(); ++i) {
+    LatencyStats::Entry &entry = latencies[i];
+    for (size_t j = 0; j < previous.latencies.size(); ++j) {
+      if (previous.latencies[j].kind == entry.kind &&
+          previous.latencies[j].command == entry.command) {
+        entry.histogram.subtract(previous.latencies[j].histogram);
+        break;
+      }
+    }
+    if (!entry.histogram.buckets.empty())
+      delta.push_back(entry);
+  }
+  latencies.swap(delta);
 }
 
 ostream &Hypertable::operator<<(ostream &os, const RangeStat &stat) {
@@ -105,6 +196,11 @@ ostream &Hypertable::operator<<(ostream &os, const RangeStat &stat) {
      << "  added_row_deletes = " << stat.added_deletes[0]
      << "  added_cf_deletes = " << stat.added_deletes[1]
      << "  added_cell_deletes = " << stat.added_deletes[2] << endl
+     << "  bytes_written = " << stat.bytes_written
+     << "  compaction_bytes_written = " << stat.compaction_bytes_written
+     << "  write_amplification = " << stat.write_amplification() << endl
+     << "  read_rate = " << stat.read_rate
+     << "  write_rate = " << stat.write_rate << endl
      << " }";
   return os;
 }
@@ -112,6 +208,39 @@ ostream &Hypertable::operator<<(ostream &os, const RangeStat &stat) {
 ostream &Hypertable::operator<<(ostream &os, const RangeServerStat &stat) {
   os << "{RangeServerStat: range_stats_number = " << stat.range_stats.size()
      <<'\n';
+  os << " compaction_throttle_rate = " << stat.compaction_throttle_rate
+     << "  compaction_throttle_bytes = " << stat.compaction_throttle_bytes
+     << "  compaction_throttle_wait_millis = "
+     << stat.compaction_throttle_wait_millis
+     << "  foreground_latency_millis = " << stat.foreground_latency_millis
+     <<'\n';
+  if (stat.comm_compression_raw_bytes)
+    os << " comm_compression_raw_bytes = " << stat.comm_compression_raw_bytes
+       << "  comm_compression_wire_bytes = "
+       << stat.comm_compression_wire_bytes << "  bytes_saved = "
+       << stat.comm_compression_raw_bytes - stat.comm_compression_wire_bytes
+       <<'\n';
+  for (size_t i = 0; i < stat.reactor_send_syscalls.size(); ++i) {
+    os << " reactor[" << i << "] send_syscalls = "
+       << stat.reactor_send_syscalls[i] << "  messages_sent = "
+       << stat.reactor_messages_sent[i] << "  syscalls_per_message = "
+       << (stat.reactor_messages_sent[i] ?
+           (double)stat.reactor_send_syscalls[i]
+           / stat.reactor_messages_sent[i] : 0.0)
+       << "  pool_hits = " << stat.reactor_pool_hits[i]
+       << "  pool_misses = " << stat.reactor_pool_misses[i] <<'\n';
+  }
+  RangeServerProtocol protocol;
+  for (size_t i = 0; i < stat.latencies.size(); ++i) {
+    const LatencyStats::Entry &entry = stat.latencies[i];
+    os << " latency " << LatencyStats::kind_text(entry.kind) << " ";
+    // round trips are of requests this server sent to other services
+    if (entry.kind == LatencyStats::ROUND_TRIP)
+      os << "command " << entry.command;
+    else
+      os << protocol.command_text(entry.command);
+    os << ": " << entry.histogram <<'\n';
+  }
   for (size_t i = 0; i < stat.range_stats.size(); ++i) {
     os << " range_stats[" << i << "] = " << stat.range_stats[i] <<'\n';
   }
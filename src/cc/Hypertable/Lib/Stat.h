@@ -22,6 +22,10 @@
 #ifndef HYPERTABLE_STAT_H
 #define HYPERTABLE_STAT_H
 
+#include <vector>
+
+#include "AsyncComm/LatencyStats.h"
+
 #include "Hypertable/Lib/Types.h"
 
 namespace Hypertable {
@@ -48,12 +52,30 @@ namespace Hypertable {
 
     uint64_t disk_usage;
     uint64_t memory_usage;
+
+    uint64_t bytes_written;
+    uint64_t compaction_bytes_written;
+
+    /** Decayed read and write request rates (requests/second) */
+    uint64_t read_rate;
+    uint64_t write_rate;
+
+    /**
+     * Bytes rewritten by compactions per byte of update data received
+     */
+    double write_amplification() const {
+      return bytes_written ?
+          (double)compaction_bytes_written / (double)bytes_written : 0.0;
+    }
   };
 
   /** Statistics of a RangeServer */
   class RangeServerStat {
   public:
-    RangeServerStat() { return; }
+    RangeServerStat() : compaction_throttle_rate(0),
+        compaction_throttle_bytes(0), compaction_throttle_wait_millis(0),
+        foreground_latency_millis(0), comm_compression_raw_bytes(0),
+        comm_compression_wire_bytes(0) { return; }
     RangeServerStat(const uint8_t **bufp, size_t *remainp) {
       decode(bufp, remainp);
     }
@@ -62,7 +84,49 @@ namespace Hypertable {
     void encode(uint8_t **bufp) const;
     void decode(const uint8_t **bufp, size_t *remainp);
 
+    /**
+     * Turns the cumulative counters of this statistics into the activity
+     * since previous, an earlier response of the same server.  The server
+     * never resets its counters, so every poller computes its own
+     * intervals.  Rates, gauges and range statistics are left as they are.
+     *
+     * @param previous earlier statistics of the same server
+     */
+    void subtract(const RangeServerStat &previous);
+
     std::vector<RangeStat> range_stats;
+
+    uint64_t compaction_throttle_rate;
+    uint64_t compaction_throttle_bytes;
+    uint64_t compaction_throttle_wait_millis;
+    uint64_t foreground_latency_millis;
+
+    /**
+     * Payload bytes of the compressed messages sent since server start,
+     * before and after compression
+     */
+    uint64_t comm_compression_raw_bytes;
+    uint64_t comm_compression_wire_bytes;
+
+    /**
+     * Send system calls made, and messages sent, by each I/O reactor since
+     * server start; the counters wrap around at 2^32
+     */
+    std::vector<uint32_t> reactor_send_syscalls;
+    std::vector<uint32_t> reactor_messages_sent;
+
+    /**
+     * Receive buffer pool hits and misses of each I/O reactor since server
+     * start; the counters wrap around at 2^32
+     */
+    std::vector<uint32_t> reactor_pool_hits;
+    std::vector<uint32_t> reactor_pool_misses;
+
+    /**
+     * Per-command queue wait, service time and round trip time histograms
+     * recorded since server start
+     */
+    std::vector<LatencyStats::Entry> latencies;
   };
 
   std::ostream &operator<<(std::ostream &os, const RangeStat &);
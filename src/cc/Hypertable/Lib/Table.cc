@@ -33,6 +33,8 @@
 #include "Table.h"
 #include "TableScanner.h"
 #include "TableMutator.h"
+#include "TableMutatorAsync.h"
+#include "TableMutatorShared.h"
 
 using namespace Hypertable;
 using namespace Hyperspace;
@@ -50,6 +52,8 @@ Table::Table(PropertiesPtr &props, ConnectionManagerPtr &conn_manager,
 
   m_range_locator = new RangeLocator(props, m_conn_manager, m_hyperspace,
                                      m_timeout_ms);
+
+  prefetch_locations();
 }
 
 
@@ -60,6 +64,15 @@ Table::Table(RangeLocatorPtr &range_locator, ConnectionManagerPtr &conn_manager,
     m_timeout_ms(timeout_ms), m_stale(true) {
 
   initialize(name.c_str());
+  prefetch_locations();
+}
+
+
+Table::Table(RangeLocatorPtr &range_locator, Comm *comm,
+             const TableIdentifier &table, SchemaPtr &schema,
+             uint32_t timeout_ms)
+  : m_comm(comm), m_schema(schema), m_range_locator(range_locator),
+    m_table(table), m_timeout_ms(timeout_ms), m_stale(false) {
 }
 
 
@@ -119,11 +132,36 @@ void Table::initialize(const char *name) {
 void Table::refresh() {
   ScopedLock lock(m_mutex);
   HT_ASSERT(m_table.name);
+  if (!m_hyperspace)
+    return;
   m_stale = true;
   initialize(m_table.name);
 }
 
 
+/**
+ * Warms the location cache with the first ranges of the table so that the
+ * first reads and writes don't each pay for a METADATA round trip.  This
+ * is skipped if the cache already knows where the table starts, e.g. when
+ * the table has been opened before, and is cut short after
+ * Hypertable.LocationCache.Prefetch.Timeout.  Failures are not fatal; the
+ * locations are then looked up on demand.
+ */
+void Table::prefetch_locations() {
+  uint32_t max_entries = m_range_locator->prefetch_max_entries();
+
+  if (max_entries == 0 || m_table.id == 0)
+    return;
+
+  Timer timer(m_timeout_ms, true);
+  int error = m_range_locator->prefetch(&m_table, "", "", max_entries, timer);
+
+  if (error != Error::OK)
+    HT_WARNF("Unable to prefetch range locations for table '%s' - %s",
+             m_table.name, Error::get_text(error));
+}
+
+
 void Table::get(TableIdentifierManaged &ident_copy, SchemaPtr &schema_copy) {
   ScopedLock lock(m_mutex);
   ident_copy = m_table;
@@ -135,8 +173,10 @@ void
 Table::refresh(TableIdentifierManaged &ident_copy, SchemaPtr &schema_copy) {
   ScopedLock lock(m_mutex);
   HT_ASSERT(m_table.name);
-  m_stale = true;
-  initialize(m_table.name);
+  if (m_hyperspace) {
+    m_stale = true;
+    initialize(m_table.name);
+  }
   ident_copy = m_table;
   schema_copy = m_schema;
 }
@@ -153,6 +193,24 @@ Table::create_mutator(uint32_t timeout_ms) {
 }
 
 
+TableMutatorAsync *
+Table::create_mutator_async(TableMutatorAsyncCallback *callback,
+                            uint32_t timeout_ms) {
+  return new TableMutatorAsync(m_comm, this, m_range_locator,
+                               timeout_ms ? timeout_ms : m_timeout_ms,
+                               callback);
+}
+
+
+TableMutatorShared *
+Table::create_mutator_shared(TableMutatorAsyncCallback *callback,
+                             uint32_t timeout_ms, uint32_t flush_interval_ms) {
+  return new TableMutatorShared(m_comm, this, m_range_locator,
+                                timeout_ms ? timeout_ms : m_timeout_ms,
+                                callback, flush_interval_ms);
+}
+
+
 TableScanner *
 Table::create_scanner(const ScanSpec &scan_spec, uint32_t timeout_ms,
                       bool retry_table_not_found) {
@@ -38,6 +38,9 @@ namespace Hypertable {
   class ConnectionManager;
   class TableScanner;
   class TableMutator;
+  class TableMutatorAsync;
+  class TableMutatorAsyncCallback;
+  class TableMutatorShared;
 
   /** Represents an open table.
    */
@@ -48,6 +51,21 @@ namespace Hypertable {
           const String &name);
     Table(RangeLocatorPtr &, ConnectionManagerPtr &, Hyperspace::SessionPtr &,
           const String &name, uint32_t default_timeout_ms);
+
+    /**
+     * Constructs a table with a known identifier and schema, without
+     * Hyperspace.  Refreshing keeps them as they are.  Used by tests,
+     * together with a cache-only RangeLocator.
+     *
+     * @param range_locator locator to find the ranges of the table with
+     * @param comm pointer to the Comm layer
+     * @param table identifier of the table
+     * @param schema schema of the table
+     * @param default_timeout_ms default timeout of mutators and scanners
+     */
+    Table(RangeLocatorPtr &range_locator, Comm *comm,
+          const TableIdentifier &table, SchemaPtr &schema,
+          uint32_t default_timeout_ms);
     virtual ~Table();
 
     /**
@@ -59,6 +77,33 @@ namespace Hypertable {
      */
     TableMutator *create_mutator(uint32_t timeout_ms = 0);
 
+    /**
+     * Creates an asynchronous mutator on this table
+     *
+     * @param callback receives the outcome of each batch of mutations
+     * @param timeout_ms maximum time in milliseconds to allow a batch
+     *        of mutations to complete
+     * @return newly constructed mutator object
+     */
+    TableMutatorAsync *
+    create_mutator_async(TableMutatorAsyncCallback *callback,
+                         uint32_t timeout_ms = 0);
+
+    /**
+     * Creates a mutator on this table that can be shared by many threads
+     *
+     * @param callback receives the outcome of each batch of mutations
+     * @param timeout_ms maximum time in milliseconds to allow a batch
+     *        of mutations to complete
+     * @param flush_interval_ms maximum time in milliseconds mutations are
+     *        held before being sent, 0 means use the configured default
+     * @return newly constructed mutator object
+     */
+    TableMutatorShared *
+    create_mutator_shared(TableMutatorAsyncCallback *callback,
+                          uint32_t timeout_ms = 0,
+                          uint32_t flush_interval_ms = 0);
+
     /**
      * Creates a scanner on this table
      *
@@ -107,6 +152,7 @@ namespace Hypertable {
 
   private:
     void initialize(const char *name);
+    void prefetch_locations();
 
     Mutex                  m_mutex;
     PropertiesPtr          m_props;
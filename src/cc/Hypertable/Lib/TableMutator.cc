@@ -117,6 +117,12 @@ TableMutator::set_cells(Cells::const_iterator it, Cells::const_iterator end) {
     m_last_op = SET_CELLS;
     auto_flush(timer);
 
+    std::vector<const char *> rows;
+    for (Cells::const_iterator cit = it; cit != end; ++cit)
+      if ((*cit).row_key)
+        rows.push_back((*cit).row_key);
+    m_buffer->locate(rows, timer);
+
     for (; it != end; ++it) {
       Key full_key;
       const Cell &cell = *it;
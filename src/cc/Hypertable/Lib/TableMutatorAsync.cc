@@ -0,0 +1,413 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <cstring>
+
+#include "AsyncComm/ApplicationHandler.h"
+#include "AsyncComm/DispatchHandler.h"
+
+#include "Common/Config.h"
+#include "Common/Time.h"
+#include "Common/Timer.h"
+
+#include "Key.h"
+#include "TableMutatorAsync.h"
+
+using namespace Hypertable;
+using namespace Hypertable::Config;
+
+Mutex TableMutatorAsync::ms_mutex;
+ApplicationQueuePtr TableMutatorAsync::ms_app_queue;
+
+/**
+ * A scatter buffer in flight, along with the time left to complete it,
+ * the back off before its next resend and the buffers whose mutations
+ * were rejected, which are reported when the batch finishes
+ */
+class TableMutatorAsync::Batch {
+public:
+  Batch(TableMutatorScatterBuffer *buf, uint64_t mem, uint32_t timeout_ms)
+    : buffer(buf), memory(mem), timer(timeout_ms, true), wait_time(1000),
+      error(Error::OK) { }
+
+  TableMutatorScatterBufferPtr buffer;
+  std::vector<TableMutatorScatterBufferPtr> failed_buffers;
+  DispatchHandlerPtr retry_timer;
+  uint64_t memory;
+  Timer    timer;
+  uint32_t wait_time;
+  int      error;
+};
+
+/**
+ * Queued by the completion counter of a batch's scatter buffer when its
+ * last update request completes
+ */
+class TableMutatorAsync::CompletionHandler : public ApplicationHandler {
+public:
+  CompletionHandler(TableMutatorAsync *mutator, Batch *batch)
+    : m_mutator(mutator), m_batch(batch) { }
+
+  virtual void run() { m_mutator->batch_completed(m_batch); }
+
+private:
+  TableMutatorAsync *m_mutator;
+  Batch *m_batch;
+};
+
+/**
+ * Resends the mutations of a batch that went to the wrong range server
+ */
+class TableMutatorAsync::RetryHandler : public ApplicationHandler {
+public:
+  RetryHandler(TableMutatorAsync *mutator, Batch *batch)
+    : m_mutator(mutator), m_batch(batch) { }
+
+  virtual void run() { m_mutator->retry_batch(m_batch); }
+
+private:
+  TableMutatorAsync *m_mutator;
+  Batch *m_batch;
+};
+
+/**
+ * Fires when the back off before a resend is over.  The resend itself
+ * may look up range locations, so it is moved off the reactor thread.
+ */
+class TableMutatorAsync::RetryTimerHandler : public DispatchHandler {
+public:
+  RetryTimerHandler(TableMutatorAsync *mutator, Batch *batch)
+    : m_mutator(mutator), m_batch(batch) { }
+
+  virtual void handle(EventPtr &event_ptr) {
+    app_queue()->add(new RetryHandler(m_mutator, m_batch));
+  }
+
+private:
+  TableMutatorAsync *m_mutator;
+  Batch *m_batch;
+};
+
+
+TableMutatorAsync::TableMutatorAsync(Comm *comm, Table *table,
+    RangeLocatorPtr &range_locator, uint32_t timeout_ms,
+    TableMutatorAsyncCallback *callback)
+  : m_comm(comm), m_table(table), m_range_locator(range_locator),
+    m_callback(callback), m_memory_used(0), m_max_memory(40*M),
+    m_outstanding_memory(0), m_outstanding(0), m_max_outstanding(4),
+    m_resends(0), m_timeout_ms(timeout_ms) {
+
+  HT_ASSERT(timeout_ms);
+  HT_ASSERT(callback);
+
+  table->refresh(m_table_identifier, m_schema);
+
+  if (properties) {
+    m_max_memory = get_i64(
+      "Hypertable.Lib.Mutator.ScatterBuffer.FlushLimit.Aggregate");
+    m_max_outstanding = get_i32("Hypertable.Lib.Mutator.Async.MaxOutstanding");
+  }
+  m_buffer = new TableMutatorScatterBuffer(m_comm, &m_table_identifier,
+      m_schema, m_range_locator, timeout_ms);
+}
+
+
+TableMutatorAsync::~TableMutatorAsync() {
+  wait_for_completion();
+}
+
+
+void
+TableMutatorAsync::set(const KeySpec &key, const void *value,
+                       uint32_t value_len) {
+  Timer timer(m_timeout_ms);
+  Key full_key;
+
+  auto_flush();
+  key.sanity_check();
+
+  to_full_key(key.row, key.column_family, key.column_qualifier,
+              key.timestamp, key.revision, FLAG_INSERT, full_key);
+  m_buffer->set(full_key, value, value_len, timer);
+  m_memory_used += 20 + key.row_len + key.column_qualifier_len + value_len;
+}
+
+
+void TableMutatorAsync::set_cells(const Cells &cells) {
+  Timer timer(m_timeout_ms);
+
+  auto_flush();
+
+  std::vector<const char *> rows;
+  rows.reserve(cells.size());
+  foreach(const Cell &cell, cells)
+    if (cell.row_key)
+      rows.push_back(cell.row_key);
+  m_buffer->locate(rows, timer);
+
+  foreach(const Cell &cell, cells) {
+    Key full_key;
+    cell.sanity_check();
+
+    if (!cell.column_family) {
+      full_key.row = cell.row_key;
+      full_key.timestamp = cell.timestamp;
+      full_key.revision = cell.revision;
+      full_key.flag = cell.flag;
+    }
+    else
+      to_full_key(cell.row_key, cell.column_family, cell.column_qualifier,
+                  cell.timestamp, cell.revision, cell.flag, full_key);
+
+    m_buffer->set(full_key, cell.value, cell.value_len, timer);
+    m_memory_used += 20 + strlen(cell.row_key) + cell.value_len
+        + (cell.column_qualifier ? strlen(cell.column_qualifier) : 0);
+  }
+}
+
+
+void TableMutatorAsync::set_delete(const KeySpec &key) {
+  Timer timer(m_timeout_ms);
+  Key full_key;
+
+  auto_flush();
+  key.sanity_check();
+
+  if (!key.column_family) {
+    full_key.row = (const char *)key.row;
+    full_key.timestamp = key.timestamp;
+    full_key.revision = key.revision;
+  }
+  else
+    to_full_key(key.row, key.column_family, key.column_qualifier,
+                key.timestamp, key.revision, FLAG_INSERT, full_key);
+
+  m_buffer->set_delete(full_key, timer);
+  m_memory_used += 20 + key.row_len + key.column_qualifier_len;
+}
+
+
+void TableMutatorAsync::flush() {
+  if (m_memory_used > 0) {
+    ScopedLock lock(m_mutex);
+    send(lock);
+  }
+}
+
+
+bool TableMutatorAsync::wait_for_completion(uint32_t timeout_ms) {
+  ScopedLock lock(m_mutex);
+  boost::xtime expire_time;
+
+  if (timeout_ms == 0) {
+    while (m_outstanding)
+      m_cond.wait(lock);
+    return true;
+  }
+
+  boost::xtime_get(&expire_time, boost::TIME_UTC);
+  xtime_add_millis(expire_time, timeout_ms);
+
+  while (m_outstanding) {
+    if (!m_cond.timed_wait(lock, expire_time))
+      return m_outstanding == 0;
+  }
+  return true;
+}
+
+
+size_t TableMutatorAsync::get_outstanding() {
+  ScopedLock lock(m_mutex);
+  return m_outstanding;
+}
+
+
+uint64_t TableMutatorAsync::memory_used() {
+  ScopedLock lock(m_mutex);
+  return m_memory_used + m_outstanding_memory;
+}
+
+
+uint64_t TableMutatorAsync::get_resend_count() {
+  ScopedLock lock(m_mutex);
+  return m_resends;
+}
+
+
+void
+TableMutatorAsync::to_full_key(const void *row, const char *column_family,
+    const void *column_qualifier, int64_t timestamp, int64_t revision,
+    uint8_t flag, Key &full_key) {
+  if (!column_family)
+    HT_THROW(Error::BAD_KEY, "Column family not specified");
+
+  Schema::ColumnFamily *cf = m_schema->get_column_family(column_family);
+
+  if (!cf)
+    HT_THROWF(Error::BAD_KEY, "Bad column family '%s'", column_family);
+
+  full_key.row = (const char *)row;
+  full_key.column_qualifier = (const char *)column_qualifier;
+  full_key.column_family_code = (uint8_t)cf->id;
+  full_key.timestamp = timestamp;
+  full_key.revision = revision;
+  full_key.flag = flag;
+}
+
+
+void TableMutatorAsync::auto_flush() {
+  if (m_buffer->full() || m_memory_used > m_max_memory) {
+    ScopedLock lock(m_mutex);
+    send(lock);
+  }
+}
+
+
+/**
+ * Hands the current scatter buffer off as a new batch, waiting first if
+ * the maximum number of batches is already outstanding.
+ */
+void TableMutatorAsync::send(ScopedLock &lock) {
+  while (m_outstanding >= m_max_outstanding)
+    m_cond.wait(lock);
+
+  Batch *batch = new Batch(m_buffer.get(), m_memory_used, m_timeout_ms);
+  m_outstanding++;
+  m_outstanding_memory += m_memory_used;
+  m_memory_used = 0;
+  lock.unlock();
+
+  m_buffer = new TableMutatorScatterBuffer(m_comm, &m_table_identifier,
+      m_schema, m_range_locator, m_timeout_ms);
+
+  batch->buffer->set_completion_handler(app_queue(),
+                                        new CompletionHandler(this, batch));
+  batch->buffer->send();
+}
+
+
+void TableMutatorAsync::batch_completed(Batch *batch) {
+  bool retry;
+
+  try {
+    if (batch->buffer->wait_for_completion(batch->timer)) {
+      finish_batch(batch, Error::OK);
+      return;
+    }
+    retry = batch->buffer->has_retries();
+  }
+  catch (Exception &e) {
+    if (batch->error == Error::OK)
+      batch->error = e.code();
+    batch->failed_buffers.push_back(batch->buffer);
+    retry = batch->buffer->has_retries();
+  }
+
+  if (!retry) {
+    finish_batch(batch, Error::OK);
+    return;
+  }
+
+  if (batch->timer.remaining() < batch->wait_time) {
+    finish_batch(batch, Error::REQUEST_TIMEOUT);
+    return;
+  }
+
+  // ranges have probably split or moved, give the new locations a moment
+  // to settle before resending
+  batch->retry_timer = new RetryTimerHandler(this, batch);
+  if (m_comm->set_timer(batch->wait_time, batch->retry_timer.get())
+      != Error::OK) {
+    retry_batch(batch);
+    return;
+  }
+  batch->wait_time += 2000;
+}
+
+
+void TableMutatorAsync::retry_batch(Batch *batch) {
+  TableMutatorScatterBuffer *redo_buffer;
+
+  try {
+    redo_buffer = batch->buffer->create_redo_buffer(batch->timer);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    finish_batch(batch, e.code());
+    return;
+  }
+
+  {
+    ScopedLock lock(m_mutex);
+    m_resends += batch->buffer->get_resend_count();
+  }
+
+  batch->buffer = redo_buffer;
+  batch->buffer->set_completion_handler(app_queue(),
+                                        new CompletionHandler(this, batch));
+  batch->buffer->send();
+}
+
+
+/**
+ * Reports the outcome of a batch.  If error is set, the mutations still
+ * waiting to be resent are reported as failed along with the rejected
+ * ones.
+ */
+void TableMutatorAsync::finish_batch(Batch *batch, int error) {
+  if (batch->error == Error::OK)
+    batch->error = error;
+
+  if (batch->error != Error::OK) {
+    FailedMutations failed_mutations, rejected;
+    foreach(TableMutatorScatterBufferPtr &buffer, batch->failed_buffers) {
+      buffer->get_failed_mutations(rejected);
+      failed_mutations.insert(failed_mutations.end(), rejected.begin(),
+                              rejected.end());
+    }
+    if (error != Error::OK)
+      batch->buffer->get_unsent_mutations(error, failed_mutations);
+    m_callback->update_error(this, batch->error, failed_mutations);
+  }
+  else
+    m_callback->update_ok(this);
+
+  {
+    ScopedLock lock(m_mutex);
+    m_outstanding--;
+    m_outstanding_memory -= batch->memory;
+    m_cond.notify_all();
+  }
+
+  delete batch;
+}
+
+
+ApplicationQueue *TableMutatorAsync::app_queue() {
+  ScopedLock lock(ms_mutex);
+
+  if (!ms_app_queue)
+    ms_app_queue = new ApplicationQueue(properties ?
+        get_i32("Hypertable.Lib.Mutator.Async.Workers") : 2);
+
+  return ms_app_queue.get();
+}
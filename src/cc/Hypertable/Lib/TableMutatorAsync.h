@@ -0,0 +1,235 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_TABLEMUTATORASYNC_H
+#define HYPERTABLE_TABLEMUTATORASYNC_H
+
+#include <boost/thread/condition.hpp>
+
+#include "AsyncComm/ApplicationQueue.h"
+#include "AsyncComm/Comm.h"
+
+#include "Common/Mutex.h"
+#include "Common/ReferenceCount.h"
+
+#include "Cells.h"
+#include "KeySpec.h"
+#include "RangeLocator.h"
+#include "Schema.h"
+#include "Table.h"
+#include "TableMutatorScatterBuffer.h"
+
+namespace Hypertable {
+
+  class TableMutatorAsync;
+
+  /**
+   * Receives the outcome of each batch of mutations sent by a
+   * TableMutatorAsync.  The methods are called from a shared pool of worker
+   * threads, so they must not block for long and must not wait on the
+   * mutator that calls them.
+   */
+  class TableMutatorAsyncCallback {
+  public:
+    virtual ~TableMutatorAsyncCallback() { }
+
+    /**
+     * Called when every mutation of a batch has been applied
+     *
+     * @param mutator mutator that sent the batch
+     */
+    virtual void update_ok(TableMutatorAsync *mutator) = 0;
+
+    /**
+     * Called instead of update_ok, once all retries of a batch are over,
+     * with the mutations of the batch that could not be applied.  These
+     * are the ones rejected by a range server plus, if the batch timed out
+     * or its ranges could not be located, the ones still waiting to be
+     * resent.  The cells are only valid for the duration of the call.
+     * Mutations of the batch not listed in failed_mutations have been
+     * applied.
+     *
+     * @param mutator mutator that sent the batch
+     * @param error error code of the first failure
+     * @param failed_mutations failed cells and their error codes
+     */
+    virtual void update_error(TableMutatorAsync *mutator, int error,
+                              FailedMutations &failed_mutations) = 0;
+  };
+
+  /**
+   * Mutates a table without tying up the calling thread until the
+   * mutations reach the range servers.  Like TableMutator, cells are
+   * collected in a scatter buffer, but when it fills up, or on #flush, the
+   * buffer is sent and a new one is started straight away.  Up to
+   * Hypertable.Lib.Mutator.Async.MaxOutstanding buffers can be in flight.
+   * The calling thread is still blocked in two cases: when that many
+   * buffers are outstanding, set() and flush() wait for one to complete,
+   * which is what bounds the memory held by pending mutations; and the
+   * set methods look up the locations of rows missing from the location
+   * cache, which may wait for METADATA scans.  Completion, retries of
+   * mutations that went to the wrong server and failures are handled on a
+   * worker pool shared by all asynchronous mutators, and reported through
+   * the callback.  Batches may complete out of order, so mutations of the
+   * same cell that must be applied in order need explicit revisions.
+   */
+  class TableMutatorAsync : public ReferenceCount {
+
+  public:
+
+    /**
+     * Constructs the TableMutatorAsync object
+     *
+     * @param comm pointer to the Comm layer
+     * @param table pointer to the table object
+     * @param range_locator smart pointer to range locator
+     * @param timeout_ms maximum time in milliseconds to allow a batch of
+     *        mutations, including retries, to complete
+     * @param callback receives the outcome of each batch
+     */
+    TableMutatorAsync(Comm *comm, Table *table, RangeLocatorPtr &range_locator,
+                      uint32_t timeout_ms, TableMutatorAsyncCallback *callback);
+
+    /**
+     * Waits for the outstanding batches.  Mutations that have not been
+     * flushed are discarded.
+     */
+    virtual ~TableMutatorAsync();
+
+    /**
+     * Inserts a cell into the table.  Blocks while the row is located and,
+     * if the collected mutations fill the buffer while the maximum number
+     * of buffers is outstanding, until one of them completes.
+     *
+     * @param key key of the cell being inserted
+     * @param value pointer to the value to store in the cell
+     * @param value_len length of data pointed to by value
+     */
+    virtual void set(const KeySpec &key, const void *value,
+                     uint32_t value_len);
+
+    /**
+     * Inserts a cell into the table.
+     *
+     * @param key key of the cell being inserted
+     * @param value null-terminated c-string value
+     */
+    void set(const KeySpec &key, const char *value) {
+      if (value)
+        set(key, value, strlen(value));
+      else
+        set(key, 0, 0);
+    }
+
+    /**
+     * Deletes an entire row, a column family in a particular row, or a specific
+     * cell within a row.
+     *
+     * @param key key of the row or cell(s) being deleted
+     */
+    virtual void set_delete(const KeySpec &key);
+
+    /**
+     * Inserts a bunch of cells into the table
+     *
+     * @param cells a list of cells
+     */
+    virtual void set_cells(const Cells &cells);
+
+    /**
+     * Sends the collected mutations without waiting for them to complete,
+     * unless the maximum number of buffers is outstanding, in which case
+     * it first waits for one of them.
+     */
+    virtual void flush();
+
+    /**
+     * Waits until every batch sent so far has completed and its callback
+     * has returned.
+     *
+     * @param timeout_ms maximum time to wait, 0 means wait indefinitely
+     * @return true if there are no outstanding batches, false on timeout
+     */
+    bool wait_for_completion(uint32_t timeout_ms = 0);
+
+    /**
+     * Returns the number of batches that have been sent but not completed.
+     */
+    size_t get_outstanding();
+
+    /**
+     * Returns the amount of memory used by the collected and outstanding
+     * mutations.
+     */
+    uint64_t memory_used();
+
+    /**
+     * Returns the number of mutations that were resent to another range
+     * server because of stale range location information.
+     */
+    uint64_t get_resend_count();
+
+  protected:
+    void to_full_key(const void *row, const char *cf, const void *cq,
+                     int64_t ts, int64_t rev, uint8_t flag, Key &full_key);
+    void auto_flush();
+    void send(ScopedLock &lock);
+    static ApplicationQueue *app_queue();
+
+    Mutex                m_mutex;
+    boost::condition     m_cond;
+    Comm                *m_comm;
+    TablePtr             m_table;
+    SchemaPtr            m_schema;
+    RangeLocatorPtr      m_range_locator;
+    TableIdentifierManaged m_table_identifier;
+    TableMutatorAsyncCallback *m_callback;
+    TableMutatorScatterBufferPtr m_buffer;
+    uint64_t             m_memory_used;
+    uint64_t             m_max_memory;
+    uint64_t             m_outstanding_memory;
+    size_t               m_outstanding;
+    size_t               m_max_outstanding;
+    uint64_t             m_resends;
+    uint32_t             m_timeout_ms;
+
+  private:
+    class Batch;
+    class CompletionHandler;
+    class RetryHandler;
+    class RetryTimerHandler;
+
+    friend class CompletionHandler;
+    friend class RetryHandler;
+
+    void batch_completed(Batch *batch);
+    void retry_batch(Batch *batch);
+    void finish_batch(Batch *batch, int error);
+
+    static Mutex ms_mutex;
+    static ApplicationQueuePtr ms_app_queue;
+  };
+
+  typedef intrusive_ptr<TableMutatorAsync> TableMutatorAsyncPtr;
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_TABLEMUTATORASYNC_H
@@ -22,6 +22,8 @@
 #ifndef HYPERTABLE_TABLEMUTATORCOMPLETIONCOUNTER_H
 #define HYPERTABLE_TABLEMUTATORCOMPLETIONCOUNTER_H
 
+#include "AsyncComm/ApplicationQueue.h"
+
 #include "Common/ReferenceCount.h"
 #include "Common/Time.h"
 
@@ -38,7 +40,10 @@ namespace Hypertable {
   class TableMutatorCompletionCounter {
   public:
     TableMutatorCompletionCounter()
-      : m_outstanding(0), m_retries(false), m_errors(false), m_done(false) { }
+      : m_outstanding(0), m_retries(false), m_errors(false), m_done(false),
+        m_app_queue(0), m_handler(0) { }
+
+    ~TableMutatorCompletionCounter() { delete m_handler; }
 
     void set(size_t count) {
       ScopedLock lock(m_mutex);
@@ -55,9 +60,26 @@ namespace Hypertable {
       if (m_outstanding == 0) {
         m_done = true;
         m_cond.notify_all();
+        if (m_handler) {
+          m_app_queue->add(m_handler);
+          m_handler = 0;
+        }
       }
     }
 
+    /**
+     * Adds handler to app_queue when the outstanding count next drops to
+     * zero, instead of (or as well as) having a thread wait for it.  The
+     * queue takes ownership of the handler.
+     */
+    void set_completion_handler(ApplicationQueue *app_queue,
+                                ApplicationHandler *handler) {
+      ScopedLock lock(m_mutex);
+      delete m_handler;
+      m_app_queue = app_queue;
+      m_handler = handler;
+    }
+
     bool wait_for_completion(Timer &timer) {
       ScopedLock lock(m_mutex);
       boost::xtime expire_time;
@@ -93,6 +115,8 @@ namespace Hypertable {
     bool m_retries;
     bool m_errors;
     bool m_done;
+    ApplicationQueue *m_app_queue;
+    ApplicationHandler *m_handler;
   };
 
 }
@@ -122,6 +122,23 @@ void TableMutatorScatterBuffer::set_delete(const Key &key, Timer &timer) {
 }
 
 
+/**
+ * Resolves the locations of a batch of rows with as few METADATA scans as
+ * possible, so that the subsequent calls to set() hit the location cache.
+ */
+void
+TableMutatorScatterBuffer::locate(const std::vector<const char *> &rows,
+                                  Timer &timer) {
+  std::vector<RangeLocationInfo> range_infos;
+
+  if (rows.size() < 2)
+    return;
+
+  timer.start();
+  m_range_locator->find_batch(&m_table_identifier, rows, range_infos, timer);
+}
+
+
 void
 TableMutatorScatterBuffer::set(SerializedKey key, ByteString value,
                                Timer &timer) {
@@ -184,7 +201,9 @@ void TableMutatorScatterBuffer::send() {
   SendRec send_rec;
   size_t len;
 
-  m_completion_counter.set(m_buffer_map.size());
+  // one extra count for this method itself, so that completion can't be
+  // signalled (and the buffer picked up elsewhere) before it returns
+  m_completion_counter.set(m_buffer_map.size() + 1);
 
   for (TableMutatorSendBufferMap::const_iterator iter = m_buffer_map.begin();
        iter != m_buffer_map.end(); ++iter) {
@@ -242,14 +261,17 @@ void TableMutatorScatterBuffer::send() {
           send_buffer->dispatch_handler.get());
     }
     catch (Exception &e) {
-      if (e.code() == Error::COMM_NOT_CONNECTED) {
+      if (e.code() == Error::COMM_NOT_CONNECTED)
         send_buffer->add_retries(send_buffer->send_count, 0,
                                  send_buffer->pending_updates.size);
-        m_completion_counter.decrement();
-      }
+      else
+        send_buffer->add_errors_all(e.code());
+      m_completion_counter.decrement();
     }
     send_buffer->pending_updates.own = true;
   }
+
+  m_completion_counter.decrement();
 }
 
 
@@ -268,31 +290,9 @@ bool TableMutatorScatterBuffer::wait_for_completion(Timer &timer) {
            it != m_buffer_map.end(); ++it)
         (*it).second->get_failed_regions(failed_regions);
 
-      if (!failed_regions.empty()) {
-        Cell cell;
-        Key key;
-        ByteString bs;
-        const uint8_t *endptr;
-        Schema::ColumnFamily *cf;
-        for (size_t i=0; i<failed_regions.size(); i++) {
-          bs.ptr = failed_regions[i].base;
-          endptr = bs.ptr + failed_regions[i].len;
-          while (bs.ptr < endptr) {
-            key.load((SerializedKey)bs);
-            cell.row_key = key.row;
-            cf = m_schema->get_column_family(key.column_family_code);
-            HT_ASSERT(cf);
-            cell.column_family = m_constant_strings.get(cf->name.c_str());
-            cell.column_qualifier = key.column_qualifier;
-            cell.timestamp = key.timestamp;
-            bs.next();
-            cell.value_len = bs.decode_length(&cell.value);
-            bs.next();
-            m_failed_mutations.push_back(std::make_pair(cell,
-                                         failed_regions[i].error));
-          }
-        }
-      }
+      for (size_t i=0; i<failed_regions.size(); i++)
+        decode_mutations(failed_regions[i].base, failed_regions[i].len,
+                         failed_regions[i].error, m_failed_mutations);
 
       // this prevents this mutation failure logic from being executed twice
       // if this method gets called again
@@ -319,6 +319,24 @@ TableMutatorScatterBuffer::create_redo_buffer(Timer &timer) {
     redo_buffer = new TableMutatorScatterBuffer(m_comm, &m_table_identifier,
         m_schema, m_range_locator, m_timeout_ms);
 
+    // the failed ranges have moved, so look up their new homes together
+    std::vector<const char *> rows;
+    for (TableMutatorSendBufferMap::const_iterator iter = m_buffer_map.begin();
+         iter != m_buffer_map.end(); ++iter) {
+      send_buffer = (*iter).second;
+      const uint8_t *endptr;
+
+      bs.ptr = send_buffer->accum.base;
+      endptr = bs.ptr + send_buffer->accum.fill();
+
+      while (bs.ptr < endptr) {
+        key.ptr = bs.next();
+        bs.next();
+        rows.push_back(key.row());
+      }
+    }
+    redo_buffer->locate(rows, timer);
+
     for (TableMutatorSendBufferMap::const_iterator iter = m_buffer_map.begin();
          iter != m_buffer_map.end(); ++iter) {
       send_buffer = (*iter).second;
@@ -349,6 +367,43 @@ TableMutatorScatterBuffer::create_redo_buffer(Timer &timer) {
 }
 
 
+void
+TableMutatorScatterBuffer::get_unsent_mutations(int error,
+    FailedMutations &failed_mutations) {
+  for (TableMutatorSendBufferMap::const_iterator iter = m_buffer_map.begin();
+       iter != m_buffer_map.end(); ++iter)
+    decode_mutations((*iter).second->accum.base, (*iter).second->accum.fill(),
+                     error, failed_mutations);
+}
+
+
+void
+TableMutatorScatterBuffer::decode_mutations(const uint8_t *base, uint32_t len,
+    int error, FailedMutations &failed_mutations) {
+  Cell cell;
+  Key key;
+  ByteString bs;
+  const uint8_t *endptr;
+  Schema::ColumnFamily *cf;
+
+  bs.ptr = base;
+  endptr = bs.ptr + len;
+  while (bs.ptr < endptr) {
+    key.load((SerializedKey)bs);
+    cell.row_key = key.row;
+    cf = m_schema->get_column_family(key.column_family_code);
+    HT_ASSERT(cf);
+    cell.column_family = m_constant_strings.get(cf->name.c_str());
+    cell.column_qualifier = key.column_qualifier;
+    cell.timestamp = key.timestamp;
+    bs.next();
+    cell.value_len = bs.decode_length(&cell.value);
+    bs.next();
+    failed_mutations.push_back(std::make_pair(cell, error));
+  }
+}
+
+
 void TableMutatorScatterBuffer::reset() {
   for (TableMutatorSendBufferMap::const_iterator iter = m_buffer_map.begin();
        iter != m_buffer_map.end(); ++iter)
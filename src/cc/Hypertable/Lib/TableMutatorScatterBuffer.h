@@ -57,6 +57,7 @@ namespace Hypertable {
     void set(const Key &, const void *value, uint32_t value_len, Timer &timer);
     void set_delete(const Key &key, Timer &timer);
     void set(SerializedKey key, ByteString value, Timer &timer);
+    void locate(const std::vector<const char *> &rows, Timer &timer);
     bool full() { return m_full; }
     void send();
     bool completed();
@@ -64,14 +65,29 @@ namespace Hypertable {
     void reset();
     TableMutatorScatterBuffer *create_redo_buffer(Timer &timer);
     uint64_t get_resend_count() { return m_resends; }
+    bool has_retries() { return m_completion_counter.has_retries(); }
+    void set_completion_handler(ApplicationQueue *app_queue,
+                                ApplicationHandler *handler) {
+      m_completion_counter.set_completion_handler(app_queue, handler);
+    }
     void
     get_failed_mutations(FailedMutations &failed_mutations) {
       failed_mutations = m_failed_mutations;
     }
     size_t get_failure_count() { return m_failed_mutations.size(); }
 
+    /**
+     * Appends the mutations that are waiting to be resent, i.e. the ones
+     * that went to the wrong range server, to failed_mutations with the
+     * given error code.  The cells point into this buffer.
+     */
+    void get_unsent_mutations(int error, FailedMutations &failed_mutations);
+
   private:
 
+    void decode_mutations(const uint8_t *base, uint32_t len, int error,
+                          FailedMutations &failed_mutations);
+
     friend class TableMutatorDispatchHandler;
 
     typedef hash_map<String, TableMutatorSendBufferPtr>
@@ -0,0 +1,448 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <cstring>
+
+#include "AsyncComm/ApplicationHandler.h"
+#include "AsyncComm/DispatchHandler.h"
+
+#include "Common/Config.h"
+#include "Common/Timer.h"
+
+#include "Key.h"
+#include "TableMutatorShared.h"
+
+using namespace Hypertable;
+using namespace Hypertable::Config;
+
+atomic_t TableMutatorShared::ms_next_id = ATOMIC_INIT(0);
+boost::thread_specific_ptr<TableMutatorShared::StagingMapPtr>
+    TableMutatorShared::ms_staging_map;
+
+/**
+ * Periodic flush timer.  A pending timer holds a reference to the handler,
+ * so it stays valid after the mutator is gone; #detach stops it from
+ * touching the mutator.
+ */
+class TableMutatorShared::FlushTimerHandler : public DispatchHandler {
+public:
+  FlushTimerHandler(TableMutatorShared *mutator, Comm *comm,
+                    uint32_t interval_ms)
+    : m_mutator(mutator), m_comm(comm), m_interval(interval_ms) { }
+
+  void start() {
+    intrusive_ptr_add_ref(this);
+    if (m_comm->set_timer(m_interval, this) != Error::OK) {
+      HT_ERROR("Unable to set shared mutator flush timer");
+      intrusive_ptr_release(this);
+    }
+  }
+
+  /**
+   * Queues the flush, which may look up range locations, rather than
+   * running it on the timer reactor
+   */
+  virtual void handle(EventPtr &event_ptr);
+
+  void run_flush() {
+    ScopedLock lock(m_mutex);
+    if (m_mutator == 0)
+      return;
+    try {
+      m_mutator->timed_flush();
+    }
+    catch (Exception &e) {
+      HT_ERROR_OUT << e << HT_END;
+    }
+    start();
+  }
+
+  void detach() {
+    ScopedLock lock(m_mutex);
+    m_mutator = 0;
+  }
+
+private:
+  Mutex m_mutex;
+  TableMutatorShared *m_mutator;
+  Comm *m_comm;
+  uint32_t m_interval;
+};
+
+class TableMutatorShared::FlushHandler : public ApplicationHandler {
+public:
+  FlushHandler(FlushTimerHandler *timer_handler)
+    : m_timer_handler(timer_handler) { }
+
+  virtual void run() { m_timer_handler->run_flush(); }
+
+private:
+  intrusive_ptr<FlushTimerHandler> m_timer_handler;
+};
+
+
+void TableMutatorShared::FlushTimerHandler::handle(EventPtr &event_ptr) {
+  app_queue()->add(new FlushHandler(this));
+  intrusive_ptr_release(this);
+}
+
+
+TableMutatorShared::TableMutatorShared(Comm *comm, Table *table,
+    RangeLocatorPtr &range_locator, uint32_t timeout_ms,
+    TableMutatorAsyncCallback *callback, uint32_t flush_interval_ms)
+  : TableMutatorAsync(comm, table, range_locator, timeout_ms, callback),
+    m_staging_limit(64*K), m_flush_interval(flush_interval_ms) {
+
+  m_id = atomic_inc_return(&ms_next_id);
+
+  if (properties) {
+    m_staging_limit = get_i32("Hypertable.Lib.Mutator.Shared.StagingBuffer.Size");
+    if (m_flush_interval == 0)
+      m_flush_interval = get_i32("Hypertable.Lib.Mutator.Shared.FlushInterval");
+  }
+  if (m_flush_interval == 0)
+    m_flush_interval = 1000;
+
+  FlushTimerHandler *flush_timer =
+      new FlushTimerHandler(this, m_comm, m_flush_interval);
+  m_flush_timer = flush_timer;
+  flush_timer->start();
+}
+
+
+TableMutatorShared::~TableMutatorShared() {
+  static_cast<FlushTimerHandler *>(m_flush_timer.get())->detach();
+  foreach(Staging *staging, m_stagings) {
+    {
+      ScopedLock lock(staging->owner->mutex);
+      staging->owner->stagings.erase(m_id);
+    }
+    delete staging;
+  }
+}
+
+
+void
+TableMutatorShared::set(const KeySpec &key, const void *value,
+                        uint32_t value_len) {
+  Staging *staging = get_staging();
+  Key full_key;
+  bool sent = true;
+
+  key.sanity_check();
+  to_full_key(key.row, key.column_family, key.column_qualifier,
+              key.timestamp, key.revision, FLAG_INSERT, full_key);
+
+  {
+    ScopedLock lock(staging->mutex);
+    append(staging, full_key, value, value_len,
+           20 + key.row_len + key.column_qualifier_len + value_len);
+    if (staging->accum.fill() >= m_staging_limit)
+      sent = merge(staging);
+  }
+
+  if (!sent)
+    send_when_room(false);
+}
+
+
+void TableMutatorShared::set_cells(const Cells &cells) {
+  Staging *staging = get_staging();
+  bool sent = true;
+
+  {
+    ScopedLock lock(staging->mutex);
+
+    foreach(const Cell &cell, cells) {
+      Key full_key;
+      cell.sanity_check();
+
+      if (!cell.column_family) {
+        full_key.row = cell.row_key;
+        full_key.timestamp = cell.timestamp;
+        full_key.revision = cell.revision;
+        full_key.flag = cell.flag;
+      }
+      else
+        to_full_key(cell.row_key, cell.column_family, cell.column_qualifier,
+                    cell.timestamp, cell.revision, cell.flag, full_key);
+
+      append(staging, full_key, cell.value, cell.value_len,
+             20 + strlen(cell.row_key) + cell.value_len
+             + (cell.column_qualifier ? strlen(cell.column_qualifier) : 0));
+    }
+
+    if (staging->accum.fill() >= m_staging_limit)
+      sent = merge(staging);
+  }
+
+  if (!sent)
+    send_when_room(false);
+}
+
+
+void TableMutatorShared::set_delete(const KeySpec &key) {
+  Staging *staging = get_staging();
+  Key full_key;
+  bool sent = true;
+
+  key.sanity_check();
+
+  if (!key.column_family) {
+    full_key.row = (const char *)key.row;
+    full_key.timestamp = key.timestamp;
+    full_key.revision = key.revision;
+  }
+  else
+    to_full_key(key.row, key.column_family, key.column_qualifier,
+                key.timestamp, key.revision, FLAG_INSERT, full_key);
+
+  if (full_key.column_family_code == 0)
+    full_key.flag = FLAG_DELETE_ROW;
+  else if (full_key.column_qualifier)
+    full_key.flag = FLAG_DELETE_CELL;
+  else
+    full_key.flag = FLAG_DELETE_COLUMN_FAMILY;
+
+  {
+    ScopedLock lock(staging->mutex);
+    append(staging, full_key, 0, 0,
+           20 + key.row_len + key.column_qualifier_len);
+    if (staging->accum.fill() >= m_staging_limit)
+      sent = merge(staging);
+  }
+
+  if (!sent)
+    send_when_room(false);
+}
+
+
+void TableMutatorShared::flush() {
+  merge_all();
+  send_when_room(true);
+}
+
+
+/**
+ * Returns the calling thread's staging buffer, creating it on first use.
+ * The map belongs to the thread; its mutex is only contended when a
+ * mutator is destroyed and removes its entry.
+ */
+TableMutatorShared::Staging *TableMutatorShared::get_staging() {
+  StagingMapPtr *staging_mapp = ms_staging_map.get();
+
+  if (staging_mapp == 0) {
+    staging_mapp = new StagingMapPtr(new StagingMap());
+    ms_staging_map.reset(staging_mapp);
+  }
+
+  StagingMap *staging_map = staging_mapp->get();
+  ScopedLock map_lock(staging_map->mutex);
+
+  hash_map<uint64_t, Staging *>::iterator iter =
+      staging_map->stagings.find(m_id);
+  if (iter != staging_map->stagings.end())
+    return (*iter).second;
+
+  Staging *staging = new Staging(staging_map);
+  {
+    ScopedLock lock(m_staging_mutex);
+    m_stagings.push_back(staging);
+  }
+  staging_map->stagings[m_id] = staging;
+  return staging;
+}
+
+
+void
+TableMutatorShared::append(Staging *staging, const Key &key,
+    const void *value, uint32_t value_len, uint64_t memory) {
+  create_key_and_append(staging->accum, key.flag, key.row,
+      key.column_family_code, key.column_qualifier, key.timestamp);
+  append_as_byte_string(staging->accum, value, value_len);
+  staging->memory += memory;
+}
+
+
+/**
+ * Moves the cells of a staging buffer into the scatter buffer.  Called
+ * with the staging buffer and the merge mutex locked.  If a cell can't be
+ * added, e.g. because its range can't be located in time, the exception is
+ * passed on and that cell and the ones after it stay in the staging
+ * buffer, to be moved by the next merge.
+ */
+void TableMutatorShared::move_cells(Staging *staging) {
+  if (staging->accum.fill() == 0)
+    return;
+
+  Timer timer(m_timeout_ms);
+  SerializedKey key;
+  ByteString value, bs;
+  const uint8_t *endptr = staging->accum.ptr;
+  const uint8_t *cellptr = staging->accum.base;
+
+  try {
+    bs.ptr = cellptr;
+
+    while (bs.ptr < endptr) {
+      cellptr = bs.ptr;
+      key.ptr = bs.next();
+      value.ptr = bs.next();
+      m_buffer->set(key, value, timer);
+    }
+    cellptr = endptr;
+  }
+  catch (...) {
+    remove_moved(staging, cellptr);
+    throw;
+  }
+
+  remove_moved(staging, cellptr);
+}
+
+
+/**
+ * Drops the cells before endptr, which have been moved into the scatter
+ * buffer, from a staging buffer and accounts for their memory.  The
+ * memory estimate of the staging buffer isn't kept per cell, so a partial
+ * move charges its share by size.
+ */
+void
+TableMutatorShared::remove_moved(Staging *staging, const uint8_t *endptr) {
+  size_t moved = endptr - staging->accum.base;
+  size_t remaining = staging->accum.fill() - moved;
+  uint64_t memory = staging->memory;
+
+  if (remaining) {
+    memory = (uint64_t)((double)staging->memory * moved
+                        / staging->accum.fill());
+    memmove(staging->accum.base, endptr, remaining);
+  }
+
+  {
+    ScopedLock lock(m_mutex);
+    m_memory_used += memory;
+  }
+  staging->accum.ptr = staging->accum.base + remaining;
+  staging->memory -= memory;
+}
+
+
+/**
+ * Merges a staging buffer, which the caller has locked, into the scatter
+ * buffer and sends it if it is full.  Returns false if it is full but
+ * the maximum number of batches is outstanding; the caller then has to
+ * #send_when_room once it has released the staging buffer.
+ */
+bool TableMutatorShared::merge(Staging *staging) {
+  ScopedLock merge_lock(m_merge_mutex);
+  move_cells(staging);
+  return send_if_room(false);
+}
+
+
+void TableMutatorShared::merge_all() {
+  std::vector<Staging *> stagings;
+  bool sent;
+
+  {
+    ScopedLock lock(m_staging_mutex);
+    stagings = m_stagings;
+  }
+
+  foreach(Staging *staging, stagings) {
+    {
+      ScopedLock lock(staging->mutex);
+      sent = merge(staging);
+    }
+    if (!sent)
+      send_when_room(false);
+  }
+}
+
+
+/**
+ * Sends the scatter buffer if it is full, or if force is true and it
+ * holds anything, as long as there is room for another batch.  Called
+ * with the merge mutex locked; never waits.  Returns false if the buffer
+ * needs sending but there is no room.
+ */
+bool TableMutatorShared::send_if_room(bool force) {
+  if (force ? m_memory_used == 0
+      : !m_buffer->full() && m_memory_used <= m_max_memory)
+    return true;
+
+  ScopedLock lock(m_mutex);
+  if (m_outstanding >= m_max_outstanding)
+    return false;
+  send(lock);
+  return true;
+}
+
+
+/**
+ * Waits, without holding the staging or merge locks, until the scatter
+ * buffer has been sent as by #send_if_room
+ */
+void TableMutatorShared::send_when_room(bool force) {
+  while (true) {
+    {
+      ScopedLock merge_lock(m_merge_mutex);
+      if (send_if_room(force))
+        return;
+    }
+    ScopedLock lock(m_mutex);
+    while (m_outstanding >= m_max_outstanding)
+      m_cond.wait(lock);
+  }
+}
+
+
+/**
+ * Merges the staging buffers and sends whatever has accumulated, unless
+ * the maximum number of batches is already outstanding, in which case it
+ * is left for the next interval.  Runs on the shared worker pool, so it
+ * must not wait: buffers that are locked by their threads, or a merge in
+ * progress, are left for the next interval as well.  Holding the merge
+ * mutex while trying the staging locks reverses the usual lock order,
+ * which is safe because try_lock never blocks.
+ */
+void TableMutatorShared::timed_flush() {
+  std::vector<Staging *> stagings;
+
+  {
+    ScopedLock lock(m_staging_mutex);
+    stagings = m_stagings;
+  }
+
+  boost::mutex::scoped_try_lock merge_lock(m_merge_mutex);
+  if (!merge_lock)
+    return;
+
+  foreach(Staging *staging, stagings) {
+    boost::mutex::scoped_try_lock lock(staging->mutex);
+    if (lock)
+      move_cells(staging);
+  }
+
+  send_if_room(true);
+}
@@ -0,0 +1,153 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_TABLEMUTATORSHARED_H
+#define HYPERTABLE_TABLEMUTATORSHARED_H
+
+#include <vector>
+
+#include <boost/thread/tss.hpp>
+
+#include "Common/DynamicBuffer.h"
+#include "Common/HashMap.h"
+
+#include "TableMutatorAsync.h"
+
+namespace Hypertable {
+
+  /**
+   * An asynchronous mutator that any number of threads can set() into
+   * concurrently, so that the updates of all of them reach each range
+   * server in a few large requests rather than many small ones.  Each
+   * thread serializes its cells into a staging buffer of its own, which
+   * only it and the periodic flush ever lock.  When a staging buffer
+   * reaches Hypertable.Lib.Mutator.Shared.StagingBuffer.Size it is merged
+   * into the shared scatter buffer, which is sent, as in TableMutatorAsync,
+   * once it is full.  Every flush interval the staging buffers of all
+   * threads are merged and whatever has accumulated is sent, so that a
+   * slow trickle of updates is not held back indefinitely.  Mutations of
+   * one thread are merged in order; mutations of different threads are
+   * not ordered with respect to each other.  A thread that has to wait for
+   * an outstanding batch to complete before it can send does so without
+   * holding any of the mutator's locks, and the periodic flush, which runs
+   * on the shared worker pool, skips buffers that are busy rather than
+   * waiting for them.
+   */
+  class TableMutatorShared : public TableMutatorAsync {
+
+  public:
+
+    /**
+     * Constructs the TableMutatorShared object
+     *
+     * @param comm pointer to the Comm layer
+     * @param table pointer to the table object
+     * @param range_locator smart pointer to range locator
+     * @param timeout_ms maximum time in milliseconds to allow a batch of
+     *        mutations, including retries, to complete
+     * @param callback receives the outcome of each batch
+     * @param flush_interval_ms maximum time in milliseconds mutations are
+     *        held before being sent, 0 means use
+     *        Hypertable.Lib.Mutator.Shared.FlushInterval
+     */
+    TableMutatorShared(Comm *comm, Table *table,
+                       RangeLocatorPtr &range_locator, uint32_t timeout_ms,
+                       TableMutatorAsyncCallback *callback,
+                       uint32_t flush_interval_ms = 0);
+
+    /**
+     * Stops the periodic flush and waits for the outstanding batches.
+     * Mutations that have not been flushed are discarded.
+     */
+    virtual ~TableMutatorShared();
+
+    using TableMutatorAsync::set;
+
+    virtual void set(const KeySpec &key, const void *value,
+                     uint32_t value_len);
+
+    virtual void set_delete(const KeySpec &key);
+
+    virtual void set_cells(const Cells &cells);
+
+    /**
+     * Merges the staging buffers of all threads and sends the collected
+     * mutations without waiting for them to complete.
+     */
+    virtual void flush();
+
+  private:
+    class FlushHandler;
+    class FlushTimerHandler;
+
+    friend class FlushHandler;
+
+    struct Staging;
+
+    /**
+     * Staging buffers of one thread, by mutator id.  It is shared by the
+     * thread and its staging buffers, so that a mutator can remove its
+     * entries after the thread is gone.
+     */
+    class StagingMap : public ReferenceCount {
+    public:
+      Mutex mutex;
+      hash_map<uint64_t, Staging *> stagings;
+    };
+    typedef intrusive_ptr<StagingMap> StagingMapPtr;
+
+    /** Cells serialized by one thread, not yet merged */
+    struct Staging {
+      Staging(StagingMap *map) : owner(map), memory(0) { }
+      StagingMapPtr owner;
+      Mutex mutex;
+      DynamicBuffer accum;
+      uint64_t memory;
+    };
+
+    Staging *get_staging();
+    void append(Staging *staging, const Key &key, const void *value,
+                uint32_t value_len, uint64_t memory);
+    void move_cells(Staging *staging);
+    void remove_moved(Staging *staging, const uint8_t *endptr);
+    bool merge(Staging *staging);
+    void merge_all();
+    bool send_if_room(bool force);
+    void send_when_room(bool force);
+    void timed_flush();
+
+    uint64_t             m_id;
+    Mutex                m_merge_mutex;
+    Mutex                m_staging_mutex;
+    std::vector<Staging *> m_stagings;
+    size_t               m_staging_limit;
+    uint32_t             m_flush_interval;
+    DispatchHandlerPtr   m_flush_timer;
+
+    static atomic_t ms_next_id;
+    static boost::thread_specific_ptr<StagingMapPtr> ms_staging_map;
+  };
+
+  typedef intrusive_ptr<TableMutatorShared> TableMutatorSharedPtr;
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_TABLEMUTATORSHARED_H
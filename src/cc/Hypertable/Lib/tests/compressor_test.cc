@@ -20,6 +20,8 @@
  */
 
 #include "Common/Compat.h"
+#include <vector>
+
 #include "Common/DynamicBuffer.h"
 #include "Common/FileUtils.h"
 #include "Common/Logger.h"
@@ -43,6 +45,8 @@ namespace {
     "zlib",
     "lzo",
     "quicklz",
+    "lz4 [--hc]",
+    "zstd [--dictionary <size>]",
     "",
     0
   };
@@ -76,6 +80,25 @@ int main(int argc, char **argv) {
   }
   input.ptr = input.base + len;
 
+  // train a dictionary on slices of the input, as a cell store would
+  if (compressor->get_dictionary_size()) {
+    DynamicBuffer samples(0);
+    DynamicBuffer dictionary(0);
+    std::vector<size_t> sample_sizes;
+    size_t slice = 64;
+    for (int i=0; i<64; i++) {
+      for (size_t off=i; off+slice <= input.fill(); off += slice) {
+        samples.add(input.base+off, slice);
+        sample_sizes.push_back(slice);
+      }
+    }
+    if (!compressor->train_dictionary(samples, sample_sizes, dictionary)) {
+      HT_ERROR("Unable to train dictionary");
+      return 1;
+    }
+    compressor->set_dictionary(dictionary.base, dictionary.fill());
+  }
+
   try {
     compressor->deflate(input, output1, header);
     compressor->inflate(output1, output2, header);
@@ -0,0 +1,138 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <iostream>
+#include <vector>
+
+extern "C" {
+#include <poll.h>
+}
+
+#include "Common/Error.h"
+#include "Common/Logger.h"
+#include "Common/Timer.h"
+
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/LocationCache.h"
+#include "Hypertable/Lib/RangeLocator.h"
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+
+  void insert_range(LocationCachePtr &cache, uint32_t table_id,
+                    const char *start_row, const char *end_row,
+                    const char *location) {
+    RangeLocationInfo info;
+    info.start_row = start_row;
+    info.end_row = end_row;
+    info.location = location;
+    cache->insert(table_id, info);
+  }
+
+  int find_batch_error(RangeLocatorPtr &locator, TableIdentifier *table,
+                       const char *row) {
+    std::vector<const char *> rows;
+    std::vector<RangeLocationInfo> infos;
+    Timer timer(10000, true);
+    rows.push_back(row);
+    try {
+      locator->find_batch(table, rows, infos, timer);
+    }
+    catch (Exception &e) {
+      return e.code();
+    }
+    return Error::OK;
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  LocationCachePtr cache = new LocationCache(100);
+  RangeLocatorPtr locator = new RangeLocator(cache, 60000);
+  TableIdentifier table("test");
+  RangeLocationInfo info;
+  Timer timer(10000, true);
+
+  table.id = 5;
+  table.generation = 1;
+
+  insert_range(cache, 5, "", "g", "rs1_38060");
+  insert_range(cache, 5, "g", "p", "rs2_38060");
+  insert_range(cache, 5, "p", Key::END_ROW_MARKER, "rs3_38060");
+
+  /**
+   * find_batch() answers every row, in the order given, from the cache
+   */
+  {
+    const char *rows[] = { "zebra", "apple", "g", "", "happy", "p", "apple" };
+    const char *end_rows[] = { Key::END_ROW_MARKER, "g", "g", "g", "p", "p",
+                               "g" };
+    const char *locations[] = { "rs3_38060", "rs1_38060", "rs1_38060",
+                                "rs1_38060", "rs2_38060", "rs2_38060",
+                                "rs1_38060" };
+    std::vector<const char *> row_vec(rows, rows + 7);
+    std::vector<RangeLocationInfo> infos;
+
+    locator->find_batch(&table, row_vec, infos, timer);
+    HT_ASSERT(infos.size() == 7);
+    for (size_t i=0; i<7; i++) {
+      if (infos[i].end_row != end_rows[i] ||
+          infos[i].location != locations[i]) {
+        cout << "row '" << rows[i] << "' located in range ending at '"
+             << infos[i].end_row << "' on " << infos[i].location << endl;
+        return 1;
+      }
+    }
+  }
+
+  /**
+   * A negative entry is returned without a METADATA lookup, by find() as
+   * well as find_batch(), until a location for the table is inserted
+   */
+  TableIdentifier dropped("dropped");
+  dropped.id = 6;
+  dropped.generation = 1;
+
+  HT_ASSERT(locator->find(&dropped, "x", &info, timer, false)
+            == Error::METADATA_NOT_FOUND);
+  cache->insert_negative(6, "x", Error::TABLE_NOT_FOUND, 60000);
+  HT_ASSERT(locator->find(&dropped, "x", &info, timer, false)
+            == Error::TABLE_NOT_FOUND);
+  HT_ASSERT(find_batch_error(locator, &dropped, "x")
+            == Error::TABLE_NOT_FOUND);
+
+  insert_range(cache, 6, "", Key::END_ROW_MARKER, "rs1_38060");
+  HT_ASSERT(cache->lookup_negative(6, "x") == Error::OK);
+  HT_ASSERT(find_batch_error(locator, &dropped, "x") == Error::OK);
+
+  /**
+   * Negative entries expire
+   */
+  cache->insert_negative(7, "y", Error::METADATA_NOT_FOUND, 1);
+  poll(0, 0, 10);
+  HT_ASSERT(cache->lookup_negative(7, "y") == Error::OK);
+
+  return 0;
+}
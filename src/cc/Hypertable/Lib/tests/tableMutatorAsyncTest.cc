@@ -0,0 +1,195 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <cstring>
+#include <iostream>
+
+#include "AsyncComm/Comm.h"
+
+#include "Common/Error.h"
+#include "Common/Logger.h"
+#include "Common/Mutex.h"
+
+#include "Hypertable/Lib/Config.h"
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/LocationCache.h"
+#include "Hypertable/Lib/RangeLocator.h"
+#include "Hypertable/Lib/Table.h"
+#include "Hypertable/Lib/TableMutatorAsync.h"
+#include "Hypertable/Lib/TableMutatorShared.h"
+
+using namespace Hypertable;
+using namespace Config;
+using namespace std;
+
+namespace {
+
+  typedef Meta::list<DefaultCommPolicy> Policies;
+
+  // nothing listens here, so every update fails to be sent
+  const char *DEAD_LOCATION = "127.0.0.1_1";
+
+  const uint32_t TIMEOUT_MS = 2000;
+
+  const char *schema_str =
+  "<Schema>\n"
+  "  <AccessGroup name=\"default\">\n"
+  "    <ColumnFamily id=\"1\">\n"
+  "      <Name>data</Name>\n"
+  "    </ColumnFamily>\n"
+  "  </AccessGroup>\n"
+  "</Schema>";
+
+  class Callback : public TableMutatorAsyncCallback {
+  public:
+    Callback() : ok(0), errors(0), failed(0) { }
+
+    virtual void update_ok(TableMutatorAsync *mutator) {
+      ScopedLock lock(mutex);
+      ok++;
+    }
+
+    virtual void update_error(TableMutatorAsync *mutator, int error,
+                              FailedMutations &failed_mutations) {
+      ScopedLock lock(mutex);
+      HT_ASSERT(error != Error::OK);
+      errors++;
+      failed += failed_mutations.size();
+    }
+
+    Mutex mutex;
+    int ok;
+    int errors;
+    size_t failed;
+  };
+
+  void insert_range(LocationCachePtr &cache, uint32_t table_id,
+                    const char *start_row, const char *end_row,
+                    const char *location) {
+    RangeLocationInfo info;
+    info.start_row = start_row;
+    info.end_row = end_row;
+    info.location = location;
+    cache->insert(table_id, info);
+  }
+
+  /**
+   * Creates table 5 with a locator of its own, which only answers from
+   * the given cache
+   */
+  TablePtr create_table(LocationCachePtr &cache) {
+    RangeLocatorPtr locator = new RangeLocator(cache, 0);
+    SchemaPtr schema = Schema::new_instance(schema_str, strlen(schema_str),
+                                            true);
+    HT_ASSERT(schema->is_valid());
+
+    TableIdentifier table_id("test");
+    table_id.id = 5;
+    table_id.generation = 1;
+    return new Table(locator, Comm::instance(), table_id, schema, TIMEOUT_MS);
+  }
+
+  void set_cells(TableMutatorAsync *mutator, const char *prefix, int n) {
+    char row[32];
+    KeySpec key;
+
+    for (int i=0; i<n; i++) {
+      sprintf(row, "%s%02d", prefix, i);
+      key.row = row;
+      key.row_len = strlen(row);
+      key.column_family = "data";
+      mutator->set(key, "value");
+    }
+  }
+
+  /**
+   * Every mutation of a batch that can't be delivered is reported through
+   * update_error, including those waiting to be resent when it gives up
+   */
+  void test_async() {
+    LocationCachePtr cache = new LocationCache(100);
+    TablePtr table = create_table(cache);
+    Callback callback;
+    TableMutatorAsyncPtr mutator =
+        table->create_mutator_async(&callback, TIMEOUT_MS);
+
+    insert_range(cache, 5, "", Key::END_ROW_MARKER, DEAD_LOCATION);
+    set_cells(mutator.get(), "a", 10);
+    mutator->flush();
+    HT_ASSERT(mutator->wait_for_completion());
+
+    HT_ASSERT(callback.ok == 0);
+    HT_ASSERT(callback.errors == 1);
+    HT_ASSERT(callback.failed == 10);
+  }
+
+  /**
+   * Cells of a staging buffer whose range can't be located stay staged
+   * and are sent by a later flush, rather than being dropped along with
+   * the rest of the staging buffer
+   */
+  void test_shared() {
+    LocationCachePtr cache = new LocationCache(100);
+    TablePtr table = create_table(cache);
+    Callback callback;
+    TableMutatorSharedPtr mutator =
+        table->create_mutator_shared(&callback, TIMEOUT_MS, 600000);
+
+    insert_range(cache, 5, "", "m", DEAD_LOCATION);
+    set_cells(mutator.get(), "a", 5);
+    set_cells(mutator.get(), "x", 5);
+
+    try {
+      mutator->flush();
+      HT_ASSERT(!"flush succeeded without a location for the x rows");
+    }
+    catch (Exception &e) {
+      HT_ASSERT(e.code() == Error::REQUEST_TIMEOUT);
+    }
+    HT_ASSERT(mutator->get_outstanding() == 0);
+    HT_ASSERT(mutator->memory_used() > 0);
+
+    insert_range(cache, 5, "m", Key::END_ROW_MARKER, DEAD_LOCATION);
+    mutator->flush();
+    HT_ASSERT(mutator->wait_for_completion());
+
+    HT_ASSERT(callback.ok == 0);
+    HT_ASSERT(callback.errors == 1);
+    HT_ASSERT(callback.failed == 10);
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  try {
+    init_with_policies<Policies>(argc, argv);
+
+    test_async();
+    test_shared();
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    return 1;
+  }
+  return 0;
+}
@@ -43,6 +43,8 @@
 #include "Master.h"
 #include "ServersDirectoryHandler.h"
 #include "ServerLockFileHandler.h"
+#include "RangeBalancer.h"
+#include "RangeMerger.h"
 #include "RangeServerState.h"
 
 using namespace Hyperspace;
@@ -134,12 +136,22 @@ Master::Master(PropertiesPtr &props, ConnectionManagerPtr &conn_mgr,
       cout << "Last Table ID: " << ival << endl;
   }
 
+  m_recovery = new RangeServerRecovery(props, this,
+      m_conn_manager_ptr->get_comm(), m_dfs_client, m_hyperspace_ptr,
+      m_metadata_table_ptr);
+
   /**
    * Locate tablet servers
    */
   scan_servers_directory();
 
   master_gc_start(props, m_threads, m_metadata_table_ptr, m_dfs_client);
+
+  range_merger_start(props, m_threads, this, m_conn_manager_ptr->get_comm());
+
+  range_balancer_start(props, m_threads, this, m_conn_manager_ptr->get_comm());
+
+  m_recovery->start(m_threads);
 }
 
 
@@ -150,6 +162,15 @@ Master::~Master() {
 
 
 
+void Master::get_servers(std::vector<RangeServerStatePtr> &servers) {
+  ScopedLock lock(m_mutex);
+  servers.clear();
+  for (ServerMap::iterator iter = m_server_map.begin();
+       iter != m_server_map.end(); ++iter)
+    servers.push_back((*iter).second);
+}
+
+
 /**
  *
  */
@@ -214,9 +235,16 @@ void Master::server_left(const String &location) {
            hsfname.c_str());
   cout << flush;
 
-  /**
-   *  Do (or schedule) tablet re-assignment here
-   */
+  if (m_recovery)
+    m_recovery->add(location);
+}
+
+
+void Master::root_server_recovered(const String &location) {
+  ScopedLock lock(m_root_server_mutex);
+  m_root_server_location = location;
+  m_root_server_connected = true;
+  m_root_server_cond.notify_all();
 }
 
 
@@ -56,6 +56,7 @@ extern "C" {
 #include "RangeServerState.h"
 #include "ResponseCallbackGetSchema.h"
 #include "MasterGc.h"
+#include "RangeServerRecovery.h"
 
 namespace Hypertable {
   using namespace Hyperspace;
@@ -79,9 +80,20 @@ namespace Hypertable {
                     bool if_exists);
     void shutdown(ResponseCallback *cb);
 
+    /**
+     * Returns the currently registered range servers
+     */
+    void get_servers(std::vector<RangeServerStatePtr> &servers);
+
     void server_joined(const String &location);
     void server_left(const String &location);
 
+    /**
+     * Records that the root METADATA range has been recovered onto the
+     * server at <code>location</code> and wakes up anyone waiting for it
+     */
+    void root_server_recovered(const String &location);
+
     void join();
 
   protected:
@@ -126,6 +138,8 @@ namespace Hypertable {
 
     RangeToAddrMap m_range_to_server_map;
 
+    RangeServerRecoveryPtr m_recovery;
+
     ThreadGroup m_threads;
     static const uint32_t MAX_ALTER_TABLE_RETRIES = 3;
   };
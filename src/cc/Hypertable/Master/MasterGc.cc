@@ -165,6 +165,10 @@ struct GcWorker {
 
   void
   insert_file(CountMap &map, const char *fname, int c) {
+    // "#+" marks a live file, listed on its own line, as inherited
+    if (*fname == '#' && fname[1] == '+')
+      return;
+
     if (*fname == '#')
       ++fname;
 
@@ -0,0 +1,345 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+#include <poll.h>
+}
+
+#include "Common/Error.h"
+#include "Common/Logger.h"
+#include "Common/Mutex.h"
+
+#include "Hypertable/Lib/RangeServerClient.h"
+#include "Hypertable/Lib/Stat.h"
+
+#include "Master.h"
+#include "RangeBalancer.h"
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+
+enum { RANGES, DISK, MEMORY, LOAD, DIMENSIONS };
+
+struct ServerLoad {
+  RangeServerStatePtr server;
+  vector<RangeStat> ranges;
+  vector<bool> moved;
+  double totals[DIMENSIONS];
+  double score;
+};
+
+struct RangeMove {
+  RangeStat range;
+  RangeServerStatePtr source;
+  RangeServerStatePtr destination;
+};
+
+void range_values(const RangeStat &rs, double *values) {
+  values[RANGES] = 1.0;
+  values[DISK] = (double)rs.disk_usage;
+  values[MEMORY] = (double)rs.memory_usage;
+  values[LOAD] = (double)(rs.read_rate + rs.write_rate);
+}
+
+/**
+ * Runs the planned moves, at most concurrency of them at a time
+ */
+struct MoveRunner {
+  MoveRunner(Comm *comm, vector<RangeMove> &moves, Mutex &mutex,
+             size_t &next) : m_comm(comm), m_moves(moves), m_mutex(mutex),
+             m_next(next) { }
+
+  Comm              *m_comm;
+  vector<RangeMove> &m_moves;
+  Mutex             &m_mutex;
+  size_t            &m_next;
+
+  void move(RangeMove &mv) {
+    RangeServerClient rsc(m_comm);
+    const char *table = mv.range.table_identifier.name;
+    const char *start_row = mv.range.range_spec.start_row;
+    const char *end_row = mv.range.range_spec.end_row;
+
+    try {
+      rsc.relinquish_range(mv.source->addr, mv.range.table_identifier,
+                           mv.range.range_spec);
+    }
+    catch (Exception &e) {
+      HT_WARNF("Balancer: move of %s[%s..%s] from %s aborted - %s", table,
+               start_row, end_row, mv.source->location.c_str(), e.what());
+      return;
+    }
+
+    try {
+      RangeState range_state;
+      rsc.load_range(mv.destination->addr, mv.range.table_identifier,
+                     mv.range.range_spec, "", range_state);
+      HT_INFOF("Balancer: moved %s[%s..%s] from %s to %s", table, start_row,
+               end_row, mv.source->location.c_str(),
+               mv.destination->location.c_str());
+      return;
+    }
+    catch (Exception &e) {
+      HT_ERRORF("Balancer: load of %s[%s..%s] on %s failed, returning it to "
+                "%s - %s", table, start_row, end_row,
+                mv.destination->location.c_str(),
+                mv.source->location.c_str(), e.what());
+    }
+
+    try {
+      RangeState range_state;
+      rsc.load_range(mv.source->addr, mv.range.table_identifier,
+                     mv.range.range_spec, "", range_state);
+    }
+    catch (Exception &e) {
+      HT_ERRORF("Balancer: unable to reload %s[%s..%s] on %s - %s", table,
+                start_row, end_row, mv.source->location.c_str(), e.what());
+    }
+  }
+
+  void operator()() {
+    while (true) {
+      size_t i;
+      {
+        ScopedLock lock(m_mutex);
+        if (m_next == m_moves.size())
+          return;
+        i = m_next++;
+      }
+      move(m_moves[i]);
+    }
+  }
+};
+
+struct BalanceWorker {
+  BalanceWorker(Master *master, Comm *comm, int interval_millis,
+                double threshold, int max_moves, int concurrency)
+    : m_master(master), m_comm(comm), m_interval_millis(interval_millis),
+      m_threshold(threshold), m_max_moves(max_moves),
+      m_concurrency(concurrency) { }
+
+  Master       *m_master;
+  Comm         *m_comm;
+  int           m_interval_millis;
+  double        m_threshold;
+  int           m_max_moves;
+  int           m_concurrency;
+
+  /**
+   * Share of the cluster average that a range contributes to a server
+   * score, averaged over the dimensions that are in use
+   */
+  static double contribution(const double *values, const double *means) {
+    double sum = 0.0;
+    int n = 0;
+    for (int d=0; d<DIMENSIONS; d++) {
+      if (means[d] > 0.0) {
+        sum += values[d] / means[d];
+        n++;
+      }
+    }
+    return n ? sum / n : 0.0;
+  }
+
+  void collect(vector<ServerLoad> &loads) {
+    RangeServerClient rsc(m_comm);
+    vector<RangeServerStatePtr> servers;
+
+    m_master->get_servers(servers);
+
+    foreach(RangeServerStatePtr &server, servers) {
+      RangeServerStat stat;
+      try {
+        rsc.get_statistics(server->addr, stat);
+      }
+      catch (Exception &e) {
+        HT_WARNF("Balancer: unable to get statistics from %s, skipping "
+                 "round - %s", server->location.c_str(), e.what());
+        loads.clear();
+        return;
+      }
+
+      ServerLoad load;
+      double values[DIMENSIONS];
+
+      load.server = server;
+      memset(load.totals, 0, sizeof(load.totals));
+      foreach(const RangeStat &rs, stat.range_stats) {
+        range_values(rs, values);
+        for (int d=0; d<DIMENSIONS; d++)
+          load.totals[d] += values[d];
+        // METADATA ranges count towards the load but are never moved
+        if (rs.table_identifier.id != 0)
+          load.ranges.push_back(rs);
+      }
+      load.moved.resize(load.ranges.size(), false);
+      loads.push_back(load);
+    }
+  }
+
+  void plan(vector<ServerLoad> &loads, vector<RangeMove> &moves) {
+    double means[DIMENSIONS];
+    double values[DIMENSIONS];
+
+    memset(means, 0, sizeof(means));
+    foreach(ServerLoad &load, loads)
+      for (int d=0; d<DIMENSIONS; d++)
+        means[d] += load.totals[d] / loads.size();
+
+    foreach(ServerLoad &load, loads) {
+      load.score = contribution(load.totals, means);
+      HT_INFOF("Balancer: %s ranges=%d disk=%llu memory=%llu load=%.1f/s "
+               "score=%.2f", load.server->location.c_str(),
+               (int)load.totals[RANGES], (Llu)load.totals[DISK],
+               (Llu)load.totals[MEMORY], load.totals[LOAD], load.score);
+    }
+
+    while ((int)moves.size() < m_max_moves) {
+      ServerLoad *high = &loads[0], *low = &loads[0];
+
+      foreach(ServerLoad &load, loads) {
+        if (load.score > high->score)
+          high = &load;
+        if (load.score < low->score)
+          low = &load;
+      }
+
+      double gap = high->score - low->score;
+
+      if (high->score <= 1.0 + m_threshold && low->score >= 1.0 - m_threshold)
+        break;
+
+      // pick the range that brings the two servers closest together
+      int best = -1;
+      double best_distance = gap;
+      for (size_t i=0; i<high->ranges.size(); i++) {
+        if (high->moved[i])
+          continue;
+        range_values(high->ranges[i], values);
+        double c = contribution(values, means);
+        if (c <= 0.0 || c >= gap)
+          continue;
+        double distance = fabs(gap/2.0 - c);
+        if (best == -1 || distance < best_distance) {
+          best = i;
+          best_distance = distance;
+        }
+      }
+
+      if (best == -1)
+        break;
+
+      RangeMove mv;
+      mv.range = high->ranges[best];
+      mv.source = high->server;
+      mv.destination = low->server;
+      moves.push_back(mv);
+
+      range_values(mv.range, values);
+      for (int d=0; d<DIMENSIONS; d++) {
+        high->totals[d] -= values[d];
+        low->totals[d] += values[d];
+      }
+      high->moved[best] = true;
+
+      HT_INFOF("Balancer: planning move of %s[%s..%s] from %s (score=%.2f) "
+               "to %s (score=%.2f)", mv.range.table_identifier.name,
+               mv.range.range_spec.start_row, mv.range.range_spec.end_row,
+               high->server->location.c_str(), high->score,
+               low->server->location.c_str(), low->score);
+
+      high->score = contribution(high->totals, means);
+      low->score = contribution(low->totals, means);
+    }
+  }
+
+  void balance_once() {
+    vector<ServerLoad> loads;
+    vector<RangeMove> moves;
+
+    collect(loads);
+
+    if (loads.size() < 2)
+      return;
+
+    plan(loads, moves);
+
+    if (moves.empty())
+      return;
+
+    HT_INFOF("Balancer: carrying out %d moves, %d at a time",
+             (int)moves.size(), m_concurrency);
+
+    Mutex mutex;
+    size_t next = 0;
+    ThreadGroup threads;
+    for (int i=0; i<m_concurrency && i<(int)moves.size(); i++)
+      threads.create_thread(MoveRunner(m_comm, moves, mutex, next));
+    threads.join_all();
+  }
+
+  void operator()() {
+    while (true) {
+      poll(0, 0, m_interval_millis);
+      try {
+        balance_once();
+      }
+      catch (Exception &e) {
+        HT_ERROR_OUT << e << HT_END;
+      }
+    }
+  }
+};
+
+} // local namespace
+
+
+namespace Hypertable {
+
+void
+range_balancer_start(PropertiesPtr &cfg, ThreadGroup &threads, Master *master,
+                     Comm *comm) {
+  int interval_millis = cfg->get_i32("Hypertable.Master.Balance.Interval");
+  int threshold = cfg->get_i32("Hypertable.Master.Balance.Threshold");
+  int max_moves = cfg->get_i32("Hypertable.Master.Balance.MaxMoves");
+  int concurrency = cfg->get_i32("Hypertable.Master.Balance.Concurrency");
+
+  if (interval_millis <= 0)
+    return;
+
+  if (concurrency < 1)
+    concurrency = 1;
+
+  threads.create_thread(BalanceWorker(master, comm, interval_millis,
+      (double)threshold / 100.0, max_moves, concurrency));
+
+  HT_INFOF("Started range balancer thread with interval: %d milliseconds, "
+           "threshold: %d%%", interval_millis, threshold);
+}
+
+} // namespace Hypertable
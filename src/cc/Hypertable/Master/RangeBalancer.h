@@ -0,0 +1,49 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_RANGEBALANCER_H
+#define HYPERTABLE_RANGEBALANCER_H
+
+#include "Common/Properties.h"
+#include "Common/Thread.h"
+
+#include "AsyncComm/Comm.h"
+
+namespace Hypertable {
+
+  class Master;
+
+  /**
+   * Starts the range balancer thread.  Every
+   * Hypertable.Master.Balance.Interval milliseconds it collects the
+   * statistics of all range servers, scores each server by its range
+   * count, disk usage, memory usage and request rate relative to the
+   * cluster average, and moves ranges from the most loaded to the least
+   * loaded servers until every score is within
+   * Hypertable.Master.Balance.Threshold percent of the average.  Does
+   * nothing if the interval is zero.
+   */
+  extern void range_balancer_start(PropertiesPtr &, ThreadGroup &threads,
+                                   Master *master, Comm *comm);
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_RANGEBALANCER_H
@@ -0,0 +1,183 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <algorithm>
+#include <vector>
+
+extern "C" {
+#include <poll.h>
+#include <string.h>
+}
+
+#include "Common/Error.h"
+#include "Common/Logger.h"
+
+#include "Hypertable/Lib/RangeServerClient.h"
+#include "Hypertable/Lib/Stat.h"
+
+#include "Master.h"
+#include "RangeMerger.h"
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+
+struct LtRangeStat {
+  bool operator()(const RangeStat *rs1, const RangeStat *rs2) const {
+    if (rs1->table_identifier.id != rs2->table_identifier.id)
+      return rs1->table_identifier.id < rs2->table_identifier.id;
+    return strcmp(rs1->range_spec.end_row, rs2->range_spec.end_row) < 0;
+  }
+};
+
+struct MergeWorker {
+  MergeWorker(Master *master, Comm *comm, int interval_millis,
+              uint64_t max_bytes, int max_merges)
+    : m_master(master), m_comm(comm), m_interval_millis(interval_millis),
+      m_max_bytes(max_bytes), m_max_merges(max_merges) { }
+
+  Master       *m_master;
+  Comm         *m_comm;
+  int           m_interval_millis;
+  uint64_t      m_max_bytes;
+  int           m_max_merges;
+
+  static uint64_t range_size(const RangeStat *rs) {
+    return rs->disk_usage + rs->memory_usage;
+  }
+
+  /**
+   * Merges adjacent small ranges of one server.  Pairs don't overlap, so
+   * a range takes part in at most one merge per round.
+   */
+  int merge_server(RangeServerClient &rsc, RangeServerStatePtr &server,
+                   int max_merges) {
+    RangeServerStat stat;
+    vector<const RangeStat *> ranges;
+    int merges = 0;
+
+    rsc.get_statistics(server->addr, stat);
+
+    for (size_t i=0; i<stat.range_stats.size(); i++) {
+      // METADATA ranges are never merged
+      if (stat.range_stats[i].table_identifier.id != 0)
+        ranges.push_back(&stat.range_stats[i]);
+    }
+
+    sort(ranges.begin(), ranges.end(), LtRangeStat());
+
+    for (size_t i=0; i+1<ranges.size() && merges<max_merges; i++) {
+      const RangeStat *low = ranges[i];
+      const RangeStat *high = ranges[i+1];
+
+      if (low->table_identifier.id != high->table_identifier.id ||
+          strcmp(low->range_spec.end_row, high->range_spec.start_row) ||
+          range_size(low) + range_size(high) >= m_max_bytes)
+        continue;
+
+      HT_INFOF("Merging %s[%s..%s] into %s[%s..%s] on %s (bytes=%llu)",
+               low->table_identifier.name, low->range_spec.start_row,
+               low->range_spec.end_row, high->table_identifier.name,
+               high->range_spec.start_row, high->range_spec.end_row,
+               server->location.c_str(),
+               (Llu)(range_size(low) + range_size(high)));
+
+      try {
+        rsc.merge_ranges(server->addr, high->table_identifier,
+                         low->range_spec, high->range_spec);
+        merges++;
+        i++;
+      }
+      catch (Exception &e) {
+        HT_WARNF("Merge of %s[%s..%s] into %s[%s..%s] failed - %s",
+                 low->table_identifier.name, low->range_spec.start_row,
+                 low->range_spec.end_row, high->table_identifier.name,
+                 high->range_spec.start_row, high->range_spec.end_row,
+                 e.what());
+      }
+    }
+    return merges;
+  }
+
+  void merge_once() {
+    RangeServerClient rsc(m_comm);
+    vector<RangeServerStatePtr> servers;
+    int merges = 0;
+
+    m_master->get_servers(servers);
+
+    foreach(RangeServerStatePtr &server, servers) {
+      if (merges >= m_max_merges)
+        break;
+      try {
+        merges += merge_server(rsc, server, m_max_merges - merges);
+      }
+      catch (Exception &e) {
+        HT_ERRORF("Problem merging ranges on %s - %s",
+                  server->location.c_str(), e.what());
+      }
+    }
+
+    if (merges)
+      HT_INFOF("Merged %d range pairs", merges);
+  }
+
+  void operator()() {
+    while (true) {
+      poll(0, 0, m_interval_millis);
+      try {
+        merge_once();
+      }
+      catch (Exception &e) {
+        HT_ERROR_OUT << e << HT_END;
+      }
+    }
+  }
+};
+
+} // local namespace
+
+
+namespace Hypertable {
+
+void
+range_merger_start(PropertiesPtr &cfg, ThreadGroup &threads, Master *master,
+                   Comm *comm) {
+  int interval_millis = cfg->get_i32("Hypertable.Master.Merge.Interval");
+  uint64_t max_bytes = cfg->get_i64("Hypertable.Master.Merge.MaxBytes");
+  int max_merges = cfg->get_i32("Hypertable.Master.Merge.MaxPerInterval");
+
+  if (interval_millis <= 0)
+    return;
+
+  if (max_bytes == 0)
+    max_bytes = cfg->get_i64("Hypertable.RangeServer.Range.MaxBytes") / 4;
+
+  threads.create_thread(MergeWorker(master, comm, interval_millis, max_bytes,
+                                    max_merges));
+
+  HT_INFOF("Started range merger thread with interval: %d milliseconds, "
+           "max bytes: %llu", interval_millis, (Llu)max_bytes);
+}
+
+} // namespace Hypertable
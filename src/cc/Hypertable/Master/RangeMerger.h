@@ -0,0 +1,46 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_RANGEMERGER_H
+#define HYPERTABLE_RANGEMERGER_H
+
+#include "Common/Properties.h"
+#include "Common/Thread.h"
+
+#include "AsyncComm/Comm.h"
+
+namespace Hypertable {
+
+  class Master;
+
+  /**
+   * Starts the range merger thread.  Every Hypertable.Master.Merge.Interval
+   * milliseconds it collects the range statistics of all range servers
+   * and asks each server to merge pairs of adjacent ranges that it holds
+   * whose combined size is below Hypertable.Master.Merge.MaxBytes.  Does
+   * nothing if the interval is zero.
+   */
+  extern void range_merger_start(PropertiesPtr &, ThreadGroup &threads,
+                                 Master *master, Comm *comm);
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_RANGEMERGER_H
@@ -0,0 +1,559 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <algorithm>
+#include <set>
+#include <cstdlib>
+#include <cstring>
+
+extern "C" {
+#include <poll.h>
+}
+
+#include "Common/DynamicBuffer.h"
+#include "Common/Error.h"
+#include "Common/Logger.h"
+#include "Common/Serialization.h"
+#include "Common/StaticBuffer.h"
+#include "Common/Stopwatch.h"
+
+#include "AsyncComm/DispatchHandlerSynchronizer.h"
+
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/KeySpec.h"
+#include "Hypertable/Lib/RangeServerClient.h"
+#include "Hypertable/Lib/RangeServerProtocol.h"
+#include "Hypertable/Lib/TableMutator.h"
+
+#include "Master.h"
+#include "RangeServerRecovery.h"
+
+using namespace Hypertable;
+using namespace Hyperspace;
+using namespace std;
+
+namespace {
+
+struct RecoveryWorker {
+  RecoveryWorker(RangeServerRecoveryPtr recovery) : m_recovery(recovery) { }
+  void operator()() { m_recovery->run(); }
+  RangeServerRecoveryPtr m_recovery;
+};
+
+/**
+ * Has one server replay its share of the fragments of a failed server's
+ * commit log
+ */
+struct FragmentReplayer {
+  FragmentReplayer(Comm *comm, RangeServerStatePtr &server,
+                   const String &log_dir, vector<uint32_t> &fragments,
+                   vector<QualifiedRangeSpec> &ranges,
+                   vector<String> &destinations, uint32_t timeout,
+                   Mutex &mutex, int &error, String &error_msg,
+                   set<String> &linked_logs)
+    : m_comm(comm), m_server(server), m_log_dir(log_dir),
+      m_fragments(fragments), m_ranges(ranges), m_destinations(destinations),
+      m_timeout(timeout), m_mutex(mutex), m_error(error),
+      m_error_msg(error_msg), m_linked_logs(linked_logs) { }
+
+  Comm                       *m_comm;
+  RangeServerStatePtr         m_server;
+  String                      m_log_dir;
+  vector<uint32_t>            m_fragments;
+  vector<QualifiedRangeSpec> &m_ranges;
+  vector<String>             &m_destinations;
+  uint32_t                    m_timeout;
+  Mutex                      &m_mutex;
+  int                        &m_error;
+  String                     &m_error_msg;
+  set<String>                &m_linked_logs;
+
+  void operator()() {
+    RangeServerClient rsc(m_comm);
+    vector<String> linked_logs;
+
+    try {
+      rsc.set_timeout(m_timeout);
+      rsc.replay_fragments(m_server->addr, m_log_dir, m_fragments, m_ranges,
+                           m_destinations, linked_logs);
+      ScopedLock lock(m_mutex);
+      m_linked_logs.insert(linked_logs.begin(), linked_logs.end());
+    }
+    catch (Exception &e) {
+      HT_ERRORF("Recovery: replay of %u fragments of %s on %s failed - %s",
+                (unsigned)m_fragments.size(), m_log_dir.c_str(),
+                m_server->location.c_str(), e.what());
+      ScopedLock lock(m_mutex);
+      if (m_error == Error::OK) {
+        m_error = e.code();
+        m_error_msg = e.what();
+      }
+    }
+  }
+};
+
+void
+wait_for_reply(DispatchHandlerSynchronizer &sync_handler, const char *what,
+               RangeServerStatePtr &server) {
+  EventPtr event_ptr;
+
+  if (!sync_handler.wait_for_reply(event_ptr))
+    HT_THROWF((int)Hypertable::Protocol::response_code(event_ptr),
+              "%s on %s failed - %s",
+              what, server->location.c_str(),
+              Hypertable::Protocol::string_format_message(event_ptr).c_str());
+}
+
+const char *group_name(uint16_t group) {
+  switch (group) {
+  case RangeServerProtocol::GROUP_METADATA_ROOT:
+    return "root";
+  case RangeServerProtocol::GROUP_METADATA:
+    return "metadata";
+  default:
+    return "user";
+  }
+}
+
+} // local namespace
+
+
+RangeServerRecovery::RangeServerRecovery(PropertiesPtr &props, Master *master,
+    Comm *comm, Filesystem *fs, Hyperspace::SessionPtr &hyperspace,
+    TablePtr &metadata)
+  : m_master(master), m_comm(comm), m_fs(fs), m_hyperspace(hyperspace),
+    m_metadata(metadata), m_next_server(0) {
+  m_max_workers = props->get_i32("Hypertable.Master.Recovery.Workers");
+  m_timeout = props->get_i32("Hypertable.Master.Recovery.Timeout");
+  m_retry_interval = props->get_i32("Hypertable.Master.Recovery.RetryInterval");
+}
+
+
+void RangeServerRecovery::start(ThreadGroup &threads) {
+  threads.create_thread(RecoveryWorker(this));
+}
+
+
+void RangeServerRecovery::add(const String &location) {
+  ScopedLock lock(m_mutex);
+  m_queue.push_back(location);
+  m_cond.notify_one();
+}
+
+
+void RangeServerRecovery::run() {
+  String location;
+
+  while (true) {
+    {
+      ScopedLock lock(m_mutex);
+      while (m_queue.empty())
+        m_cond.wait(lock);
+      location = m_queue.front();
+      m_queue.pop_front();
+    }
+
+    try {
+      recover(location);
+    }
+    catch (Exception &e) {
+      HT_ERROR_OUT << "Recovery: problem recovering " << location
+          << ", will try again in " << m_retry_interval << " milliseconds - "
+          << e << HT_END;
+      poll(0, 0, m_retry_interval);
+      add(location);
+    }
+  }
+}
+
+
+void RangeServerRecovery::recover(const String &location) {
+  String log_dir = "/hypertable/servers/" + location + "/log";
+  String rsml_fname = log_dir + "/range_txn/0.log";
+  RangeServerMetaLogReaderPtr rsml_reader;
+  vector<RangeServerStatePtr> servers;
+  RangeInfoVector root_ranges, metadata_ranges, user_ranges;
+  Stopwatch stopwatch;
+
+  if (!m_fs->exists(rsml_fname)) {
+    HT_INFOF("Recovery: %s has no range server meta log, nothing to recover",
+             location.c_str());
+    return;
+  }
+
+  m_master->get_servers(servers);
+
+  // a server that came back under the same location recovers its own logs
+  foreach(RangeServerStatePtr &server, servers) {
+    if (server->location == location) {
+      HT_INFOF("Recovery: %s has re-registered, skipping recovery",
+               location.c_str());
+      return;
+    }
+  }
+
+  if (servers.empty())
+    HT_THROWF(Error::MASTER_NO_RANGESERVERS, "No servers to recover the "
+              "ranges of %s onto", location.c_str());
+
+  rsml_reader = new RangeServerMetaLogReader(m_fs, rsml_fname);
+  const RangeStates &range_states = rsml_reader->load_range_states();
+
+  foreach(const RangeStateInfo *i, range_states) {
+    if (i->table.id == 0 && i->range.end_row
+        && !strcmp(i->range.end_row, Key::END_ROOT_ROW))
+      root_ranges.push_back(i);
+    else if (i->table.id == 0)
+      metadata_ranges.push_back(i);
+    else
+      user_ranges.push_back(i);
+  }
+
+  HT_INFOF("Recovery: recovering %u ranges of %s onto %u servers",
+           (unsigned)range_states.size(), location.c_str(),
+           (unsigned)servers.size());
+
+  int &groups_done = m_groups_done[location];
+
+  if (groups_done < 1) {
+    recover_group(location, RangeServerProtocol::GROUP_METADATA_ROOT,
+                  log_dir + "/root", root_ranges, servers);
+    groups_done = 1;
+  }
+  if (groups_done < 2) {
+    recover_group(location, RangeServerProtocol::GROUP_METADATA,
+                  log_dir + "/metadata", metadata_ranges, servers);
+    groups_done = 2;
+  }
+  recover_group(location, RangeServerProtocol::GROUP_USER, log_dir + "/user",
+                user_ranges, servers);
+
+  rsml_reader = 0;
+
+  // The ranges are now owned by other servers, remove the logs so that a
+  // server restarted under this location does not load them again.  The
+  // transfer logs linked into them live elsewhere and go too.
+  m_fs->rmdir(log_dir);
+  foreach(const String &linked_log, m_linked_logs[location]) {
+    try {
+      m_fs->rmdir(linked_log);
+    }
+    catch (Exception &e) {
+      HT_WARN_OUT << "Recovery: problem removing linked log " << linked_log
+          << " - " << e << HT_END;
+    }
+  }
+
+  m_groups_done.erase(location);
+  m_linked_logs.erase(location);
+
+  HT_INFOF("Recovery: recovered %s in %.3f seconds", location.c_str(),
+           stopwatch.elapsed());
+}
+
+
+void
+RangeServerRecovery::recover_group(const String &location, uint16_t group,
+    const String &log_dir, RangeInfoVector &ranges,
+    vector<RangeServerStatePtr> &servers) {
+  String plan_fname = log_dir + ".plan";
+  RecoveryPlan plan;
+  map<String, RangeServerStatePtr> live;
+  vector<String> owners;
+  vector<RangeServerStatePtr> targets, pending;
+  vector<QualifiedRangeSpec> specs;
+  vector<String> destinations;
+  vector<uint32_t> fragments;
+  RangeServerClient rsc(m_comm);
+  Stopwatch stopwatch;
+
+  if (ranges.empty())
+    return;
+
+  foreach(RangeServerStatePtr &server, servers)
+    live[server->location] = server;
+
+  // Reuse the assignment of an earlier attempt so that no range is loaded
+  // on two servers.  Only the ranges of servers that went away before
+  // committing are spread over the live servers again.
+  bool plan_changed = !load_plan(plan_fname, plan);
+
+  foreach(const RangeStateInfo *info, ranges) {
+    String key = format("%lu:%s", (Lu)info->table.id, info->range.end_row);
+    String &owner = plan.locations[key];
+    if (owner.empty() || (plan.committed.count(owner) == 0
+                          && live.find(owner) == live.end())) {
+      owner = servers[m_next_server++ % servers.size()]->location;
+      plan_changed = true;
+    }
+    owners.push_back(owner);
+    if (plan.committed.count(owner) == 0 &&
+        find(targets.begin(), targets.end(), live[owner]) == targets.end())
+      targets.push_back(live[owner]);
+  }
+
+  if (plan_changed)
+    save_plan(plan_fname, plan);
+
+  // start a replay on every server that has not committed yet and load its
+  // ranges.  A server that already holds its first range committed in an
+  // attempt that failed before the commit was recorded.
+  foreach(RangeServerStatePtr &server, targets) {
+    bool loaded = false;
+    {
+      DispatchHandlerSynchronizer sync_handler;
+      rsc.replay_begin(server->addr, group, &sync_handler);
+      wait_for_reply(sync_handler, "replay_begin", server);
+    }
+    try {
+      for (size_t i=0; i<ranges.size(); i++) {
+        if (owners[i] != server->location)
+          continue;
+        DispatchHandlerSynchronizer sync_handler;
+        rsc.replay_load_range(server->addr, ranges[i]->table,
+                              ranges[i]->range, ranges[i]->range_state,
+                              &sync_handler);
+        wait_for_reply(sync_handler, "replay_load_range", server);
+        loaded = true;
+      }
+    }
+    catch (Exception &e) {
+      if (e.code() != Error::RANGESERVER_RANGE_ALREADY_LOADED || loaded)
+        throw;
+      HT_INFOF("Recovery: %s already committed its %s ranges of %s",
+               server->location.c_str(), group_name(group), location.c_str());
+      plan.committed.insert(server->location);
+      save_plan(plan_fname, plan);
+      continue;
+    }
+    pending.push_back(server);
+  }
+
+  for (size_t i=0; i<ranges.size(); i++) {
+    if (plan.committed.count(owners[i]))
+      continue;
+    specs.push_back(QualifiedRangeSpec(ranges[i]->table, ranges[i]->range));
+    destinations.push_back(owners[i]);
+  }
+
+  if (!specs.empty())
+    list_fragments(log_dir, fragments);
+
+  // divide the fragments among the workers and replay them in parallel
+  size_t worker_count = servers.size();
+  if (m_max_workers && worker_count > m_max_workers)
+    worker_count = m_max_workers;
+  if (worker_count > fragments.size())
+    worker_count = fragments.size();
+
+  if (worker_count > 0) {
+    vector<vector<uint32_t> > shares(worker_count);
+    ThreadGroup threads;
+    Mutex mutex;
+    int error = Error::OK;
+    String error_msg;
+
+    for (size_t i=0; i<fragments.size(); i++)
+      shares[i % worker_count].push_back(fragments[i]);
+
+    for (size_t i=0; i<worker_count; i++)
+      threads.create_thread(FragmentReplayer(m_comm, servers[i], log_dir,
+          shares[i], specs, destinations, m_timeout, mutex, error, error_msg,
+          m_linked_logs[location]));
+
+    threads.join_all();
+
+    if (error != Error::OK)
+      HT_THROW(error, error_msg);
+  }
+
+  // make the ranges live on their new servers, recording each commit so
+  // that a retry does not load the ranges again
+  foreach(RangeServerStatePtr &server, pending) {
+    DispatchHandlerSynchronizer sync_handler;
+    rsc.replay_commit(server->addr, &sync_handler);
+    wait_for_reply(sync_handler, "replay_commit", server);
+    plan.committed.insert(server->location);
+    save_plan(plan_fname, plan);
+  }
+
+  update_locations(ranges, owners);
+
+  HT_INFOF("Recovery: recovered %u %s ranges of %s from %u fragments with %u "
+           "workers in %.3f seconds", (unsigned)ranges.size(),
+           group_name(group), location.c_str(), (unsigned)fragments.size(),
+           (unsigned)worker_count, stopwatch.elapsed());
+}
+
+
+/**
+ * Reads the recovery plan written by an earlier attempt, returns false if
+ * there is none
+ */
+bool
+RangeServerRecovery::load_plan(const String &fname, RecoveryPlan &plan) {
+  if (!m_fs->exists(fname))
+    return false;
+
+  size_t len = m_fs->length(fname);
+  DynamicBuffer buf(len);
+  int fd = m_fs->open(fname);
+
+  try {
+    while (buf.fill() < len) {
+      size_t nread = m_fs->read(fd, buf.ptr, len - buf.fill());
+      if (nread == 0)
+        HT_THROWF(Error::FAILED_EXPECTATION, "Recovery plan %s truncated",
+                  fname.c_str());
+      buf.ptr += nread;
+    }
+  }
+  catch (Exception &) {
+    m_fs->close(fd);
+    throw;
+  }
+  m_fs->close(fd);
+
+  const uint8_t *ptr = buf.base;
+  size_t remain = len;
+  uint32_t count = Serialization::decode_i32(&ptr, &remain);
+
+  for (uint32_t i=0; i<count; i++) {
+    String key = Serialization::decode_vstr(&ptr, &remain);
+    plan.locations[key] = Serialization::decode_vstr(&ptr, &remain);
+  }
+
+  count = Serialization::decode_i32(&ptr, &remain);
+  for (uint32_t i=0; i<count; i++)
+    plan.committed.insert(Serialization::decode_vstr(&ptr, &remain));
+
+  return true;
+}
+
+
+/**
+ * Replaces the recovery plan file; the plan is written to a temporary file
+ * first so that a retry never sees a partial plan
+ */
+void
+RangeServerRecovery::save_plan(const String &fname, RecoveryPlan &plan) {
+  String tmp_fname = fname + ".tmp";
+  size_t len = 8;
+  typedef map<String, String> LocationMap;
+
+  foreach(const LocationMap::value_type &v, plan.locations)
+    len += Serialization::encoded_length_vstr(v.first)
+        + Serialization::encoded_length_vstr(v.second);
+  foreach(const String &committed, plan.committed)
+    len += Serialization::encoded_length_vstr(committed);
+
+  DynamicBuffer buf(len);
+  Serialization::encode_i32(&buf.ptr, plan.locations.size());
+  foreach(const LocationMap::value_type &v, plan.locations) {
+    Serialization::encode_vstr(&buf.ptr, v.first);
+    Serialization::encode_vstr(&buf.ptr, v.second);
+  }
+  Serialization::encode_i32(&buf.ptr, plan.committed.size());
+  foreach(const String &committed, plan.committed)
+    Serialization::encode_vstr(&buf.ptr, committed);
+
+  StaticBuffer sbuf(buf);
+  int fd = m_fs->create(tmp_fname, true, -1, -1, -1);
+
+  try {
+    m_fs->append(fd, sbuf, Filesystem::O_FLUSH);
+  }
+  catch (Exception &) {
+    m_fs->close(fd);
+    throw;
+  }
+  m_fs->close(fd);
+  m_fs->rename(tmp_fname, fname);
+}
+
+
+void
+RangeServerRecovery::list_fragments(const String &log_dir,
+                                    vector<uint32_t> &fragments) {
+  vector<String> listing;
+
+  if (!m_fs->exists(log_dir))
+    return;
+
+  m_fs->readdir(log_dir, listing);
+
+  foreach(const String &name, listing) {
+    char *endptr;
+    long num = strtol(name.c_str(), &endptr, 10);
+    if (*endptr == 0)
+      fragments.push_back((uint32_t)num);
+  }
+
+  sort(fragments.begin(), fragments.end());
+}
+
+
+/**
+ * Points the METADATA 'Location' column (or, for the root range, the
+ * 'Location' attribute of /hypertable/root) at the new owner of each range
+ */
+void
+RangeServerRecovery::update_locations(RangeInfoVector &ranges,
+                                      vector<String> &owners) {
+  TableMutatorPtr mutator;
+  String metadata_key_str;
+  KeySpec key;
+
+  for (size_t i=0; i<ranges.size(); i++) {
+    const RangeStateInfo *info = ranges[i];
+    const String &owner = owners[i];
+
+    if (info->table.id == 0 && !strcmp(info->range.end_row, Key::END_ROOT_ROW)) {
+      HandleCallbackPtr null_callback;
+      uint64_t handle = m_hyperspace->open("/hypertable/root",
+          OPEN_FLAG_READ | OPEN_FLAG_WRITE | OPEN_FLAG_CREATE, null_callback);
+      m_hyperspace->attr_set(handle, "Location", owner.c_str(),
+                             owner.length());
+      m_hyperspace->close(handle);
+      m_master->root_server_recovered(owner);
+      continue;
+    }
+
+    if (!m_metadata)
+      HT_THROW(Error::FAILED_EXPECTATION, "METADATA table not open");
+
+    if (!mutator)
+      mutator = m_metadata->create_mutator();
+
+    metadata_key_str = format("%lu:%s", (Lu)info->table.id,
+                              info->range.end_row);
+    key.row = metadata_key_str.c_str();
+    key.row_len = metadata_key_str.length();
+    key.column_family = "Location";
+    key.column_qualifier = 0;
+    key.column_qualifier_len = 0;
+    mutator->set(key, owner.c_str(), owner.length());
+  }
+
+  if (mutator)
+    mutator->flush();
+}
@@ -0,0 +1,130 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#ifndef HYPERTABLE_RANGESERVERRECOVERY_H
+#define HYPERTABLE_RANGESERVERRECOVERY_H
+
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <boost/thread/condition.hpp>
+
+#include "Common/Mutex.h"
+#include "Common/Properties.h"
+#include "Common/ReferenceCount.h"
+#include "Common/String.h"
+#include "Common/Thread.h"
+
+#include "AsyncComm/Comm.h"
+
+#include "Hyperspace/Session.h"
+
+#include "Hypertable/Lib/Filesystem.h"
+#include "Hypertable/Lib/RangeServerMetaLogReader.h"
+#include "Hypertable/Lib/Table.h"
+
+#include "RangeServerState.h"
+
+namespace Hypertable {
+
+  class Master;
+
+  /**
+   * Recovers the ranges of failed range servers.  The ranges listed in the
+   * failed server's range server meta log are spread over the live servers
+   * and loaded there with the replay protocol.  The fragments of the failed
+   * server's commit log are then divided among the live servers, each of
+   * which reads its share and sends every update to the server that now
+   * holds its range.  This is done group by group (root, metadata, user) so
+   * that the METADATA entries of each group can be updated before the next
+   * group is recovered.  Failed recoveries are retried every
+   * Hypertable.Master.Recovery.RetryInterval milliseconds.  The assignment
+   * of ranges to servers is written to the failed server's log directory
+   * before any range is loaded and reused on retry, so a range is never
+   * loaded on two servers and servers that already committed are skipped.
+   */
+  class RangeServerRecovery : public ReferenceCount {
+  public:
+    RangeServerRecovery(PropertiesPtr &props, Master *master, Comm *comm,
+                        Filesystem *fs, Hyperspace::SessionPtr &hyperspace,
+                        TablePtr &metadata);
+
+    /**
+     * Starts the thread that carries out queued recoveries
+     */
+    void start(ThreadGroup &threads);
+
+    /**
+     * Queues the recovery of a failed server
+     *
+     * @param location location of the failed server
+     */
+    void add(const String &location);
+
+    void run();
+
+  private:
+    typedef std::vector<const RangeStateInfo *> RangeInfoVector;
+
+    /**
+     * Destination of each range of a group, keyed by "<table id>:<end row>",
+     * and the destinations that have committed their ranges
+     */
+    struct RecoveryPlan {
+      std::map<String, String> locations;
+      std::set<String> committed;
+    };
+
+    void recover(const String &location);
+    void recover_group(const String &location, uint16_t group,
+                       const String &log_dir, RangeInfoVector &ranges,
+                       std::vector<RangeServerStatePtr> &servers);
+    void list_fragments(const String &log_dir,
+                        std::vector<uint32_t> &fragments);
+    bool load_plan(const String &fname, RecoveryPlan &plan);
+    void save_plan(const String &fname, RecoveryPlan &plan);
+    void update_locations(RangeInfoVector &ranges,
+                          std::vector<String> &owners);
+
+    Mutex                  m_mutex;
+    boost::condition       m_cond;
+    std::list<String>      m_queue;
+    std::map<String, int>  m_groups_done;
+    std::map<String, std::set<String> > m_linked_logs;
+    Master                *m_master;
+    Comm                  *m_comm;
+    Filesystem            *m_fs;
+    Hyperspace::SessionPtr m_hyperspace;
+    TablePtr              &m_metadata;
+    size_t                 m_next_server;
+    uint32_t               m_max_workers;
+    uint32_t               m_timeout;
+    uint32_t               m_retry_interval;
+  };
+
+  typedef intrusive_ptr<RangeServerRecovery> RangeServerRecoveryPtr;
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_RANGESERVERRECOVERY_H
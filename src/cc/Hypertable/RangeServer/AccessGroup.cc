@@ -24,8 +24,10 @@
 #include <iterator>
 #include <vector>
 
+#include "Common/Checksum.h"
 #include "Common/Error.h"
 #include "Common/md5.h"
+#include "Common/Serialization.h"
 
 #include "AccessGroup.h"
 #include "CellCache.h"
@@ -40,6 +42,9 @@
 
 using namespace Hypertable;
 
+namespace {
+  const char CHECKPOINT_MAGIC[8] = { 'C','H','K','P','T','-','-','1' };
+}
 
 AccessGroup::AccessGroup(const TableIdentifier *identifier,
     SchemaPtr &schema, Schema::AccessGroup *ag, const RangeSpec *range)
@@ -50,7 +55,13 @@ AccessGroup::AccessGroup(const TableIdentifier *identifier,
     m_earliest_cached_revision_saved(TIMESTAMP_NULL),
     m_collisions(0), m_needs_compaction(false), m_drop(false),
     m_file_tracker(identifier, schema, range, ag->name),
-    m_recovering(false) {
+    m_recovering(false), m_compaction_bytes_written(0),
+    m_relinquished(false), m_needs_checkpoint(false),
+    m_checkpoint_revision(TIMESTAMP_NULL), m_snapshot_revision(TIMESTAMP_NULL),
+    m_earliest_uncheckpointed_revision(TIMESTAMP_NULL),
+    m_earliest_uncheckpointed_revision_saved(TIMESTAMP_NULL),
+    m_checkpoint_entries(0),
+    m_checkpoint_earliest_revision(TIMESTAMP_NULL) {
 
   m_table_name = m_identifier.name;
   m_start_row = range->start_row;
@@ -80,11 +91,18 @@ AccessGroup::AccessGroup(const TableIdentifier *identifier,
   }
   m_bloom_filter_disabled = BLOOM_FILTER_DISABLED ==
       m_cellstore_props->get<BloomFilterMode>("bloom-filter-mode");
+
+  m_compaction_policy = CompactionPolicy::create(
+      schema->get_compaction_policy().size() ?
+      schema->get_compaction_policy() : Config::get_str("Hypertable."
+      "RangeServer.AccessGroup.CompactionPolicy"));
 }
 
 
 AccessGroup::~AccessGroup() {
   if (m_drop) {
+    if (m_checkpoint_revision != TIMESTAMP_NULL)
+      remove_checkpoint();
     if (m_identifier.id == 0) {
       HT_ERROR("~AccessGroup has drop bit set, but table is METADATA");
       return;
@@ -142,6 +160,11 @@ void AccessGroup::update_schema(SchemaPtr &schema_ptr,
     }
     // Update schema ptr
     m_schema = schema_ptr;
+
+    if (schema_ptr->get_compaction_policy().size() &&
+        schema_ptr->get_compaction_policy() != m_compaction_policy->get_name())
+      m_compaction_policy =
+          CompactionPolicy::create(schema_ptr->get_compaction_policy());
   }
 }
 
@@ -152,8 +175,14 @@ void AccessGroup::update_schema(SchemaPtr &schema_ptr,
  */
 void AccessGroup::add(const Key &key, const ByteString value) {
   if (key.revision > m_compaction_revision || !m_recovering) {
+    // already loaded from the checkpoint
+    if (m_recovering && key.revision <= m_checkpoint_revision)
+      return;
     if (m_earliest_cached_revision == TIMESTAMP_NULL)
       m_earliest_cached_revision = key.revision;
+    if (m_snapshot_revision != TIMESTAMP_NULL &&
+        m_earliest_uncheckpointed_revision == TIMESTAMP_NULL)
+      m_earliest_uncheckpointed_revision = key.revision;
     return m_cell_cache->add(key, value);
   }
 }
@@ -274,7 +303,9 @@ AccessGroup::MaintenanceData *AccessGroup::get_maintenance_data(ByteArena &arena
 
   mdata->ag = this;
 
-  if (m_earliest_cached_revision_saved != TIMESTAMP_NULL)
+  if (m_checkpoint_revision != TIMESTAMP_NULL)
+    mdata->earliest_cached_revision = earliest_uncheckpointed_revision();
+  else if (m_earliest_cached_revision_saved != TIMESTAMP_NULL)
     mdata->earliest_cached_revision = m_earliest_cached_revision_saved;
   else
     mdata->earliest_cached_revision = m_earliest_cached_revision;
@@ -290,13 +321,21 @@ AccessGroup::MaintenanceData *AccessGroup::get_maintenance_data(ByteArena &arena
   mdata->in_memory = m_in_memory;
   mdata->deletes = m_cell_cache->get_delete_count();
 
+  mdata->merge_needed = false;
+  if (!m_in_memory) {
+    std::vector<size_t> selected;
+    select_merge_stores(selected);
+    mdata->merge_needed = !selected.empty();
+  }
+
   // add TTL stuff
 
   return mdata;
 }
 
 
-void AccessGroup::add_cell_store(CellStorePtr &cellstore, uint32_t id) {
+void AccessGroup::add_cell_store(CellStorePtr &cellstore, uint32_t id,
+                                 bool inherited) {
   ScopedLock lock(m_mutex);
 
   // Figure out the "next" CellStore number
@@ -332,18 +371,66 @@ void AccessGroup::add_cell_store(CellStorePtr &cellstore, uint32_t id) {
 
   m_stores.push_back(cellstore);
 
+  if (inherited) {
+    m_inherited_stores.insert(cellstore->get_filename());
+    m_file_tracker.set_inherited(m_inherited_stores);
+  }
 }
 
-namespace {
-  struct LtCellStore {
-    bool operator()(const CellStorePtr &x, const CellStorePtr &y) const {
-      return !(x->disk_usage() < y->disk_usage());
-    }
-  };
+/**
+ * Asks the compaction policy which cell stores to merge.  Cell stores
+ * inherited from a split are rewritten first, regardless of the policy.
+ * Assumes mutex is locked.
+ */
+void AccessGroup::select_merge_stores(std::vector<size_t> &selected) {
+  CompactionPolicy::StoreInfoVector store_info;
+
+  for (size_t i=0; i<m_stores.size(); i++)
+    if (is_shared_store(m_stores[i]))
+      selected.push_back(i);
+
+  if (!selected.empty())
+    return;
+
+  foreach(CellStorePtr &cellstore, m_stores)
+    store_info.push_back(CompactionPolicy::StoreInfo(cellstore->disk_usage(),
+                                                     cellstore->get_revision()));
+
+  m_compaction_policy->select(store_info, selected);
+}
+
+
+/**
+ * Returns the directory that holds the cell stores written by this range.
+ * Assumes mutex is locked.
+ */
+String AccessGroup::get_range_dir() {
+  // TODO: Issue 11
+  char hash_str[33];
+
+  if (m_end_row == "")
+    memset(hash_str, '0', 24);
+  else
+    md5_string(m_end_row.c_str(), hash_str);
+
+  hash_str[24] = 0;
+  return format("/hypertable/tables/%s/%s/%s", m_table_name.c_str(),
+                m_name.c_str(), hash_str);
 }
 
 
-void AccessGroup::run_compaction(bool major) {
+/**
+ * A split leaves both halves referencing the parent's cell stores, each
+ * restricted to its own row interval.  shrink() records them as inherited,
+ * as does add_cell_store() for a store that the 'Files' column of METADATA
+ * marks as inherited.  Assumes mutex is locked.
+ */
+bool AccessGroup::is_shared_store(CellStorePtr &cellstore) {
+  return m_inherited_stores.count(cellstore->get_filename()) > 0;
+}
+
+
+void AccessGroup::run_compaction(bool major, bool flush_only) {
   ByteString bskey;
   ByteString value;
   Key key;
@@ -351,10 +438,11 @@ void AccessGroup::run_compaction(bool major) {
   size_t tableidx = 1;
   CellStorePtr cellstore;
   String metadata_key_str;
+  bool throttle = false;
 
   try {
 
-    if (!major && !m_needs_compaction)
+    if (!major && !flush_only && !m_needs_compaction)
       HT_THROW(Error::OK, "");
 
     HT_ASSERT(m_immutable_cache);
@@ -375,13 +463,35 @@ void AccessGroup::run_compaction(bool major) {
         HT_INFOF("Starting Major Compaction of %s(%s)",
                  m_range_name.c_str(), m_name.c_str());
       }
+      else if (flush_only) {
+        if (m_immutable_cache->memory_used() == 0)
+          HT_THROW(Error::OK, "");
+        tableidx = m_stores.size();
+        HT_INFOF("Starting Minor Compaction of %s(%s)",
+                 m_range_name.c_str(), m_name.c_str());
+      }
       else {
-        if (m_stores.size() > (size_t)Global::access_group_max_files) {
-          LtCellStore ascending;
-          sort(m_stores.begin(), m_stores.end(), ascending);
-          tableidx = m_stores.size() - Global::access_group_merge_files;
-          HT_INFOF("Starting Merging Compaction of %s(%s)",
-                   m_range_name.c_str(), m_name.c_str());
+        std::vector<size_t> selected;
+        select_merge_stores(selected);
+        if (!selected.empty()) {
+          /**
+           * Move the selected stores to the end of the store vector, since
+           * everything from tableidx on gets merged
+           */
+          std::vector<bool> is_selected(m_stores.size(), false);
+          std::vector<CellStorePtr> reordered;
+          foreach(size_t i, selected)
+            is_selected[i] = true;
+          for (size_t i=0; i<m_stores.size(); i++)
+            if (!is_selected[i])
+              reordered.push_back(m_stores[i]);
+          foreach(size_t i, selected)
+            reordered.push_back(m_stores[i]);
+          m_stores.swap(reordered);
+          tableidx = m_stores.size() - selected.size();
+          HT_INFOF("Starting Merging Compaction of %s(%s) (policy=%s, "
+                   "files=%d)", m_range_name.c_str(), m_name.c_str(),
+                   m_compaction_policy->get_name(), (int)selected.size());
         }
         else {
           if (m_immutable_cache->memory_used() == 0)
@@ -391,6 +501,14 @@ void AccessGroup::run_compaction(bool major) {
                    m_range_name.c_str(), m_name.c_str());
         }
       }
+
+      /**
+       * Only compactions that rewrite existing cell stores are throttled;
+       * minor compactions, and anything run while memory is short, free
+       * memory and must not be held back
+       */
+      throttle = !m_in_memory && tableidx < m_stores.size() &&
+          Global::memory_tracker.balance() <= Global::memory_limit;
     }
 
   }
@@ -405,21 +523,16 @@ void AccessGroup::run_compaction(bool major) {
   }
 
   try {
+    String cs_file;
 
-    // TODO: Issue 11
-    char hash_str[33];
-
-    if (m_end_row == "")
-      memset(hash_str, '0', 24);
-    else
-      md5_string(m_end_row.c_str(), hash_str);
-
-    hash_str[24] = 0;
-    String cs_file = format("/hypertable/tables/%s/%s/%s/cs%d",
-                            m_table_name.c_str(), m_name.c_str(), hash_str,
-                            m_next_cs_id++);
+    {
+      ScopedLock lock(m_mutex);
+      cs_file = format("%s/cs%d", get_range_dir().c_str(), m_next_cs_id++);
+    }
 
-    cellstore = new CellStoreV0(Global::dfs);
+    CellStoreV0 *cellstore_v0 = new CellStoreV0(Global::dfs);
+    cellstore_v0->set_throttle(throttle);
+    cellstore = cellstore_v0;
     size_t max_num_entries = 0;
 
 
@@ -427,6 +540,8 @@ void AccessGroup::run_compaction(bool major) {
       ScopedLock lock(m_mutex);
       ScanContextPtr scan_context = new ScanContext(m_schema);
 
+      scan_context->throttle = throttle;
+
       if (m_in_memory) {
         MergeScanner *mscanner = new MergeScanner(scan_context, false);
         mscanner->add_scanner(m_immutable_cache->create_scanner(
@@ -468,8 +583,10 @@ void AccessGroup::run_compaction(bool major) {
 
     cellstore->create(cs_file.c_str(), max_num_entries, m_cellstore_props);
 
+    uint64_t bytes_written = 0;
     while (scanner->get(key, value)) {
       cellstore->add(key, value);
+      bytes_written += key.length + value.length();
       scanner->forward();
     }
 
@@ -486,6 +603,8 @@ void AccessGroup::run_compaction(bool major) {
       if (m_in_memory) {
         merge_caches();
         m_stores.clear();
+        m_inherited_stores.clear();
+        m_file_tracker.set_inherited(m_inherited_stores);
       }
       else {
 
@@ -495,6 +614,9 @@ void AccessGroup::run_compaction(bool major) {
         m_immutable_cache = 0;
 
         /** Drop the compacted tables from the table vector **/
+        for (size_t i=tableidx; i<m_stores.size(); i++)
+          m_inherited_stores.erase(m_stores[i]->get_filename());
+        m_file_tracker.set_inherited(m_inherited_stores);
         if (tableidx < m_stores.size())
           m_stores.resize(tableidx);
       }
@@ -531,12 +653,20 @@ void AccessGroup::run_compaction(bool major) {
       if (cellstore)
         m_compaction_revision = cellstore->get_revision();
 
+      m_compaction_bytes_written += bytes_written;
     }
 
     m_file_tracker.update_files_column();
 
     m_earliest_cached_revision_saved = TIMESTAMP_NULL;
 
+    // the cell store now holds everything the checkpoint did
+    {
+      ScopedLock lock(m_mutex);
+      if (m_checkpoint_revision != TIMESTAMP_NULL)
+        remove_checkpoint();
+    }
+
     HT_INFOF("Finished Compaction of %s(%s)", m_range_name.c_str(),
              m_name.c_str());
 
@@ -631,7 +761,11 @@ void AccessGroup::shrink(String &split_row, bool drop_high) {
       new_stores.push_back(new_cell_store);
     }
 
+    // every store is now shared with the other half of the split
     m_stores = new_stores;
+    foreach(CellStorePtr &cellstore, m_stores)
+      m_inherited_stores.insert(cellstore->get_filename());
+    m_file_tracker.set_inherited(m_inherited_stores);
   }
   catch (Exception &e) {
     m_cell_cache = old_cell_cache;
@@ -646,11 +780,381 @@ void AccessGroup::shrink(String &split_row, bool drop_high) {
 /**
  */
 void AccessGroup::release_files(const std::vector<String> &files) {
+  AccessGroupPtr merged_into;
+  bool relinquished;
+
+  {
+    ScopedLock lock(m_mutex);
+    merged_into = m_merged_into;
+    relinquished = m_relinquished;
+  }
+
+  // references were handed over to the range this one was merged into
+  if (merged_into) {
+    merged_into->release_files(files);
+    return;
+  }
+
+  // the range has moved, its METADATA entry belongs to another server now
+  if (relinquished) {
+    m_file_tracker.remove_references(files);
+    return;
+  }
+
   m_file_tracker.remove_references(files);
   m_file_tracker.update_files_column();
 }
 
 
+bool AccessGroup::has_shared_stores() {
+  ScopedLock lock(m_mutex);
+  foreach(CellStorePtr &cellstore, m_stores)
+    if (is_shared_store(cellstore))
+      return true;
+  return false;
+}
+
+
+void AccessGroup::merge(AccessGroup *low) {
+  ScopedLock lock(m_mutex);
+  ScopedLock low_lock(low->m_mutex);
+  ScanContextPtr scan_context = new ScanContext(m_schema);
+  CellListScannerPtr cell_cache_scanner;
+  std::vector<CellStorePtr> new_stores;
+  ByteString value;
+  Key key_comps;
+
+  HT_ASSERT(!m_immutable_cache && !low->m_immutable_cache);
+
+  // Range::merge() refuses ranges with inherited stores
+  HT_ASSERT(m_inherited_stores.empty() && low->m_inherited_stores.empty());
+
+  // both caches were flushed, which removes any checkpoint
+  HT_ASSERT(m_checkpoint_revision == TIMESTAMP_NULL &&
+            low->m_checkpoint_revision == TIMESTAMP_NULL);
+
+  /**
+   * Copy the cell cache
+   */
+  cell_cache_scanner = low->m_cell_cache->create_scanner(scan_context);
+  while (cell_cache_scanner->get(key_comps, value)) {
+    m_cell_cache->add(key_comps, value);
+    cell_cache_scanner->forward();
+  }
+
+  if (m_earliest_cached_revision == TIMESTAMP_NULL ||
+      (low->m_earliest_cached_revision != TIMESTAMP_NULL &&
+       low->m_earliest_cached_revision < m_earliest_cached_revision))
+    m_earliest_cached_revision = low->m_earliest_cached_revision;
+
+  /**
+   * Take over the cell stores
+   */
+  new_stores = low->m_stores;
+  foreach(CellStorePtr &cellstore, m_stores)
+    new_stores.push_back(cellstore);
+  m_stores.swap(new_stores);
+
+  m_disk_usage = 0;
+  m_compression_ratio = 0.0;
+  for (size_t i=0; i<m_stores.size(); i++) {
+    double disk_usage = m_stores[i]->disk_usage();
+    m_disk_usage += (uint64_t)disk_usage;
+    m_compression_ratio += m_stores[i]->compression_ratio() * disk_usage;
+  }
+  if (m_disk_usage)
+    m_compression_ratio /= m_disk_usage;
+  else
+    m_compression_ratio = 1.0;
+
+  if (low->m_compaction_revision > m_compaction_revision)
+    m_compaction_revision = low->m_compaction_revision;
+  m_collisions += low->m_collisions;
+  m_compaction_bytes_written += low->m_compaction_bytes_written;
+
+  m_start_row = low->m_start_row;
+  m_range_name = m_table_name + "[" + m_start_row + ".." + m_end_row + "]";
+  m_full_name = m_range_name + "(" + m_name + ")";
+
+  m_file_tracker.merge(low->m_file_tracker);
+
+  low->m_merged_into = this;
+}
+
+
+/**
+ * Checkpoint files are keyed by range rather than by server so that any
+ * server that loads the range will find it.  Assumes mutex is locked.
+ */
+String AccessGroup::get_checkpoint_file() {
+  char hash_str[33];
+
+  if (m_end_row == "")
+    memset(hash_str, '0', 24);
+  else
+    md5_string(m_end_row.c_str(), hash_str);
+
+  hash_str[24] = 0;
+  return format("%s/%u/%s/%s", Global::checkpoint_dir.c_str(),
+                (unsigned)m_identifier.id, hash_str, m_name.c_str());
+}
+
+
+/**
+ * Assumes mutex is locked.  Until write_checkpoint() has renamed a new
+ * checkpoint into place, the previous one is what a restart would load,
+ * so the cells added after it (tracked in the saved value since the
+ * snapshot) still pin the log along with those added since the snapshot.
+ */
+int64_t AccessGroup::earliest_uncheckpointed_revision() {
+  int64_t saved = m_earliest_uncheckpointed_revision_saved;
+  int64_t current = m_earliest_uncheckpointed_revision;
+
+  if (saved == TIMESTAMP_NULL)
+    return current;
+  if (current == TIMESTAMP_NULL || saved < current)
+    return saved;
+  return current;
+}
+
+
+bool AccessGroup::snapshot_checkpoint() {
+  ScopedLock lock(m_mutex);
+  Key key;
+  ByteString value;
+
+  m_needs_checkpoint = false;
+
+  if (m_immutable_cache || m_cell_cache->size() == 0)
+    return false;
+
+  ScanContextPtr scan_context = new ScanContext(m_schema);
+  CellListScannerPtr scanner = m_cell_cache->create_scanner(scan_context);
+  int64_t revision = TIMESTAMP_NULL;
+
+  m_checkpoint_buf.clear();
+  m_checkpoint_buf.reserve(m_cell_cache->memory_used());
+  m_checkpoint_entries = 0;
+  m_checkpoint_earliest_revision = TIMESTAMP_MAX;
+
+  while (scanner->get(key, value)) {
+    m_checkpoint_buf.add(key.serial.ptr, key.length);
+    m_checkpoint_buf.add(value.ptr, value.length());
+    if (key.revision > revision)
+      revision = key.revision;
+    if (key.revision < m_checkpoint_earliest_revision)
+      m_checkpoint_earliest_revision = key.revision;
+    m_checkpoint_entries++;
+    scanner->forward();
+  }
+
+  /**
+   * From here on, track the earliest revision added after the snapshot.  The
+   * previous value is kept in case writing the checkpoint fails and the
+   * previous checkpoint has to stay in effect.
+   */
+  m_snapshot_revision = revision;
+  m_earliest_uncheckpointed_revision_saved = m_earliest_uncheckpointed_revision;
+  m_earliest_uncheckpointed_revision = TIMESTAMP_NULL;
+  return true;
+}
+
+
+void AccessGroup::write_checkpoint() {
+  String fname, tmp_fname;
+  DynamicBuffer header(0);
+  int64_t revision;
+  int fd = -1;
+
+  {
+    ScopedLock lock(m_mutex);
+    fname = get_checkpoint_file();
+    revision = m_snapshot_revision;
+    header.reserve(64 + m_start_row.length() + m_end_row.length()
+                   + m_name.length());
+    header.add(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    header.ptr += 4;  // checksum
+    Serialization::encode_i32(&header.ptr, m_identifier.id);
+    Serialization::encode_vstr(&header.ptr, m_start_row);
+    Serialization::encode_vstr(&header.ptr, m_end_row);
+    Serialization::encode_vstr(&header.ptr, m_name);
+    Serialization::encode_i64(&header.ptr, revision);
+    Serialization::encode_i64(&header.ptr, m_checkpoint_earliest_revision);
+    Serialization::encode_i32(&header.ptr, m_checkpoint_entries);
+    Serialization::encode_i64(&header.ptr, m_checkpoint_buf.fill());
+  }
+
+  uint8_t *checksum_ptr = header.base + sizeof(CHECKPOINT_MAGIC);
+  uint32_t checksum = adler32(checksum_ptr + 4,
+                              header.ptr - (checksum_ptr + 4));
+  checksum = adler32_update(checksum, m_checkpoint_buf.base,
+                            m_checkpoint_buf.fill());
+  Serialization::encode_i32(&checksum_ptr, checksum);
+
+  tmp_fname = fname + ".tmp";
+
+  try {
+    size_t body_len = m_checkpoint_buf.fill();
+    StaticBuffer header_sbuf(header);
+    StaticBuffer body_sbuf(m_checkpoint_buf);
+
+    Global::log_dfs->mkdirs(fname.substr(0, fname.rfind('/')));
+    fd = Global::log_dfs->create(tmp_fname, true, -1, -1, -1);
+    Global::log_dfs->append(fd, header_sbuf);
+    Global::log_dfs->append(fd, body_sbuf, Filesystem::O_FLUSH);
+    Global::log_dfs->close(fd);
+    fd = -1;
+    Global::log_dfs->rename(tmp_fname, fname);
+
+    HT_INFOF("Checkpointed %s (%u cells, %llu bytes, revision %lld)",
+             m_full_name.c_str(), (unsigned)m_checkpoint_entries,
+             (Llu)body_len, (Lld)revision);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << "Problem writing checkpoint " << fname << " - "
+                 << e << HT_END;
+    if (fd != -1) {
+      try { Global::log_dfs->close(fd); }
+      catch (Exception &) { }
+    }
+    ScopedLock lock(m_mutex);
+    m_snapshot_revision = m_checkpoint_revision;
+    if (m_checkpoint_revision == TIMESTAMP_NULL)
+      m_earliest_uncheckpointed_revision = TIMESTAMP_NULL;
+    else if (m_earliest_uncheckpointed_revision_saved != TIMESTAMP_NULL)
+      m_earliest_uncheckpointed_revision =
+          m_earliest_uncheckpointed_revision_saved;
+    m_earliest_uncheckpointed_revision_saved = TIMESTAMP_NULL;
+    m_checkpoint_buf.free();
+    throw;
+  }
+
+  ScopedLock lock(m_mutex);
+  m_checkpoint_revision = revision;
+  m_earliest_uncheckpointed_revision_saved = TIMESTAMP_NULL;
+}
+
+
+/**
+ * Loads the checkpoint of this access group, if there is one, into the
+ * cell cache.  A checkpoint that is older than the latest cell store is
+ * left over from a compaction that finished just before a crash and is
+ * removed.  Called when the range is loaded, before any replay.
+ */
+void AccessGroup::load_checkpoint() {
+  ScopedLock lock(m_mutex);
+  String fname = get_checkpoint_file();
+  int fd = -1;
+
+  try {
+    if (!Global::log_dfs->exists(fname))
+      return;
+
+    size_t len = Global::log_dfs->length(fname);
+    DynamicBuffer buf(len);
+
+    fd = Global::log_dfs->open(fname);
+    while (buf.fill() < len) {
+      size_t nread = Global::log_dfs->read(fd, buf.ptr, len - buf.fill());
+      if (nread == 0)
+        HT_THROWF(Error::RANGESERVER_CORRUPT_CHECKPOINT, "%s truncated",
+                  fname.c_str());
+      buf.ptr += nread;
+    }
+    Global::log_dfs->close(fd);
+    fd = -1;
+
+    const uint8_t *ptr = buf.base;
+    size_t remain = len;
+
+    if (remain < sizeof(CHECKPOINT_MAGIC) + 4 ||
+        memcmp(ptr, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)))
+      HT_THROWF(Error::RANGESERVER_CORRUPT_CHECKPOINT, "%s: bad magic",
+                fname.c_str());
+    ptr += sizeof(CHECKPOINT_MAGIC);
+    remain -= sizeof(CHECKPOINT_MAGIC);
+
+    uint32_t checksum = Serialization::decode_i32(&ptr, &remain);
+    if (checksum != adler32(ptr, remain))
+      HT_THROWF(Error::RANGESERVER_CORRUPT_CHECKPOINT, "%s: checksum "
+                "mismatch", fname.c_str());
+
+    uint32_t table_id = Serialization::decode_i32(&ptr, &remain);
+    String start_row = Serialization::decode_vstr(&ptr, &remain);
+    String end_row = Serialization::decode_vstr(&ptr, &remain);
+    String ag_name = Serialization::decode_vstr(&ptr, &remain);
+    int64_t revision = Serialization::decode_i64(&ptr, &remain);
+    int64_t earliest = Serialization::decode_i64(&ptr, &remain);
+    uint32_t entries = Serialization::decode_i32(&ptr, &remain);
+    uint64_t body_len = Serialization::decode_i64(&ptr, &remain);
+
+    if (table_id != m_identifier.id || start_row != m_start_row ||
+        end_row != m_end_row || ag_name != m_name || body_len != remain) {
+      HT_WARNF("Checkpoint %s does not match %s, removing", fname.c_str(),
+               m_full_name.c_str());
+      Global::log_dfs->remove(fname);
+      return;
+    }
+
+    if (revision <= m_compaction_revision) {
+      HT_INFOF("Removing stale checkpoint %s (revision %lld <= %lld)",
+               fname.c_str(), (Lld)revision, (Lld)m_compaction_revision);
+      Global::log_dfs->remove(fname);
+      return;
+    }
+
+    Key key;
+    ByteString value;
+    const uint8_t *end = ptr + body_len;
+
+    while (ptr < end) {
+      key.load(SerializedKey(ptr));
+      value.ptr = ptr + key.length;
+      ptr = value.ptr + value.length();
+      if (key.revision > m_compaction_revision)
+        m_cell_cache->add(key, value);
+    }
+
+    m_checkpoint_revision = m_snapshot_revision = revision;
+    m_earliest_uncheckpointed_revision = TIMESTAMP_NULL;
+    if (m_earliest_cached_revision == TIMESTAMP_NULL ||
+        earliest < m_earliest_cached_revision)
+      m_earliest_cached_revision = earliest;
+
+    HT_INFOF("Loaded checkpoint of %s (%u cells, revision %lld)",
+             m_full_name.c_str(), (unsigned)entries, (Lld)revision);
+  }
+  catch (Exception &e) {
+    if (fd != -1) {
+      try { Global::log_dfs->close(fd); }
+      catch (Exception &) { }
+    }
+    HT_THROW2F(e.code(), e, "Problem loading checkpoint %s", fname.c_str());
+  }
+}
+
+
+/**
+ * Assumes mutex is locked
+ */
+void AccessGroup::remove_checkpoint() {
+  String fname = get_checkpoint_file();
+
+  m_checkpoint_revision = TIMESTAMP_NULL;
+  m_snapshot_revision = TIMESTAMP_NULL;
+  m_earliest_uncheckpointed_revision = TIMESTAMP_NULL;
+  m_earliest_uncheckpointed_revision_saved = TIMESTAMP_NULL;
+
+  try {
+    Global::log_dfs->remove(fname);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << "Problem removing checkpoint " << fname << " - "
+                 << e << HT_END;
+  }
+}
+
+
 void AccessGroup::initiate_compaction() {
   ScopedLock lock(m_mutex);
   HT_ASSERT(!m_immutable_cache);
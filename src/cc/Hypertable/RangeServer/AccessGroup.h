@@ -29,6 +29,7 @@
 #include <boost/thread/condition.hpp>
 
 #include "Common/CharArena.h"
+#include "Common/DynamicBuffer.h"
 #include "Common/String.h"
 #include "Common/StringExt.h"
 #include "Common/HashMap.h"
@@ -38,6 +39,7 @@
 
 #include "CellCache.h"
 #include "CellStore.h"
+#include "CompactionPolicy.h"
 #include "LiveFileTracker.h"
 
 
@@ -58,6 +60,7 @@ namespace Hypertable {
       uint32_t deletes;
       void *user_data;
       bool in_memory;
+      bool merge_needed;
     };
 
     AccessGroup(const TableIdentifier *identifier, SchemaPtr &schema,
@@ -93,11 +96,29 @@ namespace Hypertable {
     uint64_t disk_usage();
     uint64_t memory_usage();
     void space_usage(int64_t *memp, int64_t *diskp);
-    void add_cell_store(CellStorePtr &cellstore, uint32_t id);
-    void run_compaction(bool major);
+    /**
+     * Adds a cell store loaded from METADATA.
+     *
+     * @param cellstore cell store, opened and with its index loaded
+     * @param id cell store number taken from the file name
+     * @param inherited true if the 'Files' column marks the store as
+     *        inherited from a split
+     */
+    void add_cell_store(CellStorePtr &cellstore, uint32_t id, bool inherited);
+
+    /**
+     * Compacts the immutable cache into a new cell store.  A major
+     * compaction merges in every cell store, a minor one merges whatever
+     * the compaction policy selects.  With flush_only set, only the
+     * immutable cache is written out, which is what a split needs before
+     * the cell stores can be shared with the split-off range.
+     */
+    void run_compaction(bool major, bool flush_only=false);
 
     int64_t get_earliest_cached_revision() {
       ScopedLock lock(m_mutex);
+      if (m_checkpoint_revision != TIMESTAMP_NULL)
+        return earliest_uncheckpointed_revision();
       return m_earliest_cached_revision;
     }
 
@@ -107,6 +128,25 @@ namespace Hypertable {
 
     bool needs_compaction() { return m_needs_compaction; }
 
+    void set_checkpoint_bit() { m_needs_checkpoint = true; }
+
+    bool needs_checkpoint() { return m_needs_checkpoint; }
+
+    /**
+     * Copies the cell cache into the checkpoint buffer.  Must be called with
+     * updates to the range blocked, so that every cell up to the highest
+     * revision copied is included.  Returns false if there is nothing to
+     * checkpoint or a compaction is in progress.
+     */
+    bool snapshot_checkpoint();
+
+    /**
+     * Writes the buffer filled by snapshot_checkpoint() to the checkpoint
+     * file.  Once it is in place, only commit log entries newer than the
+     * checkpoint pin the log for this access group.
+     */
+    void write_checkpoint();
+
     void initiate_compaction();
 
     bool compaction_initiated() {
@@ -132,18 +172,61 @@ namespace Hypertable {
 
     void drop() { m_drop = true; }
 
-    void get_file_list(String &file_list, bool include_blocked) {
-      m_file_tracker.get_file_list(file_list, include_blocked);
+    /**
+     * Marks the access group as no longer owned by this server.  The
+     * METADATA Files column is left alone from then on.
+     */
+    void relinquish() {
+      ScopedLock lock(m_mutex);
+      m_relinquished = true;
+    }
+
+    void get_file_list(String &file_list, bool include_blocked,
+                       bool all_inherited=false) {
+      m_file_tracker.get_file_list(file_list, include_blocked, all_inherited);
     }
 
     void release_files(const std::vector<String> &files);
 
-    void recovery_initialize() { m_recovering = true; }
+    /**
+     * Returns true if any of the cell stores is still shared with the
+     * other half of a split.
+     */
+    bool has_shared_stores();
+
+    /**
+     * Absorbs the access group of the adjacent lower range.  Its cell
+     * cache contents are copied, its cell stores are taken over as they
+     * are and its file references are transferred.  Both access groups
+     * must be quiescent, with updates and scans blocked, neither may have
+     * a compaction in progress and neither may hold cell stores inherited
+     * from a split, so that every store only holds rows of its range.
+     *
+     * @param low access group of the lower range
+     */
+    void merge(AccessGroup *low);
+
+    uint64_t get_compaction_bytes_written() {
+      ScopedLock lock(m_mutex);
+      return m_compaction_bytes_written;
+    }
+
+    void recovery_initialize() {
+      m_recovering = true;
+      load_checkpoint();
+    }
     void recovery_finalize() { m_recovering = false; }
 
   private:
     void update_files_column(const String &end_row, const String &file_list);
     void merge_caches();
+    void select_merge_stores(std::vector<size_t> &selected);
+    String get_range_dir();
+    bool is_shared_store(CellStorePtr &cellstore);
+    String get_checkpoint_file();
+    int64_t earliest_uncheckpointed_revision();
+    void load_checkpoint();
+    void remove_checkpoint();
 
     Mutex                m_mutex;
     TableIdentifierManaged m_identifier;
@@ -156,6 +239,7 @@ namespace Hypertable {
     String               m_end_row;
     String               m_range_name;
     std::vector<CellStorePtr> m_stores;
+    std::set<String>     m_inherited_stores;
     PropertiesPtr        m_cellstore_props;
     CellCachePtr         m_cell_cache;
     CellCachePtr         m_immutable_cache;
@@ -173,6 +257,18 @@ namespace Hypertable {
     LiveFileTracker      m_file_tracker;
     bool                 m_recovering;
     bool                 m_bloom_filter_disabled;
+    CompactionPolicyPtr  m_compaction_policy;
+    uint64_t             m_compaction_bytes_written;
+    boost::intrusive_ptr<AccessGroup> m_merged_into;
+    bool                 m_relinquished;
+    bool                 m_needs_checkpoint;
+    int64_t              m_checkpoint_revision;
+    int64_t              m_snapshot_revision;
+    int64_t              m_earliest_uncheckpointed_revision;
+    int64_t              m_earliest_uncheckpointed_revision_saved;
+    DynamicBuffer        m_checkpoint_buf;
+    uint32_t             m_checkpoint_entries;
+    int64_t              m_checkpoint_earliest_revision;
   };
   typedef boost::intrusive_ptr<AccessGroup> AccessGroupPtr;
 
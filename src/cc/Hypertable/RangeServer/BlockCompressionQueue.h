@@ -0,0 +1,83 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_BLOCKCOMPRESSIONQUEUE_H
+#define HYPERTABLE_BLOCKCOMPRESSIONQUEUE_H
+
+#include "Common/DynamicBuffer.h"
+#include "Common/Error.h"
+#include "Common/JobQueue.h"
+
+#include "Hypertable/Lib/BlockCompressionCodec.h"
+#include "Hypertable/Lib/BlockCompressionHeader.h"
+
+namespace Hypertable {
+
+  /**
+   * Pool of threads that compress cell store blocks.  A cell store being
+   * written hands each full block to the pool with add() and later
+   * collects the blocks, in file order, with wait().  A block that no
+   * worker has picked up by the time it is waited for is compressed by
+   * the waiting thread, so a writer never stalls behind other writers.
+   */
+  class BlockCompressionQueue : public JobQueue {
+
+  public:
+
+    /**
+     * A single block to compress.  The codec must not be shared with any
+     * other outstanding job.
+     */
+    class Job : public JobQueue::Job {
+    public:
+      Job(BlockCompressionCodec *c, const char *magic)
+        : codec(c), header(magic) { }
+      virtual void run() { codec->deflate(input, output, header); }
+      BlockCompressionCodec *codec;
+      BlockCompressionHeader header;
+      DynamicBuffer input;
+      DynamicBuffer output;
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param worker_count number of compressor threads to create
+     */
+    BlockCompressionQueue(int worker_count) : JobQueue(worker_count) { }
+
+    /**
+     * Waits for a job to complete, compressing it in the calling thread
+     * if no worker has claimed it yet.  Throws the error encountered
+     * while compressing, if any.
+     */
+    void wait(Job *job) {
+      JobQueue::wait(job);
+      if (job->error() != Error::OK)
+        HT_THROW(job->error(), job->error_msg());
+    }
+  };
+
+  typedef boost::intrusive_ptr<BlockCompressionQueue> BlockCompressionQueuePtr;
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_BLOCKCOMPRESSIONQUEUE_H
@@ -43,7 +43,8 @@ CellStoreScannerV0::CellStoreScannerV0(CellStorePtr &cellstore,
     m_index(m_cell_store_v0->m_index), m_check_for_range_end(false),
     m_readahead(true), m_close_fd_on_exit(false), m_fd(-1),
     m_start_offset(0), m_end_offset(0), m_returned(0), m_has_start_deletes(false),
-    m_has_start_row_delete(false), m_has_start_cf_delete(false) {
+    m_has_start_row_delete(false), m_has_start_cf_delete(false),
+    m_throttle(scan_ctx->throttle && Global::compaction_throttle) {
   int start_key_offset = -1, end_key_offset = -1;
   CellStoreV0::IndexMap::iterator start_iter;
   bool start_block_loaded = false;
@@ -779,6 +780,9 @@ bool CellStoreScannerV0::fetch_next_block_readahead() {
       m_block.zlength = (*it_next).second - m_block.offset;
     }
 
+    if (m_throttle)
+      Global::compaction_throttle->consume(m_block.zlength);
+
     try {
       DynamicBuffer buf(m_block.zlength);
       /** Read compressed block **/
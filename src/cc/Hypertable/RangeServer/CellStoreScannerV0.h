@@ -87,6 +87,7 @@ namespace Hypertable {
     bool                  m_has_start_deletes;
     bool                  m_has_start_row_delete;
     bool                  m_has_start_cf_delete;
+    bool                  m_throttle;
     Key                   m_start_deletes[2];
     DynamicBuffer         m_start_delete_buf;
     Key                   m_delete_search_keys[2];
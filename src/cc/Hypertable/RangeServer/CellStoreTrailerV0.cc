@@ -45,6 +45,10 @@ CellStoreTrailerV0::CellStoreTrailerV0() {
 /**
  */
 void CellStoreTrailerV0::clear() {
+  data_blocks = 0;
+  uncompressed_blocks = 0;
+  dictionary_offset = 0;
+  dictionary_length = 0;
   fix_index_offset = 0;
   var_index_offset = 0;
   filter_offset = 0;
@@ -67,6 +71,14 @@ void CellStoreTrailerV0::clear() {
  */
 void CellStoreTrailerV0::serialize(uint8_t *buf) {
   uint8_t *base = buf;
+  if (version >= 2) {
+    encode_i32(&buf, data_blocks);
+    encode_i32(&buf, uncompressed_blocks);
+  }
+  if (version >= 1) {
+    encode_i32(&buf, dictionary_offset);
+    encode_i32(&buf, dictionary_length);
+  }
   encode_i32(&buf, fix_index_offset);
   encode_i32(&buf, var_index_offset);
   encode_i32(&buf, filter_offset);
@@ -92,6 +104,14 @@ void CellStoreTrailerV0::serialize(uint8_t *buf) {
 void CellStoreTrailerV0::deserialize(const uint8_t *buf) {
   HT_TRY("deserializing cellstore trailer",
     size_t remaining = CellStoreTrailerV0::size();
+    if (version >= 2) {
+      data_blocks = decode_i32(&buf, &remaining);
+      uncompressed_blocks = decode_i32(&buf, &remaining);
+    }
+    if (version >= 1) {
+      dictionary_offset = decode_i32(&buf, &remaining);
+      dictionary_length = decode_i32(&buf, &remaining);
+    }
     fix_index_offset = decode_i32(&buf, &remaining);
     var_index_offset = decode_i32(&buf, &remaining);
     filter_offset = decode_i32(&buf, &remaining);
@@ -128,6 +148,14 @@ void CellStoreTrailerV0::display(std::ostream &os) {
   os << ", table_generation=" << table_generation;
   os << ", compression_ratio=" << compression_ratio;
   os << ", compression_type=" << compression_type;
+  if (version >= 1) {
+    os << ", dictionary_offset=" << dictionary_offset;
+    os << ", dictionary_length=" << dictionary_length;
+  }
+  if (version >= 2) {
+    os << ", data_blocks=" << data_blocks;
+    os << ", uncompressed_blocks=" << uncompressed_blocks;
+  }
   os << ", version=" << version << "}";
 }
 
@@ -32,11 +32,28 @@ namespace Hypertable {
     CellStoreTrailerV0();
     virtual ~CellStoreTrailerV0() { return; }
     virtual void clear();
-    virtual size_t size() { return 56; }
+    virtual size_t size() {
+      return version >= 2 ? 72 : (version == 1 ? 64 : 56);
+    }
     virtual void serialize(uint8_t *buf);
+
+    /**
+     * Deserializes the trailer.  Each version adds its fields in front of
+     * the ones of the previous version, so the caller has to set #version
+     * (from the last two bytes of the file) before calling this, to tell
+     * where the trailer starts.
+     *
+     * @param buf pointer to the first byte of the serialized trailer
+     */
     virtual void deserialize(const uint8_t *buf);
     virtual void display(std::ostream &os);
 
+    static const size_t MAX_SIZE = 72;
+
+    uint32_t  data_blocks;
+    uint32_t  uncompressed_blocks;
+    uint32_t  dictionary_offset;
+    uint32_t  dictionary_length;
     uint32_t  fix_index_offset;
     uint32_t  var_index_offset;
     uint32_t  filter_offset;
@@ -74,6 +91,10 @@ namespace Hypertable {
       else if (prop == "table_generation")      return table_generation;
       else if (prop == "compression_ratio")     return compression_ratio;
       else if (prop == "compression_type")      return compression_type;
+      else if (prop == "dictionary_offset")     return dictionary_offset;
+      else if (prop == "dictionary_length")     return dictionary_length;
+      else if (prop == "data_blocks")           return data_blocks;
+      else if (prop == "uncompressed_blocks")   return uncompressed_blocks;
       else                                      return boost::any();
     }
 
@@ -27,10 +27,12 @@
 
 #include "Common/Error.h"
 #include "Common/Logger.h"
+#include "Common/Serialization.h"
 #include "Common/System.h"
 
 #include "AsyncComm/Protocol.h"
 
+#include "Hypertable/Lib/BlockCompressionCodecNone.h"
 #include "Hypertable/Lib/BlockCompressionHeader.h"
 #include "Hypertable/Lib/CompressorFactory.h"
 #include "Hypertable/Lib/Key.h"
@@ -51,9 +53,12 @@ const char CellStoreV0::INDEX_FIXED_BLOCK_MAGIC[10]    =
     { 'I','d','x','F','i','x','-','-','-','-' };
 const char CellStoreV0::INDEX_VARIABLE_BLOCK_MAGIC[10] =
     { 'I','d','x','V','a','r','-','-','-','-' };
+const char CellStoreV0::DICTIONARY_BLOCK_MAGIC[10]     =
+    { 'D','i','c','t','-','-','-','-','-','-' };
 
 namespace {
   const uint32_t MAX_APPENDS_OUTSTANDING = 3;
+  const size_t DICTIONARY_SAMPLE_SIZE = 4096;
 }
 
 
@@ -62,8 +67,10 @@ CellStoreV0::CellStoreV0(Filesystem *filesys)
     m_fix_index_buffer(0), m_var_index_buffer(0), m_memory_consumed(0),
     m_outstanding_appends(0), m_offset(0), m_last_key(0), m_file_length(0),
     m_disk_usage(0), m_file_id(0), m_uncompressed_blocksize(0),
+    m_min_compression_gain(0),
+    m_dictionary(0), m_dictionary_samples(0), m_dictionary_sample_target(0),
     m_bloom_filter_mode(BLOOM_FILTER_DISABLED), m_bloom_filter(0),
-    m_bloom_filter_items(0) {
+    m_bloom_filter_items(0), m_throttle(false) {
 
   m_file_id = FileBlockCache::get_next_file_id();
   assert(sizeof(float) == 4);
@@ -71,8 +78,11 @@ CellStoreV0::CellStoreV0(Filesystem *filesys)
 
 
 CellStoreV0::~CellStoreV0() {
+  discard_pending_blocks();
   try {
     delete m_compressor;
+    foreach(BlockCompressionCodec *codec, m_spare_codecs)
+      delete codec;
 
     if (m_bloom_filter != 0) {
       delete m_bloom_filter;
@@ -92,8 +102,11 @@ CellStoreV0::~CellStoreV0() {
 
 
 BlockCompressionCodec *CellStoreV0::create_block_compression_codec() {
-  return CompressorFactory::create_block_codec(
+  BlockCompressionCodec *codec = CompressorFactory::create_block_codec(
       (BlockCompressionCodec::Type)m_trailer.compression_type);
+  if (m_dictionary.fill())
+    codec->set_dictionary(m_dictionary.base, m_dictionary.fill());
+  return codec;
 }
 
 
@@ -137,6 +150,9 @@ CellStoreV0::create(const char *fname, size_t max_entries,
 
   m_buffer.reserve(blocksize*4);
 
+  m_min_compression_gain = Config::get_f64("Hypertable.RangeServer.CellStore"
+                                           ".MinCompressionGain");
+
   m_max_entries = max_entries;
 
   m_fd = -1;
@@ -164,6 +180,13 @@ CellStoreV0::create(const char *fname, size_t max_entries,
       (BlockCompressionCodec::Type)m_trailer.compression_type,
       m_compressor_args);
 
+  /**
+   * Codecs that want a dictionary get one trained from the first
+   * blocks of this cell store
+   */
+  m_dictionary.clear();
+  m_dictionary_sample_target = 100 * m_compressor->get_dictionary_size();
+
   m_fd = m_filesys->create(m_filename, true, -1, -1, -1);
 
   m_bloom_filter_mode = props->get<BloomFilterMode>("bloom-filter-mode");
@@ -200,49 +223,203 @@ void CellStoreV0::create_bloom_filter(bool is_approx) {
 }
 
 
-void CellStoreV0::add(const Key &key, const ByteString value) {
+/**
+ * Appends a compressed data block to the file and records its index entry.
+ * Blocks must be written in key order.  A block that compressed by less
+ * than the minimum gain is stored uncompressed instead, so that reads
+ * don't pay for inflating it.
+ */
+void
+CellStoreV0::write_data_block(const SerializedKey last_key,
+    const DynamicBuffer &input, DynamicBuffer &zbuf,
+    BlockCompressionHeader &header) {
   EventPtr event_ptr;
-  DynamicBuffer zbuf;
 
-  if (key.revision > m_trailer.revision)
-    m_trailer.revision = key.revision;
+  if (header.get_compression_type() != BlockCompressionCodec::NONE &&
+      header.get_data_zlength()
+      > (1.0 - m_min_compression_gain) * input.fill()) {
+    BlockCompressionCodecNone none_codec((BlockCompressionCodec::Args()));
+    none_codec.deflate(input, zbuf, header);
+  }
 
-  if (m_buffer.fill() > m_uncompressed_blocksize) {
-    BlockCompressionHeader header(DATA_BLOCK_MAGIC);
+  m_trailer.data_blocks++;
+  if (header.get_compression_type() == BlockCompressionCodec::NONE)
+    m_trailer.uncompressed_blocks++;
 
-    add_index_entry(m_last_key, m_offset);
+  add_index_entry(last_key, m_offset);
 
-    m_uncompressed_data += (float)m_buffer.fill();
-    m_compressor->deflate(m_buffer, zbuf, header);
-    m_compressed_data += (float)zbuf.fill();
-    m_buffer.clear();
-
-    uint64_t llval = ((uint64_t)m_trailer.blocksize
-        * (uint64_t)m_uncompressed_data) / (uint64_t)m_compressed_data;
-    m_uncompressed_blocksize = (uint32_t)llval;
-
-    if (m_outstanding_appends >= MAX_APPENDS_OUTSTANDING) {
-      if (!m_sync_handler.wait_for_reply(event_ptr)) {
-        if (event_ptr->type == Event::MESSAGE)
-          HT_THROWF(Hypertable::Protocol::response_code(event_ptr),
-             "Problem writing to DFS file '%s' : %s", m_filename.c_str(),
-             Hypertable::Protocol::string_format_message(event_ptr).c_str());
-        HT_THROWF(event_ptr->error,
-                  "Problem writing to DFS file '%s'", m_filename.c_str());
-      }
-      m_outstanding_appends--;
+  m_uncompressed_data += (float)input.fill();
+  m_compressed_data += (float)zbuf.fill();
+
+  uint64_t llval = ((uint64_t)m_trailer.blocksize
+      * (uint64_t)m_uncompressed_data) / (uint64_t)m_compressed_data;
+  m_uncompressed_blocksize = (uint32_t)llval;
+
+  if (m_outstanding_appends >= MAX_APPENDS_OUTSTANDING) {
+    if (!m_sync_handler.wait_for_reply(event_ptr)) {
+      if (event_ptr->type == Event::MESSAGE)
+        HT_THROWF(Hypertable::Protocol::response_code(event_ptr),
+           "Problem writing to DFS file '%s' : %s", m_filename.c_str(),
+           Hypertable::Protocol::string_format_message(event_ptr).c_str());
+      HT_THROWF(event_ptr->error,
+                "Problem writing to DFS file '%s'", m_filename.c_str());
     }
+    m_outstanding_appends--;
+  }
+
+  size_t zlen = zbuf.fill();
+  StaticBuffer send_buf(zbuf);
+
+  if (m_throttle && Global::compaction_throttle)
+    Global::compaction_throttle->consume(zlen);
+
+  try { m_filesys->append(m_fd, send_buf, 0, &m_sync_handler); }
+  catch (Exception &e) {
+    HT_THROW2F(e.code(), e, "Problem writing to DFS file '%s'",
+               m_filename.c_str());
+  }
+  m_outstanding_appends++;
+  m_offset += zlen;
+}
+
+
+/**
+ * Hands the current block buffer to the block compression queue.  At most
+ * one block per compressor thread is kept in flight; beyond that, the
+ * oldest block is written out before returning.
+ */
+void CellStoreV0::queue_data_block() {
+  BlockCompressionCodec *codec;
+  PendingBlock *block;
+  uint8_t *base;
+  size_t len;
+
+  if (m_spare_codecs.empty()) {
+    codec = CompressorFactory::create_block_codec(
+        (BlockCompressionCodec::Type)m_trailer.compression_type,
+        m_compressor_args);
+    if (m_dictionary.fill())
+      codec->set_dictionary(m_dictionary.base, m_dictionary.fill());
+  }
+  else {
+    codec = m_spare_codecs.back();
+    m_spare_codecs.pop_back();
+  }
+
+  block = new PendingBlock(codec);
+
+  // hand the block buffer over to the job, m_last_key still points into it
+  base = m_buffer.release(&len);
+  block->input.base = base;
+  block->input.ptr = base + len;
+  block->input.size = len;
+  block->last_key = m_last_key;
+  m_buffer.reserve(m_trailer.blocksize*4);
+
+  m_pending_blocks.push_back(block);
+  Global::block_compression_queue->add(block);
+
+  while (m_pending_blocks.size() > Global::block_compression_queue->workers())
+    write_pending_block();
+}
+
+
+void CellStoreV0::write_pending_block() {
+  PendingBlock *block = m_pending_blocks.front();
+
+  Global::block_compression_queue->wait(block);
+
+  write_data_block(block->last_key, block->input, block->output,
+                   block->header);
+
+  m_pending_blocks.pop_front();
+  m_spare_codecs.push_back(block->codec);
+  delete block;
+}
+
+
+/**
+ * Waits for blocks that are still being compressed and throws them away.
+ * Used when the cell store is destroyed before it was finalized.
+ */
+void CellStoreV0::discard_pending_blocks() {
+  while (!m_pending_blocks.empty()) {
+    PendingBlock *block = m_pending_blocks.front();
+    try { Global::block_compression_queue->wait(block); }
+    catch (Exception &e) { }
+    m_pending_blocks.pop_front();
+    m_spare_codecs.push_back(block->codec);
+    delete block;
+  }
+}
+
+
+/**
+ * Copies the current block buffer into the dictionary training samples,
+ * cut into pieces about the size of a small block, and trains the
+ * dictionary once enough of them have been collected.
+ */
+void CellStoreV0::sample_data_block() {
+  size_t remaining = m_buffer.fill();
+
+  m_dictionary_samples.ensure(remaining);
+  m_dictionary_samples.add_unchecked(m_buffer.base, remaining);
+
+  while (remaining > 0) {
+    size_t len = std::min(remaining, DICTIONARY_SAMPLE_SIZE);
+    m_dictionary_sample_sizes.push_back(len);
+    remaining -= len;
+  }
+
+  if (m_dictionary_samples.fill() >= m_dictionary_sample_target)
+    train_dictionary();
+}
+
+
+/**
+ * Trains the compression dictionary from the collected samples and hands
+ * it to every codec.  Blocks already compressed without it stay readable,
+ * their frames do not reference a dictionary.
+ */
+void CellStoreV0::train_dictionary() {
+
+  if (m_compressor->train_dictionary(m_dictionary_samples,
+                                     m_dictionary_sample_sizes, m_dictionary)) {
+    // codecs that are busy compressing can't have their dictionary swapped
+    while (!m_pending_blocks.empty())
+      write_pending_block();
+
+    m_compressor->set_dictionary(m_dictionary.base, m_dictionary.fill());
+    foreach(BlockCompressionCodec *codec, m_spare_codecs)
+      codec->set_dictionary(m_dictionary.base, m_dictionary.fill());
 
-    size_t zlen = zbuf.fill();
-    StaticBuffer send_buf(zbuf);
+    HT_DEBUGF("Trained %lu byte compression dictionary for CellStore '%s'",
+              (Lu)m_dictionary.fill(), m_filename.c_str());
+  }
+
+  m_dictionary_sample_target = 0;
+  m_dictionary_samples.free();
+  m_dictionary_sample_sizes.clear();
+}
+
+
+void CellStoreV0::add(const Key &key, const ByteString value) {
+
+  if (key.revision > m_trailer.revision)
+    m_trailer.revision = key.revision;
 
-    try { m_filesys->append(m_fd, send_buf, 0, &m_sync_handler); }
-    catch (Exception &e) {
-      HT_THROW2F(e.code(), e, "Problem writing to DFS file '%s'",
-                 m_filename.c_str());
+  if (m_buffer.fill() > m_uncompressed_blocksize) {
+    if (m_dictionary_sample_target)
+      sample_data_block();
+    if (Global::block_compression_queue)
+      queue_data_block();
+    else {
+      BlockCompressionHeader header(DATA_BLOCK_MAGIC);
+      DynamicBuffer zbuf;
+      m_compressor->deflate(m_buffer, zbuf, header);
+      write_data_block(m_last_key, m_buffer, zbuf, header);
+      m_buffer.clear();
     }
-    m_outstanding_appends++;
-    m_offset += zlen;
   }
 
   size_t value_len = value.length();
@@ -280,7 +457,6 @@ void CellStoreV0::add(const Key &key, const ByteString value) {
 
 
 void CellStoreV0::finalize(TableIdentifier *table_identifier) {
-  EventPtr event_ptr;
   size_t zlen;
   DynamicBuffer zbuf(0);
   size_t len;
@@ -288,41 +464,30 @@ void CellStoreV0::finalize(TableIdentifier *table_identifier) {
   SerializedKey key;
   StaticBuffer send_buf;
 
+  while (!m_pending_blocks.empty())
+    write_pending_block();
+
   if (m_buffer.fill() > 0) {
     BlockCompressionHeader header(DATA_BLOCK_MAGIC);
-
-    add_index_entry(m_last_key, m_offset);
-
-    m_uncompressed_data += (float)m_buffer.fill();
     m_compressor->deflate(m_buffer, zbuf, header);
-    m_compressed_data += (float)zbuf.fill();
-
-    zlen = zbuf.fill();
-    send_buf = zbuf;
-
-    if (m_outstanding_appends >= MAX_APPENDS_OUTSTANDING) {
-      if (!m_sync_handler.wait_for_reply(event_ptr))
-        HT_THROWF(Protocol::response_code(event_ptr),
-                  "Problem finalizing CellStore file '%s' : %s",
-                  m_filename.c_str(),
-                  Protocol::string_format_message(event_ptr).c_str());
-      m_outstanding_appends--;
-    }
-
-    m_filesys->append(m_fd, send_buf, 0, &m_sync_handler);
-
-    m_outstanding_appends++;
-    m_offset += zlen;
+    write_data_block(m_last_key, m_buffer, zbuf, header);
   }
 
   m_buffer.free();
 
+  // too little data to be worth a dictionary
+  if (m_dictionary_sample_target) {
+    m_dictionary_sample_target = 0;
+    m_dictionary_samples.free();
+    m_dictionary_sample_sizes.clear();
+  }
+
   m_trailer.fix_index_offset = m_offset;
   if (m_uncompressed_data == 0)
     m_trailer.compression_ratio = 1.0;
   else
     m_trailer.compression_ratio = m_compressed_data / m_uncompressed_data;
-  m_trailer.version = 0;
+  m_trailer.version = 2;
 
   /**
    * Chop the Index buffers down to the exact length
@@ -387,6 +552,26 @@ void CellStoreV0::finalize(TableIdentifier *table_identifier) {
     m_offset += m_bloom_filter->size();
   }
 
+  /**
+   * Write dictionary, uncompressed since it's needed to inflate the rest
+   */
+  if (m_dictionary.fill()) {
+    BlockCompressionCodecNone none_codec((BlockCompressionCodec::Args()));
+    BlockCompressionHeader header(DICTIONARY_BLOCK_MAGIC);
+    none_codec.deflate(m_dictionary, zbuf, header);
+
+    zlen = zbuf.fill();
+    send_buf = zbuf;
+
+    m_filesys->append(m_fd, send_buf, 0, &m_sync_handler);
+
+    m_trailer.dictionary_offset = m_offset;
+    m_trailer.dictionary_length = zlen;
+
+    m_outstanding_appends++;
+    m_offset += zlen;
+  }
+
 
   /**
    * Set up m_index map
@@ -440,6 +625,7 @@ void CellStoreV0::finalize(TableIdentifier *table_identifier) {
   m_disk_usage = (uint32_t)m_file_length;
 
   m_memory_consumed = sizeof(CellStoreV0) + m_var_index_buffer.size
+      + m_dictionary.size
       + (m_index.size() * 2 * sizeof(IndexMap::value_type));
   if (m_bloom_filter)
     m_memory_consumed += m_bloom_filter->size();
@@ -489,27 +675,47 @@ CellStoreV0::open(const char *fname, const char *start_row,
   m_fd = m_filesys->open(m_filename);
 
   /**
-   * Read and deserialize trailer
+   * Read and deserialize trailer.  The version, in the last two bytes,
+   * determines how long the trailer is.
    */
   {
     uint32_t len;
-    uint8_t *trailer_buf = new uint8_t [m_trailer.size()];
+    size_t amount = CellStoreTrailerV0::MAX_SIZE;
+    const uint8_t *version_ptr;
+    size_t remaining = 2;
+
+    if (m_file_length < amount)
+      amount = m_file_length;
 
-    len = m_filesys->pread(m_fd, trailer_buf, m_trailer.size(),
-                           m_file_length - m_trailer.size());
+    uint8_t *trailer_buf = new uint8_t [amount];
 
-    if (len != m_trailer.size())
+    len = m_filesys->pread(m_fd, trailer_buf, amount,
+                           m_file_length - amount);
+
+    if (len != amount) {
+      delete [] trailer_buf;
       HT_THROWF(Error::DFSBROKER_IO_ERROR,
                 "Problem reading trailer for CellStore file '%s'"
                 " - only read %u of %lu bytes", m_filename.c_str(),
-                len, (Lu)m_trailer.size());
+                len, (Lu)amount);
+    }
+
+    version_ptr = trailer_buf + amount - 2;
+    m_trailer.version = Serialization::decode_i16(&version_ptr, &remaining);
 
-    m_trailer.deserialize(trailer_buf);
+    if (m_trailer.size() > amount) {
+      delete [] trailer_buf;
+      HT_THROWF(Error::RANGESERVER_CORRUPT_CELLSTORE,
+                "Bad length of CellStore file '%s' - %llu",
+                m_filename.c_str(), (Llu)m_file_length);
+    }
+
+    m_trailer.deserialize(trailer_buf + amount - m_trailer.size());
     delete [] trailer_buf;
   }
 
   /** Sanity check trailer **/
-  if (m_trailer.version != 0)
+  if (m_trailer.version > 2)
     HT_THROWF(Error::VERSION_MISMATCH,
               "Unsupported CellStore version (%d) for file '%s'",
               m_trailer.version, fname);
@@ -520,6 +726,15 @@ CellStoreV0::open(const char *fname, const char *start_row,
               "Bad index offsets in CellStore trailer fix=%u, var=%u, "
               "length=%llu, file='%s'", m_trailer.fix_index_offset,
               m_trailer.var_index_offset, (Llu)m_file_length, fname);
+
+  if (m_trailer.dictionary_length > 0 &&
+      !(m_trailer.filter_offset <= m_trailer.dictionary_offset &&
+        m_trailer.dictionary_offset + m_trailer.dictionary_length
+        == m_file_length - m_trailer.size()))
+    HT_THROWF(Error::RANGESERVER_CORRUPT_CELLSTORE,
+              "Bad dictionary offset in CellStore trailer dict=%u, len=%u, "
+              "length=%llu, file='%s'", m_trailer.dictionary_offset,
+              m_trailer.dictionary_length, (Llu)m_file_length, fname);
 }
 
 
@@ -532,6 +747,31 @@ void CellStoreV0::load_index() {
   SerializedKey key;
   bool inflating_fixed=true;
   bool second_try = false;
+  uint32_t filter_end = m_file_length - m_trailer.size();
+
+  /**
+   * Read the dictionary first, the index blocks were compressed with it
+   */
+  if (m_trailer.dictionary_length > 0) {
+    BlockCompressionCodecNone none_codec((BlockCompressionCodec::Args()));
+    DynamicBuffer buf(m_trailer.dictionary_length);
+
+    len = m_filesys->pread(m_fd, buf.ptr, m_trailer.dictionary_length,
+                           m_trailer.dictionary_offset);
+
+    if (len != m_trailer.dictionary_length)
+      HT_THROWF(Error::DFSBROKER_IO_ERROR, "Error loading dictionary for "
+                "CellStore '%s' : tried to read %d but only got %d",
+                m_filename.c_str(), m_trailer.dictionary_length, len);
+    buf.ptr += len;
+
+    none_codec.inflate(buf, m_dictionary, header);
+
+    if (!header.check_magic(DICTIONARY_BLOCK_MAGIC))
+      HT_THROW(Error::BLOCK_COMPRESSOR_BAD_MAGIC, m_filename);
+
+    filter_end = m_trailer.dictionary_offset;
+  }
 
   m_compressor = create_block_compression_codec();
 
@@ -627,7 +867,7 @@ void CellStoreV0::load_index() {
     m_bloom_filter = new BloomFilter(m_trailer.num_filter_items,
                                      m_trailer.filter_false_positive_prob);
 
-    amount = (m_file_length - m_trailer.size()) - m_trailer.filter_offset;
+    amount = filter_end - m_trailer.filter_offset;
     len = m_filesys->pread(m_fd, m_bloom_filter->ptr(), amount,
                              m_trailer.filter_offset);
 
@@ -638,7 +878,7 @@ void CellStoreV0::load_index() {
 
     }
   } else {
-    assert((m_file_length - m_trailer.size()) == m_trailer.filter_offset);
+    assert(filter_end == m_trailer.filter_offset);
   }
 
   /**
@@ -679,6 +919,7 @@ void CellStoreV0::load_index() {
   }
 
   m_memory_consumed = sizeof(CellStoreV0) + m_var_index_buffer.size
+    + m_dictionary.size
     + (m_index.size() * 2 * sizeof(IndexMap::value_type));
   if (m_bloom_filter)
     m_memory_consumed += m_bloom_filter->size();
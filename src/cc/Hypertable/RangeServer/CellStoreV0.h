@@ -22,6 +22,7 @@
 #ifndef HYPERTABLE_CELLSTOREV0_H
 #define HYPERTABLE_CELLSTOREV0_H
 
+#include <deque>
 #include <map>
 #include <string>
 #include <vector>
@@ -42,6 +43,7 @@
 #include "Hypertable/Lib/Filesystem.h"
 #include "Hypertable/Lib/SerializedKey.h"
 
+#include "BlockCompressionQueue.h"
 #include "CellStore.h"
 #include "CellStoreTrailerV0.h"
 
@@ -86,6 +88,12 @@ namespace Hypertable {
 
     BlockCompressionCodec *create_block_compression_codec();
 
+    /**
+     * Sends the blocks written by add() through the compaction throttle.
+     * Off by default.
+     */
+    void set_throttle(bool throttle) { m_throttle = throttle; }
+
     int32_t get_fd() {
       ScopedLock lock(m_mutex);
       return m_fd;
@@ -110,13 +118,35 @@ namespace Hypertable {
     virtual CellStoreTrailer *get_trailer() { return &m_trailer; }
 
   protected:
+
+    /**
+     * Data block handed to the block compression queue, along with the
+     * last key it contains, which becomes its index entry once the block
+     * is written out.
+     */
+    class PendingBlock : public BlockCompressionQueue::Job {
+    public:
+      PendingBlock(BlockCompressionCodec *codec)
+        : BlockCompressionQueue::Job(codec, DATA_BLOCK_MAGIC) { }
+      ByteString last_key;
+    };
+
     void add_index_entry(const SerializedKey key, uint32_t offset);
+    void write_data_block(const SerializedKey last_key,
+                          const DynamicBuffer &input, DynamicBuffer &zbuf,
+                          BlockCompressionHeader &header);
+    void queue_data_block();
+    void write_pending_block();
+    void discard_pending_blocks();
+    void sample_data_block();
+    void train_dictionary();
     void record_split_row(const SerializedKey key);
     void create_bloom_filter(bool is_approx = false);
 
     static const char DATA_BLOCK_MAGIC[10];
     static const char INDEX_FIXED_BLOCK_MAGIC[10];
     static const char INDEX_VARIABLE_BLOCK_MAGIC[10];
+    static const char DICTIONARY_BLOCK_MAGIC[10];
 
     typedef std::map<SerializedKey, uint32_t> IndexMap;
     typedef BlobHashSet<> BloomFilterItems;
@@ -143,13 +173,21 @@ namespace Hypertable {
     float                  m_uncompressed_data;
     float                  m_compressed_data;
     uint32_t               m_uncompressed_blocksize;
+    double                 m_min_compression_gain;
     BlockCompressionCodec::Args m_compressor_args;
+    std::deque<PendingBlock *> m_pending_blocks;
+    std::vector<BlockCompressionCodec *> m_spare_codecs;
     size_t                 m_max_entries;
+    DynamicBuffer          m_dictionary;
+    DynamicBuffer          m_dictionary_samples;
+    std::vector<size_t>    m_dictionary_sample_sizes;
+    size_t                 m_dictionary_sample_target;
 
     BloomFilterMode        m_bloom_filter_mode;
     BloomFilter           *m_bloom_filter;
     BloomFilterItems      *m_bloom_filter_items;
     uint32_t               m_max_approx_items;
+    bool                   m_throttle;
   };
 
   typedef intrusive_ptr<CellStoreV0> CellStoreV0Ptr;
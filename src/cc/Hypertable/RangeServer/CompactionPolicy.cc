@@ -0,0 +1,50 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "Common/Compat.h"
+#include "Common/Config.h"
+#include "Common/Error.h"
+
+#include "CompactionPolicy.h"
+#include "CompactionPolicyDefault.h"
+#include "CompactionPolicyLeveled.h"
+#include "CompactionPolicySizeTiered.h"
+
+using namespace Hypertable;
+using namespace Hypertable::Config;
+
+CompactionPolicy *CompactionPolicy::create(const String &name) {
+
+  if (name == "default" || name.empty())
+    return new CompactionPolicyDefault();
+
+  if (name == "size-tiered")
+    return new CompactionPolicySizeTiered(get_f64("Hypertable.RangeServer."
+        "AccessGroup.CompactionPolicy.SizeTiered.BucketRatio", 2.0));
+
+  if (name == "leveled")
+    return new CompactionPolicyLeveled(get_f64("Hypertable.RangeServer."
+        "AccessGroup.CompactionPolicy.Leveled.SizeRatio", 10.0));
+
+  HT_THROWF(Error::CONFIG_BAD_VALUE, "Unknown compaction policy '%s'",
+            name.c_str());
+}
@@ -0,0 +1,78 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_COMPACTIONPOLICY_H
+#define HYPERTABLE_COMPACTIONPOLICY_H
+
+#include <vector>
+
+#include "Common/ReferenceCount.h"
+#include "Common/String.h"
+
+namespace Hypertable {
+
+  /**
+   * Decides which cell stores of an access group get merged together
+   * during a merging compaction.
+   */
+  class CompactionPolicy : public ReferenceCount {
+  public:
+
+    /**
+     * Size and age of a cell store, as seen by the policy.
+     */
+    struct StoreInfo {
+      StoreInfo() : disk_usage(0), revision(0) { }
+      StoreInfo(uint64_t du, int64_t rev) : disk_usage(du), revision(rev) { }
+      uint64_t disk_usage;
+      int64_t  revision;
+    };
+
+    typedef std::vector<StoreInfo> StoreInfoVector;
+
+    virtual ~CompactionPolicy() { }
+
+    /**
+     * Selects the cell stores to merge.  The indices (into stores) of the
+     * selected stores are appended to selected.  If nothing is selected,
+     * no merging compaction is necessary.
+     *
+     * @param stores size and age of each cell store in the access group
+     * @param selected vector to receive indices of stores to merge
+     */
+    virtual void select(const StoreInfoVector &stores,
+                        std::vector<size_t> &selected) = 0;
+
+    virtual const char *get_name() = 0;
+
+    /**
+     * Constructs a policy by name.  Recognized names are "default",
+     * "size-tiered" and "leveled".  Throws Error::CONFIG_BAD_VALUE for
+     * anything else.
+     */
+    static CompactionPolicy *create(const String &name);
+  };
+
+  typedef intrusive_ptr<CompactionPolicy> CompactionPolicyPtr;
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_COMPACTIONPOLICY_H
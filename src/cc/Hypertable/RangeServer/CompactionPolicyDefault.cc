@@ -0,0 +1,59 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "Common/Compat.h"
+#include <algorithm>
+
+#include "CompactionPolicyDefault.h"
+#include "Global.h"
+
+using namespace Hypertable;
+
+namespace {
+  struct LtStoreSize {
+    LtStoreSize(const CompactionPolicy::StoreInfoVector &s) : stores(s) { }
+    bool operator()(size_t x, size_t y) const {
+      return stores[x].disk_usage < stores[y].disk_usage;
+    }
+    const CompactionPolicy::StoreInfoVector &stores;
+  };
+}
+
+void
+CompactionPolicyDefault::select(const StoreInfoVector &stores,
+                                std::vector<size_t> &selected) {
+  std::vector<size_t> order;
+
+  if (stores.size() <= (size_t)Global::access_group_max_files)
+    return;
+
+  for (size_t i=0; i<stores.size(); i++)
+    order.push_back(i);
+
+  sort(order.begin(), order.end(), LtStoreSize(stores));
+
+  size_t merge_count = std::min(order.size(),
+                                (size_t)Global::access_group_merge_files);
+
+  for (size_t i=0; i<merge_count; i++)
+    selected.push_back(order[i]);
+}
@@ -0,0 +1,82 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "Common/Compat.h"
+#include <algorithm>
+
+#include "CompactionPolicyLeveled.h"
+#include "Global.h"
+
+using namespace Hypertable;
+
+namespace {
+  struct GtStoreRevision {
+    GtStoreRevision(const CompactionPolicy::StoreInfoVector &s) : stores(s) { }
+    bool operator()(size_t x, size_t y) const {
+      return stores[x].revision > stores[y].revision;
+    }
+    const CompactionPolicy::StoreInfoVector &stores;
+  };
+}
+
+void
+CompactionPolicyLeveled::select(const StoreInfoVector &stores,
+                                std::vector<size_t> &selected) {
+  std::vector<size_t> order;
+  double newer_total = 0.0;
+  size_t merge_count = 0;
+
+  if (stores.size() < 2)
+    return;
+
+  for (size_t i=0; i<stores.size(); i++)
+    order.push_back(i);
+
+  // newest first
+  sort(order.begin(), order.end(), GtStoreRevision(stores));
+
+  /**
+   * Find the oldest level that is too small relative to everything newer
+   * than it; it and all newer levels get merged together
+   */
+  for (size_t i=0; i<order.size(); i++) {
+    double level_size = (double)stores[order[i]].disk_usage;
+    if (i > 0 && level_size < newer_total * m_size_ratio)
+      merge_count = i + 1;
+    newer_total += level_size;
+  }
+
+  /**
+   * Cap the number of files in the access group
+   */
+  if (merge_count < 2 && stores.size() > (size_t)Global::access_group_max_files)
+    merge_count = std::max(2, (int)Global::access_group_merge_files);
+
+  if (merge_count > order.size())
+    merge_count = order.size();
+
+  if (merge_count < 2)
+    return;
+
+  for (size_t i=0; i<merge_count; i++)
+    selected.push_back(order[i]);
+}
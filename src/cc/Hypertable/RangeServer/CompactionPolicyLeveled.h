@@ -0,0 +1,54 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#ifndef HYPERTABLE_COMPACTIONPOLICYLEVELED_H
+#define HYPERTABLE_COMPACTIONPOLICYLEVELED_H
+
+#include "CompactionPolicy.h"
+
+namespace Hypertable {
+
+  /**
+   * Leveled-style merging.  Cell stores are ordered from newest to oldest
+   * (by revision) and each one is treated as a level that should be at
+   * least size_ratio times larger than all newer levels combined.  The
+   * oldest level that violates that bound is merged together with all
+   * newer levels into a single cell store.  Older levels, which satisfy
+   * the bound, are not rewritten; the merged store simply becomes the
+   * newest level above them.  Level sizes therefore grow geometrically
+   * with age, which keeps the number of cell stores logarithmic in the
+   * access group size without rewriting the large levels on every merge.
+   */
+  class CompactionPolicyLeveled : public CompactionPolicy {
+  public:
+    CompactionPolicyLeveled(double size_ratio) : m_size_ratio(size_ratio) { }
+    virtual void select(const StoreInfoVector &stores,
+                        std::vector<size_t> &selected);
+    virtual const char *get_name() { return "leveled"; }
+
+  private:
+    double m_size_ratio;
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_COMPACTIONPOLICYLEVELED_H
@@ -0,0 +1,82 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "Common/Compat.h"
+#include <algorithm>
+
+#include "CompactionPolicySizeTiered.h"
+#include "Global.h"
+
+using namespace Hypertable;
+
+namespace {
+  struct LtStoreSize {
+    LtStoreSize(const CompactionPolicy::StoreInfoVector &s) : stores(s) { }
+    bool operator()(size_t x, size_t y) const {
+      return stores[x].disk_usage < stores[y].disk_usage;
+    }
+    const CompactionPolicy::StoreInfoVector &stores;
+  };
+}
+
+void
+CompactionPolicySizeTiered::select(const StoreInfoVector &stores,
+                                   std::vector<size_t> &selected) {
+  size_t min_files = std::max(2, (int)Global::access_group_merge_files);
+  size_t max_files = std::max((int)min_files,
+                              (int)Global::access_group_max_files);
+  std::vector<size_t> order;
+  size_t bucket_start = 0;
+
+  if (stores.size() < min_files)
+    return;
+
+  for (size_t i=0; i<stores.size(); i++)
+    order.push_back(i);
+
+  sort(order.begin(), order.end(), LtStoreSize(stores));
+
+  for (size_t i=1; i<=order.size(); i++) {
+    if (i < order.size()) {
+      double smallest = (double)stores[order[bucket_start]].disk_usage;
+      if ((double)stores[order[i]].disk_usage <= smallest * m_bucket_ratio)
+        continue;
+    }
+    // [bucket_start, i) is a bucket
+    if (i - bucket_start >= min_files) {
+      size_t end = std::min(i, bucket_start + max_files);
+      for (size_t j=bucket_start; j<end; j++)
+        selected.push_back(order[j]);
+      return;
+    }
+    bucket_start = i;
+  }
+
+  /**
+   * No bucket qualified, but the access group has too many files to
+   * scan efficiently, so fall back to merging the smallest ones
+   */
+  if (stores.size() > max_files) {
+    for (size_t j=0; j<min_files; j++)
+      selected.push_back(order[j]);
+  }
+}
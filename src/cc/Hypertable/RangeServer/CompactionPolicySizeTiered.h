@@ -0,0 +1,53 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#ifndef HYPERTABLE_COMPACTIONPOLICYSIZETIERED_H
+#define HYPERTABLE_COMPACTIONPOLICYSIZETIERED_H
+
+#include "CompactionPolicy.h"
+
+namespace Hypertable {
+
+  /**
+   * Size-tiered merging.  Cell stores are grouped into buckets of similar
+   * size (the largest store in a bucket is at most bucket_ratio times the
+   * smallest) and a bucket is merged once it holds
+   * Hypertable.RangeServer.AccessGroup.MergeFiles stores.  When several
+   * buckets qualify, the one with the smallest stores is chosen, since it
+   * is the cheapest to rewrite.  Large stores are therefore only rewritten
+   * when enough stores of comparable size have accumulated.
+   */
+  class CompactionPolicySizeTiered : public CompactionPolicy {
+  public:
+    CompactionPolicySizeTiered(double bucket_ratio)
+      : m_bucket_ratio(bucket_ratio) { }
+    virtual void select(const StoreInfoVector &stores,
+                        std::vector<size_t> &selected);
+    virtual const char *get_name() { return "size-tiered"; }
+
+  private:
+    double m_bucket_ratio;
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_COMPACTIONPOLICYSIZETIERED_H
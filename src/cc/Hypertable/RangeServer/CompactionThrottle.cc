@@ -0,0 +1,176 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+#include "Common/Time.h"
+
+extern "C" {
+#include <poll.h>
+}
+
+#include "CompactionThrottle.h"
+
+using namespace Hypertable;
+
+namespace {
+  const int32_t ADJUST_INTERVAL_MILLIS = 1000;
+  const double  LATENCY_DECAY = 0.5;
+  const int     LATENCY_BATCH = 1024;
+  // A single sample never exceeds MAX_SAMPLE_MICROS and the sum is drained
+  // as soon as it reaches SUM_DRAIN_MICROS, so the 32-bit atomic_t keeps
+  // more than a second's worth of headroom per concurrent caller
+  const int     MAX_SAMPLE_MICROS = 1000000;
+  const int     SUM_DRAIN_MICROS = 1 << 30;
+}
+
+
+CompactionThrottle::CompactionThrottle(int64_t max_rate, int64_t min_rate,
+                                       int32_t latency_target)
+  : m_max_rate((double)max_rate), m_min_rate((double)min_rate),
+    m_rate((double)max_rate), m_tokens((double)max_rate),
+    m_latency_target(latency_target), m_latency(0.0), m_bytes(0),
+    m_wait_millis(0) {
+  if (m_min_rate > m_max_rate)
+    m_min_rate = m_max_rate;
+  atomic_set(&m_latency_sum, 0);
+  atomic_set(&m_latency_count, 0);
+  boost::xtime_get(&m_last_refill, boost::TIME_UTC);
+  m_last_adjust = m_last_refill;
+}
+
+
+/**
+ * Assumes m_mutex is locked.  The bucket holds at most one second's worth
+ * of tokens.
+ */
+void CompactionThrottle::refill(boost::xtime &now) {
+  int64_t elapsed = xtime_diff_millis(m_last_refill, now);
+  if (elapsed > 0) {
+    m_tokens += m_rate * ((double)elapsed / 1000.0);
+    if (m_tokens > m_rate)
+      m_tokens = m_rate;
+    m_last_refill = now;
+  }
+}
+
+
+void CompactionThrottle::consume(size_t len) {
+  int wait_millis = 0;
+
+  {
+    ScopedLock lock(m_mutex);
+    boost::xtime now;
+
+    boost::xtime_get(&now, boost::TIME_UTC);
+    adjust(now, false);
+    refill(now);
+
+    m_bytes += len;
+    m_tokens -= (double)len;
+
+    // Callers go into debt, so concurrent compactions queue up fairly
+    if (m_tokens < 0.0) {
+      wait_millis = (int)((-m_tokens * 1000.0) / m_rate) + 1;
+      m_wait_millis += wait_millis;
+    }
+  }
+
+  if (wait_millis)
+    poll(0, 0, wait_millis);
+}
+
+
+void CompactionThrottle::record_foreground_latency(double millis) {
+  int micros = (int)(millis * 1000.0);
+
+  if (micros > MAX_SAMPLE_MICROS)
+    micros = MAX_SAMPLE_MICROS;
+
+  if (micros < 0)
+    micros = 0;
+
+  int sum = atomic_add_return(micros, &m_latency_sum);
+  if (atomic_inc_return(&m_latency_count) != LATENCY_BATCH &&
+      sum < SUM_DRAIN_MICROS)
+    return;
+
+  ScopedLock lock(m_mutex);
+  boost::xtime now;
+  boost::xtime_get(&now, boost::TIME_UTC);
+  adjust(now, true);
+}
+
+
+/**
+ * Assumes m_mutex is locked.  Folds the latencies accumulated since the
+ * last call into m_latency and, at most once per ADJUST_INTERVAL_MILLIS,
+ * moves the rate toward the latency target.  Unless force is set, nothing
+ * is done before the interval has passed.
+ */
+void CompactionThrottle::adjust(boost::xtime &now, bool force) {
+  bool interval_passed =
+      xtime_diff_millis(m_last_adjust, now) >= ADJUST_INTERVAL_MILLIS;
+
+  if (!force && !interval_passed)
+    return;
+
+  int count = atomic_read(&m_latency_count);
+  if (count > 0) {
+    int sum = atomic_read(&m_latency_sum);
+    atomic_sub(count, &m_latency_count);
+    atomic_sub(sum, &m_latency_sum);
+    double average = ((double)sum / 1000.0) / (double)count;
+    m_latency = (LATENCY_DECAY * m_latency) + ((1.0 - LATENCY_DECAY) * average);
+  }
+
+  if (m_latency_target == 0 || !interval_passed)
+    return;
+
+  m_last_adjust = now;
+  refill(now);
+
+  if (m_latency > (double)m_latency_target) {
+    if (m_rate > m_min_rate) {
+      m_rate /= 2.0;
+      if (m_rate < m_min_rate)
+        m_rate = m_min_rate;
+      HT_INFOF("Foreground latency %.1fms exceeds target %dms, compaction "
+               "rate lowered to %lld bytes/s", m_latency,
+               (int)m_latency_target, (Lld)m_rate);
+    }
+  }
+  else if (m_rate < m_max_rate) {
+    m_rate += m_max_rate / 20.0;
+    if (m_rate > m_max_rate)
+      m_rate = m_max_rate;
+  }
+}
+
+
+void CompactionThrottle::get_stats(Stats &stats) {
+  ScopedLock lock(m_mutex);
+  stats.rate = (int64_t)m_rate;
+  stats.bytes = m_bytes;
+  stats.wait_millis = m_wait_millis;
+  stats.latency_millis = m_latency;
+}
@@ -0,0 +1,109 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#ifndef HYPERTABLE_COMPACTIONTHROTTLE_H
+#define HYPERTABLE_COMPACTIONTHROTTLE_H
+
+#include <boost/thread/xtime.hpp>
+
+#include "Common/Mutex.h"
+#include "Common/ReferenceCount.h"
+#include "Common/atomic.h"
+
+namespace Hypertable {
+
+  /**
+   * Token bucket that limits the rate at which compactions read and write
+   * cell store data.  Compaction threads call consume() for every block
+   * they read or write and are put to sleep when the bucket runs dry.  If
+   * a latency target is configured, the rate adapts to foreground request
+   * latency reported through record_foreground_latency(): it is halved
+   * (down to the minimum rate) while latency exceeds the target and grows
+   * back linearly toward the maximum rate once latency recovers.
+   * Latencies are accumulated with atomic counters and folded into the
+   * controller under the mutex only once every LATENCY_BATCH requests, or
+   * by consume() once the adjust interval has passed.  Only merging and
+   * major compactions are throttled; minor compactions and compactions
+   * started while the server is over its memory limit are not.
+   */
+  class CompactionThrottle : public ReferenceCount {
+  public:
+
+    class Stats {
+    public:
+      Stats() : rate(0), bytes(0), wait_millis(0), latency_millis(0.0) { }
+      int64_t  rate;
+      uint64_t bytes;
+      uint64_t wait_millis;
+      double   latency_millis;
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param max_rate maximum compaction I/O rate in bytes per second
+     * @param min_rate rate floor used when backing off
+     * @param latency_target foreground latency target in milliseconds,
+     *        zero disables adaptation
+     */
+    CompactionThrottle(int64_t max_rate, int64_t min_rate,
+                       int32_t latency_target);
+
+    /**
+     * Takes len bytes worth of tokens from the bucket, sleeping for as
+     * long as it takes to refill the deficit.
+     */
+    void consume(size_t len);
+
+    /**
+     * Feeds the latency of a completed foreground request into the rate
+     * controller.  Does not take the mutex except for one call in every
+     * LATENCY_BATCH, or when the accumulated sum nears the atomic_t limit.
+     */
+    void record_foreground_latency(double millis);
+
+    void get_stats(Stats &stats);
+
+  private:
+    void refill(boost::xtime &now);
+    void adjust(boost::xtime &now, bool force);
+
+    Mutex        m_mutex;
+    double       m_max_rate;
+    double       m_min_rate;
+    double       m_rate;
+    double       m_tokens;
+    int32_t      m_latency_target;
+    double       m_latency;
+    atomic_t     m_latency_sum;
+    atomic_t     m_latency_count;
+    boost::xtime m_last_refill;
+    boost::xtime m_last_adjust;
+    uint64_t     m_bytes;
+    uint64_t     m_wait_millis;
+  };
+
+  typedef intrusive_ptr<CompactionThrottle> CompactionThrottlePtr;
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_COMPACTIONTHROTTLE_H
@@ -52,6 +52,9 @@ extern "C" {
 #include "RequestHandlerReplayUpdate.h"
 #include "RequestHandlerReplayCommit.h"
 #include "RequestHandlerDropRange.h"
+#include "RequestHandlerMergeRanges.h"
+#include "RequestHandlerRelinquishRange.h"
+#include "RequestHandlerReplayFragments.h"
 #include "RequestHandlerShutdown.h"
 
 #include "ConnectionHandler.h"
@@ -152,6 +155,18 @@ void ConnectionHandler::handle(EventPtr &event) {
         handler = new RequestHandlerDropRange(m_comm, m_range_server_ptr.get(),
                                               event);
         break;
+      case RangeServerProtocol::COMMAND_MERGE_RANGES:
+        handler = new RequestHandlerMergeRanges(m_comm,
+            m_range_server_ptr.get(), event);
+        break;
+      case RangeServerProtocol::COMMAND_RELINQUISH_RANGE:
+        handler = new RequestHandlerRelinquishRange(m_comm,
+            m_range_server_ptr.get(), event);
+        break;
+      case RangeServerProtocol::COMMAND_REPLAY_FRAGMENTS:
+        handler = new RequestHandlerReplayFragments(m_comm,
+            m_range_server_ptr.get(), event);
+        break;
       case RangeServerProtocol::COMMAND_STATUS:
         handler = new RequestHandlerStatus(m_comm, m_range_server_ptr.get(),
                                            event);
@@ -51,9 +51,17 @@ namespace Hypertable {
   FileBlockCache        *Global::block_cache = 0;
   TablePtr               Global::metadata_table = 0;
   int64_t                Global::range_metadata_max_bytes = 0;
+  int32_t                Global::range_split_load_rate = 0;
+  int64_t                Global::range_split_load_min_bytes = 0;
+  int32_t                Global::range_load_half_life = 60;
   MemoryTracker          Global::memory_tracker;
   int64_t                Global::log_prune_threshold_min = 0;
   int64_t                Global::log_prune_threshold_max = 0;
+  std::string            Global::checkpoint_dir = "";
+  bool                   Global::checkpoint_enabled = false;
+  int64_t                Global::checkpoint_max_memory = 0;
   int64_t                Global::memory_limit = 0;
   FailureInducer        *Global::failure_inducer = 0;
+  CompactionThrottlePtr  Global::compaction_throttle;
+  BlockCompressionQueuePtr Global::block_compression_queue;
 }
@@ -40,6 +40,8 @@
 #include "Hypertable/Lib/Client.h"
 #include "Hypertable/Lib/Types.h"
 
+#include "BlockCompressionQueue.h"
+#include "CompactionThrottle.h"
 #include "FileBlockCache.h"
 #include "MaintenanceQueue.h"
 #include "MemoryTracker.h"
@@ -72,11 +74,19 @@ namespace Hypertable {
     static Hypertable::FileBlockCache *block_cache;
     static TablePtr       metadata_table;
     static int64_t        range_metadata_max_bytes;
+    static int32_t        range_split_load_rate;
+    static int64_t        range_split_load_min_bytes;
+    static int32_t        range_load_half_life;
     static Hypertable::MemoryTracker memory_tracker;
     static int64_t        log_prune_threshold_min;
     static int64_t        log_prune_threshold_max;
+    static std::string    checkpoint_dir;
+    static bool           checkpoint_enabled;
+    static int64_t        checkpoint_max_memory;
     static int64_t        memory_limit;
     static Hypertable::FailureInducer *failure_inducer;
+    static Hypertable::CompactionThrottlePtr compaction_throttle;
+    static Hypertable::BlockCompressionQueuePtr block_compression_queue;
   };
 
 } // namespace Hypertable
@@ -20,6 +20,8 @@
  */
 #include "Common/Compat.h"
 
+#include <boost/algorithm/string.hpp>
+
 #include "Hypertable/Lib/Key.h"
 
 #include "LiveFileTracker.h"
@@ -73,6 +75,32 @@ void LiveFileTracker::remove_references(const std::vector<String> &filev) {
 }
 
 
+void LiveFileTracker::merge(LiveFileTracker &other) {
+  ScopedLock lock(m_mutex);
+  ScopedLock other_lock(other.m_mutex);
+  FileRefCountMap::iterator iter;
+
+  m_start_row = other.m_start_row;
+
+  foreach(const String &file, other.m_live)
+    m_live.insert(file);
+
+  foreach(const FileRefCountMap::value_type &v, other.m_referenced) {
+    iter = m_referenced.find(v.first);
+    if (iter == m_referenced.end())
+      m_referenced[v.first] = v.second;
+    else
+      (*iter).second += v.second;
+  }
+  other.m_referenced.clear();
+
+  foreach(const String &file, other.m_blocked)
+    m_blocked.insert(file);
+
+  m_need_update = true;
+}
+
+
 void LiveFileTracker::update_files_column() {
 
   if (!m_need_update)
@@ -86,6 +114,10 @@ void LiveFileTracker::update_files_column() {
   foreach(const String &file, m_live)
     file_list += file + ";\n";
 
+  foreach(const String &file, m_inherited)
+    if (m_live.count(file) > 0)
+      file_list += format("#+%s;\n", file.c_str());
+
   m_blocked.clear();
   foreach(const FileRefCountMap::value_type &v, m_referenced) {
     if (m_live.count(v.first) == 0) {
@@ -122,7 +154,8 @@ void LiveFileTracker::update_files_column() {
 }
 
 
-void LiveFileTracker::get_file_list(String &file_list, bool include_blocked) {
+void LiveFileTracker::get_file_list(String &file_list, bool include_blocked,
+                                    bool all_inherited) {
   ScopedLock lock(m_mutex);
 
   file_list = "";
@@ -130,6 +163,10 @@ void LiveFileTracker::get_file_list(String &file_list, bool include_blocked) {
   foreach(const String &file, m_live)
     file_list += file + ";\n";
 
+  foreach(const String &file, m_live)
+    if (all_inherited || m_inherited.count(file) > 0)
+      file_list += format("#+%s;\n", file.c_str());
+
   if (include_blocked) {
     m_blocked.clear();
     foreach(const FileRefCountMap::value_type &v, m_referenced) {
@@ -143,3 +180,35 @@ void LiveFileTracker::get_file_list(String &file_list, bool include_blocked) {
 }
 
 
+bool LiveFileTracker::parse_file_list(const String &file_list,
+                                      std::vector<String> &live,
+                                      std::set<String> &inherited) {
+  const char *base, *ptr, *end;
+  String file_str;
+  bool blocked = false;
+
+  ptr = base = file_list.c_str();
+  end = base + file_list.length();
+  while (ptr < end) {
+
+    while (*ptr != ';' && ptr < end)
+      ptr++;
+
+    file_str = String(base, ptr-base);
+    boost::trim(file_str);
+
+    if (file_str[0] == '#') {
+      if (file_str[1] == '+')
+        inherited.insert(file_str.substr(2));
+      else
+        blocked = true;
+    }
+    else if (file_str != "")
+      live.push_back(file_str);
+
+    ++ptr;
+    base = ptr;
+  }
+
+  return blocked;
+}
@@ -71,6 +71,20 @@ namespace Hypertable {
       m_need_update = true;
     }
 
+    /**
+     * Replaces the set of live files that were inherited from a split and
+     * still hold rows of the other half.  They are marked as such in the
+     * 'Files' column so that a reload knows about them without having to
+     * look into the files.  Does not set the m_need_update flag, the
+     * caller either wrote the markers already or changes the live set too.
+     *
+     * @param files names of the inherited files
+     */
+    void set_inherited(const std::set<String> &files) {
+      ScopedLock lock(m_mutex);
+      m_inherited = files;
+    }
+
     /**
      * Adds a set of files to the referenced file set.  If they already
      * exist in the referenced file set, then their reference count is
@@ -89,6 +103,16 @@ namespace Hypertable {
      */
     void remove_references(const std::vector<String> &filev);
 
+    /**
+     * Takes over the live and referenced files of the tracker of the
+     * adjacent lower range when the two ranges are merged, and extends
+     * the start row to that of the lower range.  Sets the m_need_update
+     * flag to true.
+     *
+     * @param other tracker of the range being merged in
+     */
+    void merge(LiveFileTracker &other);
+
 
     /**
      * Updates the 'Files' METADATA column if it needs updating.
@@ -99,12 +123,32 @@ namespace Hypertable {
      * Returns '\n' separated list of files, suitable for writing into
      * the 'Files' column of METADATA.  If include_blocked is set to true,
      * then the files that are currently blocked from GC are included in
-     * the list, prefixed by the '#' character
+     * the list, prefixed by the '#' character.  Live files inherited from
+     * a split are listed a second time, prefixed by "#+".  If all_inherited
+     * is set to true, every live file is marked that way, which is what
+     * both halves of a split write before shrinking.
      *
      * @param file_list reference to output string to hold file list
      * @param include_blocked include commented out files blocked from GC
+     * @param all_inherited mark every live file as inherited
+     */
+    void get_file_list(String &file_list, bool include_blocked,
+                       bool all_inherited=false);
+
+    /**
+     * Parses the contents of a 'Files' column as written by
+     * get_file_list() or update_files_column().  Entries commented out
+     * with '#' are skipped, except that "#+" entries add the file to the
+     * inherited set.
+     *
+     * @param file_list contents of the 'Files' column
+     * @param live vector to receive the live files, in order
+     * @param inherited set to receive the files inherited from a split
+     * @return true if the list holds files blocked from GC
      */
-    void get_file_list(String &file_list, bool include_blocked);
+    static bool parse_file_list(const String &file_list,
+                                std::vector<String> &live,
+                                std::set<String> &inherited);
 
   private:
     Mutex            m_mutex;
@@ -117,6 +161,7 @@ namespace Hypertable {
     FileRefCountMap  m_referenced;
     std::set<String> m_live;
     std::set<String> m_blocked;
+    std::set<String> m_inherited;
     bool             m_need_update;
     bool             m_is_root;
   };
@@ -0,0 +1,155 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "Common/Compat.h"
+#include "Common/Time.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Global.h"
+#include "LoadTracker.h"
+
+using namespace Hypertable;
+
+
+LoadTracker::LoadTracker() : m_reads(0.0), m_writes(0.0), m_next_sample(0) {
+  atomic_set(&m_write_cells, 0);
+  boost::xtime_get(&m_last_decay, boost::TIME_UTC);
+}
+
+
+/**
+ * Assumes m_mutex is locked.  Decayed counts converge to rate * half_life /
+ * ln(2) under a steady request rate, which is what get_rates() divides by.
+ */
+void LoadTracker::decay(boost::xtime &now) {
+  int64_t elapsed = xtime_diff_millis(m_last_decay, now);
+  if (elapsed > 0) {
+    double factor = pow(0.5, (double)elapsed /
+                        (1000.0 * (double)Global::range_load_half_life));
+    m_reads *= factor;
+    m_writes *= factor;
+    m_last_decay = now;
+  }
+}
+
+
+/**
+ * Assumes m_mutex is locked.
+ */
+void LoadTracker::add_sample(const char *row) {
+  if (m_samples.size() < MAX_SAMPLES)
+    m_samples.push_back(row);
+  else {
+    m_samples[m_next_sample] = row;
+    m_next_sample = (m_next_sample + 1) % MAX_SAMPLES;
+  }
+}
+
+
+void LoadTracker::record_read(const char *row) {
+  ScopedLock lock(m_mutex);
+  boost::xtime now;
+
+  boost::xtime_get(&now, boost::TIME_UTC);
+  decay(now);
+  m_reads += 1.0;
+  if (row)
+    add_sample(row);
+}
+
+
+void LoadTracker::record_write() {
+  ScopedLock lock(m_mutex);
+  boost::xtime now;
+
+  boost::xtime_get(&now, boost::TIME_UTC);
+  decay(now);
+  m_writes += 1.0;
+}
+
+
+void LoadTracker::sample_write_row(const char *row) {
+  if ((uint32_t)atomic_inc_return(&m_write_cells) % WRITE_SAMPLE_INTERVAL)
+    return;
+  ScopedLock lock(m_mutex);
+  add_sample(row);
+}
+
+
+void LoadTracker::get_rates(double *read_ratep, double *write_ratep) {
+  ScopedLock lock(m_mutex);
+  boost::xtime now;
+  double scale = log(2.0) / (double)Global::range_load_half_life;
+
+  boost::xtime_get(&now, boost::TIME_UTC);
+  decay(now);
+  *read_ratep = m_reads * scale;
+  *write_ratep = m_writes * scale;
+}
+
+
+bool LoadTracker::get_split_row(const String &start_row,
+                                const String &end_row, String &split_row) {
+  std::vector<String> rows;
+
+  {
+    ScopedLock lock(m_mutex);
+    foreach(const String &row, m_samples) {
+      if (row > start_row && row < end_row)
+        rows.push_back(row);
+    }
+  }
+
+  if (rows.size() < MIN_SPLIT_SAMPLES)
+    return false;
+
+  sort(rows.begin(), rows.end());
+
+  /**
+   * The split row ends the lower half.  If the median is the highest
+   * sampled row, the upper half would get none of the sampled load, so
+   * back off to the highest row below it.  Load that all lands on a single
+   * row can't be divided.
+   */
+  size_t i = rows.size() / 2;
+  if (rows[i] == rows.back()) {
+    while (i > 0 && rows[i] == rows.back())
+      i--;
+    if (rows[i] == rows.back())
+      return false;
+  }
+
+  split_row = rows[i];
+  return true;
+}
+
+
+void LoadTracker::reset() {
+  ScopedLock lock(m_mutex);
+  m_reads = 0.0;
+  m_writes = 0.0;
+  m_samples.clear();
+  m_next_sample = 0;
+  atomic_set(&m_write_cells, 0);
+}
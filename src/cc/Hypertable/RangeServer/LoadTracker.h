@@ -0,0 +1,105 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#ifndef HYPERTABLE_LOADTRACKER_H
+#define HYPERTABLE_LOADTRACKER_H
+
+#include <vector>
+
+#include <boost/thread/xtime.hpp>
+
+#include "Common/Mutex.h"
+#include "Common/String.h"
+#include "Common/atomic.h"
+
+namespace Hypertable {
+
+  /**
+   * Tracks the request load of a range.  Read and write requests are
+   * counted with exponential decay, so the reported rates follow the
+   * recent past with the configured half-life.  The rows touched by
+   * requests are sampled into a fixed size ring so that a split row can
+   * be chosen that divides the load, rather than the data, in two.
+   */
+  class LoadTracker {
+  public:
+    LoadTracker();
+
+    /**
+     * Records one read request (scan block) that returned row as its
+     * first row.
+     */
+    void record_read(const char *row);
+
+    /**
+     * Records one write request
+     */
+    void record_write();
+
+    /**
+     * Samples the row of a cell that has been written by a client.  Only
+     * every WRITE_SAMPLE_INTERVAL-th call is kept, and only those take the
+     * mutex.
+     */
+    void sample_write_row(const char *row);
+
+    /**
+     * Returns the decayed read and write request rates (requests/second)
+     */
+    void get_rates(double *read_ratep, double *write_ratep);
+
+    /**
+     * Chooses the row that splits the sampled accesses in half.
+     *
+     * @param start_row start row of the range (exclusive)
+     * @param end_row end row of the range (inclusive)
+     * @param split_row filled in with the split row
+     * @return true if enough samples fell strictly inside the range
+     */
+    bool get_split_row(const String &start_row, const String &end_row,
+                       String &split_row);
+
+    /**
+     * Forgets the rates and samples, called after the range has split
+     */
+    void reset();
+
+    static const size_t MAX_SAMPLES = 512;
+    static const size_t MIN_SPLIT_SAMPLES = 32;
+    static const uint32_t WRITE_SAMPLE_INTERVAL = 16;
+
+  private:
+    void decay(boost::xtime &now);
+    void add_sample(const char *row);
+
+    Mutex        m_mutex;
+    double       m_reads;
+    double       m_writes;
+    boost::xtime m_last_decay;
+    std::vector<String> m_samples;
+    size_t       m_next_sample;
+    atomic_t     m_write_cells;
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_LOADTRACKER_H
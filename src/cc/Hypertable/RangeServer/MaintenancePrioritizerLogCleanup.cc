@@ -88,6 +88,7 @@ MaintenancePrioritizerLogCleanup::assign_priorities(RangeStatsVector &stats,
   CommitLog::CumulativeSizeMap::iterator iter;
   AccessGroup::MaintenanceData *ag_data;
   int state, disk_total;
+  bool checkpoint_needed;
 
   log->load_cumulative_size_map(cumulative_size_map);
   
@@ -107,6 +108,7 @@ MaintenancePrioritizerLogCleanup::assign_priorities(RangeStatsVector &stats,
     }
 
     disk_total = 0;
+    checkpoint_needed = false;
 
     for (ag_data = stats[i]->agdata; ag_data; ag_data = ag_data->next) {
 
@@ -115,6 +117,13 @@ MaintenancePrioritizerLogCleanup::assign_priorities(RangeStatsVector &stats,
         ag_data->ag->set_compaction_bit();
       }
 
+      if (ag_data->merge_needed) {
+        trace_str += String("STAT ") + ag_data->ag->get_full_name()
+          + " merge needed\n";
+        stats[i]->priority = 1;
+        ag_data->ag->set_compaction_bit();
+      }
+
       disk_total += ag_data->disk_used;
 
       if (ag_data->earliest_cached_revision == TIMESTAMP_NULL ||
@@ -145,6 +154,19 @@ MaintenancePrioritizerLogCleanup::assign_priorities(RangeStatsVector &stats,
         trace_str += String("STAT ") + ag_data->ag->get_full_name()+" cumulative_size "
           + (*iter).second.cumulative_size + " > prune_threshold " + prune_threshold + "\n";
 
+        /**
+         * A checkpoint releases the log just as well, without adding a
+         * small cell store, as long as the cache is not too big to copy
+         */
+        if (Global::checkpoint_enabled && ag_data->mem_used > 0 &&
+            ag_data->mem_used <= Global::checkpoint_max_memory) {
+          trace_str += String("STAT ") + ag_data->ag->get_full_name()
+            + " checkpoint needed\n";
+          ag_data->ag->set_checkpoint_bit();
+          checkpoint_needed = true;
+          continue;
+        }
+
         if (ag_data->mem_used > 0)
           ag_data->ag->set_compaction_bit();
 
@@ -156,12 +178,26 @@ MaintenancePrioritizerLogCleanup::assign_priorities(RangeStatsVector &stats,
           + (*iter).second.cumulative_size + " <= prune_threshold " + prune_threshold + "\n";
     }
 
+    if (checkpoint_needed && stats[i]->priority == 0)
+      stats[i]->priority = 4;
+
     if (!stats[i]->range->is_root() && disk_total >= Global::range_max_bytes) {
       HT_INFOF("Adding maintenance for range %s because dist_total %d exceeds %d",
                stats[i]->range->get_name().c_str(), (int)disk_total, (int)Global::range_max_bytes);
       stats[i]->priority = 2;
       stats[i]->split_needed = true;
     }
+    else if (Global::range_split_load_rate > 0 && stats[i]->table_id != 0 &&
+             disk_total >= Global::range_split_load_min_bytes &&
+             stats[i]->read_rate + stats[i]->write_rate >=
+             (double)Global::range_split_load_rate) {
+      HT_INFOF("Adding maintenance for range %s because request rate "
+               "%.1f/s exceeds %d/s", stats[i]->range->get_name().c_str(),
+               stats[i]->read_rate + stats[i]->write_rate,
+               (int)Global::range_split_load_rate);
+      stats[i]->priority = 2;
+      stats[i]->split_needed = true;
+    }
   }
 
 }
@@ -26,6 +26,7 @@
 #include "Global.h"
 #include "MaintenancePrioritizerLogCleanup.h"
 #include "MaintenanceScheduler.h"
+#include "MaintenanceTaskCheckpoint.h"
 #include "MaintenanceTaskCompaction.h"
 
 using namespace Hypertable;
@@ -140,6 +141,10 @@ void MaintenanceScheduler::schedule() {
         RangePtr range(range_data[i]->range);
         Global::maintenance_queue->add(new MaintenanceTaskSplit(schedule_time, range));
       }
+      else if (range_data[i]->priority == 4) {
+        RangePtr range(range_data[i]->range);
+        Global::maintenance_queue->add(new MaintenanceTaskCheckpoint(schedule_time, range));
+      }
     }
 
   }
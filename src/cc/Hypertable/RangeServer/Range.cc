@@ -57,7 +57,8 @@ Range::Range(MasterClientPtr &master_client,
     : m_bytes_read(0), m_bytes_written(0), m_master_client(master_client),
       m_identifier(*identifier), m_schema(schema), m_revision(0),
       m_latest_revision(TIMESTAMP_NULL), m_split_off_high(false),
-      m_added_inserts(0), m_range_set(range_set), m_state(*state),
+      m_apply_next_ticket(0), m_apply_serving(0), m_added_inserts(0),
+      m_range_set(range_set), m_state(*state),
       m_error(Error::OK), m_dropped(false) {
   AccessGroup *ag;
 
@@ -178,18 +179,17 @@ void Range::load_cell_stores(Metadata *metadata) {
   AccessGroup *ag;
   CellStorePtr cellstore;
   uint32_t csid;
-  const char *base, *ptr, *end;
   std::vector<String> csvec;
+  std::set<String> inherited;
   String ag_name;
   String files;
-  String file_str;
   bool need_update;
 
   metadata->reset_files_scan();
 
   while (metadata->get_next_files(ag_name, files)) {
     csvec.clear();
-    need_update = false;
+    inherited.clear();
 
     if ((ag = m_access_group_map[ag_name]) == 0) {
       HT_ERRORF("Unrecognized access group name '%s' found in METADATA for "
@@ -197,29 +197,7 @@ void Range::load_cell_stores(Metadata *metadata) {
       HT_ABORT;
     }
 
-    ptr = base = (const char *)files.c_str();
-    end = base + strlen(base);
-    while (ptr < end) {
-
-      while (*ptr != ';' && ptr < end)
-        ptr++;
-
-      file_str = String(base, ptr-base);
-      boost::trim(file_str);
-
-      if (file_str[0] == '#') {
-        ++ptr;
-        base = ptr;
-        need_update = true;
-        continue;
-      }
-
-      if (file_str != "")
-        csvec.push_back(file_str);
-
-      ++ptr;
-      base = ptr;
-    }
+    need_update = LiveFileTracker::parse_file_list(files, csvec, inherited);
 
     files = "";
 
@@ -243,7 +221,7 @@ void Range::load_cell_stores(Metadata *metadata) {
       if (cellstore->get_revision() > m_latest_revision)
         m_latest_revision = cellstore->get_revision();
 
-      ag->add_cell_store(cellstore, csid);
+      ag->add_cell_store(cellstore, csid, inherited.count(csvec[i]) > 0);
     }
 
     /** this causes startup deadlock ..
@@ -339,12 +317,26 @@ bool Range::need_maintenance() {
         disk_total >= (int64_t)Global::range_metadata_max_bytes)
       needed = true;
   }
-  else if (disk_total >= Global::range_max_bytes)
+  else if (disk_total >= Global::range_max_bytes ||
+           split_load_exceeded(disk_total))
     needed = true;
   return needed;
 }
 
 
+bool Range::split_load_exceeded(int64_t disk_total) {
+  double read_rate, write_rate;
+
+  if (Global::range_split_load_rate <= 0 || m_identifier.id == 0 ||
+      disk_total < Global::range_split_load_min_bytes)
+    return false;
+
+  m_load_tracker.get_rates(&read_rate, &write_rate);
+
+  return read_rate + write_rate >= (double)Global::range_split_load_rate;
+}
+
+
 bool Range::cancel_maintenance() {
   return m_dropped ? true : false;
 }
@@ -365,6 +357,7 @@ Range::MaintenanceData *Range::get_maintenance_data(ByteArena &arena) {
   mdata->table_id = m_identifier.id;
   mdata->bytes_read = m_bytes_read;
   mdata->bytes_written = m_bytes_written;
+  m_load_tracker.get_rates(&mdata->read_rate, &mdata->write_rate);
 
   for (size_t i=0; i<ag_vector.size(); i++) {
     if (mdata->agdata == 0) {
@@ -392,6 +385,9 @@ void Range::split() {
 
   HT_ASSERT(!m_is_root);
 
+  if (cancel_maintenance())
+    return;
+
   try {
 
     switch (m_state.state) {
@@ -419,20 +415,19 @@ void Range::split() {
 
 
 
-/**
- */
-void Range::split_install_log() {
-  std::vector<String> split_rows;
-  char md5DigestStr[33];
-  AccessGroupVector  ag_vector(0);
+bool Range::select_split_row_by_load() {
+  ScopedLock lock(m_mutex);
+  String split_row;
 
-  {
-    ScopedLock lock(m_schema_mutex);
-    ag_vector = m_access_group_vector;
-  }
+  if (!m_load_tracker.get_split_row(m_start_row, m_end_row, split_row))
+    return false;
+  m_split_row = split_row;
+  return true;
+}
 
-  if (cancel_maintenance())
-    HT_THROW(Error::CANCELLED, "");
+
+void Range::select_split_row_by_size(AccessGroupVector &ag_vector) {
+  std::vector<String> split_rows;
 
   for (size_t i=0; i<ag_vector.size(); i++)
     ag_vector[i]->get_split_rows(split_rows, false);
@@ -492,6 +487,34 @@ void Range::split_install_log() {
               "(c) Unable to determine split row for range %s[%s..%s]",
               m_identifier.name, m_start_row.c_str(), m_end_row.c_str());
   }
+}
+
+
+/**
+ */
+void Range::split_install_log() {
+  char md5DigestStr[33];
+  AccessGroupVector  ag_vector(0);
+
+  {
+    ScopedLock lock(m_schema_mutex);
+    ag_vector = m_access_group_vector;
+  }
+
+  if (cancel_maintenance())
+    HT_THROW(Error::CANCELLED, "");
+
+  /**
+   * If the range is hot, split it where the sampled accesses divide in
+   * half, so that the two halves can be served by different servers.
+   * Otherwise split it in the middle of its data.
+   */
+  if (split_load_exceeded((int64_t)disk_usage()) &&
+      select_split_row_by_load())
+    HT_INFOF("Splitting %s on load, split row '%s'", m_name.c_str(),
+             m_split_row.c_str());
+  else
+    select_split_row_by_size(ag_vector);
 
   m_state.set_split_point(m_split_row);
 
@@ -572,12 +595,14 @@ void Range::split_compact_and_shrink() {
     HT_THROW(Error::CANCELLED, "");
 
   /**
-   * Perform major compactions
+   * Flush the cell caches.  The existing cell stores are not rewritten,
+   * both halves keep referencing them, restricted to their own row
+   * interval, until a later compaction replaces them.
    */
   {
     for (size_t i=0; i<ag_vector.size(); i++)
       if (ag_vector[i]->compaction_initiated())
-        ag_vector[i]->run_compaction(true);
+        ag_vector[i]->run_compaction(false, true);
   }
 
   try {
@@ -602,7 +627,7 @@ void Range::split_compact_and_shrink() {
       for (size_t i=0; i<ag_vector.size(); i++) {
         key.column_qualifier = ag_vector[i]->get_name();
         key.column_qualifier_len = strlen(ag_vector[i]->get_name());
-        ag_vector[i]->get_file_list(files, false);
+        ag_vector[i]->get_file_list(files, false, true);
         if (files != "")
           mutator->set(key, (uint8_t *)files.c_str(), files.length());
       }
@@ -623,7 +648,7 @@ void Range::split_compact_and_shrink() {
     for (size_t i=0; i<ag_vector.size(); i++) {
       key.column_qualifier = ag_vector[i]->get_name();
       key.column_qualifier_len = strlen(ag_vector[i]->get_name());
-      ag_vector[i]->get_file_list(files, m_split_off_high);
+      ag_vector[i]->get_file_list(files, m_split_off_high, true);
       if (files != "")
         mutator->set(key, (uint8_t *)files.c_str(), files.length());
     }
@@ -671,6 +696,9 @@ void Range::split_compact_and_shrink() {
       for (size_t i=0; i<ag_vector.size(); i++)
         ag_vector[i]->shrink(split_row, m_split_off_high);
 
+      // the load measured so far was for the whole range
+      m_load_tracker.reset();
+
       // Close and uninstall split log
       if ((error = m_split_log->close()) != Error::OK) {
         HT_ERRORF("Problem closing split log '%s' - %s",
@@ -802,9 +830,304 @@ void Range::split_notify_master() {
 }
 
 
+void Range::merge(RangePtr &low) {
+  RangeMaintenanceGuard::Activator activator(m_maintenance_guard);
+  RangeMaintenanceGuard::Activator low_activator(low->m_maintenance_guard);
+  AccessGroupVector ag_vector(0);
+  AccessGroupVector low_ag_vector(0);
+  String low_start_row, low_end_row;
+
+  HT_ASSERT(!m_is_root);
+
+  if (cancel_maintenance() || low->cancel_maintenance())
+    HT_THROW(Error::CANCELLED, "");
+
+  if (m_state.state != RangeState::STEADY ||
+      low->m_state.state != RangeState::STEADY)
+    HT_THROWF(Error::RANGESERVER_RANGE_BUSY, "Unable to merge %s into %s, "
+              "split in progress", low->get_name().c_str(), get_name().c_str());
+
+  {
+    ScopedLock lock(m_schema_mutex);
+    ScopedLock low_lock(low->m_schema_mutex);
+    if (m_schema->get_generation() != low->m_schema->get_generation())
+      HT_THROWF(Error::RANGESERVER_GENERATION_MISMATCH, "Unable to merge %s "
+                "into %s, schema generation mismatch (%d != %d)",
+                low->get_name().c_str(), get_name().c_str(),
+                (int)low->m_schema->get_generation(),
+                (int)m_schema->get_generation());
+    ag_vector = m_access_group_vector;
+    low_ag_vector = low->m_access_group_vector;
+  }
+
+  HT_ASSERT(ag_vector.size() == low_ag_vector.size());
+
+  {
+    ScopedLock lock(low->m_mutex);
+    low_start_row = low->m_start_row;
+    low_end_row = low->m_end_row;
+  }
+
+  if (low_end_row != start_row())
+    HT_THROWF(Error::RANGESERVER_RANGE_NOT_FOUND, "Unable to merge %s into "
+              "%s, ranges are not adjacent", low->get_name().c_str(),
+              get_name().c_str());
+
+  /**
+   * Cell stores inherited from a split hold rows outside of their range.
+   * Carried into the merged range's Files column, they would be loaded
+   * restricted to the merged interval after a restart and bring back rows
+   * that have since been deleted or rewritten.  Have them rewritten first.
+   */
+  bool inherited = false;
+  for (size_t i=0; i<ag_vector.size(); i++) {
+    if (ag_vector[i]->has_shared_stores()) {
+      ag_vector[i]->set_compaction_bit();
+      inherited = true;
+    }
+    if (low_ag_vector[i]->has_shared_stores()) {
+      low_ag_vector[i]->set_compaction_bit();
+      inherited = true;
+    }
+  }
+  if (inherited)
+    HT_THROWF(Error::RANGESERVER_RANGE_BUSY, "Unable to merge %s into %s, "
+              "cell stores inherited from a split not yet rewritten",
+              low->get_name().c_str(), get_name().c_str());
+
+  HT_INFOF("Merging %s into %s", low->get_name().c_str(), get_name().c_str());
+
+  /**
+   * Flush the cell caches of both ranges so that all of the data being
+   * carried over is referenced from the Files column
+   */
+  {
+    Barrier::ScopedActivator block_updates(m_update_barrier);
+    Barrier::ScopedActivator block_low_updates(low->m_update_barrier);
+    for (size_t i=0; i<ag_vector.size(); i++) {
+      ag_vector[i]->initiate_compaction();
+      low_ag_vector[i]->initiate_compaction();
+    }
+  }
+
+  for (size_t i=0; i<ag_vector.size(); i++) {
+    ag_vector[i]->run_compaction(false, true);
+    low_ag_vector[i]->run_compaction(false, true);
+  }
+
+  /**
+   * Extend the METADATA entry of this range to cover both ranges.  The
+   * entry of the lower range is removed only after the merge has been
+   * recorded in the range server meta log, so that a failure in between
+   * leaves two overlapping entries rather than a hole.
+   */
+  try {
+    String files, low_files;
+    String metadata_key_str;
+    KeySpec key;
+
+    TableMutatorPtr mutator = Global::metadata_table->create_mutator();
+
+    metadata_key_str = format("%u:%s", m_identifier.id, m_end_row.c_str());
+    key.row = metadata_key_str.c_str();
+    key.row_len = metadata_key_str.length();
+    key.column_qualifier = 0;
+    key.column_qualifier_len = 0;
+    key.column_family = "StartRow";
+    mutator->set(key, low_start_row.c_str(), low_start_row.length());
+
+    key.column_family = "Files";
+    for (size_t i=0; i<ag_vector.size(); i++) {
+      key.column_qualifier = ag_vector[i]->get_name();
+      key.column_qualifier_len = strlen(ag_vector[i]->get_name());
+      ag_vector[i]->get_file_list(files, true);
+      low_ag_vector[i]->get_file_list(low_files, true);
+      files += low_files;
+      if (files != "")
+        mutator->set(key, (uint8_t *)files.c_str(), files.length());
+    }
+
+    mutator->flush();
+  }
+  catch (Hypertable::Exception &e) {
+    HT_ERROR_OUT << "Problem updating METADATA for merge of "
+        << low->get_name() << " into " << get_name() << " - " << e << HT_END;
+    throw;
+  }
+
+  /**
+   * Absorb the lower range
+   */
+  {
+    Barrier::ScopedActivator block_updates(m_update_barrier);
+    Barrier::ScopedActivator block_scans(m_scan_barrier);
+    Barrier::ScopedActivator block_low_updates(low->m_update_barrier);
+    Barrier::ScopedActivator block_low_scans(low->m_scan_barrier);
+
+    {
+      ScopedLock lock(m_mutex);
+      ScopedLock low_lock(low->m_mutex);
+
+      m_start_row = low->m_start_row;
+      m_name = String(m_identifier.name) + "[" + m_start_row + ".."
+          + m_end_row + "]";
+
+      for (size_t i=0; i<ag_vector.size(); i++)
+        ag_vector[i]->merge(low_ag_vector[i].get());
+
+      if (low->m_latest_revision > m_latest_revision)
+        m_latest_revision = low->m_latest_revision;
+      m_added_inserts += low->m_added_inserts;
+      for (size_t i=0; i<3; i++)
+        m_added_deletes[i] += low->m_added_deletes[i];
+      m_bytes_read += low->m_bytes_read;
+      m_bytes_written += low->m_bytes_written;
+    }
+
+    HT_ASSERT(m_range_set->remove(low_end_row));
+
+    // Updaters blocked on the lower range see that its row interval has
+    // changed and look their rows up again
+    {
+      ScopedLock low_lock(low->m_mutex);
+      low->m_start_row = low->m_end_row;
+      low->m_dropped = true;
+    }
+  }
+
+  for (int i=0; true; i++) {
+    try {
+      Global::range_log->log_range_merged(m_identifier,
+          RangeSpec(m_start_row.c_str(), m_end_row.c_str()), m_state);
+      break;
+    }
+    catch (Exception &e) {
+      if (i<3) {
+        HT_ERRORF("%s - %s", Error::get_text(e.code()), e.what());
+        poll(0, 0, 5000);
+        continue;
+      }
+      HT_ERRORF("Problem writing RANGE_MERGED meta log entry for %s",
+                m_name.c_str());
+      HT_FATAL_OUT << e << HT_END;
+    }
+  }
+
+  try {
+    String metadata_key_str;
+    KeySpec key;
+
+    TableMutatorPtr mutator = Global::metadata_table->create_mutator();
+
+    metadata_key_str = format("%u:%s", m_identifier.id, low_end_row.c_str());
+    key.row = metadata_key_str.c_str();
+    key.row_len = metadata_key_str.length();
+    key.column_family = 0;
+    key.column_qualifier = 0;
+    key.column_qualifier_len = 0;
+    mutator->set_delete(key);
+    mutator->flush();
+  }
+  catch (Hypertable::Exception &e) {
+    HT_ERROR_OUT << "Problem removing METADATA entry of merged range "
+        << low_end_row << " - " << e << HT_END;
+  }
+
+  HT_INFOF("Merge Complete.  New Range %s", get_name().c_str());
+}
+
+
+void Range::relinquish() {
+  RangeMaintenanceGuard::Activator activator(m_maintenance_guard);
+  AccessGroupVector ag_vector(0);
+  String start_row, end_row;
+
+  HT_ASSERT(!m_is_root);
+
+  if (cancel_maintenance())
+    HT_THROW(Error::CANCELLED, "");
+
+  if (m_state.state != RangeState::STEADY)
+    HT_THROWF(Error::RANGESERVER_RANGE_BUSY, "Unable to relinquish %s, "
+              "split in progress", get_name().c_str());
+
+  {
+    ScopedLock lock(m_schema_mutex);
+    ag_vector = m_access_group_vector;
+  }
+
+  {
+    ScopedLock lock(m_mutex);
+    start_row = m_start_row;
+    end_row = m_end_row;
+  }
+
+  RangeSpec range_spec(start_row.c_str(), end_row.c_str());
+
+  Global::range_log->log_move_start(m_identifier, range_spec, m_state);
+
+  /**
+   * Flush the bulk of the cell caches while still taking updates
+   */
+  {
+    Barrier::ScopedActivator block_updates(m_update_barrier);
+    for (size_t i=0; i<ag_vector.size(); i++)
+      ag_vector[i]->initiate_compaction();
+  }
+
+  for (size_t i=0; i<ag_vector.size(); i++)
+    ag_vector[i]->run_compaction(false, true);
+
+  Global::range_log->log_move_prepared(m_identifier, range_spec);
+
+  /**
+   * Cut off updates and flush what has arrived in the meantime
+   */
+  {
+    Barrier::ScopedActivator block_updates(m_update_barrier);
+
+    HT_ASSERT(m_range_set->remove(end_row));
+
+    // Updaters blocked on this range see that its row interval has
+    // changed and look their rows up again
+    ScopedLock lock(m_mutex);
+    m_start_row = m_end_row;
+    m_dropped = true;
+    for (size_t i=0; i<ag_vector.size(); i++)
+      ag_vector[i]->initiate_compaction();
+  }
+
+  /**
+   * Until the move is logged as done the range is still ours, so any
+   * failure puts its row interval back for the caller to reinstate it
+   */
+  try {
+    for (size_t i=0; i<ag_vector.size(); i++)
+      ag_vector[i]->run_compaction(false, true);
+
+    Global::range_log->log_move_done(m_identifier, range_spec);
+  }
+  catch (...) {
+    ScopedLock lock(m_mutex);
+    m_start_row = start_row;
+    m_dropped = false;
+    throw;
+  }
+
+  for (size_t i=0; i<ag_vector.size(); i++)
+    ag_vector[i]->relinquish();
+
+  HT_INFOF("Relinquished range %s", get_name().c_str());
+}
+
+
 void Range::compact(bool major) {
   RangeMaintenanceGuard::Activator activator(m_maintenance_guard);
 
+  // dropped or merged into its neighbour since being scheduled
+  if (cancel_maintenance())
+    return;
+
   try {
     run_compaction(major);
   }
@@ -817,6 +1140,50 @@ void Range::compact(bool major) {
 }
 
 
+void Range::checkpoint() {
+  RangeMaintenanceGuard::Activator activator(m_maintenance_guard);
+  AccessGroupVector ag_vector(0);
+  std::vector<bool> snapshotted;
+
+  // dropped or merged into its neighbour since being scheduled
+  if (cancel_maintenance())
+    return;
+
+  {
+    ScopedLock lock(m_schema_mutex);
+    ag_vector = m_access_group_vector;
+  }
+
+  {
+    Barrier::ScopedActivator block_updates(m_update_barrier);
+    ScopedLock lock(m_mutex);
+    for (size_t i=0; i<ag_vector.size(); i++)
+      snapshotted.push_back(ag_vector[i]->needs_checkpoint() &&
+                            ag_vector[i]->snapshot_checkpoint());
+  }
+
+  // a failure in one access group should not leave the others unwritten
+  int error = Error::OK;
+  String error_msg;
+  for (size_t i=0; i<ag_vector.size(); i++) {
+    if (!snapshotted[i])
+      continue;
+    try {
+      ag_vector[i]->write_checkpoint();
+    }
+    catch (Exception &e) {
+      if (error == Error::OK) {
+        error = e.code();
+        error_msg = e.what();
+      }
+    }
+  }
+
+  if (error != Error::OK)
+    HT_THROW(error, error_msg);
+}
+
+
 void Range::run_compaction(bool major) {
   AccessGroupVector  ag_vector(0);
 
@@ -872,6 +1239,7 @@ void Range::get_statistics(RangeStat *stat) {
   uint64_t cached = 0;
   uint64_t disk_usage = 0;
   uint64_t memory_usage = 0;
+  uint64_t compaction_bytes = 0;
 
   stat->added_inserts = m_added_inserts;
   stat->added_deletes[0] = m_added_deletes[0];
@@ -883,12 +1251,23 @@ void Range::get_statistics(RangeStat *stat) {
     cached += m_access_group_vector[i]->get_cached_count();
     disk_usage += m_access_group_vector[i]->disk_usage();
     memory_usage += m_access_group_vector[i]->memory_usage();
+    compaction_bytes +=
+        m_access_group_vector[i]->get_compaction_bytes_written();
   }
 
   stat->collided_cells = collisions;
   stat->cached_cells = cached;
   stat->disk_usage = disk_usage;
   stat->memory_usage = memory_usage;
+  stat->bytes_written = m_bytes_written;
+  stat->compaction_bytes_written = compaction_bytes;
+
+  {
+    double read_rate, write_rate;
+    m_load_tracker.get_rates(&read_rate, &write_rate);
+    stat->read_rate = (uint64_t)(read_rate + 0.5);
+    stat->write_rate = (uint64_t)(write_rate + 0.5);
+  }
 
 
 
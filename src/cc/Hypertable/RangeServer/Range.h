@@ -25,6 +25,8 @@
 #include <map>
 #include <vector>
 
+#include <boost/thread/condition.hpp>
+
 #include "Common/Barrier.h"
 #include "Common/String.h"
 
@@ -39,6 +41,7 @@
 
 #include "AccessGroup.h"
 #include "CellStore.h"
+#include "LoadTracker.h"
 #include "Metadata.h"
 #include "RangeMaintenanceGuard.h"
 #include "RangeSet.h"
@@ -49,6 +52,9 @@ namespace Hypertable {
   /**
    * Represents a table row range.
    */
+  class Range;
+  typedef intrusive_ptr<Range> RangePtr;
+
   class Range : public CellList {
 
   public:
@@ -63,6 +69,8 @@ namespace Hypertable {
       int32_t  priority;
       bool     busy;
       bool     split_needed;
+      double   read_rate;
+      double   write_rate;
     };
 
     typedef std::map<String, AccessGroup *> AccessGroupMap;
@@ -121,6 +129,34 @@ namespace Hypertable {
 
     void compact(bool major=false);
 
+    /**
+     * Checkpoints the cell caches of the access groups that have their
+     * checkpoint bit set, as an alternative to compacting them when all they
+     * do is pin the commit log.
+     */
+    void checkpoint();
+
+    /**
+     * Merges the adjacent lower range into this one.  The cell caches of
+     * both ranges are flushed, the METADATA entry of this range is
+     * extended to cover both, and the access groups of the lower range
+     * are absorbed.  The lower range is marked as dropped and removed from
+     * the range set.  If either range still holds cell stores inherited
+     * from a split, those access groups are flagged for compaction, which
+     * rewrites them, and RANGESERVER_RANGE_BUSY is thrown.
+     *
+     * @param low range whose end row is this range's start row
+     */
+    void merge(RangePtr &low);
+
+    /**
+     * Prepares the range to be loaded by another server.  The cell caches
+     * are flushed, updates are cut off, and the range is removed from the
+     * range set.  On failure the range is left with its original row
+     * interval so that the caller can put it back into service.
+     */
+    void relinquish();
+
     void recovery_initialize() {
       ScopedLock lock(m_mutex);
       for (size_t i=0; i<m_access_group_vector.size(); i++)
@@ -136,6 +172,33 @@ namespace Hypertable {
       m_update_barrier.exit();
     }
 
+    /**
+     * Reserves this range's slot in the update apply order.  Must be
+     * called while the commit log write for the update is serialized
+     * (i.e. under the RangeServer update mutex) so that tickets are handed
+     * out in revision order.
+     */
+    uint64_t acquire_apply_ticket() {
+      ScopedLock lock(m_apply_mutex);
+      return m_apply_next_ticket++;
+    }
+
+    /**
+     * Blocks until all updates holding an earlier apply ticket have been
+     * applied to this range.
+     */
+    void enter_apply(uint64_t ticket) {
+      ScopedLock lock(m_apply_mutex);
+      while (m_apply_serving != ticket)
+        m_apply_cond.wait(lock);
+    }
+
+    void exit_apply() {
+      ScopedLock lock(m_apply_mutex);
+      m_apply_serving++;
+      m_apply_cond.notify_all();
+    }
+
     void increment_scan_counter() {
       m_scan_barrier.enter();
     }
@@ -166,6 +229,33 @@ namespace Hypertable {
       m_bytes_written += n;
     }
 
+    /**
+     * Counts a read request against the range's load.  If row is
+     * non-NULL it is sampled for load-based split row selection.
+     */
+    void record_read(const char *row) {
+      m_load_tracker.record_read(row);
+    }
+
+    void record_write() {
+      m_load_tracker.record_write();
+    }
+
+    /**
+     * Samples the row of a cell written by a client for load-based split
+     * row selection.  Not called for cells replayed from commit logs.
+     */
+    void sample_write_row(const char *row) {
+      m_load_tracker.sample_write_row(row);
+    }
+
+    /**
+     * Returns true if load-based splitting is enabled and the decayed
+     * request rate of this range, which holds at least disk_total bytes,
+     * exceeds Hypertable.RangeServer.Range.SplitLoad.Rate
+     */
+    bool split_load_exceeded(int64_t disk_total);
+
     uint64_t get_size_limit() { return m_state.soft_limit; }
 
     bool need_maintenance();
@@ -198,6 +288,9 @@ namespace Hypertable {
 
     bool cancel_maintenance();
 
+    bool select_split_row_by_load();
+    void select_split_row_by_size(AccessGroupVector &ag_vector);
+
     void split_install_log();
     void split_compact_and_shrink();
     void split_notify_master();
@@ -225,6 +318,10 @@ namespace Hypertable {
     bool             m_split_off_high;
     Barrier          m_update_barrier;
     Barrier          m_scan_barrier;
+    Mutex            m_apply_mutex;
+    boost::condition m_apply_cond;
+    uint64_t         m_apply_next_ticket;
+    uint64_t         m_apply_serving;
     bool             m_is_root;
     uint64_t         m_added_deletes[3];
     uint64_t         m_added_inserts;
@@ -232,10 +329,9 @@ namespace Hypertable {
     RangeStateManaged m_state;
     int32_t          m_error;
     bool             m_dropped;
+    LoadTracker      m_load_tracker;
   };
 
-  typedef intrusive_ptr<Range> RangePtr;
-
 } // namespace Hypertable
 
 #endif // HYPERTABLE_RANGE_H
@@ -22,6 +22,7 @@
 #include "Common/Compat.h"
 #include <algorithm>
 #include <cassert>
+#include <map>
 
 extern "C" {
 #include <math.h>
@@ -31,17 +32,25 @@ extern "C" {
 
 #include "Common/FileUtils.h"
 #include "Common/md5.h"
+#include "Common/Stopwatch.h"
 #include "Common/StringExt.h"
 #include "Common/SystemInfo.h"
 
+#include "Hypertable/Lib/BlockCompressionHeader.h"
+#include "Hypertable/Lib/CommPayloadCodec.h"
 #include "Hypertable/Lib/CommitLog.h"
 #include "Hypertable/Lib/Defaults.h"
 #include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/LocationCache.h"
 #include "Hypertable/Lib/Stat.h"
 #include "Hypertable/Lib/RangeServerMetaLogReader.h"
 #include "Hypertable/Lib/RangeServerMetaLogEntries.h"
+#include "Hypertable/Lib/RangeServerClient.h"
 #include "Hypertable/Lib/RangeServerProtocol.h"
 
+#include "AsyncComm/DispatchHandlerSynchronizer.h"
+#include "AsyncComm/ReactorFactory.h"
+
 #include "DfsBroker/Lib/Client.h"
 
 #include "FillScanBlock.h"
@@ -54,6 +63,7 @@ extern "C" {
 #include "RangeServer.h"
 #include "RangeStatsGatherer.h"
 #include "ScanContext.h"
+#include "UpdateApplyQueue.h"
 
 using namespace std;
 using namespace Hypertable;
@@ -68,22 +78,38 @@ RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_mgr,
 
   uint16_t port;
   uint32_t maintenance_threads = std::min(2, System::cpu_info().total_cores);
+  uint32_t apply_threads = std::min(8, System::cpu_info().total_cores);
+  uint32_t compressor_threads = std::min(4, System::cpu_info().total_cores);
   Comm *comm = conn_mgr->get_comm();
   SubProperties cfg(props, "Hypertable.RangeServer.");
 
   m_verbose = props->get_bool("verbose");
+  CommPayloadCodec::install(props);
   Global::range_metadata_max_bytes = cfg.get_i64("Range.MetadataMaxBytes", 0);
   Global::range_max_bytes = cfg.get_i64("Range.MaxBytes");
+  Global::range_split_load_rate = cfg.get_i32("Range.SplitLoad.Rate");
+  Global::range_split_load_min_bytes = cfg.get_i64("Range.SplitLoad.MinBytes");
+  Global::range_load_half_life = cfg.get_i32("Range.SplitLoad.HalfLife");
   Global::access_group_max_files = cfg.get_i32("AccessGroup.MaxFiles");
   Global::access_group_merge_files = cfg.get_i32("AccessGroup.MergeFiles");
   Global::access_group_max_mem = cfg.get_i64("AccessGroup.MaxMemory");
   maintenance_threads = cfg.get_i32("MaintenanceThreads", maintenance_threads);
+  apply_threads = cfg.get_i32("UpdateApplyThreads", apply_threads);
+  m_replay_inflate_threads = cfg.get_i32("Replay.InflateThreads",
+      std::min(4, System::cpu_info().total_cores));
+  m_replay_read_ahead = cfg.get_i32("Replay.ReadAhead");
+  m_replay_batch_size = cfg.get_i64("Replay.BatchSize");
+  compressor_threads = cfg.get_i32("CellStore.CompressorThreads",
+                                   compressor_threads);
   port = cfg.get_i16("Port");
   m_scanner_ttl = (time_t)cfg.get_i32("Scanner.Ttl");
 
   if (Global::access_group_merge_files > Global::access_group_max_files)
     Global::access_group_merge_files = Global::access_group_max_files;
 
+  if (Global::range_load_half_life <= 0)
+    Global::range_load_half_life = 1;
+
   if (m_scanner_ttl < (time_t)10000) {
     HT_WARNF("Value %u for Hypertable.RangeServer.Scanner.ttl is too small, "
              "setting to 10000", (unsigned int)m_scanner_ttl);
@@ -101,6 +127,24 @@ RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_mgr,
 
   m_update_delay = cfg.get_i32("UpdateDelay", 0);
 
+  int64_t throttle_max_rate = cfg.get_i64("Maintenance.Throttle.MaxRate");
+  if (throttle_max_rate > 0) {
+    int64_t throttle_min_rate = cfg.get_i64("Maintenance.Throttle.MinRate");
+    int32_t latency_target = cfg.get_i32("Maintenance.Throttle.LatencyTarget");
+    if (throttle_min_rate > throttle_max_rate)
+      throttle_min_rate = throttle_max_rate;
+    Global::compaction_throttle =
+        new CompactionThrottle(throttle_max_rate, throttle_min_rate,
+                               latency_target);
+    HT_INFOF("Compaction throttle max_rate=%lld min_rate=%lld "
+             "latency_target=%d", (Lld)throttle_max_rate,
+             (Lld)throttle_min_rate, (int)latency_target);
+  }
+
+  if (!cfg.get_bool("Checksum.Crc32c"))
+    BlockCompressionHeader::set_default_checksum_type(
+        BlockCompressionHeader::CHECKSUM_FLETCHER32);
+
   uint64_t block_cacheMemory = cfg.get_i64("BlockCache.MaxMemory");
   Global::block_cache = new FileBlockCache(block_cacheMemory);
 
@@ -143,9 +187,28 @@ RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_mgr,
 
   Global::location = addr.format('_');
 
+  /**
+   * Cell cache checkpoints are kept next to the commit logs, keyed by range
+   * rather than by server, so that whichever server recovers a range finds
+   * its checkpoint
+   */
+  Global::checkpoint_dir = cfg.get_str("Checkpoint.Dir");
+  Global::checkpoint_enabled = cfg.get_bool("Checkpoint.Enable");
+  Global::checkpoint_max_memory = cfg.get_i64("Checkpoint.MaxMemory");
+  if (Global::checkpoint_enabled)
+    Global::log_dfs->mkdirs(Global::checkpoint_dir);
+
   // Create the maintenance queue
   Global::maintenance_queue = new MaintenanceQueue(maintenance_threads);
 
+  // Create the pool that applies update batches to the cell caches
+  m_apply_queue = new UpdateApplyQueue(apply_threads);
+
+  // Create the pool that compresses cell store blocks
+  if (compressor_threads > 0)
+    Global::block_compression_queue =
+        new BlockCompressionQueue(compressor_threads);
+
   // Create table info maps
   m_live_map = new TableInfoMap();
   m_replay_map = new TableInfoMap();
@@ -171,6 +234,7 @@ RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_mgr,
    * Create Master client
    */
   timeout = props->get_i32("Hypertable.Request.Timeout");
+  m_replay_timeout = timeout;
   m_master_client = new MasterClient(m_conn_manager, m_hyperspace,
                                      timeout, m_app_queue);
   m_master_connection_handler = new ConnectionHandler(comm, m_app_queue,
@@ -215,6 +279,12 @@ RangeServer::~RangeServer() {
   m_master_client = 0;
   m_conn_manager = 0;
   m_app_queue = 0;
+  m_apply_queue->shutdown();
+  m_apply_queue->join();
+  if (Global::block_compression_queue) {
+    Global::block_compression_queue->shutdown();
+    Global::block_compression_queue->join();
+  }
 }
 
 
@@ -460,24 +530,147 @@ void RangeServer::local_recover() {
 }
 
 
+namespace {
+
+  struct ReplayExtent {
+    const uint8_t *base;
+    size_t len;
+  };
+
+  /**
+   * Applies the runs of a replay batch that belong to a single range, in
+   * the order they were read from the commit log.
+   */
+  class ReplayApplyJob : public UpdateApplyQueue::Job {
+  public:
+    ReplayApplyJob(Range *r) : range(r) { }
+
+    virtual void run() {
+      Locker<Range> lock(*range);
+      SerializedKey key;
+      ByteString value;
+      Key key_comps;
+      foreach(const ReplayExtent &extent, extents) {
+        const uint8_t *ptr = extent.base;
+        const uint8_t *end = ptr + extent.len;
+        while (ptr < end) {
+          key.ptr = ptr;
+          key_comps.load(key);
+          ptr += key_comps.length;
+          value.ptr = ptr;
+          ptr += value.length();
+          range->add(key_comps, value);
+        }
+      }
+    }
+
+    Range *range;
+    std::vector<ReplayExtent> extents;
+  };
+
+  typedef std::map<Range *, ReplayApplyJob *> ReplayJobMap;
+
+  void add_replay_extent(ReplayJobMap &jobs, Range *range,
+                         const uint8_t *base, size_t len) {
+    ReplayApplyJob *&job = jobs[range];
+    if (job == 0)
+      job = new ReplayApplyJob(range);
+    ReplayExtent extent;
+    extent.base = base;
+    extent.len = len;
+    job->extents.push_back(extent);
+  }
+
+  /**
+   * Applies a replay batch, one job per range, and frees the batch.
+   */
+  void apply_replay_batch(UpdateApplyQueue *apply_queue, ReplayJobMap &jobs,
+                          std::vector<uint8_t *> &buffers) {
+    UpdateApplyQueue::Batch batch;
+
+    for (ReplayJobMap::iterator iter = jobs.begin(); iter != jobs.end(); ++iter)
+      batch.jobs.push_back((*iter).second);
+
+    apply_queue->execute(batch);
+
+    foreach(UpdateApplyQueue::Job *job, batch.jobs)
+      delete job;
+    jobs.clear();
+    foreach(uint8_t *buf, buffers)
+      delete [] buf;
+    buffers.clear();
+
+    if (batch.error != Error::OK)
+      HT_THROW(batch.error, batch.error_msg);
+  }
+
+  /**
+   * Frees the jobs and block copies of a replay batch that was never
+   * applied and stops the reader's read-ahead threads when replay_log()
+   * leaves with an exception.  On a normal return both are already done.
+   */
+  class ReplayGuard {
+  public:
+    ReplayGuard(CommitLogReader *reader, ReplayJobMap &jobs,
+                std::vector<uint8_t *> &buffers)
+      : m_reader(reader), m_jobs(jobs), m_buffers(buffers) { }
+    ~ReplayGuard() {
+      for (ReplayJobMap::iterator iter = m_jobs.begin();
+           iter != m_jobs.end(); ++iter)
+        delete (*iter).second;
+      m_jobs.clear();
+      foreach(uint8_t *buf, m_buffers)
+        delete [] buf;
+      m_buffers.clear();
+      m_reader->stop_read_ahead();
+    }
+  private:
+    CommitLogReader *m_reader;
+    ReplayJobMap &m_jobs;
+    std::vector<uint8_t *> &m_buffers;
+  };
+
+}
+
+
 void RangeServer::replay_log(CommitLogReaderPtr &log_reader) {
   BlockCompressionHeaderCommitLog header;
-  uint8_t *base;
+  const uint8_t *base;
   size_t len;
   TableIdentifier table_id;
-  DynamicBuffer dbuf;
-  const uint8_t *ptr, *end;
-  int64_t revision;
+  const uint8_t *ptr, *end, *key_base, *run_base;
+  const char *row;
   TableInfoPtr table_info;
+  TableInfo *last_table_info = 0;
   RangePtr range;
   SerializedKey key;
   ByteString value;
   uint32_t block_count = 0;
+  uint64_t byte_count = 0;
+  uint64_t batch_bytes = 0;
   String start_row, end_row;
+  ReplayJobMap jobs;
+  std::vector<uint8_t *> buffers;
+  Stopwatch total_timer;
+  Stopwatch read_timer(false);
+  Stopwatch route_timer(false);
+  Stopwatch apply_timer(false);
+  ReplayGuard guard(log_reader.get(), jobs, buffers);
+
+  if (m_replay_inflate_threads > 0)
+    log_reader->enable_read_ahead(m_replay_inflate_threads,
+                                  m_replay_read_ahead);
 
-  while (log_reader->next((const uint8_t **)&base, &len, &header)) {
+  while (true) {
 
-    revision = header.get_revision();
+    read_timer.start();
+    bool more = log_reader->next(&base, &len, &header);
+    read_timer.stop();
+
+    if (!more)
+      break;
+
+    route_timer.start();
 
     ptr = base;
     end = base + len;
@@ -485,20 +678,28 @@ void RangeServer::replay_log(CommitLogReaderPtr &log_reader) {
     table_id.decode(&ptr, &len);
 
     // Fetch table info
-    if (!m_replay_map->get(table_id.id, table_info))
+    if (!m_replay_map->get(table_id.id, table_info)) {
+      route_timer.stop();
       continue;
+    }
 
-    dbuf.ensure(table_id.encoded_length() + 12 + len);
-    dbuf.clear();
+    if (table_info.get() != last_table_info) {
+      last_table_info = table_info.get();
+      range = 0;
+    }
 
-    dbuf.ptr += 4;  // skip size
-    encode_i64(&dbuf.ptr, revision);
-    table_id.encode(&dbuf.ptr);
-    base = dbuf.ptr;
+    // the reader reuses its block buffer, so the batch keeps its own copy
+    uint8_t *buf = new uint8_t [end - ptr];
+    memcpy(buf, ptr, end - ptr);
+    buffers.push_back(buf);
+    end = buf + (end - ptr);
+    ptr = buf;
+    run_base = 0;
 
     while (ptr < end) {
 
       // extract the key
+      key_base = ptr;
       key.ptr = ptr;
       ptr += key.length();
       if (ptr > end)
@@ -510,27 +711,52 @@ void RangeServer::replay_log(CommitLogReaderPtr &log_reader) {
       if (ptr > end)
         HT_THROW(Error::REQUEST_TRUNCATED, "Problem decoding value");
 
-      // Look for containing range, add to stop mods if not found
-      if (!table_info->find_containing_range(key.row(), range,
-                                             start_row, end_row))
-        continue;
+      row = key.row();
 
-      // add key/value pair to buffer
-      memcpy(dbuf.ptr, key.ptr, ptr-key.ptr);
-      dbuf.ptr += ptr-key.ptr;
+      // Look for containing range unless the row falls in the last one
+      if (!range || strcmp(row, start_row.c_str()) <= 0
+          || strcmp(row, end_row.c_str()) > 0) {
+        if (run_base) {
+          add_replay_extent(jobs, range.get(), run_base, key_base - run_base);
+          run_base = 0;
+        }
+        if (!table_info->find_containing_range(row, range,
+                                               start_row, end_row)) {
+          range = 0;
+          continue;
+        }
+      }
 
+      if (run_base == 0)
+        run_base = key_base;
     }
 
-    uint32_t block_size = dbuf.ptr - base;
-    base = dbuf.base;
-    encode_i32(&base, block_size);
+    if (run_base)
+      add_replay_extent(jobs, range.get(), run_base, end - run_base);
 
-    replay_update(0, dbuf.base, dbuf.fill());
     block_count++;
+    batch_bytes += end - buf;
+    byte_count += end - buf;
+
+    route_timer.stop();
+
+    if (batch_bytes >= m_replay_batch_size) {
+      apply_timer.start();
+      apply_replay_batch(m_apply_queue.get(), jobs, buffers);
+      apply_timer.stop();
+      batch_bytes = 0;
+    }
   }
 
-  HT_INFOF("Replayed %u blocks of updates from '%s'", block_count,
-           log_reader->get_log_dir().c_str());
+  apply_timer.start();
+  apply_replay_batch(m_apply_queue.get(), jobs, buffers);
+  apply_timer.stop();
+
+  HT_INFOF("Replayed %u blocks (%llu bytes) of updates from '%s' in %.3f "
+           "seconds (read/inflate wait %.3f, routing %.3f, apply %.3f)",
+           block_count, (Llu)byte_count, log_reader->get_log_dir().c_str(),
+           total_timer.elapsed(), read_timer.elapsed(), route_timer.elapsed(),
+           apply_timer.elapsed());
 }
 
 
@@ -585,6 +811,28 @@ RangeServer::compact(ResponseCallback *cb, const TableIdentifier *table,
 }
 
 
+namespace {
+
+  /**
+   * Accounts a scan block against the range's read load, sampling the
+   * first row of the block
+   */
+  void record_scan_block(RangePtr &range, DynamicBuffer &rbuf, size_t count) {
+    range->add_bytes_read(rbuf.fill());
+    if (count) {
+      SerializedKey key;
+      Key key_comps;
+      key.ptr = rbuf.base + 4;
+      key_comps.load(key);
+      range->record_read(key_comps.row);
+    }
+    else
+      range->record_read(0);
+  }
+
+}
+
+
 void
 RangeServer::create_scanner(ResponseCallbackCreateScanner *cb,
     const TableIdentifier *table, const RangeSpec *range_spec,
@@ -599,6 +847,7 @@ RangeServer::create_scanner(ResponseCallbackCreateScanner *cb,
   SchemaPtr schema;
   ScanContextPtr scan_ctx;
   bool decrement_needed=false;
+  Stopwatch stopwatch;
 
   HT_DEBUG_OUT <<"Creating scanner:\n"<< *table << *range_spec
                << *scan_spec << HT_END;
@@ -659,11 +908,17 @@ RangeServer::create_scanner(ResponseCallbackCreateScanner *cb,
     size_t count;
     more = FillScanBlock(scanner, rbuf, &count);
 
+    record_scan_block(range, rbuf, count);
+
     id = (more) ? Global::scanner_map.put(scanner, range, table) : 0;
 
     HT_DEBUGF("Successfully created scanner (id=%u) on table '%s', returning "
               "%d k/v pairs", id, table->name, (int)count);
 
+    if (Global::compaction_throttle)
+      Global::compaction_throttle->record_foreground_latency(
+          stopwatch.elapsed() * 1000.0);
+
     /**
      *  Send back data
      */
@@ -708,6 +963,7 @@ RangeServer::fetch_scanblock(ResponseCallbackFetchScanblock *cb,
   TableInfoPtr table_info;
   TableIdentifierManaged scanner_table;
   SchemaPtr schema;
+  Stopwatch stopwatch;
 
   HT_DEBUG_OUT <<"Scanner ID = " << scanner_id << HT_END;
 
@@ -730,14 +986,18 @@ RangeServer::fetch_scanblock(ResponseCallbackFetchScanblock *cb,
                       schema->get_generation(), scanner_table.generation));
     }
 
-    range->add_bytes_read( rbuf.fill() );
-
     size_t count;
     more = FillScanBlock(scanner, rbuf, &count);
 
+    record_scan_block(range, rbuf, count);
+
     if (!more)
       Global::scanner_map.remove(scanner_id);
 
+    if (Global::compaction_throttle)
+      Global::compaction_throttle->record_foreground_latency(
+          stopwatch.elapsed() * 1000.0);
+
     /**
      *  Send back data
      */
@@ -1063,6 +1323,55 @@ namespace {
     uint64_t len;
   };
 
+  /**
+   * Applies the portions of an update batch destined for a single range.
+   * Portions are applied in the order they appear in the batch and only
+   * after every earlier batch has been applied to the range.
+   */
+  class RangeApplyJob : public UpdateApplyQueue::Job {
+  public:
+    RangeApplyJob(Range *r, uint64_t t)
+      : range(r), ticket(t), need_maintenance(false) { }
+
+    virtual void run() {
+      range->enter_apply(ticket);
+      try {
+        Locker<Range> lock(*range);
+        SerializedKey key;
+        ByteString value;
+        Key key_comps;
+        foreach(RangeUpdateInfo *rui, updates) {
+          uint8_t *ptr = rui->bufp->base + rui->offset;
+          uint8_t *end = ptr + rui->len;
+          range->add_bytes_written(rui->len);
+          range->record_write();
+          while (ptr < end) {
+            key.ptr = ptr;
+            key_comps.load(key);
+            ptr += key_comps.length;
+            value.ptr = ptr;
+            ptr += value.length();
+            range->add(key_comps, value);
+            range->sample_write_row(key_comps.row);
+          }
+        }
+      }
+      catch (...) {
+        range->exit_apply();
+        throw;
+      }
+      range->exit_apply();
+      need_maintenance = range->need_maintenance();
+    }
+
+    Range *range;
+    uint64_t ticket;
+    bool need_maintenance;
+    std::vector<RangeUpdateInfo *> updates;
+  };
+
+  typedef std::map<Range *, RangeApplyJob *> ApplyJobMap;
+
 }
 
 
@@ -1080,7 +1389,6 @@ RangeServer::update(ResponseCallbackUpdate *cb, const TableIdentifier *table,
   CommitLogPtr splitlog;
   bool split_pending;
   SerializedKey key;
-  ByteString value;
   bool a_locked = false;
   bool b_locked = false;
   vector<SendBackRec> send_back_vector;
@@ -1098,6 +1406,9 @@ RangeServer::update(ResponseCallbackUpdate *cb, const TableIdentifier *table,
   std::set<Range *> reference_set;
   std::pair<std::set<Range *>::iterator, bool> reference_set_state;
   String start_row, end_row;
+  std::vector<RangeApplyJob> apply_jobs;
+  ApplyJobMap apply_job_map;
+  UpdateApplyQueue::Batch apply_batch;
 
   // Pre-allocate the go_buf - each key could expand by 8 or 9 bytes,
   // if auto-assigned (8 for the ts or rev and maybe 1 for possible
@@ -1376,34 +1687,45 @@ RangeServer::update(ResponseCallbackUpdate *cb, const TableIdentifier *table,
                   (int)go_buf.fill(), log->get_log_dir().c_str());
     }
 
+    /**
+     * Group the modifications by range and reserve each range's place in
+     * the apply order while the log write is still serialized
+     */
+    apply_jobs.reserve(range_vector.size());
     for (size_t rangei=0; rangei<range_vector.size(); rangei++) {
-
-      /**
-       * Apply the modifications
-       */
-      {
-        Locker<Range> lock(*range_vector[rangei].range);
-        Key key_comps;
-        uint8_t *ptr = range_vector[rangei].bufp->base
-            + range_vector[rangei].offset;
-        uint8_t *end = ptr + range_vector[rangei].len;
-        range_vector[rangei].range->add_bytes_written( range_vector[rangei].len );
-        while (ptr < end) {
-          key.ptr = ptr;
-          key_comps.load(key);
-          ptr += key_comps.length;
-          value.ptr = ptr;
-          ptr += value.length();
-          range_vector[rangei].range->add(key_comps, value);
-        }
+      Range *range = range_vector[rangei].range.get();
+      ApplyJobMap::iterator job_iter = apply_job_map.find(range);
+      if (job_iter == apply_job_map.end()) {
+        apply_jobs.push_back(RangeApplyJob(range,
+                                           range->acquire_apply_ticket()));
+        job_iter = apply_job_map.insert(
+            std::make_pair(range, &apply_jobs.back())).first;
       }
+      job_iter->second->updates.push_back(&range_vector[rangei]);
+    }
+
+    // The updates are durable, so let the next batch into the log
+    m_update_mutex_b.unlock();
+    b_locked = false;
 
-      if (range_vector[rangei].range->need_maintenance() &&
-          !Global::maintenance_queue->is_scheduled(range_vector[rangei].range.get())) {
+    /**
+     * Apply the modifications
+     */
+    for (size_t i=0; i<apply_jobs.size(); i++)
+      apply_batch.jobs.push_back(&apply_jobs[i]);
+
+    m_apply_queue->execute(apply_batch);
+
+    if (apply_batch.error != Error::OK)
+      HT_THROW(apply_batch.error, apply_batch.error_msg);
+
+    for (size_t i=0; i<apply_jobs.size(); i++) {
+      if (apply_jobs[i].need_maintenance &&
+          !Global::maintenance_queue->is_scheduled(apply_jobs[i].range)) {
         m_maintenance_scheduler->need_scheduling();
         m_timer_handler->schedule_maintenance();
+        break;
       }
-
     }
 
     if (Global::verbose && misses)
@@ -1584,6 +1906,29 @@ void RangeServer::get_statistics(ResponseCallbackGetStatistics *cb) {
     }
   }
 
+  if (Global::compaction_throttle) {
+    CompactionThrottle::Stats tstats;
+    Global::compaction_throttle->get_stats(tstats);
+    stat.compaction_throttle_rate = tstats.rate;
+    stat.compaction_throttle_bytes = tstats.bytes;
+    stat.compaction_throttle_wait_millis = tstats.wait_millis;
+    stat.foreground_latency_millis = (uint64_t)tstats.latency_millis;
+  }
+
+  foreach(ReactorPtr &reactor, ReactorFactory::ms_reactors) {
+    uint32_t syscalls, messages, hits, misses;
+    reactor->get_send_stats(&syscalls, &messages);
+    stat.reactor_send_syscalls.push_back(syscalls);
+    stat.reactor_messages_sent.push_back(messages);
+    reactor->receive_pool()->get_stats(&hits, &misses);
+    stat.reactor_pool_hits.push_back(hits);
+    stat.reactor_pool_misses.push_back(misses);
+  }
+
+  LatencyStats::snapshot(stat.latencies);
+  PayloadCodec::get_stats(&stat.comm_compression_raw_bytes,
+                          &stat.comm_compression_wire_bytes);
+
   StaticBuffer ext(stat.encoded_length());
   uint8_t *bufp = ext.base;
   stat.encode(&bufp);
@@ -1664,11 +2009,19 @@ RangeServer::replay_load_range(ResponseCallback *cb,
       m_replay_map->set(table->id, table_info);
 
     /**
-     * Make sure this range is not already loaded
+     * Make sure this range is not already loaded, either by this replay or
+     * by an earlier one that committed
      */
     if (table_info->get_range(range_spec, range))
       HT_THROWF(Error::RANGESERVER_RANGE_ALREADY_LOADED, "%s[%s..%s]",
                 table->name, range_spec->start_row, range_spec->end_row);
+    {
+      TableInfoPtr live_info;
+      if (m_live_map->get(table->id, live_info) &&
+          live_info->get_range(range_spec, range))
+        HT_THROWF(Error::RANGESERVER_RANGE_ALREADY_LOADED, "%s[%s..%s]",
+                  table->name, range_spec->start_row, range_spec->end_row);
+    }
 
     /**
      * Lazily create METADATA table pointer
@@ -1719,7 +2072,7 @@ RangeServer::replay_update(ResponseCallback *cb, const uint8_t *data,
   Key key;
   const uint8_t *ptr = data;
   const uint8_t *end = data + len;
-  const uint8_t *block_end;
+  const uint8_t *block_start, *block_end;
   uint32_t block_size;
   size_t remaining = len;
   const char *row;
@@ -1738,15 +2091,7 @@ RangeServer::replay_update(ResponseCallback *cb, const uint8_t *data,
       // decode key/value block size + revision
       block_size = decode_i32(&ptr, &remaining);
       revision = decode_i64(&ptr, &remaining);
-
-      if (m_replay_log) {
-        DynamicBuffer dbuf(0, false);
-        dbuf.base = (uint8_t *)ptr;
-        dbuf.ptr = dbuf.base + remaining;
-
-        if ((error = m_replay_log->write(dbuf, revision)) != Error::OK)
-          HT_THROW(error, "");
-      }
+      block_start = ptr;
 
       // decode table identifier
       table_identifier.decode(&ptr, &remaining);
@@ -1756,6 +2101,18 @@ RangeServer::replay_update(ResponseCallback *cb, const uint8_t *data,
                   (Lu)block_size);
 
       block_end = ptr + block_size;
+      remaining -= block_size;
+
+      // log just this block (table identifier + key/value pairs), a request
+      // may carry several
+      if (m_replay_log) {
+        DynamicBuffer dbuf(0, false);
+        dbuf.base = (uint8_t *)block_start;
+        dbuf.ptr = (uint8_t *)block_end;
+
+        if ((error = m_replay_log->write(dbuf, revision)) != Error::OK)
+          HT_THROW(error, "");
+      }
 
       // Fetch table info
       if (!m_replay_map->get(table_identifier.id, table_info))
@@ -1834,12 +2191,30 @@ void RangeServer::replay_commit(ResponseCallback *cb) {
     CommitLog *log = 0;
     std::vector<RangePtr> rangev;
 
-    if (m_replay_group == RangeServerProtocol::GROUP_METADATA_ROOT)
-      log = Global::root_log;
-    else if (m_replay_group == RangeServerProtocol::GROUP_METADATA)
-      log = Global::metadata_log;
-    else if (m_replay_group == RangeServerProtocol::GROUP_USER)
-      log = Global::user_log;
+    // ranges recovered from a failed server may be the first of their
+    // group on this server
+    {
+      ScopedLock lock(m_mutex);
+      if (m_replay_group == RangeServerProtocol::GROUP_METADATA_ROOT) {
+        if (Global::root_log == 0) {
+          Global::log_dfs->mkdirs(Global::log_dir + "/root");
+          Global::root_log = new CommitLog(Global::log_dfs, Global::log_dir
+                                           + "/root", m_props);
+        }
+        log = Global::root_log;
+      }
+      else if (m_replay_group == RangeServerProtocol::GROUP_METADATA) {
+        if (Global::metadata_log == 0) {
+          Global::log_dfs->mkdirs(Global::log_dir + "/metadata");
+          Global::metadata_log = new CommitLog(Global::log_dfs,
+                                               Global::log_dir + "/metadata",
+                                               m_props);
+        }
+        log = Global::metadata_log;
+      }
+      else if (m_replay_group == RangeServerProtocol::GROUP_USER)
+        log = Global::user_log;
+    }
 
     /** FIX ME - should we link here?  what about stitch_in? **/
     if ((error = log->link_log(m_replay_log.get())) != Error::OK)
@@ -1870,6 +2245,224 @@ void RangeServer::replay_commit(ResponseCallback *cb) {
 
 
 
+namespace {
+
+  /**
+   * Server that a recovered range has been assigned to, keyed by end row
+   */
+  struct ReplayRoute {
+    String start_row;
+    size_t output;
+  };
+
+  typedef std::map<String, ReplayRoute> ReplayRouteMap;
+  typedef std::map<uint32_t, ReplayRouteMap> ReplayTableRouteMap;
+
+  /**
+   * Replay update blocks accumulated for one destination server
+   */
+  struct ReplayOutput : public ReferenceCount {
+    ReplayOutput(const String &l) : location(l), bytes_sent(0) { }
+    String location;
+    sockaddr_in addr;
+    DynamicBuffer buffer;
+    uint64_t bytes_sent;
+  };
+  typedef intrusive_ptr<ReplayOutput> ReplayOutputPtr;
+
+  void append_replay_run(ReplayOutput &out, int64_t revision,
+                         const TableIdentifier &table, const uint8_t *base,
+                         size_t len) {
+    out.buffer.ensure(12 + table.encoded_length() + len);
+    encode_i32(&out.buffer.ptr, len);
+    encode_i64(&out.buffer.ptr, revision);
+    table.encode(&out.buffer.ptr);
+    out.buffer.add_unchecked(base, len);
+  }
+
+  void send_replay_updates(RangeServerClient &client, ReplayOutput &out) {
+    DispatchHandlerSynchronizer sync_handler;
+    EventPtr event_ptr;
+    size_t len = out.buffer.fill();
+
+    if (len == 0)
+      return;
+
+    StaticBuffer buffer(out.buffer);
+    client.replay_update(out.addr, buffer, &sync_handler);
+
+    if (!sync_handler.wait_for_reply(event_ptr))
+      HT_THROWF((int)Hypertable::Protocol::response_code(event_ptr),
+                "replay_update to %s failed - %s", out.location.c_str(),
+                Hypertable::Protocol::string_format_message(event_ptr).c_str());
+
+    out.bytes_sent += len;
+  }
+
+}
+
+
+/**
+ * Reads a subset of the fragments of a failed server's commit log and
+ * streams every update for a range being recovered to the server that the
+ * range has been assigned to, using the replay_update protocol.  Several
+ * servers do this at once for disjoint subsets of the fragments.  The
+ * order in which the destination receives updates from different workers
+ * does not matter because each cell carries its revision.
+ */
+void
+RangeServer::replay_fragments(ResponseCallbackReplayFragments *cb,
+    const String &log_dir, const std::vector<uint32_t> &fragments,
+    const std::vector<QualifiedRangeSpec> &ranges,
+    const std::vector<String> &destinations) {
+  ReplayTableRouteMap routes;
+  std::vector<ReplayOutputPtr> outputs;
+  CommitLogReaderPtr log_reader;
+  BlockCompressionHeaderCommitLog header;
+  TableIdentifier table_id;
+  SerializedKey key;
+  ByteString value;
+  const uint8_t *base, *ptr, *end, *key_base, *run_base;
+  size_t len, run_output = 0;
+  uint32_t block_count = 0;
+  uint64_t skipped = 0;
+  std::vector<String> linked_logs;
+  Stopwatch stopwatch;
+
+  HT_INFOF("Replaying %u fragments of %s for %u ranges",
+           (unsigned)fragments.size(), log_dir.c_str(),
+           (unsigned)ranges.size());
+
+  try {
+    RangeServerClient client(m_comm);
+
+    for (size_t i=0; i<ranges.size(); i++) {
+      ReplayRoute route;
+      for (route.output=0; route.output<outputs.size(); route.output++) {
+        if (outputs[route.output]->location == destinations[i])
+          break;
+      }
+      if (route.output == outputs.size())
+        outputs.push_back(new ReplayOutput(destinations[i]));
+      route.start_row = ranges[i].range.start_row;
+      routes[ranges[i].table.id][ranges[i].range.end_row] = route;
+    }
+
+    // The destinations are listen locations; connections to other servers
+    // are not set up implicitly, so establish them before streaming
+    foreach(ReplayOutputPtr &out, outputs) {
+      if (!LocationCache::location_to_addr(out->location.c_str(), out->addr))
+        HT_THROWF(Error::INVALID_METADATA, "Bad replay destination '%s'",
+                  out->location.c_str());
+      m_conn_manager->add(out->addr, m_replay_timeout, "RangeServer");
+      if (!m_conn_manager->wait_for_connection(out->addr, m_replay_timeout))
+        HT_THROWF(Error::COMM_NOT_CONNECTED, "Unable to connect to replay "
+                  "destination %s", out->location.c_str());
+    }
+
+    log_reader = new CommitLogReader(Global::log_dfs, log_dir, fragments);
+    if (m_replay_inflate_threads > 0)
+      log_reader->enable_read_ahead(m_replay_inflate_threads,
+                                    m_replay_read_ahead);
+
+    while (log_reader->next(&base, &len, &header)) {
+      int64_t revision = header.get_revision();
+
+      ptr = base;
+      end = base + len;
+
+      table_id.decode(&ptr, &len);
+
+      ReplayTableRouteMap::iterator table_iter = routes.find(table_id.id);
+      if (table_iter == routes.end())
+        continue;
+      ReplayRouteMap &route_map = (*table_iter).second;
+
+      run_base = 0;
+
+      while (ptr < end) {
+
+        // extract the key
+        key_base = ptr;
+        key.ptr = ptr;
+        ptr += key.length();
+        if (ptr > end)
+          HT_THROW(Error::REQUEST_TRUNCATED, "Problem decoding key");
+
+        // extract the value
+        value.ptr = ptr;
+        ptr += value.length();
+        if (ptr > end)
+          HT_THROW(Error::REQUEST_TRUNCATED, "Problem decoding value");
+
+        const char *row = key.row();
+        ReplayRouteMap::iterator iter = route_map.lower_bound(row);
+
+        if (iter == route_map.end()
+            || strcmp(row, (*iter).second.start_row.c_str()) <= 0) {
+          if (run_base) {
+            append_replay_run(*outputs[run_output], revision, table_id,
+                              run_base, key_base - run_base);
+            run_base = 0;
+          }
+          skipped++;
+          continue;
+        }
+
+        if (run_base && (*iter).second.output != run_output) {
+          append_replay_run(*outputs[run_output], revision, table_id,
+                            run_base, key_base - run_base);
+          run_base = 0;
+        }
+
+        if (run_base == 0) {
+          run_base = key_base;
+          run_output = (*iter).second.output;
+        }
+      }
+
+      if (run_base)
+        append_replay_run(*outputs[run_output], revision, table_id, run_base,
+                          end - run_base);
+
+      block_count++;
+
+      foreach(ReplayOutputPtr &out, outputs) {
+        if (out->buffer.fill() >= m_replay_batch_size)
+          send_replay_updates(client, *out);
+      }
+    }
+
+    foreach(ReplayOutputPtr &out, outputs)
+      send_replay_updates(client, *out);
+
+    // report the transfer logs that were linked in so that the Master can
+    // remove them once the failed server's ranges are recovered
+    foreach(const CommitLogFileInfo &info, log_reader->get_fragment_queue()) {
+      if (info.purge_log_dir)
+        linked_logs.push_back(info.log_dir);
+    }
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << "Problem replaying fragments of " << log_dir << " - "
+                 << e << HT_END;
+    cb->error(e.code(), e.what());
+    return;
+  }
+
+  uint64_t bytes_sent = 0;
+  foreach(ReplayOutputPtr &out, outputs)
+    bytes_sent += out->bytes_sent;
+
+  HT_INFOF("Replayed %u blocks from %u fragments of %s in %.3f seconds "
+           "(%llu bytes sent to %u servers, %llu cells skipped)", block_count,
+           (unsigned)fragments.size(), log_dir.c_str(), stopwatch.elapsed(),
+           (Llu)bytes_sent, (unsigned)outputs.size(), (Llu)skipped);
+
+  cb->response(linked_logs);
+}
+
+
 void
 RangeServer::drop_range(ResponseCallback *cb, const TableIdentifier *table,
                         const RangeSpec *range_spec) {
@@ -1899,6 +2492,95 @@ RangeServer::drop_range(ResponseCallback *cb, const TableIdentifier *table,
 }
 
 
+void
+RangeServer::merge_ranges(ResponseCallback *cb, const TableIdentifier *table,
+                          const RangeSpec *low_spec,
+                          const RangeSpec *high_spec) {
+  TableInfoPtr table_info;
+  RangePtr low, high;
+
+  HT_INFO_OUT << "merge_ranges\n"<< *table << *low_spec << *high_spec
+              << HT_END;
+
+  try {
+
+    if (table->id == 0)
+      HT_THROW(Error::RANGESERVER_RANGE_BUSY, "METADATA ranges can't be merged");
+
+    if (strcmp(low_spec->end_row, high_spec->start_row))
+      HT_THROWF(Error::RANGESERVER_RANGE_NOT_FOUND, "Ranges %s[%s..%s] and "
+                "%s[%s..%s] are not adjacent", table->name,
+                low_spec->start_row, low_spec->end_row, table->name,
+                high_spec->start_row, high_spec->end_row);
+
+    m_live_map->get(table->id, table_info);
+
+    if (!table_info->get_range(low_spec, low))
+      HT_THROW(Error::RANGESERVER_RANGE_NOT_FOUND,
+               format("%s[%s..%s]", table->name, low_spec->start_row,
+                      low_spec->end_row));
+
+    if (!table_info->get_range(high_spec, high))
+      HT_THROW(Error::RANGESERVER_RANGE_NOT_FOUND,
+               format("%s[%s..%s]", table->name, high_spec->start_row,
+                      high_spec->end_row));
+
+    high->merge(low);
+
+    cb->response_ok();
+  }
+  catch (Hypertable::Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    int error;
+    if (cb && (error = cb->error(e.code(), e.what())) != Error::OK)
+      HT_ERRORF("Problem sending error response - %s", Error::get_text(error));
+  }
+}
+
+
+void
+RangeServer::relinquish_range(ResponseCallback *cb,
+    const TableIdentifier *table, const RangeSpec *range_spec) {
+  TableInfoPtr table_info;
+  RangePtr range;
+
+  HT_INFO_OUT << "relinquish_range\n"<< *table << *range_spec << HT_END;
+
+  try {
+
+    if (table->id == 0)
+      HT_THROW(Error::RANGESERVER_RANGE_BUSY,
+               "METADATA ranges can't be relinquished");
+
+    m_live_map->get(table->id, table_info);
+
+    if (!table_info->get_range(range_spec, range))
+      HT_THROW(Error::RANGESERVER_RANGE_NOT_FOUND,
+               format("%s[%s..%s]", table->name, range_spec->start_row,
+                      range_spec->end_row));
+
+    try {
+      range->relinquish();
+    }
+    catch (Exception &e) {
+      RangePtr existing;
+      // put the range back into service if it was already taken out
+      if (!table_info->get_range(range_spec, existing))
+        table_info->add_range(range);
+      throw;
+    }
+
+    cb->response_ok();
+  }
+  catch (Hypertable::Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    int error;
+    if (cb && (error = cb->error(e.code(), e.what())) != Error::OK)
+      HT_ERRORF("Problem sending error response - %s", Error::get_text(error));
+  }
+}
+
+
 void RangeServer::shutdown(ResponseCallback *cb) {
   std::vector<TableInfoPtr> table_vec;
   std::vector<RangePtr> range_vec;
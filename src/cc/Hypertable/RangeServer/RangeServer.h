@@ -44,11 +44,13 @@
 #include "ResponseCallbackCreateScanner.h"
 #include "ResponseCallbackFetchScanblock.h"
 #include "ResponseCallbackGetStatistics.h"
+#include "ResponseCallbackReplayFragments.h"
 #include "ResponseCallbackUpdate.h"
 #include "TableIdCache.h"
 #include "TableInfo.h"
 #include "TableInfoMap.h"
 #include "TimerInterface.h"
+#include "UpdateApplyQueue.h"
 
 namespace Hypertable {
   using namespace Hyperspace;
@@ -85,10 +87,21 @@ namespace Hypertable {
                            const RangeSpec *, const RangeState *);
     void replay_update(ResponseCallback *, const uint8_t *data, size_t len);
     void replay_commit(ResponseCallback *);
+    void replay_fragments(ResponseCallbackReplayFragments *,
+                          const String &log_dir,
+                          const std::vector<uint32_t> &fragments,
+                          const std::vector<QualifiedRangeSpec> &ranges,
+                          const std::vector<String> &destinations);
 
     void drop_range(ResponseCallback *, const TableIdentifier *,
                     const RangeSpec *);
 
+    void merge_ranges(ResponseCallback *, const TableIdentifier *,
+                      const RangeSpec *low, const RangeSpec *high);
+
+    void relinquish_range(ResponseCallback *, const TableIdentifier *,
+                          const RangeSpec *);
+
     void shutdown(ResponseCallback *cb);
 
     // Other methods
@@ -149,8 +162,13 @@ namespace Hypertable {
     TableIdCachePtr        m_dropped_table_id_cache;
     RangeStatsGathererPtr  m_stats_gatherer;
     MaintenanceSchedulerPtr m_maintenance_scheduler;
+    UpdateApplyQueuePtr    m_apply_queue;
     TimerInterface        *m_timer_handler;
     uint32_t               m_update_delay;
+    uint32_t               m_replay_inflate_threads;
+    uint32_t               m_replay_read_ahead;
+    uint64_t               m_replay_batch_size;
+    uint32_t               m_replay_timeout;
   };
 
   typedef intrusive_ptr<RangeServer> RangeServerPtr;
@@ -0,0 +1,74 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/Logger.h"
+
+#include "AsyncComm/ResponseCallback.h"
+#include "Common/Serialization.h"
+
+#include "Hypertable/Lib/Types.h"
+
+#include "RangeServer.h"
+#include "RequestHandlerReplayFragments.h"
+#include "ResponseCallbackReplayFragments.h"
+
+using namespace Hypertable;
+using namespace Serialization;
+
+/**
+ *
+ */
+void RequestHandlerReplayFragments::run() {
+  ResponseCallbackReplayFragments cb(m_comm, m_event_ptr);
+  String log_dir;
+  std::vector<uint32_t> fragments;
+  std::vector<QualifiedRangeSpec> ranges;
+  std::vector<String> destinations;
+  TableIdentifier table;
+  RangeSpec range;
+  const uint8_t *decode_ptr = m_event_ptr->payload;
+  size_t decode_remain = m_event_ptr->payload_len;
+
+  try {
+    log_dir = decode_str16(&decode_ptr, &decode_remain);
+
+    size_t count = decode_i32(&decode_ptr, &decode_remain);
+    for (size_t i=0; i<count; i++)
+      fragments.push_back(decode_i32(&decode_ptr, &decode_remain));
+
+    count = decode_i32(&decode_ptr, &decode_remain);
+    for (size_t i=0; i<count; i++) {
+      table.decode(&decode_ptr, &decode_remain);
+      range.decode(&decode_ptr, &decode_remain);
+      ranges.push_back(QualifiedRangeSpec(table, range));
+      destinations.push_back(decode_str16(&decode_ptr, &decode_remain));
+    }
+
+    m_range_server->replay_fragments(&cb, log_dir, fragments, ranges,
+                                     destinations);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    cb.error(Error::PROTOCOL_ERROR, "Error handling replay fragments message");
+  }
+}
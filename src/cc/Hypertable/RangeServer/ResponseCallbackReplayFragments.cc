@@ -0,0 +1,46 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Serialization.h"
+
+#include "ResponseCallbackReplayFragments.h"
+
+using namespace Hypertable;
+using namespace Serialization;
+
+int
+ResponseCallbackReplayFragments::response(
+    const std::vector<String> &linked_logs) {
+  CommHeader header;
+  size_t len = 8;
+
+  for (size_t i=0; i<linked_logs.size(); i++)
+    len += encoded_length_str16(linked_logs[i]);
+
+  header.initialize_from_request_header(m_event_ptr->header);
+  CommBufPtr cbp(new CommBuf(header, len));
+  cbp->append_i32(Error::OK);
+  cbp->append_i32(linked_logs.size());
+  for (size_t i=0; i<linked_logs.size(); i++)
+    cbp->append_str16(linked_logs[i]);
+  return m_comm->send_response(m_event_ptr->addr, cbp);
+}
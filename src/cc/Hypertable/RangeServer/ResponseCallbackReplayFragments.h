@@ -0,0 +1,46 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_RESPONSECALLBACKREPLAYFRAGMENTS_H
+#define HYPERTABLE_RESPONSECALLBACKREPLAYFRAGMENTS_H
+
+#include <vector>
+
+#include "Common/Error.h"
+#include "Common/String.h"
+
+#include "AsyncComm/CommBuf.h"
+#include "AsyncComm/ResponseCallback.h"
+
+namespace Hypertable {
+
+  class ResponseCallbackReplayFragments : public ResponseCallback {
+  public:
+    ResponseCallbackReplayFragments(Comm *comm, EventPtr &event_ptr)
+      : ResponseCallback(comm, event_ptr) { }
+
+    int response(const std::vector<String> &linked_logs);
+  };
+
+}
+
+
+#endif // HYPERTABLE_RESPONSECALLBACKREPLAYFRAGMENTS_H
@@ -143,6 +143,7 @@ ScanContext::initialize(int64_t rev, const ScanSpec *ss,
 
   single_row = false;
   has_cell_interval = false;
+  throttle = false;
   has_start_cf_qualifier = false;
 
 
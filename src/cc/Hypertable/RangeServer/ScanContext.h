@@ -55,6 +55,7 @@ namespace Hypertable {
     bool single_row;
     bool has_cell_interval;
     bool has_start_cf_qualifier;
+    bool throttle;
     int64_t revision;
     std::pair<int64_t, int64_t> time_interval;
     bool family_mask[256];
@@ -0,0 +1,91 @@
+/** -*- c++ -*-
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_UPDATEAPPLYQUEUE_H
+#define HYPERTABLE_UPDATEAPPLYQUEUE_H
+
+#include <vector>
+
+#include "Common/Error.h"
+#include "Common/JobQueue.h"
+#include "Common/String.h"
+
+namespace Hypertable {
+
+  /**
+   * Fork-join pool used to apply the per-range portions of an update
+   * batch to the CellCaches in parallel once the batch has been made
+   * durable in the commit log.  The submitting thread takes part in the
+   * work: after handing its jobs to the pool it runs the first one and
+   * then claims any of its remaining jobs that no worker has picked up
+   * yet, so a batch always makes progress even when every worker is busy.
+   */
+  class UpdateApplyQueue : public JobQueue {
+
+  public:
+
+    /**
+     * Set of jobs submitted together by one thread, along with the first
+     * error encountered.
+     */
+    class Batch {
+    public:
+      Batch() : error(Error::OK) { }
+      int error;
+      String error_msg;
+      std::vector<Job *> jobs;
+    };
+
+    /**
+     * Constructor.  Creates worker_count worker threads.  With zero
+     * workers, every batch is run entirely by the submitting thread.
+     *
+     * @param worker_count number of worker threads to create
+     */
+    UpdateApplyQueue(int worker_count) : JobQueue(worker_count) { }
+
+    /**
+     * Runs all of the jobs in the batch and returns when they have all
+     * completed.  The first job is run by the calling thread, the rest are
+     * offered to the worker threads.  Any job that has not been claimed by
+     * a worker by the time the caller gets to it is run by the caller.
+     *
+     * @param batch batch of jobs to execute
+     */
+    void execute(Batch &batch) {
+      for (size_t i=1; i<batch.jobs.size(); i++)
+        add(batch.jobs[i]);
+
+      for (size_t i=0; i<batch.jobs.size(); i++) {
+        wait(batch.jobs[i]);
+        if (batch.jobs[i]->error() != Error::OK && batch.error == Error::OK) {
+          batch.error = batch.jobs[i]->error();
+          batch.error_msg = batch.jobs[i]->error_msg();
+        }
+      }
+    }
+  };
+
+  typedef boost::intrusive_ptr<UpdateApplyQueue> UpdateApplyQueuePtr;
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_UPDATEAPPLYQUEUE_H
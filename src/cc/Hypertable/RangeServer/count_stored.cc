@@ -244,7 +244,9 @@ fill_cell_store_vector(ClientPtr &hypertable_client_ptr, const char *table_name,
       char *ptr, *save_ptr;
       ptr = strtok_r((char *)files.c_str(), "\n\r;", &save_ptr);
       while (ptr) {
-        range_cell_store_info.cell_stores.push_back(ptr);
+        // skip files blocked from GC and inherited markers
+        if (*ptr != '#')
+          range_cell_store_info.cell_stores.push_back(ptr);
         ptr = strtok_r(0, "\n\r;", &save_ptr);
       }
     }
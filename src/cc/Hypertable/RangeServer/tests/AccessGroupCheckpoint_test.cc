@@ -0,0 +1,246 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Config.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/InetAddr.h"
+#include "Common/Serialization.h"
+#include "Common/System.h"
+#include "Common/Usage.h"
+
+#include <utility>
+#include <vector>
+
+#include "AsyncComm/ConnectionManager.h"
+
+#include "DfsBroker/Lib/Client.h"
+
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/Schema.h"
+#include "Hypertable/Lib/SerializedKey.h"
+
+#include "../AccessGroup.h"
+#include "../Global.h"
+#include "../ScanContext.h"
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+  const uint16_t DEFAULT_DFSBROKER_PORT = 38030;
+  const char *usage[] = {
+    "usage: AccessGroupCheckpoint_test",
+    "",
+    "  This program tests that the commit log revision an access group",
+    "  reports while it writes a checkpoint keeps every cell that the",
+    "  checkpoint on disk does not cover, so that purging the log at that",
+    "  revision and then replaying it after a restart loses nothing.",
+    (const char *)0
+  };
+
+  const char *schema_str =
+  "<Schema>\n"
+  "  <AccessGroup name=\"default\">\n"
+  "    <ColumnFamily id=\"1\">\n"
+  "      <Name>tag</Name>\n"
+  "    </ColumnFamily>\n"
+  "  </AccessGroup>\n"
+  "</Schema>";
+
+  /** Commit log stand-in: the revision and row of each update */
+  typedef vector<pair<int64_t, String> > UpdateLog;
+
+  void add_cell(AccessGroupPtr &ag, const String &row, int64_t revision) {
+    DynamicBuffer dbuf(64);
+    uint8_t valuebuf[32];
+    uint8_t *uptr = valuebuf;
+    const char *value = "value";
+    ByteString bsvalue;
+    Key key;
+
+    Serialization::encode_vi32(&uptr, strlen(value));
+    strcpy((char *)uptr, value);
+    bsvalue.ptr = valuebuf;
+
+    create_key_and_append(dbuf, FLAG_INSERT, row.c_str(), 1, "", revision,
+                          revision);
+    key.load(SerializedKey(dbuf.base));
+
+    ag->lock();
+    ag->add(key, bsvalue);
+    ag->unlock();
+  }
+
+  void update(AccessGroupPtr &ag, UpdateLog &log, int first, int count) {
+    char rowbuf[32];
+    for (int i=first; i<first+count; i++) {
+      sprintf(rowbuf, "row%03d", i);
+      log.push_back(make_pair((int64_t)i+1, String(rowbuf)));
+      add_cell(ag, rowbuf, i+1);
+    }
+  }
+
+  /**
+   * Drops the updates that the access group no longer needs, the way the
+   * maintenance scheduler purges commit log fragments
+   */
+  void purge(AccessGroupPtr &ag, UpdateLog &log) {
+    int64_t revision = ag->get_earliest_cached_revision();
+    UpdateLog remaining;
+
+    if (revision != TIMESTAMP_NULL) {
+      for (size_t i=0; i<log.size(); i++)
+        if (log[i].first >= revision)
+          remaining.push_back(log[i]);
+    }
+    log.swap(remaining);
+  }
+
+  /**
+   * Brings up the access group the way a restart does: load the
+   * checkpoint, then replay what is left of the log
+   */
+  AccessGroupPtr recover(const TableIdentifier *table, SchemaPtr &schema,
+                         const RangeSpec *range, const UpdateLog &log) {
+    AccessGroupPtr ag = new AccessGroup(table, schema,
+        schema->get_access_group("default"), range);
+    ag->recovery_initialize();
+    for (size_t i=0; i<log.size(); i++)
+      add_cell(ag, log[i].second, log[i].first);
+    ag->recovery_finalize();
+    return ag;
+  }
+
+  size_t count_cells(AccessGroupPtr &ag, SchemaPtr &schema) {
+    ScanContextPtr scan_ctx = new ScanContext(schema);
+    CellListScannerPtr scanner = ag->create_scanner(scan_ctx);
+    Key key;
+    ByteString value;
+    size_t count = 0;
+    while (scanner->get(key, value)) {
+      count++;
+      scanner->forward();
+    }
+    return count;
+  }
+}
+
+
+int main(int argc, char **argv) {
+  try {
+    struct sockaddr_in addr;
+    ConnectionManagerPtr conn_mgr;
+    DfsBroker::ClientPtr client;
+
+    Config::init(argc, argv);
+
+    if (Config::has("help"))
+      Usage::dump_and_exit(usage);
+
+    System::initialize(System::locate_install_dir(argv[0]));
+    ReactorFactory::initialize(2);
+
+    InetAddr::initialize(&addr, "localhost", DEFAULT_DFSBROKER_PORT);
+
+    conn_mgr = new ConnectionManager();
+    Global::dfs = new DfsBroker::Client(conn_mgr, addr, 15000);
+    Global::log_dfs = Global::dfs;
+
+    // force broker client to be destroyed before connection manager
+    client = (DfsBroker::Client *)Global::dfs;
+
+    if (!client->wait_for_connection(15000)) {
+      HT_ERROR("Unable to connect to DFS");
+      return 1;
+    }
+
+    String testdir = "/AccessGroupCheckpoint_test";
+    client->mkdirs(testdir);
+    Global::checkpoint_dir = testdir + "/checkpoint";
+
+    SchemaPtr schema = Schema::new_instance(schema_str, strlen(schema_str),
+                                            true);
+    if (!schema->is_valid()) {
+      HT_ERRORF("Schema Parse Error: %s", schema->get_error_string());
+      return 1;
+    }
+
+    TableIdentifier table("AccessGroupCheckpoint_test");
+    table.id = 42;
+    RangeSpec range("", Key::END_ROW_MARKER);
+    UpdateLog log;
+    AccessGroupPtr ag;
+
+    ag = new AccessGroup(&table, schema, schema->get_access_group("default"),
+                         &range);
+
+    // first checkpoint covers everything, so the whole log goes
+    update(ag, log, 0, 10);
+    HT_ASSERT(ag->snapshot_checkpoint());
+    ag->write_checkpoint();
+    purge(ag, log);
+    HT_ASSERT(log.empty());
+
+    // second checkpoint: purge while it is being written, then crash
+    update(ag, log, 10, 10);
+    HT_ASSERT(ag->snapshot_checkpoint());
+    purge(ag, log);
+    HT_ASSERT(log.size() == 10);
+    ag = 0;
+
+    ag = recover(&table, schema, &range, log);
+    HT_ASSERT(count_cells(ag, schema) == 20);
+
+    // updates that arrive during the write pin the log as well
+    HT_ASSERT(ag->snapshot_checkpoint());
+    update(ag, log, 20, 5);
+    purge(ag, log);
+    HT_ASSERT(log.size() == 15);
+    ag = 0;
+
+    ag = recover(&table, schema, &range, log);
+    HT_ASSERT(count_cells(ag, schema) == 25);
+
+    // once the checkpoint is in place, only the newer updates stay
+    HT_ASSERT(ag->snapshot_checkpoint());
+    ag->write_checkpoint();
+    update(ag, log, 25, 5);
+    purge(ag, log);
+    HT_ASSERT(log.size() == 5);
+    ag = 0;
+
+    ag = recover(&table, schema, &range, log);
+    HT_ASSERT(count_cells(ag, schema) == 30);
+    ag = 0;
+
+    client->rmdir(testdir);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    return 1;
+  }
+  catch (...) {
+    HT_ERROR_OUT << "unexpected exception caught" << HT_END;
+    return 1;
+  }
+  return 0;
+}
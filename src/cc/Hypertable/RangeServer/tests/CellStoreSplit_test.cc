@@ -0,0 +1,113 @@
+/**
+ * Copyright (C) 2009 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <algorithm>
+
+#include "Common/Config.h"
+#include "Common/Usage.h"
+
+#include "Hypertable/Lib/Key.h"
+
+#include "../LiveFileTracker.h"
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+  const char *usage[] = {
+    "usage: CellStoreSplit_test",
+    "",
+    "  This program tests that cell stores inherited from a split are",
+    "  marked in the 'Files' METADATA column and recognized again when",
+    "  the column is parsed on range load.",
+    (const char *)0
+  };
+
+  void parse(const String &files, size_t nlive, size_t ninherited,
+             bool blocked) {
+    std::vector<String> live;
+    std::set<String> inherited;
+    HT_ASSERT(LiveFileTracker::parse_file_list(files, live, inherited)
+              == blocked);
+    HT_ASSERT(live.size() == nlive);
+    HT_ASSERT(inherited.size() == ninherited);
+    foreach(const String &file, inherited)
+      HT_ASSERT(std::find(live.begin(), live.end(), file) != live.end());
+  }
+}
+
+
+int main(int argc, char **argv) {
+  try {
+    Config::init(argc, argv);
+
+    if (Config::has("help"))
+      Usage::dump_and_exit(usage);
+
+    TableIdentifier table("CellStoreSplit_test");
+    table.id = 42;
+    RangeSpec range("", Key::END_ROW_MARKER);
+    SchemaPtr schema;
+    String files;
+
+    LiveFileTracker tracker(&table, schema, &range, "default");
+    tracker.add_live("cs0");
+    tracker.add_live("cs1");
+
+    std::vector<String> refs;
+    refs.push_back("cs2");
+    tracker.add_references(refs);
+
+    // a column written before any split has no markers
+    tracker.get_file_list(files, false);
+    HT_ASSERT(files == "cs0;\ncs1;\n");
+    parse(files, 2, 0, false);
+
+    // both halves of a split mark every live store
+    tracker.get_file_list(files, false, true);
+    HT_ASSERT(files == "cs0;\ncs1;\n#+cs0;\n#+cs1;\n");
+    parse(files, 2, 2, false);
+
+    // files blocked from GC are never marked as inherited
+    tracker.get_file_list(files, true, true);
+    HT_ASSERT(files == "cs0;\ncs1;\n#+cs0;\n#+cs1;\n#cs2;\n");
+    parse(files, 2, 2, true);
+
+    // only stores that are still inherited and live are marked
+    std::set<String> inherited;
+    inherited.insert("cs0");
+    inherited.insert("cs2");
+    tracker.set_inherited(inherited);
+    tracker.get_file_list(files, true);
+    HT_ASSERT(files == "cs0;\ncs1;\n#+cs0;\n#cs2;\n");
+    parse(files, 2, 1, true);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    return 1;
+  }
+  catch (...) {
+    HT_ERROR_OUT << "unexpected exception caught" << HT_END;
+    return 1;
+  }
+  return 0;
+}
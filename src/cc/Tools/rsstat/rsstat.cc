@@ -21,6 +21,9 @@
  */
 
 #include "Common/Compat.h"
+
+#include <poll.h>
+
 #include "Common/InetAddr.h"
 #include "Common/Logger.h"
 
@@ -34,7 +37,28 @@
 using namespace Hypertable;
 using namespace Config;
 
-typedef Meta::list<RangeServerClientPolicy, DefaultCommPolicy> Policies;
+namespace {
+
+  const char *usage =
+    "Usage: rsstat [options]\n\n"
+    "Description:\n"
+    "  Prints the statistics of a range server.  Its counters are cumulative\n"
+    "  since server start; with --interval the server is polled twice and\n"
+    "  the activity in between is printed instead.\n\n"
+    "Options";
+
+  struct AppPolicy : Config::Policy {
+    static void init_options() {
+      cmdline_desc(usage).add_options()
+          ("interval", i32()->default_value(0),
+           "Print the activity over this many seconds");
+    }
+  };
+
+  typedef Meta::list<AppPolicy, RangeServerClientPolicy, DefaultCommPolicy>
+          Policies;
+
+} // local namespace
 
 int main(int argc, char **argv) {
   try {
@@ -44,6 +68,7 @@ int main(int argc, char **argv) {
     ConnectionManagerPtr conn_mgr = new ConnectionManager(comm);
     InetAddr addr(get_str("rs-host"), get_i16("rs-port"));
     int timeout = get_i32("timeout");
+    int interval = get_i32("interval");
 
     conn_mgr->add(addr, timeout, "Range Server");
 
@@ -56,6 +81,14 @@ int main(int argc, char **argv) {
 
     client->get_statistics(addr, stat);
 
+    if (interval > 0) {
+      RangeServerStat previous = stat;
+      poll(0, 0, interval * 1000);
+      stat = RangeServerStat();
+      client->get_statistics(addr, stat);
+      stat.subtract(previous);
+    }
+
     std::cout << stat << std::endl;
   }
   catch (Exception &e) {